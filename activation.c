@@ -0,0 +1,551 @@
+/**************************************************************************************************
+* activation.c: Innehller funktionsdefinitioner fr aktiveringsfunktioner samt motsvarande
+*               derivator. Sigmoid samt tanh berknas via e^x - 1 (expm1), vilket undviker
+*               kancellation nra noll: sigmoid(x) = 1 / (2 + expm1(-x)) samt
+*               tanh(x) = expm1(2x) / (expm1(2x) + 2). Funktionen expm1 berknas via reduktion
+*               x = n * ln(2) + r, dr |r| <= ln(2) / 2, varefter q = e^r - 1 approximeras via ett
+*               Taylorpolynom och e^x - 1 = 2^n * q + (2^n - 1). Samma algoritm anvnds av
+*               samtliga krnor.
+**************************************************************************************************/
+#include "activation.h"
+#include "simd.h"
+
+#include "simd_vector.h"
+
+/* Makrodefinitioner: */
+#define LEAKY_RELU_SLOPE 0.01          /* Lutning fr negativa insignaler vid leaky ReLU. */
+#define LOG2E 1.44269504088896340736   /* 1 / ln(2). */
+
+#ifdef ANN_FLOAT32
+#define EXP_MAX 88.0f                  /* Strsta insignal till expm1 (undviker overflow). */
+#define EXP_MIN -87.0f                 /* Minsta insignal till expm1 (undviker subnormala tal). */
+#define LN2_HI 0.693359375f            /* vre del av ln(2), exakt representerbar. */
+#define LN2_LO -2.12194440e-4f         /* Resterande del av ln(2). */
+#define EXP_DEGREE 7                   /* Gradtal fr polynomet som approximerar e^r - 1. */
+#else
+#define EXP_MAX 708.0
+#define EXP_MIN -708.0
+#define LN2_HI 6.93147180369123816490e-01
+#define LN2_LO 1.90821492927058770002e-10
+#define EXP_DEGREE 13
+#endif /* ANN_FLOAT32 */
+
+/**************************************************************************************************
+* exp_coefficients: Koefficienter 1 / k! (k = EXP_DEGREE, ..., 1) fr Taylorpolynomet, i
+*                   fallande ordning fr Horners metod. Konstanttermen utelmnas, eftersom
+*                   polynomet approximerar e^r - 1.
+**************************************************************************************************/
+static const real_t exp_coefficients[EXP_DEGREE] =
+{
+#ifndef ANN_FLOAT32
+   1.60590438368216145994e-10, 2.08767569878680989792e-09, 2.50521083854417187751e-08,
+   2.75573192239858906526e-07, 2.75573192239858906526e-06, 2.48015873015873015873e-05,
+#endif
+   1.98412698412698412698e-04, 1.38888888888888888889e-03, 8.33333333333333333333e-03,
+   4.16666666666666666667e-02, 1.66666666666666666667e-01, 5.00000000000000000000e-01,
+   1.0
+};
+
+/* Statiska funktioner: */
+static void apply_scalar(const enum activation activation, real_t* data, const real_t* bias,
+                         const size_t size);
+static void delta_scalar(const enum activation activation, real_t* error, const real_t* output,
+                         const size_t size);
+static real_t expm1_scalar(real_t x);
+
+#ifdef SIMD_X86
+static void apply_avx2(const enum activation activation, real_t* data, const real_t* bias,
+                       const size_t size);
+static void delta_avx2(const enum activation activation, real_t* error, const real_t* output,
+                       const size_t size);
+static void apply_avx512(const enum activation activation, real_t* data, const real_t* bias,
+                         const size_t size);
+static void delta_avx512(const enum activation activation, real_t* error, const real_t* output,
+                         const size_t size);
+#endif /* SIMD_X86 */
+
+/**************************************************************************************************
+* activation_apply: Adderar bias till angivna vrden och tillmpar drefter angiven
+*                   aktiveringsfunktion, s att data[i] = f(data[i] + bias[i]). Berkningskrnan
+*                   vljs en gng per anrop utefter den instruktionsuppsttning som anvnds i
+*                   simd.c. SSE2 saknar avrundning samt FMA och anvnder drmed den skalra krnan.
+*
+*                   - activation: Aktiveringsfunktionen som skall tillmpas.
+*                   - data      : Pekare till de vrden som skall uppdateras.
+*                   - bias      : Pekare till biasvrden fr respektive element.
+*                   - size      : Antalet element.
+**************************************************************************************************/
+void activation_apply(const enum activation activation,
+                      real_t* data,
+                      const real_t* bias,
+                      const size_t size)
+{
+#ifdef SIMD_X86
+   const enum simd_isa isa = simd_get_isa();
+   if (isa == SIMD_ISA_AVX512) apply_avx512(activation, data, bias, size);
+   else if (isa == SIMD_ISA_AVX2) apply_avx2(activation, data, bias, size);
+   else apply_scalar(activation, data, bias, size);
+#else
+   apply_scalar(activation, data, bias, size);
+#endif /* SIMD_X86 */
+   return;
+}
+
+/**************************************************************************************************
+* activation_delta: Multiplicerar angivna avvikelser med derivatan av angiven aktiverings-
+*                   funktion. Derivatan berknas utifrn nodernas utsignaler, vilket r mjligt
+*                   fr samtliga aktiveringsfunktioner, exempelvis sigmoid'(x) = y * (1 - y).
+*
+*                   - activation: Aktiveringsfunktionen som har anvnts vid feedforward.
+*                   - error     : Pekare till de avvikelser som skall uppdateras.
+*                   - output    : Pekare till nodernas utsignaler.
+*                   - size      : Antalet element.
+**************************************************************************************************/
+void activation_delta(const enum activation activation,
+                      real_t* error,
+                      const real_t* output,
+                      const size_t size)
+{
+   if (activation == ACTIVATION_LINEAR) return;
+#ifdef SIMD_X86
+   const enum simd_isa isa = simd_get_isa();
+   if (isa == SIMD_ISA_AVX512) delta_avx512(activation, error, output, size);
+   else if (isa == SIMD_ISA_AVX2) delta_avx2(activation, error, output, size);
+   else delta_scalar(activation, error, output, size);
+#else
+   delta_scalar(activation, error, output, size);
+#endif /* SIMD_X86 */
+   return;
+}
+
+/**************************************************************************************************
+* activation_valid: Indikerar ifall angivet vrde motsvarar en befintlig aktiveringsfunktion.
+*
+*                   - activation: Vrdet som skall kontrolleras.
+**************************************************************************************************/
+bool activation_valid(const enum activation activation)
+{
+   return activation >= ACTIVATION_RELU && activation <= ACTIVATION_LINEAR;
+}
+
+/**************************************************************************************************
+* activation_name: Returnerar namnet p angiven aktiveringsfunktion.
+*
+*                  - activation: Aktiveringsfunktionen vars namn skall returneras.
+**************************************************************************************************/
+const char* activation_name(const enum activation activation)
+{
+   switch (activation)
+   {
+      case ACTIVATION_RELU: return "relu";
+      case ACTIVATION_LEAKY_RELU: return "leaky_relu";
+      case ACTIVATION_SIGMOID: return "sigmoid";
+      case ACTIVATION_TANH: return "tanh";
+      case ACTIVATION_LINEAR: return "linear";
+   }
+   return "unknown";
+}
+
+/**************************************************************************************************
+* apply_scalar, delta_scalar: Portabla skalra berkningskrnor.
+**************************************************************************************************/
+static void apply_scalar(const enum activation activation, real_t* data, const real_t* bias,
+                         const size_t size)
+{
+   switch (activation)
+   {
+      case ACTIVATION_RELU:
+         for (size_t i = 0; i < size; ++i)
+         {
+            const real_t x = bias[i] + data[i];
+            data[i] = x > 0.0 ? x : 0.0;
+         }
+         break;
+      case ACTIVATION_LEAKY_RELU:
+         for (size_t i = 0; i < size; ++i)
+         {
+            const real_t x = bias[i] + data[i];
+            data[i] = x > 0.0 ? x : (real_t)LEAKY_RELU_SLOPE * x;
+         }
+         break;
+      case ACTIVATION_SIGMOID:
+         for (size_t i = 0; i < size; ++i)
+         {
+            data[i] = 1 / (2 + expm1_scalar(-(bias[i] + data[i])));
+         }
+         break;
+      case ACTIVATION_TANH:
+         for (size_t i = 0; i < size; ++i)
+         {
+            const real_t m = expm1_scalar(2 * (bias[i] + data[i]));
+            data[i] = m / (m + 2);
+         }
+         break;
+      case ACTIVATION_LINEAR:
+         for (size_t i = 0; i < size; ++i)
+         {
+            data[i] += bias[i];
+         }
+         break;
+   }
+   return;
+}
+
+static void delta_scalar(const enum activation activation, real_t* error, const real_t* output,
+                         const size_t size)
+{
+   switch (activation)
+   {
+      case ACTIVATION_RELU:
+         for (size_t i = 0; i < size; ++i)
+         {
+            error[i] *= output[i] > 0.0 ? 1.0 : 0.0;
+         }
+         break;
+      case ACTIVATION_LEAKY_RELU:
+         for (size_t i = 0; i < size; ++i)
+         {
+            error[i] *= output[i] > 0.0 ? 1.0 : (real_t)LEAKY_RELU_SLOPE;
+         }
+         break;
+      case ACTIVATION_SIGMOID:
+         for (size_t i = 0; i < size; ++i)
+         {
+            error[i] *= output[i] * (1 - output[i]);
+         }
+         break;
+      case ACTIVATION_TANH:
+         for (size_t i = 0; i < size; ++i)
+         {
+            error[i] *= 1 - output[i] * output[i];
+         }
+         break;
+      case ACTIVATION_LINEAR:
+         break;
+   }
+   return;
+}
+
+/**************************************************************************************************
+* expm1_scalar: Returnerar en approximation av e^x - 1, dr x begrnsas till [EXP_MIN, EXP_MAX].
+*               Heltalet n avrundas bort frn noll, vilket enbart pverkar valet mellan tv
+*               likvrdiga reduktioner d |r| = ln(2) / 2.
+*
+*               - x: Exponenten.
+**************************************************************************************************/
+static real_t expm1_scalar(real_t x)
+{
+   x = x < EXP_MAX ? x : EXP_MAX;
+   x = x > EXP_MIN ? x : EXP_MIN;
+
+   const real_t product = x * (real_t)LOG2E;
+   const int32_t n = (int32_t)(product < 0 ? product - 0.5 : product + 0.5);
+   const real_t r = (x - n * LN2_HI) - n * LN2_LO;
+   real_t p = exp_coefficients[0];
+
+   for (size_t i = 1; i < EXP_DEGREE; ++i)
+   {
+      p = p * r + exp_coefficients[i];
+   }
+
+#ifdef ANN_FLOAT32
+   const uint32_t bits = (uint32_t)(n + 127) << 23;
+#else
+   const uint64_t bits = (uint64_t)(n + 1023) << 52;
+#endif /* ANN_FLOAT32 */
+   real_t scale;
+   memcpy(&scale, &bits, sizeof(scale));
+   return scale * (p * r) + (scale - 1);
+}
+
+#ifdef SIMD_X86
+
+/**************************************************************************************************
+* expm1_avx2, expm1_avx512: Returnerar en approximation av e^x - 1 fr varje element i angiven
+*                           vektor, enligt samma algoritm som expm1_scalar. AVX-512 skapar 2^n
+*                           via vscalef, medan AVX2 skapar 2^n direkt via exponentfltet.
+**************************************************************************************************/
+__attribute__((target("avx2,fma")))
+static inline V256 expm1_avx2(V256 x)
+{
+   x = v256_max(v256_min(x, v256_set1(EXP_MAX)), v256_set1(EXP_MIN));
+   const V256 n = v256_round(v256_mul(x, v256_set1((real_t)LOG2E)));
+   const V256 r = v256_fnmadd(n, v256_set1(LN2_LO), v256_fnmadd(n, v256_set1(LN2_HI), x));
+   const V256 scale = v256_pow2n(n);
+   V256 p = v256_set1(exp_coefficients[0]);
+
+   for (size_t i = 1; i < EXP_DEGREE; ++i)
+   {
+      p = v256_fmadd(p, r, v256_set1(exp_coefficients[i]));
+   }
+   return v256_fmadd(scale, v256_mul(p, r), v256_sub(scale, v256_set1(1.0)));
+}
+
+__attribute__((target("avx512f")))
+static inline V512 expm1_avx512(V512 x)
+{
+   x = v512_max(v512_min(x, v512_set1(EXP_MAX)), v512_set1(EXP_MIN));
+   const V512 n = v512_round(v512_mul(x, v512_set1((real_t)LOG2E)));
+   const V512 r = v512_fnmadd(n, v512_set1(LN2_LO), v512_fnmadd(n, v512_set1(LN2_HI), x));
+   const V512 scale = v512_scalef(v512_set1(1.0), n);
+   V512 p = v512_set1(exp_coefficients[0]);
+
+   for (size_t i = 1; i < EXP_DEGREE; ++i)
+   {
+      p = v512_fmadd(p, r, v512_set1(exp_coefficients[i]));
+   }
+   return v512_fmadd(scale, v512_mul(p, r), v512_sub(scale, v512_set1(1.0)));
+}
+
+/**************************************************************************************************
+* apply_avx2, delta_avx2: Berkningskrnor fr 256-bitars vektorer med FMA. Aktiverings-
+*                         funktionen vljs en gng, varefter en separat loop anvnds fr
+*                         respektive funktion. Resterande element kopieras till en utfylld
+*                         buffert och berknas via samma krna, s att samtliga element ger
+*                         identiska resultat oavsett position.
+**************************************************************************************************/
+__attribute__((target("avx2,fma")))
+static void apply_avx2(const enum activation activation, real_t* data, const real_t* bias,
+                       const size_t size)
+{
+   const V256 zero = v256_zero();
+   const V256 one = v256_set1(1.0);
+   const V256 two = v256_set1(2.0);
+   const V256 slope = v256_set1(LEAKY_RELU_SLOPE);
+   size_t i = 0;
+
+   switch (activation)
+   {
+      case ACTIVATION_RELU:
+         for (; i + V256_LANES <= size; i += V256_LANES)
+         {
+            const V256 x = v256_add(v256_loadu(bias + i), v256_loadu(data + i));
+            v256_storeu(data + i, v256_max(x, zero));
+         }
+         break;
+      case ACTIVATION_LEAKY_RELU:
+         for (; i + V256_LANES <= size; i += V256_LANES)
+         {
+            const V256 x = v256_add(v256_loadu(bias + i), v256_loadu(data + i));
+            v256_storeu(data + i, v256_blendv(v256_mul(slope, x), x, v256_cmpgt(x, zero)));
+         }
+         break;
+      case ACTIVATION_SIGMOID:
+         for (; i + V256_LANES <= size; i += V256_LANES)
+         {
+            const V256 x = v256_add(v256_loadu(bias + i), v256_loadu(data + i));
+            v256_storeu(data + i, v256_div(one, v256_add(two, expm1_avx2(v256_sub(zero, x)))));
+         }
+         break;
+      case ACTIVATION_TANH:
+         for (; i + V256_LANES <= size; i += V256_LANES)
+         {
+            const V256 x = v256_add(v256_loadu(bias + i), v256_loadu(data + i));
+            const V256 m = expm1_avx2(v256_mul(two, x));
+            v256_storeu(data + i, v256_div(m, v256_add(m, two)));
+         }
+         break;
+      case ACTIVATION_LINEAR:
+         for (; i + V256_LANES <= size; i += V256_LANES)
+         {
+            v256_storeu(data + i, v256_add(v256_loadu(bias + i), v256_loadu(data + i)));
+         }
+         break;
+   }
+
+   if (i < size)
+   {
+      real_t buffer[V256_LANES] = { 0 };
+      real_t buffer_bias[V256_LANES] = { 0 };
+      memcpy(buffer, data + i, sizeof(real_t) * (size - i));
+      memcpy(buffer_bias, bias + i, sizeof(real_t) * (size - i));
+      apply_avx2(activation, buffer, buffer_bias, V256_LANES);
+      memcpy(data + i, buffer, sizeof(real_t) * (size - i));
+   }
+   return;
+}
+
+__attribute__((target("avx2,fma")))
+static void delta_avx2(const enum activation activation, real_t* error, const real_t* output,
+                       const size_t size)
+{
+   const V256 zero = v256_zero();
+   const V256 one = v256_set1(1.0);
+   const V256 slope = v256_set1(LEAKY_RELU_SLOPE);
+   size_t i = 0;
+
+   switch (activation)
+   {
+      case ACTIVATION_RELU:
+         for (; i + V256_LANES <= size; i += V256_LANES)
+         {
+            const V256 y = v256_loadu(output + i);
+            const V256 derivative = v256_blendv(zero, one, v256_cmpgt(y, zero));
+            v256_storeu(error + i, v256_mul(v256_loadu(error + i), derivative));
+         }
+         break;
+      case ACTIVATION_LEAKY_RELU:
+         for (; i + V256_LANES <= size; i += V256_LANES)
+         {
+            const V256 y = v256_loadu(output + i);
+            const V256 derivative = v256_blendv(slope, one, v256_cmpgt(y, zero));
+            v256_storeu(error + i, v256_mul(v256_loadu(error + i), derivative));
+         }
+         break;
+      case ACTIVATION_SIGMOID:
+         for (; i + V256_LANES <= size; i += V256_LANES)
+         {
+            const V256 y = v256_loadu(output + i);
+            const V256 derivative = v256_mul(y, v256_sub(one, y));
+            v256_storeu(error + i, v256_mul(v256_loadu(error + i), derivative));
+         }
+         break;
+      case ACTIVATION_TANH:
+         for (; i + V256_LANES <= size; i += V256_LANES)
+         {
+            const V256 y = v256_loadu(output + i);
+            const V256 derivative = v256_fnmadd(y, y, one);
+            v256_storeu(error + i, v256_mul(v256_loadu(error + i), derivative));
+         }
+         break;
+      case ACTIVATION_LINEAR:
+         return;
+   }
+
+   if (i < size)
+   {
+      real_t buffer[V256_LANES] = { 0 };
+      real_t buffer_output[V256_LANES] = { 0 };
+      memcpy(buffer, error + i, sizeof(real_t) * (size - i));
+      memcpy(buffer_output, output + i, sizeof(real_t) * (size - i));
+      delta_avx2(activation, buffer, buffer_output, V256_LANES);
+      memcpy(error + i, buffer, sizeof(real_t) * (size - i));
+   }
+   return;
+}
+
+/**************************************************************************************************
+* apply_avx512, delta_avx512: Berkningskrnor fr 512-bitars vektorer, uppbyggda likt
+*                             motsvarande krnor fr AVX2.
+**************************************************************************************************/
+__attribute__((target("avx512f")))
+static void apply_avx512(const enum activation activation, real_t* data, const real_t* bias,
+                         const size_t size)
+{
+   const V512 zero = v512_zero();
+   const V512 one = v512_set1(1.0);
+   const V512 two = v512_set1(2.0);
+   const V512 slope = v512_set1(LEAKY_RELU_SLOPE);
+   size_t i = 0;
+
+   switch (activation)
+   {
+      case ACTIVATION_RELU:
+         for (; i + V512_LANES <= size; i += V512_LANES)
+         {
+            const V512 x = v512_add(v512_loadu(bias + i), v512_loadu(data + i));
+            v512_storeu(data + i, v512_max(x, zero));
+         }
+         break;
+      case ACTIVATION_LEAKY_RELU:
+         for (; i + V512_LANES <= size; i += V512_LANES)
+         {
+            const V512 x = v512_add(v512_loadu(bias + i), v512_loadu(data + i));
+            v512_storeu(data + i, v512_mask_blend(v512_cmpgt_mask(x, zero), v512_mul(slope, x), x));
+         }
+         break;
+      case ACTIVATION_SIGMOID:
+         for (; i + V512_LANES <= size; i += V512_LANES)
+         {
+            const V512 x = v512_add(v512_loadu(bias + i), v512_loadu(data + i));
+            v512_storeu(data + i, v512_div(one, v512_add(two, expm1_avx512(v512_sub(zero, x)))));
+         }
+         break;
+      case ACTIVATION_TANH:
+         for (; i + V512_LANES <= size; i += V512_LANES)
+         {
+            const V512 x = v512_add(v512_loadu(bias + i), v512_loadu(data + i));
+            const V512 m = expm1_avx512(v512_mul(two, x));
+            v512_storeu(data + i, v512_div(m, v512_add(m, two)));
+         }
+         break;
+      case ACTIVATION_LINEAR:
+         for (; i + V512_LANES <= size; i += V512_LANES)
+         {
+            v512_storeu(data + i, v512_add(v512_loadu(bias + i), v512_loadu(data + i)));
+         }
+         break;
+   }
+
+   if (i < size)
+   {
+      real_t buffer[V512_LANES] = { 0 };
+      real_t buffer_bias[V512_LANES] = { 0 };
+      memcpy(buffer, data + i, sizeof(real_t) * (size - i));
+      memcpy(buffer_bias, bias + i, sizeof(real_t) * (size - i));
+      apply_avx512(activation, buffer, buffer_bias, V512_LANES);
+      memcpy(data + i, buffer, sizeof(real_t) * (size - i));
+   }
+   return;
+}
+
+__attribute__((target("avx512f")))
+static void delta_avx512(const enum activation activation, real_t* error, const real_t* output,
+                         const size_t size)
+{
+   const V512 zero = v512_zero();
+   const V512 one = v512_set1(1.0);
+   const V512 slope = v512_set1(LEAKY_RELU_SLOPE);
+   size_t i = 0;
+
+   switch (activation)
+   {
+      case ACTIVATION_RELU:
+         for (; i + V512_LANES <= size; i += V512_LANES)
+         {
+            const V512 y = v512_loadu(output + i);
+            const V512 derivative = v512_mask_blend(v512_cmpgt_mask(y, zero), zero, one);
+            v512_storeu(error + i, v512_mul(v512_loadu(error + i), derivative));
+         }
+         break;
+      case ACTIVATION_LEAKY_RELU:
+         for (; i + V512_LANES <= size; i += V512_LANES)
+         {
+            const V512 y = v512_loadu(output + i);
+            const V512 derivative = v512_mask_blend(v512_cmpgt_mask(y, zero), slope, one);
+            v512_storeu(error + i, v512_mul(v512_loadu(error + i), derivative));
+         }
+         break;
+      case ACTIVATION_SIGMOID:
+         for (; i + V512_LANES <= size; i += V512_LANES)
+         {
+            const V512 y = v512_loadu(output + i);
+            const V512 derivative = v512_mul(y, v512_sub(one, y));
+            v512_storeu(error + i, v512_mul(v512_loadu(error + i), derivative));
+         }
+         break;
+      case ACTIVATION_TANH:
+         for (; i + V512_LANES <= size; i += V512_LANES)
+         {
+            const V512 y = v512_loadu(output + i);
+            const V512 derivative = v512_fnmadd(y, y, one);
+            v512_storeu(error + i, v512_mul(v512_loadu(error + i), derivative));
+         }
+         break;
+      case ACTIVATION_LINEAR:
+         return;
+   }
+
+   if (i < size)
+   {
+      real_t buffer[V512_LANES] = { 0 };
+      real_t buffer_output[V512_LANES] = { 0 };
+      memcpy(buffer, error + i, sizeof(real_t) * (size - i));
+      memcpy(buffer_output, output + i, sizeof(real_t) * (size - i));
+      delta_avx512(activation, buffer, buffer_output, V512_LANES);
+      memcpy(error + i, buffer, sizeof(real_t) * (size - i));
+   }
+   return;
+}
+
+#endif /* SIMD_X86 */
@@ -0,0 +1,43 @@
+/**************************************************************************************************
+* activation.h: Innehller aktiveringsfunktioner fr dense-lager samt motsvarande derivator.
+*               Aktiveringsfunktionen vljs per lager och tillmpas p samtliga noder i lagret
+*               via ett enda anrop, dr valet av funktion samt instruktionsuppsttning sker en
+*               gng per anrop i stllet fr en gng per nod. Sigmoid samt tanh berknas via en
+*               polynomapproximation av exponentialfunktionen, vilket mjliggr vektorisering
+*               med AVX2 samt AVX-512 i stllet fr ett anrop av exp per element.
+*
+*               Sigmoid samt tanh avviker relativt hgst 1e-15 vid dubbel precision samt 3e-7
+*               vid enkel precision frn motsvarande exakta vrden, dvs. ett ftal enheter i
+*               sista siffran, ven nra noll.
+**************************************************************************************************/
+#ifndef ACTIVATION_H_
+#define ACTIVATION_H_
+
+/* Inkluderingsdirektiv: */
+#include "def.h"
+
+/**************************************************************************************************
+* activation: Aktiveringsfunktioner som kan vljas fr respektive dense-lager.
+**************************************************************************************************/
+enum activation
+{
+   ACTIVATION_RELU,       /* max(x, 0), default fr samtliga lager. */
+   ACTIVATION_LEAKY_RELU, /* x fr x > 0, annars 0.01 * x. */
+   ACTIVATION_SIGMOID,    /* 1 / (1 + e^-x). */
+   ACTIVATION_TANH,       /* (e^x - e^-x) / (e^x + e^-x). */
+   ACTIVATION_LINEAR      /* x, exempelvis fr regression i utgngslagret. */
+};
+
+/* Externa funktioner: */
+void activation_apply(const enum activation activation,
+                      real_t* data,
+                      const real_t* bias,
+                      const size_t size);
+void activation_delta(const enum activation activation,
+                      real_t* error,
+                      const real_t* output,
+                      const size_t size);
+bool activation_valid(const enum activation activation);
+const char* activation_name(const enum activation activation);
+
+#endif /* ACTIVATION_H_ */
@@ -0,0 +1,206 @@
+/**************************************************************************************************
+* allocator.c: Innehller funktionsdefinitioner fr allokering av minne via aktiv arena eller
+*              via heapen. Varje minnesblock fregs av ett huvud som anger vilken arena (om
+*              ngon) minnesblocket tillhr, s att minnet kan frigras eller omallokeras utan
+*              att arenorna behver genomskas.
+**************************************************************************************************/
+#include "allocator.h"
+#include "arena.h"
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+#ifdef ANN_MEMORY_DEBUG
+#include <stdatomic.h>
+#endif
+
+/* Makrodefinitioner: */
+#define ALLOCATOR_HEADER_SIZE 16 /* Huvudets storlek i byte vid allokering p heapen. */
+
+/**************************************************************************************************
+* allocator_header: Huvud som lagras direkt fre varje minnesblock.
+**************************************************************************************************/
+struct allocator_header
+{
+   struct arena* arena; /* Arenan som minnesblocket tillhr (null = heapen). */
+   size_t offset;       /* Avstnd i byte frn allokeringens start till minnesblocket. */
+};
+
+_Static_assert(sizeof(struct allocator_header) <= ALLOCATOR_HEADER_SIZE, "Header too large!");
+
+/* Statiska funktioner: */
+static inline void count_allocation(void);
+static inline struct allocator_header* get_header(const void* data);
+static void* attach_header(void* base,
+                           struct arena* arena,
+                           const size_t offset);
+
+/* Statiska variabler: */
+#ifdef ANN_MEMORY_DEBUG
+static atomic_size_t num_allocations = 0; /* Antalet allokeringar sedan programmets start. */
+#endif
+
+/**************************************************************************************************
+* allocator_alloc: Returnerar en pekare till ett minnesblock av angiven storlek, allokerat ur
+*                  aktiv arena eller p heapen. Returnerar null ifall minnesallokering
+*                  misslyckas.
+*
+*                  - size: Minnesblockets storlek i byte.
+**************************************************************************************************/
+void* allocator_alloc(const size_t size)
+{
+   struct arena* arena = arena_current();
+   count_allocation();
+
+   if (arena)
+   {
+      return attach_header(arena_alloc(arena, ARENA_ALIGNMENT + size, ARENA_ALIGNMENT),
+                           arena, ARENA_ALIGNMENT);
+   }
+   return attach_header(malloc(ALLOCATOR_HEADER_SIZE + size), 0, ALLOCATOR_HEADER_SIZE);
+}
+
+/**************************************************************************************************
+* allocator_realloc: ndrar storleken p angivet minnesblock och returnerar en pekare till
+*                    minnesblocket. Ett minnesblock som tillhr en arena omallokeras i samma
+*                    arena, vriga minnesblock omallokeras p heapen. Vid null allokeras ett
+*                    nytt minnesblock likt funktionen allocator_alloc. Returnerar null ifall
+*                    minnesallokering misslyckas, varvid det gamla minnesblocket behlls.
+*
+*                    - data    : Pekare till minnesblocket (eller null).
+*                    - old_size: Minnesblockets nuvarande storlek i byte.
+*                    - new_size: Minnesblockets nya storlek i byte.
+**************************************************************************************************/
+void* allocator_realloc(void* data,
+                        const size_t old_size,
+                        const size_t new_size)
+{
+   if (!data) return allocator_alloc(new_size);
+   const struct allocator_header* header = get_header(data);
+   struct arena* arena = header->arena;
+   const size_t offset = header->offset;
+   uint8_t* base = (uint8_t*)data - offset;
+   count_allocation();
+
+   if (arena)
+   {
+      return attach_header(arena_realloc(arena, base, offset + old_size, offset + new_size, offset),
+                           arena, offset);
+   }
+   return attach_header(realloc(base, offset + new_size), 0, offset);
+}
+
+/**************************************************************************************************
+* allocator_free: Frigr angivet minnesblock allokerat via funktionen allocator_alloc eller
+*                 allocator_realloc. Minnesblock som tillhr en arena frigrs frst nr arenan
+*                 raderas.
+*
+*                 - data: Pekare till minnesblocket (eller null).
+**************************************************************************************************/
+void allocator_free(void* data)
+{
+   if (!data) return;
+   const struct allocator_header* header = get_header(data);
+   if (!header->arena) free((uint8_t*)data - header->offset);
+   return;
+}
+
+/**************************************************************************************************
+* allocator_aligned_alloc: Returnerar en pekare till ett minnesblock av angiven storlek, justerat
+*                          till angiven justering, allokerat ur aktiv arena eller p heapen.
+*                          Storleken mste utgra en multipel av justeringen. Returnerar null
+*                          ifall minnesallokering misslyckas.
+*
+*                          - alignment: Minnesblockets justering i byte (en tvpotens).
+*                          - size     : Minnesblockets storlek i byte.
+**************************************************************************************************/
+void* allocator_aligned_alloc(const size_t alignment,
+                              const size_t size)
+{
+   struct arena* arena = arena_current();
+   const size_t offset = alignment > ALLOCATOR_HEADER_SIZE ? alignment : ALLOCATOR_HEADER_SIZE;
+   count_allocation();
+   if (arena) return attach_header(arena_alloc(arena, offset + size, offset), arena, offset);
+#ifdef _WIN32
+   return attach_header(_aligned_malloc(offset + size, offset), 0, offset);
+#else
+   return attach_header(aligned_alloc(offset, offset + size), 0, offset);
+#endif
+}
+
+/**************************************************************************************************
+* allocator_aligned_free: Frigr angivet minnesblock allokerat via funktionen
+*                         allocator_aligned_alloc. Minnesblock som tillhr en arena frigrs
+*                         frst nr arenan raderas.
+*
+*                         - data: Pekare till minnesblocket (eller null).
+**************************************************************************************************/
+void allocator_aligned_free(void* data)
+{
+   if (!data) return;
+   const struct allocator_header* header = get_header(data);
+   if (header->arena) return;
+#ifdef _WIN32
+   _aligned_free((uint8_t*)data - header->offset);
+#else
+   free((uint8_t*)data - header->offset);
+#endif
+   return;
+}
+
+/**************************************************************************************************
+* allocator_num_allocations: Returnerar antalet allokeringar samt omallokeringar som har
+*                            genomfrts via funktionerna ovan sedan programmets start, eller 0
+*                            ifall makrot ANN_MEMORY_DEBUG inte r definierat.
+**************************************************************************************************/
+size_t allocator_num_allocations(void)
+{
+#ifdef ANN_MEMORY_DEBUG
+   return atomic_load_explicit(&num_allocations, memory_order_relaxed);
+#else
+   return 0;
+#endif
+}
+
+/**************************************************************************************************
+* count_allocation: Rknar en allokering ifall makrot ANN_MEMORY_DEBUG r definierat.
+**************************************************************************************************/
+static inline void count_allocation(void)
+{
+#ifdef ANN_MEMORY_DEBUG
+   atomic_fetch_add_explicit(&num_allocations, 1, memory_order_relaxed);
+#endif
+   return;
+}
+
+/**************************************************************************************************
+* get_header: Returnerar en pekare till huvudet fr angivet minnesblock.
+*
+*             - data: Pekare till minnesblocket.
+**************************************************************************************************/
+static inline struct allocator_header* get_header(const void* data)
+{
+   return (struct allocator_header*)data - 1;
+}
+
+/**************************************************************************************************
+* attach_header: Lagrar ett huvud direkt fre minnesblocket i angiven allokering och returnerar
+*                en pekare till minnesblocket, som brjar angivet antal byte in i allokeringen.
+*                Returnerar null ifall allokeringen misslyckades.
+*
+*                - base  : Pekare till allokeringens start (null = misslyckad allokering).
+*                - arena : Arenan som allokeringen tillhr (null = heapen).
+*                - offset: Avstnd i byte frn allokeringens start till minnesblocket.
+**************************************************************************************************/
+static void* attach_header(void* base,
+                           struct arena* arena,
+                           const size_t offset)
+{
+   if (!base) return 0;
+   void* data = (uint8_t*)base + offset;
+   struct allocator_header* header = get_header(data);
+   header->arena = arena;
+   header->offset = offset;
+   return data;
+}
@@ -0,0 +1,30 @@
+/**************************************************************************************************
+* allocator.h: Innehller funktioner fr allokering av minne till programmets vektorer och
+*              matriser. Ifall en arena r aktiv fr anropande trd (se arena.h) delas minnet
+*              ut ur arenan, annars allokeras minnet p heapen. Minne som tillhr en arena
+*              frigrs enbart nr arenan raderas, oavsett vilken trd eller arena som r aktiv
+*              nr minnet frigrs eller omallokeras.
+*
+*              Vid kompilering med makrot ANN_MEMORY_DEBUG definierat rknas samtliga
+*              allokeringar och omallokeringar, vilket exempelvis kan anvndas fr att verifiera
+*              att trningen inte allokerar ngot minne, exempelvis via kommandot
+*              $ gcc *.c -o main -Wall -pthread -DANN_MEMORY_DEBUG
+**************************************************************************************************/
+#ifndef ALLOCATOR_H_
+#define ALLOCATOR_H_
+
+/* Inkluderingsdirektiv: */
+#include "def.h"
+
+/* Externa funktioner: */
+void* allocator_alloc(const size_t size);
+void* allocator_realloc(void* data,
+                        const size_t old_size,
+                        const size_t new_size);
+void allocator_free(void* data);
+void* allocator_aligned_alloc(const size_t alignment,
+                              const size_t size);
+void allocator_aligned_free(void* data);
+size_t allocator_num_allocations(void);
+
+#endif /* ALLOCATOR_H_ */
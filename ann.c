@@ -2,14 +2,100 @@
 * ann.c: Innehller funktionsdefinitioner som anvnds fr implementering av neurala ntverk.
 **************************************************************************************************/
 #include "ann.h"
+#include "dense_layer_batch.h"
+#include "simd.h"
+#include "allocator.h"
+#include "data_stream.h"
+#include "gemm.h"
+
+#include <pthread.h>
+#include <unistd.h>
+
+/**************************************************************************************************
+* ann_worker: Arbetsminne fr en trd vid parallell trning. Trdens ntverk delar vikter samt
+*             bias med det ursprungliga ntverket, men har egna utsignaler samt avvikelser.
+**************************************************************************************************/
+struct ann_worker
+{
+   struct ann replica;        /* Trdens ntverk, vars lager delar vikter med originalet. */
+   const struct ann* network; /* Pekare till det ursprungliga ntverket (trningsdata). */
+   size_t begin;              /* Index fr trdens frsta trningsuppsttning i ordningsfljden. */
+   size_t end;                /* Index efter trdens sista trningsuppsttning. */
+   double learning_rate;      /* Lrhastigheten, avgr justeringsgraden vid avvikelse. */
+   pthread_t thread;          /* Trden som genomfr trningen. */
+   bool started;              /* Indikerar ifall trden har startats. */
+};
+
+/**************************************************************************************************
+* ann_sync_worker: Arbetsminne fr en trd vid synkron dataparallell trning. Varje trd
+*                  berknar gradienter fr sin andel av aktuell batch i egna gradientbuffertar.
+**************************************************************************************************/
+struct ann_sync_worker
+{
+   struct dense_layer_batch* batches; /* Trdens arbetsminne samt gradienter per lager. */
+   struct double_matrix input;        /* Indata fr trdens andel av aktuell batch. */
+   struct double_matrix reference;    /* Referensvrden fr trdens andel av aktuell batch. */
+   struct ann_sync* shared;           /* Pekare till tillstnd som delas av samtliga trdar. */
+   size_t index;                      /* Trdens index, dr index 0 utgr anropande trd. */
+   pthread_t thread;                  /* Trden som genomfr berkningarna. */
+};
+
+/**************************************************************************************************
+* ann_sync: Tillstnd som delas av samtliga trdar vid synkron dataparallell trning.
+**************************************************************************************************/
+struct ann_sync
+{
+   struct ann* network;             /* Pekare till det neurala ntverket som trnas. */
+   struct ann_sync_worker* workers; /* Flt innehllande arbetsminne fr respektive trd. */
+   size_t num_workers;              /* Antalet trdar som deltar i berkningarna. */
+   size_t begin;                    /* Index fr batchens frsta uppsttning i ordningsfljden. */
+   size_t num_samples;              /* Antalet trningsuppsttningar i aktuell batch. */
+   bool stop;                       /* Indikerar ifall trdarna skall avslutas. */
+   pthread_barrier_t barrier;       /* Barrir som synkroniserar trdarna infr varje steg. */
+   pthread_mutex_t mutex;           /* Ls som hindrar trdarna frn att starta fr tidigt. */
+};
 
 /* Statiska funktioner: */
+static void ann_unmap(struct ann* self);
+static bool is_mapped(const void* data,
+                      const struct file_map* map);
+static void ann_train_epoch(struct ann* self,
+                            struct training_data* data,
+                            const double learning_rate);
 static void ann_feedforward(struct ann* self, 
                             const struct double_vector* input);
-static void ann_backpropagate(struct ann* self, 
-                              const struct double_vector* reference);
-static void ann_optimize(struct ann* self,
-                         const double learning_rate);
+static void ann_backpropagate_optimize(struct ann* self,
+                                       const struct double_vector* reference,
+                                       const double learning_rate);
+static void ann_batch_gradients(struct ann* self,
+                                struct dense_layer_batch* batches,
+                                const struct double_matrix* input,
+                                const struct double_matrix* reference,
+                                const size_t num_samples);
+static void ann_batch_optimize(struct ann* self,
+                               const struct dense_layer_batch* batches,
+                               const double learning_rate);
+static struct dense_layer_batch* ann_batches_new(const struct ann* self,
+                                                 const size_t batch_size);
+static void ann_batches_delete(const struct ann* self,
+                               struct dense_layer_batch* batches);
+static int ann_sync_worker_new(struct ann_sync_worker* self,
+                               struct ann_sync* shared,
+                               const size_t index,
+                               const size_t batch_size);
+static void ann_sync_worker_delete(struct ann_sync_worker* self);
+static void ann_sync_worker_step(struct ann_sync_worker* self);
+static void* ann_sync_worker_run(void* arg);
+static int ann_worker_new(struct ann_worker* self,
+                          const struct ann* network);
+static void ann_worker_delete(struct ann_worker* self);
+static void* ann_worker_train(void* arg);
+static int replica_new(struct dense_layer* self,
+                       const struct dense_layer* source);
+static void replica_delete(struct dense_layer* self);
+static void copy_row(real_t* destination,
+                     const struct double_vector* source,
+                     const size_t size);
 static void print_line(const struct double_vector* self, 
                        FILE* ostream, 
                        const double threshold);
@@ -32,6 +118,8 @@ void ann_new(struct ann* self,
    self->num_inputs = num_inputs;
    self->num_outputs = num_outputs;
    self->input_layer = 0;
+   self->map.data = 0;
+   self->map.size = 0;
 
    dense_layer_new(&self->output_layer, self->num_outputs, num_hidden);
    training_data_new(&self->training_data, self->num_inputs, self->num_outputs);
@@ -48,6 +136,7 @@ void ann_new(struct ann* self,
 **************************************************************************************************/
 void ann_delete(struct ann* self)
 {
+   ann_unmap(self);
    dense_layer_delete(&self->output_layer);
    dense_layer_vector_delete(&self->hidden_layers);
    training_data_delete(&self->training_data);
@@ -71,7 +160,7 @@ struct ann* ann_ptr_new(const size_t num_inputs,
                         const size_t num_hidden,
                         const size_t num_outputs)
 {
-   struct ann* self = (struct ann*)malloc(sizeof(struct ann));
+   struct ann* self = (struct ann*)allocator_alloc(sizeof(struct ann));
    if (!self) return 0;
    ann_new(self, num_inputs, num_outputs, num_hidden);
    return self;
@@ -85,7 +174,7 @@ struct ann* ann_ptr_new(const size_t num_inputs,
 void ann_ptr_delete(struct ann** self)
 {
    ann_delete(*self);
-   free(*self);
+   allocator_free(*self);
    *self = 0;
    return;
 }
@@ -138,6 +227,73 @@ int ann_add_hidden_layers(struct ann* self,
    }
 }
 
+/**************************************************************************************************
+* ann_set_weight_format: Vljer format fr de vikter som anvnds vid feedforward i samtliga
+*                        befintliga lager i angivet neuralt ntverk. Vid halv precision (fp16
+*                        eller bf16) lses en avrundad kopia av vikterna vid prediktion, medan
+*                        trning sker med vikterna i full precision. Returnerar 1 ifall
+*                        minnesallokering misslyckas, annars 0.
+*
+*                        - self  : Pekare till det neurala ntverket.
+*                        - format: Format fr vikterna som anvnds vid feedforward.
+**************************************************************************************************/
+int ann_set_weight_format(struct ann* self,
+                          const enum half_format format)
+{
+   for (size_t i = 0; i < self->hidden_layers.size; ++i)
+   {
+      if (dense_layer_set_weight_format(&self->hidden_layers.data[i], format)) return 1;
+   }
+   return dense_layer_set_weight_format(&self->output_layer, format);
+}
+
+/**************************************************************************************************
+* ann_sparsify: Beskr samtliga befintliga lager i angivet neuralt ntverk genom att nollstlla
+*               vikter vars belopp inte verstiger angivet trskelvrde, se dense_layer_sparsify.
+*               Fr varje lager mts huruvida gles eller tt berkning r snabbast, vilket
+*               drefter vljs automatiskt vid prediktion samt trning. Vid ett negativt
+*               trskelvrde anvnds tta berkningar p nytt. Returnerar 1 ifall
+*               minnesallokering misslyckas, annars 0.
+*
+*               - self     : Pekare till det neurala ntverket.
+*               - threshold: Trskelvrde, vikter med mindre eller lika belopp tas bort.
+**************************************************************************************************/
+int ann_sparsify(struct ann* self,
+                 const double threshold)
+{
+   for (size_t i = 0; i < self->hidden_layers.size; ++i)
+   {
+      if (dense_layer_sparsify(&self->hidden_layers.data[i], threshold)) return 1;
+   }
+   return dense_layer_sparsify(&self->output_layer, threshold);
+}
+
+/**************************************************************************************************
+* ann_set_activation: Vljer aktiveringsfunktion fr angivet lager i angivet neuralt ntverk, dr
+*                     dolda lager rknas frst (index 0 motsvarar det frsta dolda lagret) fljt
+*                     av utgngslagret, vars index drmed r lika med antalet dolda lager. Som
+*                     default anvnds ReLU i samtliga lager. Returnerar 1 ifall lagret eller
+*                     aktiveringsfunktionen inte finns, annars 0.
+*
+*                     - self       : Pekare till det neurala ntverket.
+*                     - layer_index: Index fr lagret vars aktiveringsfunktion skall vljas.
+*                     - activation : Aktiveringsfunktionen som skall anvndas.
+**************************************************************************************************/
+int ann_set_activation(struct ann* self,
+                       const size_t layer_index,
+                       const enum activation activation)
+{
+   if (layer_index < self->hidden_layers.size)
+   {
+      return dense_layer_set_activation(&self->hidden_layers.data[layer_index], activation);
+   }
+   else if (layer_index == self->hidden_layers.size)
+   {
+      return dense_layer_set_activation(&self->output_layer, activation);
+   }
+   return 1;
+}
+
 /**************************************************************************************************
 * ann_load_training_data: Lser in trningsdata till angivet neuralt ntverk frn en fil.
 *               
@@ -151,6 +307,21 @@ void ann_load_training_data(struct ann* self,
    return;
 }
 
+/**************************************************************************************************
+* ann_map_training_data: Mappar en binr trningsdatafil, skapad via funktionen
+*                        training_data_save (exempelvis via verktyget ann_convert), som
+*                        trningsdata till angivet neuralt ntverk utan att talen lses in eller
+*                        kopieras. Returnerar 1 ifall filen inte kan mappas, annars 0.
+*
+*                        - self    : Pekare till det neurala ntverket.
+*                        - filepath: Pekare till filskvgen till den binra trningsdatafilen.
+**************************************************************************************************/
+int ann_map_training_data(struct ann* self,
+                          const char* filepath)
+{
+   return training_data_map(&self->training_data, filepath);
+}
+
 /**************************************************************************************************
 * ann_set_training_data: Lgger till trningsdata till angivet neuralt ntverk lagrat via 
 *                        var sin tvdimensionell vektor.
@@ -184,20 +355,385 @@ void ann_train(struct ann* self,
                const double learning_rate)
 {
    for (size_t i = 0; i < num_epochs; ++i)
+   {
+      ann_train_epoch(self, &self->training_data, learning_rate);
+   }
+   return;
+}
+
+/**************************************************************************************************
+* ann_train_stream: Trnar angivet neuralt ntverk angivet antal epoker med trningsdata som
+*                   strmmas frn en binr trningsdatafil, skapad via funktionen
+*                   training_data_save (exempelvis via verktyget ann_convert), i stllet fr
+*                   ntverkets trningsdatabehllare. Filen lses i block som ryms inom angiven
+*                   minnesbudget, vilket mjliggr trning med datamngder som r strre n
+*                   tillgngligt minne. Infr varje epok randomiseras ordningen p blocken, och
+*                   ordningen p uppsttningarna inom respektive block randomiseras nr blocket
+*                   har lsts in. Varje uppsttning trnas som i funktionen ann_train.
+*                   Returnerar 1 ifall filen inte kan ppnas eller lsas, eller ifall
+*                   minnesallokering misslyckas, annars 0.
+*
+*                   - self         : Pekare till det neurala ntverket.
+*                   - filepath     : Filskvg till den binra trningsdatafilen.
+*                   - num_epochs   : Antalet epoker/omgng trning som skall genomfras.
+*                   - learning_rate: Lrhastigheten, avgr justeringsgraden vid avvikelse.
+*                   - memory_budget: Minnesbudget i byte fr ett block (0 = DATA_STREAM_BUDGET).
+**************************************************************************************************/
+int ann_train_stream(struct ann* self,
+                     const char* filepath,
+                     const size_t num_epochs,
+                     const double learning_rate,
+                     const size_t memory_budget)
+{
+   struct data_stream stream;
+
+   if (data_stream_new(&stream, filepath, self->num_inputs, self->num_outputs, memory_budget))
+   {
+      return 1;
+   }
+
+   for (size_t i = 0; i < num_epochs && !stream.failed; ++i)
+   {
+      data_stream_shuffle(&stream);
+
+      for (struct training_data* chunk; (chunk = data_stream_next(&stream));)
+      {
+         ann_train_epoch(self, chunk, learning_rate);
+      }
+   }
+
+   const int status = stream.failed;
+   data_stream_delete(&stream);
+   return status;
+}
+
+/**************************************************************************************************
+* ann_train_batch: Trnar angivet neuralt ntverk angivet antal epoker med mini-batch. Infr varje
+*                  epok randomiseras ordningen p trningsuppsttningarna, som sedan delas upp i
+*                  batcher av angiven storlek. Varje batch passeras genom ntverket som en matris,
+*                  dr gradienterna ackumuleras ver hela batchen och bias samt vikter justeras en
+*                  gng per batch. Drmed lses varje viktmatris en gng per batch i stllet fr en
+*                  gng per trningsuppsttning. Returnerar 1 ifall minnesallokering misslyckas,
+*                  annars 0.
+* 
+*                  - self         : Pekare till det neurala ntverket.
+*                  - num_epochs   : Antalet epoker/omgng trning som skall genomfras.
+*                  - batch_size   : Antalet trningsuppsttningar per batch.
+*                  - learning_rate: Lrhastigheten, avgr justeringsgraden vid avvikelse.
+**************************************************************************************************/
+int ann_train_batch(struct ann* self,
+                    const size_t num_epochs,
+                    const size_t batch_size,
+                    const double learning_rate)
+{
+   const struct training_data* data = &self->training_data;
+   struct dense_layer_batch* batches = 0;
+   struct double_matrix input, reference;
+   int status = 1;
+
+   if (!batch_size) return 1;
+   double_matrix_new(&input);
+   double_matrix_new(&reference);
+
+   if (!double_matrix_resize(&input, batch_size, self->num_inputs) &&
+       !double_matrix_resize(&reference, batch_size, self->num_outputs))
+   {
+      batches = ann_batches_new(self, batch_size);
+      status = batches ? 0 : 1;
+   }
+
+   for (size_t i = 0; i < num_epochs && !status; ++i)
    {
       training_data_shuffle(&self->training_data);
-      for (size_t j = 0; j < self->training_data.sets; ++j)
+
+      for (size_t j = 0; j < data->sets; j += batch_size)
       {
-         const size_t k = self->training_data.order.data[j];
-         const struct double_vector* input = &self->training_data.in.data[k];
-         const struct double_vector* reference = &self->training_data.out.data[k];
+         const size_t num_samples = data->sets - j < batch_size ? data->sets - j : batch_size;
+
+         for (size_t k = 0; k < num_samples; ++k)
+         {
+            const size_t l = data->order.data[j + k];
+            copy_row(double_matrix_row(&input, k), &data->in.data[l], self->num_inputs);
+            copy_row(double_matrix_row(&reference, k), &data->out.data[l], self->num_outputs);
+         }
 
-         ann_feedforward(self, input);
-         ann_backpropagate(self, reference);
-         ann_optimize(self, learning_rate);
+         ann_batch_gradients(self, batches, &input, &reference, num_samples);
+         ann_batch_optimize(self, batches, learning_rate);
       }
    }
-   return;
+
+   ann_batches_delete(self, batches);
+   double_matrix_delete(&input);
+   double_matrix_delete(&reference);
+   return status;
+}
+
+/**************************************************************************************************
+* ann_train_loader: Trnar angivet neuralt ntverk angivet antal epoker med mini-batch likt
+*                   funktionen ann_train_batch, dr trningsdatan lses, randomiseras och samlas
+*                   i batcher av en bakgrundstrd (se ann_loader.h). Anropande trd trnar
+*                   enbart p frdiga batcher, medan bakgrundstrden fyller nsta batch. Ifall
+*                   en filskvg anges strmmas trningsdatan frn en binr trningsdatafil inom
+*                   angiven minnesbudget, annars anvnds ntverkets trningsdata. Statistik fr
+*                   inlsningen, bland annat hur lnge respektive trd har vntat p den andra,
+*                   lagras p angiven adress. Returnerar 1 ifall batchstorleken r noll, filen
+*                   inte kan ppnas eller lsas, ifall minnesallokering misslyckas eller ifall
+*                   trden inte kan skapas, annars 0.
+*
+*                   - self         : Pekare till det neurala ntverket.
+*                   - filepath     : Filskvg till binr trningsdatafil (null = ntverkets data).
+*                   - num_epochs   : Antalet epoker/omgng trning som skall genomfras.
+*                   - batch_size   : Antalet trningsuppsttningar per batch.
+*                   - learning_rate: Lrhastigheten, avgr justeringsgraden vid avvikelse.
+*                   - memory_budget: Minnesbudget i byte fr strmningen (0 = DATA_STREAM_BUDGET).
+*                   - stats        : Pekare till adressen dr statistiken lagras (null = ingen).
+**************************************************************************************************/
+int ann_train_loader(struct ann* self,
+                     const char* filepath,
+                     const size_t num_epochs,
+                     const size_t batch_size,
+                     const double learning_rate,
+                     const size_t memory_budget,
+                     struct ann_loader_stats* stats)
+{
+   struct ann_loader loader;
+   struct dense_layer_batch* batches = batch_size ? ann_batches_new(self, batch_size) : 0;
+
+   if (!batches || ann_loader_new(&loader, &self->training_data, filepath, num_epochs,
+                                  batch_size, memory_budget))
+   {
+      ann_batches_delete(self, batches);
+      return 1;
+   }
+
+   for (const struct ann_loader_batch* batch; (batch = ann_loader_next(&loader));)
+   {
+      ann_batch_gradients(self, batches, &batch->input, &batch->reference, batch->num_samples);
+      ann_loader_release(&loader);
+      ann_batch_optimize(self, batches, learning_rate);
+   }
+
+   const int status = loader.failed;
+   if (stats) *stats = loader.stats;
+   ann_loader_delete(&loader);
+   ann_batches_delete(self, batches);
+   return status;
+}
+
+/**************************************************************************************************
+* ann_train_synchronous: Trnar angivet neuralt ntverk angivet antal epoker med mini-batch,
+*                        dr varje batch delas upp mellan angivet antal trdar. Varje trd
+*                        genomfr feedforward samt backpropagation fr sin andel av batchen och
+*                        ackumulerar gradienterna i egna buffertar med samma form som respektive
+*                        lager. Buffertarna summeras sedan parvis i ett trd med fast ordning
+*                        (trd 1 till 0, 3 till 2 osv., drefter 2 till 0 osv.), varefter bias
+*                        samt vikter justeras en gng per batch av anropande trd. Eftersom
+*                        uppdelningen samt summeringsordningen enbart beror p antalet trdar
+*                        blir resultatet bitidentiskt mellan krningar med samma antal trdar
+*                        samt samma startvrde fr slumpgeneratorn. Vid en trd motsvarar
+*                        trningen ann_train_batch. Vid noll trdar anvnds en trd per
+*                        tillgnglig processorkrna. Returnerar 1 ifall minnesallokering eller
+*                        skapande av trdar misslyckas, annars 0.
+*
+*                        - self         : Pekare till det neurala ntverket.
+*                        - num_epochs   : Antalet epoker/omgng trning som skall genomfras.
+*                        - batch_size   : Antalet trningsuppsttningar per batch.
+*                        - learning_rate: Lrhastigheten, avgr justeringsgraden vid avvikelse.
+*                        - num_threads  : Antalet trdar som skall anvndas (0 = antalet krnor).
+**************************************************************************************************/
+int ann_train_synchronous(struct ann* self,
+                          const size_t num_epochs,
+                          const size_t batch_size,
+                          const double learning_rate,
+                          size_t num_threads)
+{
+   const struct training_data* data = &self->training_data;
+   struct ann_sync shared;
+   size_t num_started = 0;
+   int status = 0;
+
+   if (!batch_size) return 1;
+
+   if (!num_threads)
+   {
+      const long num_cores = sysconf(_SC_NPROCESSORS_ONLN);
+      num_threads = num_cores > 0 ? (size_t)num_cores : 1;
+   }
+
+   if (num_threads > batch_size) num_threads = batch_size;
+   shared.workers = (struct ann_sync_worker*)calloc(num_threads, sizeof(struct ann_sync_worker));
+   if (!shared.workers) return 1;
+
+   shared.network = self;
+   shared.num_workers = num_threads;
+   shared.begin = 0;
+   shared.num_samples = 0;
+   shared.stop = false;
+
+   for (size_t i = 0; i < num_threads && !status; ++i)
+   {
+      status = ann_sync_worker_new(&shared.workers[i], &shared, i,
+                                   (batch_size + num_threads - 1) / num_threads);
+   }
+
+   simd_init();
+   pthread_mutex_init(&shared.mutex, 0);
+   pthread_mutex_lock(&shared.mutex);
+
+   for (size_t i = 1; i < num_threads && !status; ++i)
+   {
+      if (pthread_create(&shared.workers[i].thread, 0, &ann_sync_worker_run, &shared.workers[i]))
+      {
+         status = 1;
+      }
+      else
+      {
+         num_started++;
+      }
+   }
+
+   shared.stop = status ? true : false;
+   pthread_barrier_init(&shared.barrier, 0, (unsigned)(num_started + 1));
+   pthread_mutex_unlock(&shared.mutex);
+
+   for (size_t i = 0; i < num_epochs && !status; ++i)
+   {
+      training_data_shuffle(&self->training_data);
+
+      for (size_t j = 0; j < data->sets; j += batch_size)
+      {
+         shared.begin = j;
+         shared.num_samples = data->sets - j < batch_size ? data->sets - j : batch_size;
+         pthread_barrier_wait(&shared.barrier);
+         ann_sync_worker_step(&shared.workers[0]);
+         ann_batch_optimize(self, shared.workers[0].batches, learning_rate);
+      }
+   }
+
+   shared.stop = true;
+   pthread_barrier_wait(&shared.barrier);
+
+   for (size_t i = 1; i <= num_started; ++i)
+   {
+      pthread_join(shared.workers[i].thread, 0);
+   }
+
+   pthread_barrier_destroy(&shared.barrier);
+   pthread_mutex_destroy(&shared.mutex);
+
+   for (size_t i = 0; i < num_threads; ++i)
+   {
+      ann_sync_worker_delete(&shared.workers[i]);
+   }
+
+   free(shared.workers);
+   return status;
+}
+
+/**************************************************************************************************
+* ann_train_parallel: Trnar angivet neuralt ntverk angivet antal epoker med angivet antal
+*                     trdar utan ls (Hogwild). Infr varje epok randomiseras ordningen p
+*                     trningsuppsttningarna, som sedan delas upp i lika stora andelar per
+*                     trd. Varje trd genomfr feedforward samt backpropagation med egna
+*                     utsignaler och avvikelser, men justerar de gemensamma vikterna och
+*                     biasvrdena direkt utan synkronisering. Uppdateringar frn olika trdar
+*                     kan drmed ibland skriva ver varandra, vilket har frsumbar inverkan p
+*                     konvergensen s lnge varje uppdatering enbart pverkar en liten del av
+*                     parametrarna, men medfr att resultatet inte r reproducerbart. Vid en
+*                     trd motsvarar trningen ann_train. Vid noll trdar anvnds en trd per
+*                     tillgnglig processorkrna. Returnerar 1 ifall minnesallokering
+*                     misslyckas, annars 0. Uppntt fel kan drefter jmfras med seriell
+*                     trning via ann_loss.
+*
+*                     - self         : Pekare till det neurala ntverket.
+*                     - num_epochs   : Antalet epoker/omgng trning som skall genomfras.
+*                     - learning_rate: Lrhastigheten, avgr justeringsgraden vid avvikelse.
+*                     - num_threads  : Antalet trdar som skall anvndas (0 = antalet krnor).
+**************************************************************************************************/
+int ann_train_parallel(struct ann* self,
+                       const size_t num_epochs,
+                       const double learning_rate,
+                       size_t num_threads)
+{
+   const size_t sets = self->training_data.sets;
+   struct ann_worker* workers = 0;
+   size_t num_workers = 0;
+
+   if (!num_threads)
+   {
+      const long num_cores = sysconf(_SC_NPROCESSORS_ONLN);
+      num_threads = num_cores > 0 ? (size_t)num_cores : 1;
+   }
+
+   if (num_threads > sets) num_threads = sets ? sets : 1;
+   workers = (struct ann_worker*)malloc(sizeof(struct ann_worker) * num_threads);
+   if (!workers) return 1;
+
+   for (; num_workers < num_threads; ++num_workers)
+   {
+      if (ann_worker_new(&workers[num_workers], self)) break;
+      workers[num_workers].begin = sets * num_workers / num_threads;
+      workers[num_workers].end = sets * (num_workers + 1) / num_threads;
+      workers[num_workers].learning_rate = learning_rate;
+   }
+
+   simd_init();
+
+   for (size_t i = 0; i < num_epochs && num_workers == num_threads; ++i)
+   {
+      training_data_shuffle(&self->training_data);
+
+      for (size_t j = 1; j < num_workers; ++j)
+      {
+         workers[j].started = !pthread_create(&workers[j].thread, 0, &ann_worker_train,
+                                              &workers[j]);
+         if (!workers[j].started) ann_worker_train(&workers[j]);
+      }
+
+      ann_worker_train(&workers[0]);
+
+      for (size_t j = 1; j < num_workers; ++j)
+      {
+         if (workers[j].started) pthread_join(workers[j].thread, 0);
+      }
+   }
+
+   const int status = num_workers == num_threads ? 0 : 1;
+
+   for (size_t i = 0; i < num_workers; ++i)
+   {
+      ann_worker_delete(&workers[i]);
+   }
+
+   free(workers);
+   return status;
+}
+
+/**************************************************************************************************
+* ann_loss: Returnerar medelkvadratfelet fr angivet neuralt ntverk ver samtliga
+*           trningsuppsttningar, dvs. medelvrdet av kvadraten av avvikelsen mellan
+*           predikterade utsignaler och referensvrden. Returnerar 0 ifall trningsdata saknas.
+*
+*           - self: Pekare till det neurala ntverket.
+**************************************************************************************************/
+double ann_loss(struct ann* self)
+{
+   const struct training_data* data = &self->training_data;
+   double sum = 0;
+   size_t count = 0;
+
+   for (size_t i = 0; i < data->sets; ++i)
+   {
+      const struct double_vector* reference = &data->out.data[i];
+      const real_t* output = ann_predict(self, &data->in.data[i]);
+
+      for (size_t j = 0; j < self->num_outputs && j < reference->size; ++j, ++count)
+      {
+         const double deviation = reference->data[j] - output[j];
+         sum += deviation * deviation;
+      }
+   }
+   return count ? sum / count : 0;
 }
 
 /**************************************************************************************************
@@ -207,13 +743,215 @@ void ann_train(struct ann* self,
 *              - self : Pekare till det neurala ntverket.
 *              - input: Pekare till vektor innehllande indata till det neurala ntverket.
 **************************************************************************************************/
-double* ann_predict(struct ann* self, 
+real_t* ann_predict(struct ann* self, 
                     const struct double_vector* input)
 {
    ann_feedforward(self, input);
    return self->output_layer.output.data;
 }
 
+/**************************************************************************************************
+* ann_predict_batch: Genomfr prediktion med angivet neuralt ntverk fr multipla uppsttningar
+*                    insignaler t gngen, dr varje lager berknas fr samtliga uppsttningar via
+*                    en matrismultiplikation. Drmed lses varje viktmatris en gng per batch i
+*                    stllet fr en gng per uppsttning. Lager som anvnder glesa vikter eller
+*                    vikter i halv precision berknas i stllet en uppsttning t gngen via samma
+*                    berkningskrnor som funktionen ann_predict, vilket ger samma resultat som vid
+*                    prediktion av en enskild uppsttning. Varje rad i indatamatrisen utgr en
+*                    uppsttning insignaler och predikterade utsignaler lagras p motsvarande rad i
+*                    utdatamatrisen. Arbetsminne fr de dolda lagren allokeras vid varje anrop, vid
+*                    upprepade anrop br drfr funktionen ann_predict_batch_ws anvndas. Returnerar
+*                    1 ifall matriserna inte rymmer angivet antal uppsttningar eller ifall
+*                    minnesallokering misslyckas, annars 0.
+*
+*                    - self       : Pekare till det neurala ntverket.
+*                    - input      : Pekare till matris innehllande insignaler, en rad per
+*                                   uppsttning och minst en kolumn per insignal.
+*                    - output     : Pekare till matris dr utsignalerna skall lagras, med minst
+*                                   en rad per uppsttning och en kolumn per utsignal.
+*                    - num_samples: Antalet uppsttningar som skall predikteras.
+**************************************************************************************************/
+int ann_predict_batch(struct ann* self,
+                      const struct double_matrix* input,
+                      struct double_matrix* output,
+                      const size_t num_samples)
+{
+   struct ann_batch_workspace workspace;
+   if (!num_samples) return ann_predict_batch_ws(self, 0, input, output, 0);
+   if (ann_batch_workspace_new(&workspace, self, num_samples)) return 1;
+   const int status = ann_predict_batch_ws(self, &workspace, input, output, num_samples);
+   ann_batch_workspace_delete(&workspace);
+   return status;
+}
+
+/**************************************************************************************************
+* ann_batch_workspace_new: Initierar arbetsminne fr batchvis prediktion med angivet neuralt
+*                          ntverk, dr minne allokeras fr utsignalerna frn ntverkets strsta
+*                          dolda lager fr angivet antal uppsttningar. Returnerar 1 ifall
+*                          minnesallokering misslyckas, annars 0.
+*
+*                          - self       : Pekare till arbetsminnet.
+*                          - network    : Pekare till det neurala ntverk som arbetsminnet avser.
+*                          - max_samples: Maximalt antal uppsttningar per batch.
+**************************************************************************************************/
+int ann_batch_workspace_new(struct ann_batch_workspace* self,
+                            const struct ann* network,
+                            const size_t max_samples)
+{
+   double_matrix_new(&self->buffers[0]);
+   double_matrix_new(&self->buffers[1]);
+   self->num_nodes = 0;
+
+   for (size_t i = 0; i < network->hidden_layers.size; ++i)
+   {
+      const size_t num_nodes = network->hidden_layers.data[i].num_nodes;
+      if (num_nodes > self->num_nodes) self->num_nodes = num_nodes;
+   }
+
+   if (double_matrix_resize(&self->buffers[0], max_samples, self->num_nodes) ||
+       (network->hidden_layers.size > 1 &&
+        double_matrix_resize(&self->buffers[1], max_samples, self->num_nodes)))
+   {
+      ann_batch_workspace_delete(self);
+      return 1;
+   }
+   return 0;
+}
+
+/**************************************************************************************************
+* ann_batch_workspace_delete: Frigr minne allokerat fr angivet arbetsminne.
+*
+*                             - self: Pekare till arbetsminnet.
+**************************************************************************************************/
+void ann_batch_workspace_delete(struct ann_batch_workspace* self)
+{
+   double_matrix_delete(&self->buffers[0]);
+   double_matrix_delete(&self->buffers[1]);
+   self->num_nodes = 0;
+   return;
+}
+
+/**************************************************************************************************
+* ann_predict_batch_ws: Genomfr batchvis prediktion likt funktionen ann_predict_batch, dr de
+*                       dolda lagrens utsignaler lagras i angivet arbetsminne, vilket medfr att
+*                       inget minne allokeras. Ntverket lses enbart, vilket medfr att
+*                       funktionen kan anropas frn multipla trdar samtidigt fr samma ntverk,
+*                       s lnge varje trd anvnder ett eget arbetsminne. Returnerar 1 ifall
+*                       matriserna eller arbetsminnet inte rymmer angivet antal uppsttningar
+*                       eller ntverkets dolda lager, annars 0.
+*
+*                       - self       : Pekare till det neurala ntverket.
+*                       - workspace  : Pekare till arbetsminnet.
+*                       - input      : Pekare till matris innehllande insignaler, en rad per
+*                                      uppsttning och minst en kolumn per insignal.
+*                       - output     : Pekare till matris dr utsignalerna skall lagras, med
+*                                      minst en rad per uppsttning och en kolumn per utsignal.
+*                       - num_samples: Antalet uppsttningar som skall predikteras.
+**************************************************************************************************/
+int ann_predict_batch_ws(const struct ann* self,
+                         struct ann_batch_workspace* workspace,
+                         const struct double_matrix* input,
+                         struct double_matrix* output,
+                         const size_t num_samples)
+{
+   const struct double_matrix* current = input;
+
+   if (input->rows < num_samples || input->cols < self->num_inputs ||
+       output->rows < num_samples || output->cols < self->num_outputs) return 1;
+   if (!num_samples) return 0;
+
+   for (size_t i = 0; i < self->hidden_layers.size; ++i)
+   {
+      const struct dense_layer* layer = &self->hidden_layers.data[i];
+      struct double_matrix* buffer = &workspace->buffers[i % 2];
+      if (layer->num_nodes > workspace->num_nodes || buffer->rows < num_samples) return 1;
+      dense_layer_feedforward_batch(layer, current, buffer, num_samples);
+      current = buffer;
+   }
+
+   dense_layer_feedforward_batch(&self->output_layer, current, output, num_samples);
+   return 0;
+}
+
+/**************************************************************************************************
+* ann_workspace_new: Initierar arbetsminne fr prediktion med angivet neuralt ntverk, dr minne
+*                    allokeras fr utsignalerna frn ntverkets strsta dolda lager. Returnerar
+*                    1 ifall minnesallokering misslyckas, annars 0.
+*
+*                    - self   : Pekare till arbetsminnet.
+*                    - network: Pekare till det neurala ntverk som arbetsminnet avser.
+**************************************************************************************************/
+int ann_workspace_new(struct ann_workspace* self,
+                      const struct ann* network)
+{
+   double_vector_new(&self->buffers[0]);
+   double_vector_new(&self->buffers[1]);
+   self->num_nodes = 0;
+
+   for (size_t i = 0; i < network->hidden_layers.size; ++i)
+   {
+      const size_t num_nodes = network->hidden_layers.data[i].num_nodes;
+      if (num_nodes > self->num_nodes) self->num_nodes = num_nodes;
+   }
+
+   if (double_vector_resize(&self->buffers[0], self->num_nodes) ||
+       double_vector_resize(&self->buffers[1], self->num_nodes))
+   {
+      ann_workspace_delete(self);
+      return 1;
+   }
+   return 0;
+}
+
+/**************************************************************************************************
+* ann_workspace_delete: Frigr minne allokerat fr angivet arbetsminne.
+*
+*                       - self: Pekare till arbetsminnet.
+**************************************************************************************************/
+void ann_workspace_delete(struct ann_workspace* self)
+{
+   double_vector_delete(&self->buffers[0]);
+   double_vector_delete(&self->buffers[1]);
+   self->num_nodes = 0;
+   return;
+}
+
+/**************************************************************************************************
+* ann_predict_ws: Genomfr prediktion med angivet neuralt ntverk utifrn givna insignaler, dr
+*                 lagrens utsignaler lagras i angivet arbetsminne i stllet fr i ntverket.
+*                 Ntverket lses enbart, vilket medfr att funktionen kan anropas frn multipla
+*                 trdar samtidigt fr samma ntverk, s lnge varje trd anvnder ett eget
+*                 arbetsminne. Ntverket fr dock inte trnas eller ndras under tiden.
+*                 Returnerar 1 ifall antalet insignaler r fr litet eller ifall arbetsminnet
+*                 inte rymmer ntverkets dolda lager, annars 0.
+*
+*                 - self     : Pekare till det neurala ntverket.
+*                 - workspace: Pekare till anropande trds arbetsminne.
+*                 - input    : Pekare till vektor innehllande indata till det neurala ntverket.
+*                 - output   : Pekare till flt dr predikterade utsignaler skall lagras, som
+*                              mste rymma en utsignal per nod i ntverkets yttre lager.
+**************************************************************************************************/
+int ann_predict_ws(const struct ann* self,
+                   struct ann_workspace* workspace,
+                   const struct double_vector* input,
+                   real_t* output)
+{
+   const struct double_vector* current = input;
+   if (input->size < self->num_inputs) return 1;
+
+   for (size_t i = 0; i < self->hidden_layers.size; ++i)
+   {
+      const struct dense_layer* layer = &self->hidden_layers.data[i];
+      struct double_vector* buffer = &workspace->buffers[i % 2];
+      if (layer->num_nodes > workspace->num_nodes) return 1;
+      dense_layer_feedforward_to(layer, current, buffer->data);
+      current = buffer;
+   }
+
+   dense_layer_feedforward_to(&self->output_layer, current, output);
+   return 0;
+}
+
 /**************************************************************************************************
 * ann_predict_range: Genomfr prediktion med angivet neuralt ntverk fr multipla kombinationer 
 *                    av insignaler och genomfr utskrift av predikterade utsignaler via angiven 
@@ -247,6 +985,66 @@ void ann_predict_range(struct ann* self,
    return;
 }
 
+/**************************************************************************************************
+* ann_unmap: Tar bort mappningen av en modellfil i angivet neuralt ntverk (se funktionen
+*            ann_map), om en sdan finns. Lagrens vikter och biasvrden som pekar in i
+*            mappningen kopplas frst bort, s att de inte frigrs nr lagren raderas.
+*
+*            - self: Pekare till det neurala ntverket.
+**************************************************************************************************/
+static void ann_unmap(struct ann* self)
+{
+   if (!self->map.data) return;
+
+   for (size_t i = 0; i <= self->hidden_layers.size; ++i)
+   {
+      struct dense_layer* layer = i < self->hidden_layers.size ?
+         &self->hidden_layers.data[i] : &self->output_layer;
+      if (is_mapped(layer->weights.data, &self->map)) layer->weights.data = 0;
+      if (is_mapped(layer->bias.data, &self->map)) layer->bias.data = 0;
+   }
+
+   file_map_delete(&self->map);
+   return;
+}
+
+/**************************************************************************************************
+* is_mapped: Indikerar ifall angivet minnesblock ligger i angiven mappning.
+*
+*            - data: Pekare till minnesblocket.
+*            - map : Pekare till mappningen.
+**************************************************************************************************/
+static bool is_mapped(const void* data,
+                      const struct file_map* map)
+{
+   const char* position = (const char*)data;
+   return position && position >= map->data && position < map->data + map->size;
+}
+
+/**************************************************************************************************
+* ann_train_epoch: Trnar angivet neuralt ntverk en epok med angiven trningsdata, vars ordning
+*                  randomiseras innan trningen. Varje uppsttning passeras genom ntverket via
+*                  feedforward, varefter bias samt vikter justeras via backprop.
+*
+*                  - self         : Pekare till det neurala ntverket.
+*                  - data         : Pekare till trningsdatan som skall anvndas.
+*                  - learning_rate: Lrhastigheten, avgr justeringsgraden vid avvikelse.
+**************************************************************************************************/
+static void ann_train_epoch(struct ann* self,
+                            struct training_data* data,
+                            const double learning_rate)
+{
+   training_data_shuffle(data);
+
+   for (size_t i = 0; i < data->sets; ++i)
+   {
+      const size_t k = data->order.data[i];
+      ann_feedforward(self, &data->in.data[k]);
+      ann_backpropagate_optimize(self, &data->out.data[k], learning_rate);
+   }
+   return;
+}
+
 /**************************************************************************************************
 * ann_feedforward: Berknar nya utsignaler fr samtliga noder i angivet neuralt ntverk via ny
 *                  indata till ntverkets ingngslager.
@@ -267,33 +1065,417 @@ static void ann_feedforward(struct ann* self,
 }
 
 /**************************************************************************************************
-* ann_backpropagate: Berknar avvikelser fr samtliga noder i aktuellt neuralt ntverk utefter
-*                    angivna referensvrden frn trningsdatan.
+* ann_backpropagate_optimize: Berknar avvikelser fr samtliga noder i aktuellt neuralt ntverk
+*                             utefter angivna referensvrden frn trningsdatan och justerar
+*                             samtidigt bias samt vikter. Lagren bearbetas bakifrn, dr varje
+*                             viktmatris anvnds fr att berkna avvikelserna i fregende lager
+*                             och justeras direkt drefter, rad fr rad, medan raden finns kvar
+*                             i cacheminnet. Drmed lses varje viktmatris en gng i stllet fr
+*                             tv, med samma resultat som separat backpropagation och optimering.
 * 
-*                    - self     : Pekare till det neurala ntverket.
-*                    - reference: Referensvrden frn trningsdatan.
+*                             - self         : Pekare till det neurala ntverket.
+*                             - reference    : Referensvrden frn trningsdatan.
+*                             - learning_rate: Lrhastigheten, avgr justeringsgraden vid avvikelse.
 **************************************************************************************************/
-static void ann_backpropagate(struct ann* self, 
-                              const struct double_vector* reference)
+static void ann_backpropagate_optimize(struct ann* self,
+                                       const struct double_vector* reference,
+                                       const double learning_rate)
 {
+   struct dense_layer* last = dense_layer_vector_last(&self->hidden_layers);
    dense_layer_compare_with_reference(&self->output_layer, reference);
-   dense_layer_vector_backpropagate(&self->hidden_layers, &self->output_layer);
+   dense_layer_backpropagate_optimize(&self->output_layer, last, &last->output, learning_rate);
+   dense_layer_vector_backpropagate_optimize(&self->hidden_layers, self->input_layer, 
+                                             learning_rate);
    return;
 }
 
 /**************************************************************************************************
-* ann_optimize: Minimerar avvikelser i angivet neuralt ntverk genom att justera bias samt vikter
-*               fr samtliga noder. Angiven lrhastighet avgr justeringsgraden vid avvikelse.
+* ann_batch_gradients: Genomfr feedforward samt backpropagation fr en batch av
+*                      trningsuppsttningar och ackumulerar gradienterna fr samtliga lager,
+*                      dr arbetsminnet fr respektive dolt lager fljs av arbetsminnet fr
+*                      utgngslagret. Ntverkets bias samt vikter justeras inte.
 * 
-*               - self         : Pekare till det neurala ntverket.
-*               - learning_rate: Lrhastigheten, avgr justeringsgraden vid avvikelse.
+*                      - self       : Pekare till det neurala ntverket.
+*                      - batches    : Pekare till flt innehllande arbetsminne fr varje lager.
+*                      - input      : Pekare till matris innehllande batchens indata.
+*                      - reference  : Pekare till matris innehllande batchens referensvrden.
+*                      - num_samples: Antalet trningsuppsttningar i batchen.
 **************************************************************************************************/
-static void ann_optimize(struct ann* self,
-                         const double learning_rate)
+static void ann_batch_gradients(struct ann* self,
+                                struct dense_layer_batch* batches,
+                                const struct double_matrix* input,
+                                const struct double_matrix* reference,
+                                const size_t num_samples)
 {
-   const struct double_vector* hidden_output = &dense_layer_vector_last(&self->hidden_layers)->output;
-   dense_layer_optimize(&self->output_layer, hidden_output, learning_rate);
-   dense_layer_vector_optimize(&self->hidden_layers, self->input_layer, learning_rate);
+   const size_t num_hidden = self->hidden_layers.size;
+   struct dense_layer* hidden = self->hidden_layers.data;
+   struct dense_layer_batch* output_batch = &batches[num_hidden];
+
+   dense_layer_batch_feedforward(&batches[0], &hidden[0], input, num_samples);
+
+   for (size_t i = 1; i < num_hidden; ++i)
+   {
+      dense_layer_batch_feedforward(&batches[i], &hidden[i], &batches[i - 1].output, num_samples);
+   }
+
+   dense_layer_batch_feedforward(output_batch, &self->output_layer, 
+                                 &batches[num_hidden - 1].output, num_samples);
+   dense_layer_batch_compare_with_reference(output_batch, &self->output_layer, reference);
+   dense_layer_batch_backpropagate(&batches[num_hidden - 1], &hidden[num_hidden - 1],
+                                   output_batch, &self->output_layer);
+
+   for (size_t i = num_hidden - 1; i > 0; --i)
+   {
+      dense_layer_batch_backpropagate(&batches[i - 1], &hidden[i - 1], &batches[i], &hidden[i]);
+   }
+
+   dense_layer_batch_accumulate(output_batch, &self->output_layer, &batches[num_hidden - 1].output);
+
+   for (size_t i = num_hidden - 1; i > 0; --i)
+   {
+      dense_layer_batch_accumulate(&batches[i], &hidden[i], &batches[i - 1].output);
+   }
+
+   dense_layer_batch_accumulate(&batches[0], &hidden[0], input);
+   return;
+}
+
+/**************************************************************************************************
+* ann_batch_optimize: Justerar bias samt vikter i samtliga lager via gradienter ackumulerade
+*                     av ann_batch_gradients, med brjan i utgngslagret.
+* 
+*                     - self         : Pekare till det neurala ntverket.
+*                     - batches      : Pekare till flt innehllande arbetsminne fr varje lager.
+*                     - learning_rate: Lrhastigheten, avgr justeringsgraden vid avvikelse.
+**************************************************************************************************/
+static void ann_batch_optimize(struct ann* self,
+                               const struct dense_layer_batch* batches,
+                               const double learning_rate)
+{
+   const size_t num_hidden = self->hidden_layers.size;
+   dense_layer_batch_optimize(&batches[num_hidden], &self->output_layer, learning_rate);
+
+   for (size_t i = num_hidden; i > 0; --i)
+   {
+      dense_layer_batch_optimize(&batches[i - 1], &self->hidden_layers.data[i - 1], learning_rate);
+   }
+   return;
+}
+
+/**************************************************************************************************
+* ann_batches_new: Returnerar ett flt innehllande arbetsminne fr trning med angiven
+*                  batchstorlek fr varje lager i angivet ntverk, dr arbetsminnet fr
+*                  respektive dolt lager fljs av arbetsminnet fr utgngslagret. Returnerar
+*                  en nullpekare ifall minnesallokering misslyckas.
+* 
+*                  - self      : Pekare till det neurala ntverket.
+*                  - batch_size: Maximalt antal trningsuppsttningar per batch.
+**************************************************************************************************/
+static struct dense_layer_batch* ann_batches_new(const struct ann* self,
+                                                 const size_t batch_size)
+{
+   const size_t num_layers = self->hidden_layers.size + 1;
+   struct dense_layer_batch* batches = 
+      (struct dense_layer_batch*)malloc(sizeof(struct dense_layer_batch) * num_layers);
+   if (!batches) return 0;
+
+   for (size_t i = 0; i < num_layers; ++i)
+   {
+      const struct dense_layer* layer = i < self->hidden_layers.size ? 
+         &self->hidden_layers.data[i] : &self->output_layer;
+
+      if (dense_layer_batch_new(&batches[i], layer, batch_size))
+      {
+         while (i > 0) dense_layer_batch_delete(&batches[--i]);
+         free(batches);
+         return 0;
+      }
+   }
+   return batches;
+}
+
+/**************************************************************************************************
+* ann_batches_delete: Frigr flt innehllande arbetsminne fr varje lager i angivet ntverk,
+*                     allokerat via ann_batches_new.
+* 
+*                     - self   : Pekare till det neurala ntverket.
+*                     - batches: Pekare till fltet som skall frigras (kan vara en nullpekare).
+**************************************************************************************************/
+static void ann_batches_delete(const struct ann* self,
+                               struct dense_layer_batch* batches)
+{
+   if (!batches) return;
+
+   for (size_t i = 0; i < self->hidden_layers.size + 1; ++i)
+   {
+      dense_layer_batch_delete(&batches[i]);
+   }
+
+   free(batches);
+   return;
+}
+
+/**************************************************************************************************
+* ann_sync_worker_new: Initierar arbetsminne fr en trd vid synkron dataparallell trning.
+*                      Returnerar 1 ifall minnesallokering misslyckas, annars 0.
+*
+*                      - self      : Pekare till arbetsminnet.
+*                      - shared    : Pekare till tillstnd som delas av samtliga trdar.
+*                      - index     : Trdens index, dr index 0 utgr anropande trd.
+*                      - batch_size: Maximalt antal trningsuppsttningar per trd och batch.
+**************************************************************************************************/
+static int ann_sync_worker_new(struct ann_sync_worker* self,
+                               struct ann_sync* shared,
+                               const size_t index,
+                               const size_t batch_size)
+{
+   const struct ann* network = shared->network;
+   self->shared = shared;
+   self->index = index;
+   double_matrix_new(&self->input);
+   double_matrix_new(&self->reference);
+
+   if (double_matrix_resize(&self->input, batch_size, network->num_inputs) ||
+       double_matrix_resize(&self->reference, batch_size, network->num_outputs))
+   {
+      self->batches = 0;
+      return 1;
+   }
+
+   self->batches = ann_batches_new(network, batch_size);
+   return self->batches ? 0 : 1;
+}
+
+/**************************************************************************************************
+* ann_sync_worker_delete: Frigr arbetsminne fr en trd vid synkron dataparallell trning.
+*
+*                         - self: Pekare till arbetsminnet.
+**************************************************************************************************/
+static void ann_sync_worker_delete(struct ann_sync_worker* self)
+{
+   if (self->shared) ann_batches_delete(self->shared->network, self->batches);
+   double_matrix_delete(&self->input);
+   double_matrix_delete(&self->reference);
+   self->batches = 0;
+   return;
+}
+
+/**************************************************************************************************
+* ann_sync_worker_step: Berknar gradienter fr trdens andel av aktuell batch och deltar
+*                       sedan i trdsummeringen, dr trden i varje niv antingen adderar
+*                       gradienterna frn en granne till sina egna eller enbart vntar in
+*                       vriga trdar. Efter sista nivn innehller trd 0 summan av samtliga
+*                       gradienter. Samtliga trdar mste anropa funktionen fr varje batch.
+*
+*                       - self: Pekare till trdens arbetsminne.
+**************************************************************************************************/
+static void ann_sync_worker_step(struct ann_sync_worker* self)
+{
+   struct ann_sync* shared = self->shared;
+   struct ann* network = shared->network;
+   const struct training_data* data = &network->training_data;
+   const size_t num_workers = shared->num_workers;
+   const size_t begin = shared->num_samples * self->index / num_workers;
+   const size_t end = shared->num_samples * (self->index + 1) / num_workers;
+
+   for (size_t i = begin; i < end; ++i)
+   {
+      const size_t j = data->order.data[shared->begin + i];
+      copy_row(double_matrix_row(&self->input, i - begin), &data->in.data[j], network->num_inputs);
+      copy_row(double_matrix_row(&self->reference, i - begin), &data->out.data[j],
+               network->num_outputs);
+   }
+
+   ann_batch_gradients(network, self->batches, &self->input, &self->reference, end - begin);
+
+   for (size_t step = 1; step < num_workers; step *= 2)
+   {
+      pthread_barrier_wait(&shared->barrier);
+
+      if (self->index % (step * 2) == 0 && self->index + step < num_workers)
+      {
+         const struct ann_sync_worker* other = &shared->workers[self->index + step];
+
+         for (size_t i = 0; i < network->hidden_layers.size; ++i)
+         {
+            dense_layer_batch_reduce(&self->batches[i], &other->batches[i],
+                                     &network->hidden_layers.data[i]);
+         }
+
+         dense_layer_batch_reduce(&self->batches[network->hidden_layers.size],
+                                  &other->batches[network->hidden_layers.size],
+                                  &network->output_layer);
+      }
+   }
+   return;
+}
+
+/**************************************************************************************************
+* ann_sync_worker_run: Startfunktion fr vriga trdar vid synkron dataparallell trning.
+*                      Trden vntar in anropande trd infr varje batch och genomfr sedan
+*                      sin andel av berkningarna, tills trden beordras att avslutas, varefter
+*                      trdens buffertar fr GEMM frigrs.
+*
+*                      - arg: Pekare till trdens arbetsminne.
+**************************************************************************************************/
+static void* ann_sync_worker_run(void* arg)
+{
+   struct ann_sync_worker* self = (struct ann_sync_worker*)arg;
+   struct ann_sync* shared = self->shared;
+
+   pthread_mutex_lock(&shared->mutex);
+   pthread_mutex_unlock(&shared->mutex);
+
+   while (true)
+   {
+      pthread_barrier_wait(&shared->barrier);
+      if (shared->stop) break;
+      ann_sync_worker_step(self);
+   }
+
+   gemm_release();
+   return 0;
+}
+
+/**************************************************************************************************
+* ann_worker_new: Initierar arbetsminne fr en trd vid parallell trning, dr trdens ntverk
+*                 skapas som en kopia av angivet ntverk vars lager delar vikter samt bias med
+*                 originalet. Returnerar 1 ifall minnesallokering misslyckas, annars 0.
+*
+*                 - self   : Pekare till arbetsminnet.
+*                 - network: Pekare till det neurala ntverket som skall trnas.
+**************************************************************************************************/
+static int ann_worker_new(struct ann_worker* self,
+                          const struct ann* network)
+{
+   const size_t num_hidden = network->hidden_layers.size;
+   struct dense_layer* hidden = (struct dense_layer*)malloc(sizeof(struct dense_layer) *
+                                                            (num_hidden ? num_hidden : 1));
+   size_t num_replicas = 0;
+
+   if (!hidden) return 1;
+   self->replica = *network;
+   self->replica.hidden_layers.data = hidden;
+   self->network = network;
+   self->started = false;
+
+   for (; num_replicas < num_hidden; ++num_replicas)
+   {
+      if (replica_new(&hidden[num_replicas], &network->hidden_layers.data[num_replicas])) break;
+   }
+
+   self->replica.hidden_layers.size = num_replicas;
+   self->replica.hidden_layers.capacity = num_hidden;
+
+   if (num_replicas < num_hidden)
+   {
+      double_vector_new(&self->replica.output_layer.output);
+      double_vector_new(&self->replica.output_layer.error);
+      ann_worker_delete(self);
+      return 1;
+   }
+   else if (replica_new(&self->replica.output_layer, &network->output_layer))
+   {
+      ann_worker_delete(self);
+      return 1;
+   }
+   return 0;
+}
+
+/**************************************************************************************************
+* ann_worker_delete: Frigr arbetsminne fr en trd vid parallell trning. Vikter samt bias
+*                    tillhr det ursprungliga ntverket och frigrs drmed inte.
+*
+*                    - self: Pekare till arbetsminnet.
+**************************************************************************************************/
+static void ann_worker_delete(struct ann_worker* self)
+{
+   for (size_t i = 0; i < self->replica.hidden_layers.size; ++i)
+   {
+      replica_delete(&self->replica.hidden_layers.data[i]);
+   }
+
+   replica_delete(&self->replica.output_layer);
+   free(self->replica.hidden_layers.data);
+   self->replica.hidden_layers.data = 0;
+   self->replica.hidden_layers.size = 0;
+   self->replica.hidden_layers.capacity = 0;
+   return;
+}
+
+/**************************************************************************************************
+* ann_worker_train: Trnar trdens ntverk med trdens andel av trningsuppsttningarna i
+*                   aktuell ordningsfljd, vilket justerar de gemensamma vikterna samt
+*                   biasvrdena. Utgr startfunktion fr trden.
+*
+*                   - arg: Pekare till trdens arbetsminne.
+**************************************************************************************************/
+static void* ann_worker_train(void* arg)
+{
+   struct ann_worker* self = (struct ann_worker*)arg;
+   const struct training_data* data = &self->network->training_data;
+
+   for (size_t i = self->begin; i < self->end; ++i)
+   {
+      const size_t j = data->order.data[i];
+      ann_feedforward(&self->replica, &data->in.data[j]);
+      ann_backpropagate_optimize(&self->replica, &data->out.data[j], self->learning_rate);
+   }
+   return 0;
+}
+
+/**************************************************************************************************
+* replica_new: Initierar angivet dense-lager som en kopia av ett annat lager, dr vikter, bias
+*              samt komprimerade kopior av vikterna delas med originalet, medan utsignaler
+*              samt avvikelser allokeras separat. Returnerar 1 ifall minnesallokering
+*              misslyckas, annars 0.
+*
+*              - self  : Pekare till kopian.
+*              - source: Pekare till dense-lagret som skall kopieras.
+**************************************************************************************************/
+static int replica_new(struct dense_layer* self,
+                       const struct dense_layer* source)
+{
+   *self = *source;
+   double_vector_new(&self->output);
+   double_vector_new(&self->error);
+
+   if (double_vector_resize(&self->output, source->num_nodes) ||
+       double_vector_resize(&self->error, source->num_nodes))
+   {
+      replica_delete(self);
+      return 1;
+   }
+   return 0;
+}
+
+/**************************************************************************************************
+* replica_delete: Frigr utsignaler samt avvikelser fr angiven kopia av ett dense-lager.
+*
+*                 - self: Pekare till kopian.
+**************************************************************************************************/
+static void replica_delete(struct dense_layer* self)
+{
+   double_vector_delete(&self->output);
+   double_vector_delete(&self->error);
+   return;
+}
+
+/**************************************************************************************************
+* copy_row: Kopierar angivet antal flyttal frn en vektor till en rad i en matris. Ifall vektorn
+*           innehller frre element fylls resterande element med nollor.
+* 
+*           - destination: Pekare till raden som flyttalen skall kopieras till.
+*           - source     : Pekare till vektorn som flyttalen skall kopieras frn.
+*           - size       : Antalet flyttal som skall kopieras.
+**************************************************************************************************/
+static void copy_row(real_t* destination,
+                     const struct double_vector* source,
+                     const size_t size)
+{
+   const size_t num = source->size < size ? source->size : size;
+   memcpy(destination, source->data, sizeof(real_t) * num);
+   memset(destination + num, 0, sizeof(real_t) * (size - num));
    return;
 }
 
@@ -307,7 +1489,7 @@ static void print_line(const struct double_vector* self,
                        FILE* ostream, 
                        const double threshold)
 {
-   for (const double* i = self->data; i < self->data + self->size; ++i)
+   for (const real_t* i = self->data; i < self->data + self->size; ++i)
    {
       if (*i > -threshold && *i < threshold)
       {
@@ -8,9 +8,11 @@
 /* Inkluderingsdirektiv: */
 #include "def.h"
 #include "double_vector.h"
+#include "double_matrix.h"
 #include "dense_layer.h"
 #include "dense_layer_vector.h"
 #include "training_data.h"
+#include "ann_loader.h"
 
 /**************************************************************************************************
 * ann: Implementering av ett neuralt nätverk innehållande ett ingångslager, valfritt antal
@@ -24,6 +26,31 @@ struct ann
    const struct double_vector* input_layer; /* Pekare till insignaler i ingångslagret. */
    size_t num_inputs;                       /* Antalet insignaler. */
    size_t num_outputs;                      /* Antalet utsignaler. */
+   struct file_map map;                     /* Mappad modellfil med vikterna (eller tom). */
+};
+
+/**************************************************************************************************
+* ann_workspace: Arbetsminne för prediktion med ett neuralt nätverk, innehållande enbart
+*                utsignaler för nätverkets lager. Nätverket läses enbart vid prediktion via
+*                arbetsminnet, vilket medför att multipla trådar kan genomföra prediktion med
+*                samma nätverk samtidigt, där varje tråd använder ett eget arbetsminne.
+**************************************************************************************************/
+struct ann_workspace
+{
+   struct double_vector buffers[2]; /* Utsignaler från dolda lager, växelvis per lager. */
+   size_t num_nodes;                /* Maximalt antal noder per dolt lager som ryms. */
+};
+
+/**************************************************************************************************
+* ann_batch_workspace: Arbetsminne för batchvis prediktion med ett neuralt nätverk, innehållande
+*                      utsignaler för nätverkets dolda lager för ett maximalt antal
+*                      uppsättningar. Arbetsminnet återanvänds mellan anropen, så att ingen
+*                      minnesallokering sker per batch.
+**************************************************************************************************/
+struct ann_batch_workspace
+{
+   struct double_matrix buffers[2]; /* Utsignaler från dolda lager, växelvis per lager. */
+   size_t num_nodes;                /* Maximalt antal noder per dolt lager som ryms. */
 };
 
 /* Externa funktioner: */
@@ -41,16 +68,71 @@ int ann_add_hidden_layer(struct ann* self,
 int ann_add_hidden_layers(struct ann* self, 
                           const size_t num_layers, 
                           const size_t num_nodes);
+int ann_set_weight_format(struct ann* self,
+                          const enum half_format format);
+int ann_sparsify(struct ann* self,
+                 const double threshold);
+int ann_set_activation(struct ann* self,
+                       const size_t layer_index,
+                       const enum activation activation);
 void ann_load_training_data(struct ann* self, 
                             const char* filepath);
+int ann_map_training_data(struct ann* self,
+                          const char* filepath);
 void ann_set_training_data(struct ann* self, 
                            const struct double_2d_vector* train_in, 
                            const struct double_2d_vector* train_out);
 void ann_train(struct ann* self,
                const size_t num_epochs,
                const double learning_rate);
-double* ann_predict(struct ann* self, 
+int ann_train_stream(struct ann* self,
+                     const char* filepath,
+                     const size_t num_epochs,
+                     const double learning_rate,
+                     const size_t memory_budget);
+int ann_train_batch(struct ann* self,
+                    const size_t num_epochs,
+                    const size_t batch_size,
+                    const double learning_rate);
+int ann_train_loader(struct ann* self,
+                     const char* filepath,
+                     const size_t num_epochs,
+                     const size_t batch_size,
+                     const double learning_rate,
+                     const size_t memory_budget,
+                     struct ann_loader_stats* stats);
+int ann_train_synchronous(struct ann* self,
+                          const size_t num_epochs,
+                          const size_t batch_size,
+                          const double learning_rate,
+                          size_t num_threads);
+int ann_train_parallel(struct ann* self,
+                       const size_t num_epochs,
+                       const double learning_rate,
+                       size_t num_threads);
+double ann_loss(struct ann* self);
+real_t* ann_predict(struct ann* self, 
                     const struct double_vector* input);
+int ann_predict_batch(struct ann* self,
+                      const struct double_matrix* input,
+                      struct double_matrix* output,
+                      const size_t num_samples);
+int ann_batch_workspace_new(struct ann_batch_workspace* self,
+                            const struct ann* network,
+                            const size_t max_samples);
+void ann_batch_workspace_delete(struct ann_batch_workspace* self);
+int ann_predict_batch_ws(const struct ann* self,
+                         struct ann_batch_workspace* workspace,
+                         const struct double_matrix* input,
+                         struct double_matrix* output,
+                         const size_t num_samples);
+int ann_workspace_new(struct ann_workspace* self,
+                      const struct ann* network);
+void ann_workspace_delete(struct ann_workspace* self);
+int ann_predict_ws(const struct ann* self,
+                   struct ann_workspace* workspace,
+                   const struct double_vector* input,
+                   real_t* output);
 void ann_predict_range(struct ann* self, 
                        const struct double_2d_vector* inputs, 
                        FILE* ostream);
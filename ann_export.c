@@ -0,0 +1,424 @@
+/**************************************************************************************************
+* ann_export.c: Innehller funktionsdefinitioner fr export av trnade neurala ntverk till
+*               fristende C-kod. Sm lager (hgst ANN_EXPORT_UNROLL_LIMIT vikter) vecklas ut
+*               helt, dr vikter och bias skrivs ut som konstanter direkt i uttrycken och
+*               beskurna vikter (noll) utelmnas. Strre lager lagras transponerade, s att den
+*               inre loopen lper ver lagrets noder med konstant lngd och kan vektoriseras
+*               utan omordning av additionerna. Summeringen sker drmed i samma ordning som i
+*               den portabla berkningskrnan, dvs. vikt fr vikt fljt av bias.
+**************************************************************************************************/
+#include "ann_export.h"
+
+#include <ctype.h>
+#include <math.h>
+
+/* Makrodefinitioner: */
+#define ANN_EXPORT_UNROLL_LIMIT 256 /* Strsta antal vikter i ett lager som vecklas ut helt. */
+#define ANN_EXPORT_MAX_NAME 64      /* Strsta lngd p namnet fr genererade symboler. */
+#define ANN_EXPORT_ALIGNMENT 64     /* Minnesjustering i byte fr genererade flt. */
+
+#ifdef ANN_FLOAT32
+#define ANN_EXPORT_TYPE "float"     /* Flyttalstyp i genererad kod. */
+#define ANN_EXPORT_SUFFIX "f"       /* Suffix fr flyttalskonstanter samt matematiska funktioner. */
+#else
+#define ANN_EXPORT_TYPE "double"    /* Flyttalstyp i genererad kod. */
+#define ANN_EXPORT_SUFFIX ""        /* Suffix fr flyttalskonstanter samt matematiska funktioner. */
+#endif
+
+/* Statiska funktioner: */
+static const struct dense_layer* get_layer(const struct ann* self,
+                                           const size_t index);
+static size_t get_num_inputs(const struct ann* self,
+                             const size_t index);
+static void get_name(const char* filepath,
+                     char* name);
+static void write_header(const struct ann* self,
+                         const char* name,
+                         FILE* ostream);
+static void write_activations(const struct ann* self,
+                              const char* name,
+                              FILE* ostream);
+static void write_weights(const struct ann* self,
+                          const size_t index,
+                          const char* name,
+                          FILE* ostream);
+static void write_layer(const struct ann* self,
+                        const size_t index,
+                        const char* name,
+                        FILE* ostream);
+static void write_real(const real_t value,
+                       FILE* ostream);
+static inline bool is_unrolled(const struct ann* self,
+                               const size_t index);
+static bool is_finite(const struct ann* self);
+
+/**************************************************************************************************
+* ann_export_c: Skriver angivet trnat neuralt ntverk till en fristende C-fil innehllande
+*               funktionen <namn>_predict(input, output), dr namnet utgrs av filnamnet utan
+*               katalog samt filndelse (exempelvis model_predict fr filen model.c). Lagrens
+*               storlek, aktiveringsfunktioner, vikter samt bias kompileras in som konstanter,
+*               dr antalet insignaler respektive utsignaler ven anges via makrona
+*               <NAMN>_NUM_INPUTS samt <NAMN>_NUM_OUTPUTS. Den genererade funktionen anvnder
+*               flyttalstypen real_t (double eller float beroende p ANN_FLOAT32). Returnerar 1
+*               ifall ntverket innehller vikter eller bias som inte r ndliga (inf eller NaN,
+*               vilka saknar motsvarande konstanter i C) eller ifall filen inte kan skrivas,
+*               annars 0. Ingen fil skapas ifall ntverket innehller icke ndliga vrden.
+*
+*               - self    : Pekare till det trnade neurala ntverket.
+*               - filepath: Pekare till filskvgen som koden skall skrivas till.
+**************************************************************************************************/
+int ann_export_c(const struct ann* self,
+                 const char* filepath)
+{
+   const size_t num_layers = self->hidden_layers.size + 1;
+   char name[ANN_EXPORT_MAX_NAME + 8];
+   if (!is_finite(self))
+   {
+      fprintf(stderr, "Network contains non-finite weights and cannot be exported!\n\n");
+      return 1;
+   }
+
+   FILE* ostream = fopen(filepath, "w");
+   if (!ostream) return 1;
+   get_name(filepath, name);
+   write_header(self, name, ostream);
+   write_activations(self, name, ostream);
+
+   for (size_t i = 0; i < num_layers; ++i)
+   {
+      write_weights(self, i, name, ostream);
+   }
+
+   fprintf(ostream, "void %s_predict(const %s* restrict input, %s* restrict output)\n{\n",
+           name, ANN_EXPORT_TYPE, ANN_EXPORT_TYPE);
+
+   for (size_t i = 0; i + 1 < num_layers; ++i)
+   {
+      fprintf(ostream, "   %s layer%zu[%zu] __attribute__((aligned(%d)));\n", ANN_EXPORT_TYPE, i,
+              get_layer(self, i)->num_nodes, ANN_EXPORT_ALIGNMENT);
+   }
+
+   for (size_t i = 0; i < num_layers; ++i)
+   {
+      write_layer(self, i, name, ostream);
+   }
+
+   fprintf(ostream, "   return;\n}\n");
+
+   const bool error = ferror(ostream) != 0;
+   if (fclose(ostream) || error) return 1;
+   return 0;
+}
+
+/**************************************************************************************************
+* get_layer: Returnerar lagret med angivet index, dr dolda lager rknas frst fljt av det
+*            yttre lagret.
+*
+*            - self : Pekare till det neurala ntverket.
+*            - index: Lagrets index.
+**************************************************************************************************/
+static const struct dense_layer* get_layer(const struct ann* self,
+                                           const size_t index)
+{
+   if (index < self->hidden_layers.size) return &self->hidden_layers.data[index];
+   return &self->output_layer;
+}
+
+/**************************************************************************************************
+* get_num_inputs: Returnerar antalet vikter per nod som anvnds i lagret med angivet index,
+*                 vilket likt dense_layer_feedforward begrnsas till antalet insignaler.
+*
+*                 - self : Pekare till det neurala ntverket.
+*                 - index: Lagrets index.
+**************************************************************************************************/
+static size_t get_num_inputs(const struct ann* self,
+                             const size_t index)
+{
+   const size_t num_inputs = index ? get_layer(self, index - 1)->num_nodes : self->num_inputs;
+   const size_t num_weights = get_layer(self, index)->num_weights;
+   return num_weights < num_inputs ? num_weights : num_inputs;
+}
+
+/**************************************************************************************************
+* get_name: Skapar ett giltigt namn fr genererade symboler utifrn angiven filskvg, dr
+*           katalog samt filndelse tas bort och vriga tecken n bokstver och siffror erstts
+*           med understreck. Namnet ann anvnds ifall inget namn terstr.
+*
+*           - filepath: Pekare till filskvgen.
+*           - name    : Pekare till flt som namnet skall skrivas till.
+**************************************************************************************************/
+static void get_name(const char* filepath,
+                     char* name)
+{
+   const char* start = filepath;
+   size_t length = 0;
+
+   for (const char* i = filepath; *i; ++i)
+   {
+      if (*i == '/' || *i == '\\') start = i + 1;
+   }
+
+   if (isdigit((unsigned char)*start))
+   {
+      strcpy(name, "ann_");
+      length = strlen(name);
+   }
+
+   for (const char* i = start; *i && *i != '.' && length < ANN_EXPORT_MAX_NAME; ++i)
+   {
+      name[length++] = isalnum((unsigned char)*i) ? *i : '_';
+   }
+
+   name[length] = '\0';
+   if (!length) strcpy(name, "ann");
+   return;
+}
+
+/**************************************************************************************************
+* write_header: Skriver en inledande kommentar innehllande ntverkets topologi samt makron fr
+*               antalet insignaler och utsignaler till angiven utstrm.
+*
+*               - self   : Pekare till det neurala ntverket.
+*               - name   : Namnet fr genererade symboler.
+*               - ostream: Pekare till utstrmmen.
+**************************************************************************************************/
+static void write_header(const struct ann* self,
+                         const char* name,
+                         FILE* ostream)
+{
+   char upper[ANN_EXPORT_MAX_NAME + 8];
+   bool uses_math = false;
+
+   for (size_t i = 0; name[i]; ++i)
+   {
+      upper[i] = (char)toupper((unsigned char)name[i]);
+      upper[i + 1] = '\0';
+   }
+
+   fprintf(ostream, "/*\n * Generated by ann_export_c, do not edit.\n *\n");
+   fprintf(ostream, " * Topology: %zu inputs", self->num_inputs);
+
+   for (size_t i = 0; i < self->hidden_layers.size + 1; ++i)
+   {
+      const struct dense_layer* layer = get_layer(self, i);
+      fprintf(ostream, ", %zu %s", layer->num_nodes, activation_name(layer->activation));
+      uses_math |= layer->activation == ACTIVATION_SIGMOID || layer->activation == ACTIVATION_TANH;
+   }
+
+   fprintf(ostream, " (%s precision).\n *\n", ANN_EXPORT_TYPE);
+   fprintf(ostream, " * void %s_predict(const %s* input, %s* output);\n */\n", name,
+           ANN_EXPORT_TYPE, ANN_EXPORT_TYPE);
+   if (uses_math) fprintf(ostream, "#include <math.h>\n");
+   fprintf(ostream, "\n#define %s_NUM_INPUTS %zu\n", upper, self->num_inputs);
+   fprintf(ostream, "#define %s_NUM_OUTPUTS %zu\n\n", upper, self->num_outputs);
+   fprintf(ostream, "void %s_predict(const %s* restrict input, %s* restrict output);\n\n",
+           name, ANN_EXPORT_TYPE, ANN_EXPORT_TYPE);
+   return;
+}
+
+/**************************************************************************************************
+* write_activations: Skriver de aktiveringsfunktioner som anvnds i ntverket som statiska
+*                    inline-funktioner till angiven utstrm.
+*
+*                    - self   : Pekare till det neurala ntverket.
+*                    - name   : Namnet fr genererade symboler.
+*                    - ostream: Pekare till utstrmmen.
+**************************************************************************************************/
+static void write_activations(const struct ann* self,
+                              const char* name,
+                              FILE* ostream)
+{
+   bool used[ACTIVATION_LINEAR + 1] = { false };
+   const char* t = ANN_EXPORT_TYPE;
+   const char* f = ANN_EXPORT_SUFFIX;
+
+   for (size_t i = 0; i < self->hidden_layers.size + 1; ++i)
+   {
+      used[get_layer(self, i)->activation] = true;
+   }
+
+   for (enum activation i = ACTIVATION_RELU; i <= ACTIVATION_LINEAR; ++i)
+   {
+      if (!used[i]) continue;
+      fprintf(ostream, "static inline %s %s_%s(const %s x)\n{\n   return ", t, name,
+              activation_name(i), t);
+
+      if (i == ACTIVATION_RELU) fprintf(ostream, "x > 0 ? x : 0;\n");
+      else if (i == ACTIVATION_LEAKY_RELU) fprintf(ostream, "x > 0 ? x : 0.01%s * x;\n", f);
+      else if (i == ACTIVATION_SIGMOID) fprintf(ostream, "1 / (1 + exp%s(-x));\n", f);
+      else if (i == ACTIVATION_TANH) fprintf(ostream, "tanh%s(x);\n", f);
+      else fprintf(ostream, "x;\n");
+
+      fprintf(ostream, "}\n\n");
+   }
+   return;
+}
+
+/**************************************************************************************************
+* write_weights: Skriver vikter samt bias fr lagret med angivet index som justerade
+*                static const-flt till angiven utstrm, dr vikterna lagras transponerade.
+*                Utvecklade lager skrivs i stllet direkt i uttrycken, se write_layer.
+*
+*                - self   : Pekare till det neurala ntverket.
+*                - index  : Lagrets index.
+*                - name   : Namnet fr genererade symboler.
+*                - ostream: Pekare till utstrmmen.
+**************************************************************************************************/
+static void write_weights(const struct ann* self,
+                          const size_t index,
+                          const char* name,
+                          FILE* ostream)
+{
+   const struct dense_layer* layer = get_layer(self, index);
+   const size_t num_inputs = get_num_inputs(self, index);
+   if (is_unrolled(self, index)) return;
+
+   fprintf(ostream, "static const %s %s_weights%zu[%zu][%zu] __attribute__((aligned(%d))) =\n{\n",
+           ANN_EXPORT_TYPE, name, index, num_inputs, layer->num_nodes, ANN_EXPORT_ALIGNMENT);
+
+   for (size_t j = 0; j < num_inputs; ++j)
+   {
+      fprintf(ostream, "   {");
+
+      for (size_t i = 0; i < layer->num_nodes; ++i)
+      {
+         fprintf(ostream, i ? ", " : " ");
+         write_real(double_matrix_row(&layer->weights, i)[j], ostream);
+      }
+      fprintf(ostream, " },\n");
+   }
+
+   fprintf(ostream, "};\n\nstatic const %s %s_bias%zu[%zu] __attribute__((aligned(%d))) =\n{\n  ",
+           ANN_EXPORT_TYPE, name, index, layer->num_nodes, ANN_EXPORT_ALIGNMENT);
+
+   for (size_t i = 0; i < layer->num_nodes; ++i)
+   {
+      fprintf(ostream, " ");
+      write_real(layer->bias.data[i], ostream);
+      fprintf(ostream, ",");
+   }
+
+   fprintf(ostream, "\n};\n\n");
+   return;
+}
+
+/**************************************************************************************************
+* write_layer: Skriver berkningen av lagret med angivet index till angiven utstrm. Utvecklade
+*              lager skrivs som ett uttryck per nod, vriga lager som loopar med konstanta
+*              grnser ver de transponerade vikterna.
+*
+*              - self   : Pekare till det neurala ntverket.
+*              - index  : Lagrets index.
+*              - name   : Namnet fr genererade symboler.
+*              - ostream: Pekare till utstrmmen.
+**************************************************************************************************/
+static void write_layer(const struct ann* self,
+                        const size_t index,
+                        const char* name,
+                        FILE* ostream)
+{
+   const struct dense_layer* layer = get_layer(self, index);
+   const size_t num_inputs = get_num_inputs(self, index);
+   const char* activation = activation_name(layer->activation);
+   char input[32], output[32];
+
+   if (index) sprintf(input, "layer%zu", index - 1);
+   else strcpy(input, "input");
+   if (index < self->hidden_layers.size) sprintf(output, "layer%zu", index);
+   else strcpy(output, "output");
+
+   fprintf(ostream, "\n   /* Layer %zu: %zu nodes, %zu weights per node, %s. */\n", index,
+           layer->num_nodes, num_inputs, activation);
+
+   if (is_unrolled(self, index))
+   {
+      for (size_t i = 0; i < layer->num_nodes; ++i)
+      {
+         const real_t* weights = double_matrix_row(&layer->weights, i);
+         fprintf(ostream, "   %s[%zu] = %s_%s(", output, i, name, activation);
+
+         for (size_t j = 0; j < num_inputs; ++j)
+         {
+            if (weights[j] == 0) continue;
+            write_real(weights[j], ostream);
+            fprintf(ostream, " * %s[%zu] + ", input, j);
+         }
+
+         write_real(layer->bias.data[i], ostream);
+         fprintf(ostream, ");\n");
+      }
+      return;
+   }
+
+   fprintf(ostream, "   for (int i = 0; i < %zu; ++i) %s[i] = 0;\n\n", layer->num_nodes, output);
+   fprintf(ostream, "   for (int j = 0; j < %zu; ++j)\n   {\n", num_inputs);
+   fprintf(ostream, "      for (int i = 0; i < %zu; ++i) %s[i] += %s_weights%zu[j][i] * %s[j];\n",
+           layer->num_nodes, output, name, index, input);
+   fprintf(ostream, "   }\n\n");
+   fprintf(ostream, "   for (int i = 0; i < %zu; ++i) %s[i] = %s_%s(%s[i] + %s_bias%zu[i]);\n",
+           layer->num_nodes, output, name, activation, output, name, index);
+   return;
+}
+
+/**************************************************************************************************
+* write_real: Skriver angivet flyttal som en C-konstant av typen real_t till angiven utstrm,
+*             med tillrckligt mnga siffror fr att vrdet skall terskapas exakt.
+*
+*             - value  : Flyttalet som skall skrivas ut.
+*             - ostream: Pekare till utstrmmen.
+**************************************************************************************************/
+static void write_real(const real_t value,
+                       FILE* ostream)
+{
+   char buffer[40];
+#ifdef ANN_FLOAT32
+   sprintf(buffer, "%.9g", (double)value);
+#else
+   sprintf(buffer, "%.17g", value);
+#endif
+
+   if (!strpbrk(buffer, ".e")) strcat(buffer, ".0");
+   fprintf(ostream, "%s%s", buffer, ANN_EXPORT_SUFFIX);
+   return;
+}
+
+/**************************************************************************************************
+* is_unrolled: Indikerar ifall lagret med angivet index skall vecklas ut helt, vilket sker ifall
+*              lagret innehller hgst ANN_EXPORT_UNROLL_LIMIT vikter.
+*
+*              - self : Pekare till det neurala ntverket.
+*              - index: Lagrets index.
+**************************************************************************************************/
+static inline bool is_unrolled(const struct ann* self,
+                               const size_t index)
+{
+   return get_layer(self, index)->num_nodes * get_num_inputs(self, index) <=
+          ANN_EXPORT_UNROLL_LIMIT;
+}
+
+/**************************************************************************************************
+* is_finite: Indikerar ifall samtliga vikter och bias som skrivs ut fr angivet ntverk r
+*            ndliga, vilket krvs fr att de skall kunna uttryckas som konstanter i C.
+*
+*            - self: Pekare till det neurala ntverket.
+**************************************************************************************************/
+static bool is_finite(const struct ann* self)
+{
+   for (size_t index = 0; index < self->hidden_layers.size + 1; ++index)
+   {
+      const struct dense_layer* layer = get_layer(self, index);
+      const size_t num_inputs = get_num_inputs(self, index);
+
+      for (size_t i = 0; i < layer->num_nodes; ++i)
+      {
+         const real_t* weights = double_matrix_row(&layer->weights, i);
+         if (!isfinite(layer->bias.data[i])) return false;
+
+         for (size_t j = 0; j < num_inputs; ++j)
+         {
+            if (!isfinite(weights[j])) return false;
+         }
+      }
+   }
+   return true;
+}
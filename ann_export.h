@@ -0,0 +1,19 @@
+/**************************************************************************************************
+* ann_export.h: Innehller funktionalitet fr export av trnade neurala ntverk till fristende
+*               C-kod, dr ntverkets topologi kompileras in som konstanter. Den genererade
+*               funktionen allokerar inget minne, saknar kontroller av indatans storlek och
+*               lagrar vikterna som justerade static const-flt, vilket medfr att kompilatorn
+*               kan veckla ut samt vektorisera samtliga loopar fr den aktuella topologin.
+**************************************************************************************************/
+#ifndef ANN_EXPORT_H_
+#define ANN_EXPORT_H_
+
+/* Inkluderingsdirektiv: */
+#include "def.h"
+#include "ann.h"
+
+/* Externa funktioner: */
+int ann_export_c(const struct ann* self,
+                 const char* filepath);
+
+#endif /* ANN_EXPORT_H_ */
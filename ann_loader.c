@@ -0,0 +1,354 @@
+/**************************************************************************************************
+* ann_loader.c: Innehller funktionsdefinitioner fr inlsning av trningsdata i en
+*               bakgrundstrd. Ringbuffern indexeras via tv rknare, dr enbart producenten
+*               skriver till rknaren fr producerade batcher och enbart konsumenten skriver
+*               till rknaren fr konsumerade batcher. En batch publiceras genom att
+*               producentens rknare rknas upp med release-semantik, vilket medfr att batchens
+*               innehll r synligt fr konsumenten nr rknaren har lsts med acquire-semantik,
+*               och vice versa nr en plats lmnas tillbaka. Batchen som avslutar inlsningen
+*               innehller noll uppsttningar.
+**************************************************************************************************/
+#include "ann_loader.h"
+
+#include <sched.h>
+#include <time.h>
+
+/* Statiska funktioner: */
+static void* ann_loader_run(void* arg);
+static struct ann_loader_batch* ann_loader_gather(struct ann_loader* self,
+                                                  struct ann_loader_batch* batch,
+                                                  const struct training_data* data);
+static struct ann_loader_batch* ann_loader_acquire(struct ann_loader* self);
+static void ann_loader_publish(struct ann_loader* self);
+static void wait_while_equal(const atomic_size_t* counter,
+                             const size_t value,
+                             const atomic_bool* stop);
+static void copy_row(real_t* destination,
+                     const struct double_vector* source,
+                     const size_t size);
+static double get_time(void);
+
+/**************************************************************************************************
+* ann_loader_new: Startar inlsning av angivet antal epoker trningsdata i en bakgrundstrd,
+*                 dr uppsttningarna samlas i batcher av angiven storlek. Ifall en filskvg
+*                 anges strmmas trningsdatan frn en binr trningsdatafil inom angiven
+*                 minnesbudget, varvid angiven trningsdatabehllare enbart anvnds fr antalet
+*                 in- och utsignaler. Annars anvnds behllarens trningsdata, vars ordning
+*                 drefter enbart fr ndras av bakgrundstrden tills inlsningen har avslutats.
+*                 Infr varje epok randomiseras ordningen p uppsttningarna (vid strmning p
+*                 samma stt som i funktionen ann_train_stream). Den sista batchen i varje epok
+*                 kan innehlla frre uppsttningar n angiven batchstorlek.
+*
+*                 Returnerar 1 ifall batchstorleken r noll, filen inte kan ppnas, ifall
+*                 minnesallokering misslyckas eller ifall trden inte kan skapas, annars 0.
+*
+*                 - self         : Pekare till producenten.
+*                 - data         : Pekare till trningsdatabehllaren.
+*                 - filepath     : Filskvg till binr trningsdatafil (null = behllarens data).
+*                 - num_epochs   : Antalet epoker som skall lsas.
+*                 - batch_size   : Maximalt antal uppsttningar per batch.
+*                 - memory_budget: Minnesbudget i byte fr strmningen (0 = DATA_STREAM_BUDGET).
+**************************************************************************************************/
+int ann_loader_new(struct ann_loader* self,
+                   struct training_data* data,
+                   const char* filepath,
+                   const size_t num_epochs,
+                   const size_t batch_size,
+                   const size_t memory_budget)
+{
+   self->data = filepath ? 0 : data;
+   self->batch_size = batch_size;
+   self->num_epochs = num_epochs;
+   self->stats.batches = 0;
+   self->stats.producer_stall = 0;
+   self->stats.consumer_stall = 0;
+   self->failed = false;
+   atomic_init(&self->head, 0);
+   atomic_init(&self->tail, 0);
+   atomic_init(&self->stop, false);
+
+   for (size_t i = 0; i < ANN_LOADER_DEPTH; ++i)
+   {
+      double_matrix_new(&self->batches[i].input);
+      double_matrix_new(&self->batches[i].reference);
+      self->batches[i].num_samples = 0;
+   }
+
+   if (!batch_size) return 1;
+
+   if (filepath && data_stream_new(&self->stream, filepath, data->num_inputs,
+                                   data->num_outputs, memory_budget))
+   {
+      return 1;
+   }
+
+   for (size_t i = 0; i < ANN_LOADER_DEPTH; ++i)
+   {
+      if (double_matrix_resize(&self->batches[i].input, batch_size, data->num_inputs) ||
+          double_matrix_resize(&self->batches[i].reference, batch_size, data->num_outputs))
+      {
+         self->failed = true;
+      }
+   }
+
+   if (self->failed || pthread_create(&self->thread, 0, ann_loader_run, self))
+   {
+      for (size_t i = 0; i < ANN_LOADER_DEPTH; ++i)
+      {
+         double_matrix_delete(&self->batches[i].input);
+         double_matrix_delete(&self->batches[i].reference);
+      }
+
+      if (!self->data) data_stream_delete(&self->stream);
+      return 1;
+   }
+   return 0;
+}
+
+/**************************************************************************************************
+* ann_loader_delete: Avslutar inlsningen, ven om samtliga batcher inte har konsumerats, samt
+*                    frigr producentens batcher samt eventuell strm.
+*
+*                    - self: Pekare till producenten.
+**************************************************************************************************/
+void ann_loader_delete(struct ann_loader* self)
+{
+   atomic_store_explicit(&self->stop, true, memory_order_release);
+   pthread_join(self->thread, 0);
+
+   for (size_t i = 0; i < ANN_LOADER_DEPTH; ++i)
+   {
+      double_matrix_delete(&self->batches[i].input);
+      double_matrix_delete(&self->batches[i].reference);
+   }
+
+   if (!self->data) data_stream_delete(&self->stream);
+   return;
+}
+
+/**************************************************************************************************
+* ann_loader_next: Returnerar en pekare till nsta frdiga batch, och vntar ifall ingen batch
+*                  r frdig. Batchen r giltig tills den lmnas tillbaka via funktionen
+*                  ann_loader_release. Returnerar null nr samtliga epoker har lsts, eller
+*                  ifall inlsningen har misslyckats, varvid medlemmen failed stts.
+*
+*                  - self: Pekare till producenten.
+**************************************************************************************************/
+const struct ann_loader_batch* ann_loader_next(struct ann_loader* self)
+{
+   const size_t head = atomic_load_explicit(&self->head, memory_order_relaxed);
+
+   if (atomic_load_explicit(&self->tail, memory_order_acquire) == head)
+   {
+      const double start = get_time();
+      wait_while_equal(&self->tail, head, 0);
+      self->stats.consumer_stall += get_time() - start;
+   }
+
+   const struct ann_loader_batch* batch = &self->batches[head % ANN_LOADER_DEPTH];
+   if (!batch->num_samples) return 0;
+   self->stats.batches++;
+   return batch;
+}
+
+/**************************************************************************************************
+* ann_loader_release: Lmnar tillbaka batchen som senast returnerades av funktionen
+*                     ann_loader_next, s att producenten kan fylla platsen med en ny batch.
+*
+*                     - self: Pekare till producenten.
+**************************************************************************************************/
+void ann_loader_release(struct ann_loader* self)
+{
+   const size_t head = atomic_load_explicit(&self->head, memory_order_relaxed);
+   atomic_store_explicit(&self->head, head + 1, memory_order_release);
+   return;
+}
+
+/**************************************************************************************************
+* ann_loader_print_stats: Skriver ut angiven statistik fr en inlsning via angiven utstrm.
+*
+*                         - stats  : Pekare till statistiken som skall skrivas ut.
+*                         - ostream: Pekare till angiven utstrm (default = stdout).
+**************************************************************************************************/
+void ann_loader_print_stats(const struct ann_loader_stats* stats,
+                            FILE* ostream)
+{
+   if (!ostream) ostream = stdout;
+   fprintf(ostream, "Loaded %zu batches: producer stalled %.3f s, consumer stalled %.3f s\n",
+           stats->batches, stats->producer_stall, stats->consumer_stall);
+   return;
+}
+
+/**************************************************************************************************
+* ann_loader_run: Producentens trd, som lser angivet antal epoker och publicerar batcherna i
+*                 ringbuffern, fljt av en tom batch som avslutar inlsningen.
+*
+*                 - arg: Pekare till producenten.
+**************************************************************************************************/
+static void* ann_loader_run(void* arg)
+{
+   struct ann_loader* self = (struct ann_loader*)arg;
+   struct ann_loader_batch* batch = 0;
+
+   for (size_t i = 0; i < self->num_epochs && !self->failed; ++i)
+   {
+      if (self->data)
+      {
+         training_data_shuffle(self->data);
+         batch = ann_loader_gather(self, batch, self->data);
+      }
+      else
+      {
+         data_stream_shuffle(&self->stream);
+
+         for (struct training_data* chunk; !self->failed &&
+              (chunk = data_stream_next(&self->stream));)
+         {
+            training_data_shuffle(chunk);
+            batch = ann_loader_gather(self, batch, chunk);
+         }
+
+         if (self->stream.failed) self->failed = true;
+      }
+
+      if (batch)
+      {
+         ann_loader_publish(self);
+         batch = 0;
+      }
+   }
+
+   batch = ann_loader_acquire(self);
+
+   if (batch)
+   {
+      batch->num_samples = 0;
+      ann_loader_publish(self);
+   }
+   return 0;
+}
+
+/**************************************************************************************************
+* ann_loader_gather: Kopierar uppsttningarna i angiven trningsdata, i randomiserad ordning,
+*                    till batcher i ringbuffern och publicerar varje fylld batch. Returnerar en
+*                    pekare till den batch som pbrjats men inte fyllts, s att den kan fyllas
+*                    p med nsta block, eller null ifall ingen sdan batch finns.
+*
+*                    - self : Pekare till producenten.
+*                    - batch: Pekare till pbrjad batch (null = ingen).
+*                    - data : Pekare till trningsdatan som skall kopieras.
+**************************************************************************************************/
+static struct ann_loader_batch* ann_loader_gather(struct ann_loader* self,
+                                                  struct ann_loader_batch* batch,
+                                                  const struct training_data* data)
+{
+   for (size_t i = 0; i < data->sets; ++i)
+   {
+      if (!batch && !(batch = ann_loader_acquire(self))) return 0;
+
+      const size_t k = data->order.data[i];
+      copy_row(double_matrix_row(&batch->input, batch->num_samples), &data->in.data[k],
+               data->num_inputs);
+      copy_row(double_matrix_row(&batch->reference, batch->num_samples), &data->out.data[k],
+               data->num_outputs);
+
+      if (++batch->num_samples == self->batch_size)
+      {
+         ann_loader_publish(self);
+         batch = 0;
+      }
+   }
+   return batch;
+}
+
+/**************************************************************************************************
+* ann_loader_acquire: Returnerar en pekare till nsta lediga batch i ringbuffern, och vntar
+*                     ifall ringbuffern r full. Returnerar null ifall inlsningen har avbrutits
+*                     via funktionen ann_loader_delete, varvid medlemmen failed stts.
+*
+*                     - self: Pekare till producenten.
+**************************************************************************************************/
+static struct ann_loader_batch* ann_loader_acquire(struct ann_loader* self)
+{
+   const size_t tail = atomic_load_explicit(&self->tail, memory_order_relaxed);
+   const size_t full = tail - ANN_LOADER_DEPTH;
+
+   if (atomic_load_explicit(&self->head, memory_order_acquire) == full)
+   {
+      const double start = get_time();
+      wait_while_equal(&self->head, full, &self->stop);
+      self->stats.producer_stall += get_time() - start;
+   }
+
+   if (atomic_load_explicit(&self->stop, memory_order_acquire))
+   {
+      self->failed = true;
+      return 0;
+   }
+
+   struct ann_loader_batch* batch = &self->batches[tail % ANN_LOADER_DEPTH];
+   batch->num_samples = 0;
+   return batch;
+}
+
+/**************************************************************************************************
+* ann_loader_publish: Publicerar batchen som senast returnerades av funktionen
+*                     ann_loader_acquire, s att den kan tas emot av konsumenten.
+*
+*                     - self: Pekare till producenten.
+**************************************************************************************************/
+static void ann_loader_publish(struct ann_loader* self)
+{
+   const size_t tail = atomic_load_explicit(&self->tail, memory_order_relaxed);
+   atomic_store_explicit(&self->tail, tail + 1, memory_order_release);
+   return;
+}
+
+/**************************************************************************************************
+* wait_while_equal: Vntar s lnge angiven rknare har angivet vrde, eller tills angiven
+*                   flagga stts. Rknaren kontrolleras upprepade gnger, dr processorn lmnas
+*                   ver till andra trdar efter ANN_LOADER_SPIN kontroller.
+*
+*                   - counter: Pekare till rknaren.
+*                   - value  : Vrdet som rknaren har medan trden vntar.
+*                   - stop   : Pekare till flagga som avbryter vntan (null = ingen).
+**************************************************************************************************/
+static void wait_while_equal(const atomic_size_t* counter,
+                             const size_t value,
+                             const atomic_bool* stop)
+{
+   for (size_t i = 0; atomic_load_explicit(counter, memory_order_acquire) == value; ++i)
+   {
+      if (stop && atomic_load_explicit(stop, memory_order_acquire)) return;
+      if (i >= ANN_LOADER_SPIN) sched_yield();
+   }
+   return;
+}
+
+/**************************************************************************************************
+* copy_row: Kopierar angivet antal flyttal frn en vektor till en rad i en matris. Ifall vektorn
+*           innehller frre element fylls resterande element med nollor.
+*
+*           - destination: Pekare till raden som flyttalen skall kopieras till.
+*           - source     : Pekare till vektorn som flyttalen skall kopieras frn.
+*           - size       : Antalet flyttal som skall kopieras.
+**************************************************************************************************/
+static void copy_row(real_t* destination,
+                     const struct double_vector* source,
+                     const size_t size)
+{
+   const size_t num = source->size < size ? source->size : size;
+   memcpy(destination, source->data, sizeof(real_t) * num);
+   memset(destination + num, 0, sizeof(real_t) * (size - num));
+   return;
+}
+
+/**************************************************************************************************
+* get_time: Returnerar aktuell tid i sekunder.
+**************************************************************************************************/
+static double get_time(void)
+{
+   struct timespec time;
+   timespec_get(&time, TIME_UTC);
+   return time.tv_sec + time.tv_nsec * 1e-9;
+}
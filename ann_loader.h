@@ -0,0 +1,87 @@
+/**************************************************************************************************
+* ann_loader.h: Innehller funktionalitet fr inlsning av trningsdata i en bakgrundstrd, som
+*               separerar datavgen frn berkningarna vid trning. Bakgrundstrden (producenten)
+*               lser trningsdatan, randomiserar ordningen och samlar uppsttningarna i batcher,
+*               vilka lmnas ver till trden som trnar ntverket (konsumenten) via en begrnsad
+*               ringbuffer utan ls fr en producent samt en konsument. Konsumenten tar drmed
+*               enbart emot frdiga batcher och vntar aldrig p fillsning eller inlsning,
+*               s lnge producenten hinner med, medan producenten fyller nsta batch samtidigt
+*               som konsumenten trnar p fregende.
+*
+*               Trningsdatan lses antingen strmmande frn en binr trningsdatafil (se
+*               data_stream.h) eller frn en befintlig trningsdatabehllare i minnet. Tiden som
+*               producenten vntar p en ledig plats i ringbuffern samt tiden som konsumenten
+*               vntar p en frdig batch mts, s att det gr att avgra vilken sida som
+*               begrnsar genomstrmningen.
+**************************************************************************************************/
+#ifndef ANN_LOADER_H_
+#define ANN_LOADER_H_
+
+/* Inkluderingsdirektiv: */
+#include "def.h"
+#include "double_matrix.h"
+#include "training_data.h"
+#include "data_stream.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+/* Makrodefinitioner: */
+#define ANN_LOADER_DEPTH 4       /* Antalet batcher som ryms i ringbuffern. */
+#define ANN_LOADER_CACHE_LINE 64 /* Storleken p en cacheminnesrad i byte. */
+#define ANN_LOADER_SPIN 1000     /* Antalet kontroller innan en vntande trd lmnar processorn. */
+
+/**************************************************************************************************
+* ann_loader_batch: En batch i ringbuffern, med en rad per uppsttning.
+**************************************************************************************************/
+struct ann_loader_batch
+{
+   struct double_matrix input;     /* Indata fr batchens uppsttningar. */
+   struct double_matrix reference; /* Referensvrden fr batchens uppsttningar. */
+   size_t num_samples;             /* Antalet uppsttningar i batchen (0 = slut p datan). */
+};
+
+/**************************************************************************************************
+* ann_loader_stats: Statistik fr en inlsning, dr vntetiderna anges i sekunder.
+**************************************************************************************************/
+struct ann_loader_stats
+{
+   size_t batches;        /* Antalet batcher som har lmnats ver till konsumenten. */
+   double producer_stall; /* Tid som producenten har vntat p en ledig plats i ringbuffern. */
+   double consumer_stall; /* Tid som konsumenten har vntat p en frdig batch. */
+};
+
+/**************************************************************************************************
+* ann_loader: Producent som lser trningsdata i en bakgrundstrd och lmnar ver batcher via
+*             en ringbuffer. Positionerna fr lsning respektive skrivning ligger p var sin
+*             cacheminnesrad, s att producenten och konsumenten inte delar cacheminnesrad.
+**************************************************************************************************/
+struct ann_loader
+{
+   struct ann_loader_batch batches[ANN_LOADER_DEPTH];  /* Ringbufferns batcher. */
+   struct training_data* data;                         /* Trningsdata i minnet (eller null). */
+   struct data_stream stream;                          /* Strm frn binr fil (om data r null). */
+   size_t batch_size;                                  /* Maximalt antal uppsttningar per batch. */
+   size_t num_epochs;                                  /* Antalet epoker som skall lsas. */
+   struct ann_loader_stats stats;                      /* Statistik sedan inlsningen startade. */
+   bool failed;                                        /* Indikerar ifall inlsningen misslyckats. */
+   pthread_t thread;                                   /* Producentens trd. */
+   _Alignas(ANN_LOADER_CACHE_LINE) atomic_size_t head; /* Antalet konsumerade batcher. */
+   _Alignas(ANN_LOADER_CACHE_LINE) atomic_size_t tail; /* Antalet producerade batcher. */
+   _Alignas(ANN_LOADER_CACHE_LINE) atomic_bool stop;   /* Indikerar ifall producenten avbryts. */
+};
+
+/* Externa funktioner: */
+int ann_loader_new(struct ann_loader* self,
+                   struct training_data* data,
+                   const char* filepath,
+                   const size_t num_epochs,
+                   const size_t batch_size,
+                   const size_t memory_budget);
+void ann_loader_delete(struct ann_loader* self);
+const struct ann_loader_batch* ann_loader_next(struct ann_loader* self);
+void ann_loader_release(struct ann_loader* self);
+void ann_loader_print_stats(const struct ann_loader_stats* stats,
+                            FILE* ostream);
+
+#endif /* ANN_LOADER_H_ */
@@ -0,0 +1,520 @@
+/**************************************************************************************************
+* ann_model.c: Innehller funktionsdefinitioner fr att spara samt lsa in neurala ntverk via
+*              binra modellfiler. Kontrollsummorna berknas likt FNV-1a, men ver 64-bitarsord
+*              i stllet fr enskilda byte, vilket medfr att en modellfil kan verifieras i
+*              ungefr samma takt som den kan lsas frn minnet.
+**************************************************************************************************/
+#include "ann_model.h"
+
+/* Makrodefinitioner: */
+#define ANN_MODEL_HASH_BASIS 14695981039346656037ULL /* Startvrde fr kontrollsummor. */
+#define ANN_MODEL_HASH_PRIME 1099511628211ULL        /* Multiplikator fr kontrollsummor. */
+
+/* Statiska funktioner: */
+static int ann_model_open(struct file_map* map,
+                          const char* filepath,
+                          const bool sequential,
+                          const bool verify);
+static int ann_model_check(const struct file_map* map,
+                           const bool verify);
+static int ann_model_build(struct ann* self,
+                           const struct file_map* map,
+                           const bool copy);
+static int ann_model_attach(struct dense_layer* self,
+                            const struct ann_model_layer* entry,
+                            const char* base,
+                            const bool copy);
+static uint64_t ann_model_layout(const struct ann* self,
+                                 struct ann_model_header* header,
+                                 struct ann_model_layer* table);
+static uint64_t header_checksum(const struct ann_model_header* header,
+                                const struct ann_model_layer* table);
+static uint64_t layer_checksum(const real_t* weights,
+                               const size_t num_weights,
+                               const real_t* bias,
+                               const size_t num_bias);
+static uint64_t checksum(uint64_t hash,
+                         const void* data,
+                         const size_t size);
+static struct dense_layer* get_layer(const struct ann* self,
+                                     const size_t index);
+static int write_padding(const uint64_t offset,
+                         const uint64_t position,
+                         FILE* fstream);
+static uint64_t align_offset(const uint64_t offset,
+                             const uint64_t alignment);
+
+/**************************************************************************************************
+* ann_save: Sparar angivet neuralt ntverk som en binr modellfil p angiven filskvg.
+*           Samtliga lagers vikter, biasvrden, aktiveringsfunktioner samt valda format fr
+*           kopior i halv precision och gles form sparas, medan trningsdatan inte sparas.
+*           Flyttalen lagras som real_t, vilket medfr att filen kan lsas av program som
+*           anvnder samma flyttalstyp. Returnerar 1 ifall minnesallokering misslyckas eller
+*           ifall filen inte kan skapas eller skrivas, annars 0.
+*
+*           - self    : Pekare till det neurala ntverket.
+*           - filepath: Filskvg dr modellfilen skall skapas.
+**************************************************************************************************/
+int ann_save(const struct ann* self,
+             const char* filepath)
+{
+   const size_t num_layers = self->hidden_layers.size + 1;
+   struct ann_model_header header;
+   struct ann_model_layer* table =
+      (struct ann_model_layer*)calloc(num_layers, sizeof(struct ann_model_layer));
+   if (!table) return 1;
+
+   const uint64_t table_end = ann_model_layout(self, &header, table);
+   FILE* fstream = fopen(filepath, "wb");
+
+   if (!fstream)
+   {
+      fprintf(stderr, "Could not open file at path %s!\n\n", filepath);
+      free(table);
+      return 1;
+   }
+
+   uint64_t position = table_end;
+   int status = fwrite(&header, sizeof(header), 1, fstream) != 1 ||
+                fwrite(table, sizeof(struct ann_model_layer), num_layers, fstream) != num_layers;
+
+   for (size_t i = 0; i < num_layers && !status; ++i)
+   {
+      const struct dense_layer* layer = get_layer(self, i);
+      const size_t num_weights = table[i].num_nodes * table[i].stride;
+
+      status = write_padding(table[i].weights_offset, position, fstream) ||
+               fwrite(layer->weights.data, sizeof(real_t), num_weights, fstream) != num_weights ||
+               write_padding(table[i].bias_offset, table[i].weights_offset +
+                             num_weights * sizeof(real_t), fstream) ||
+               fwrite(layer->bias.data, sizeof(real_t), layer->num_nodes, fstream) !=
+               layer->num_nodes;
+      position = table[i].bias_offset + layer->num_nodes * sizeof(real_t);
+   }
+
+   free(table);
+   return fclose(fstream) || status;
+}
+
+/**************************************************************************************************
+* ann_load: Initierar angivet neuralt ntverk frn en binr modellfil skapad via funktionen
+*           ann_save, dr samtliga vikter och biasvrden kopieras till ntverket. Samtliga
+*           kontrollsummor verifieras. Ntverket kan drefter anvndas som vilket ntverk som
+*           helst, exempelvis trnas vidare, och frigrs via funktionen ann_delete.
+*
+*           Returnerar 1 ifall filen inte kan ppnas, inte utgr en giltig modellfil fr
+*           flyttalstypen real_t, har en felaktig kontrollsumma eller ifall minnesallokering
+*           misslyckas, varvid ntverket inte initieras, annars 0.
+*
+*           - self    : Pekare till det neurala ntverket.
+*           - filepath: Filskvg till modellfilen.
+**************************************************************************************************/
+int ann_load(struct ann* self,
+             const char* filepath)
+{
+   struct file_map map;
+   if (ann_model_open(&map, filepath, true, true)) return 1;
+   const int status = ann_model_build(self, &map, true);
+   file_map_delete(&map);
+   return status;
+}
+
+/**************************************************************************************************
+* ann_map: Initierar angivet neuralt ntverk frn en binr modellfil skapad via funktionen
+*          ann_save, dr filen mappas till minnet och lagrens vikter samt biasvrden pekar
+*          direkt in i filen utan att kopieras. Enbart utsignaler, avvikelser samt eventuella
+*          kopior i halv precision eller gles form allokeras. Sidorna lses in av
+*          operativsystemet nr de anvnds och delas mellan processer som mappar samma fil.
+*          Mappningen tas bort nr ntverket raderas via funktionen ann_delete.
+*
+*          Mappningen r skrivskyddad, vilket medfr att ntverket enbart fr anvndas fr
+*          prediktion. Anrop av funktioner som ndrar vikterna, exempelvis ann_train,
+*          ann_sparsify eller ann_add_hidden_layer, r inte tilltna.
+*
+*          Huvudet och lagertabellen verifieras alltid, medan kontrollsummorna fr vikterna
+*          enbart verifieras p begran, eftersom samtliga vikter d mste lsas in direkt.
+*
+*          Returnerar 1 ifall filen inte kan ppnas, inte utgr en giltig modellfil fr
+*          flyttalstypen real_t, har en felaktig kontrollsumma eller ifall minnesallokering
+*          misslyckas, varvid ntverket inte initieras, annars 0.
+*
+*          - self    : Pekare till det neurala ntverket.
+*          - filepath: Filskvg till modellfilen.
+*          - verify  : Indikerar ifall kontrollsummorna fr lagrens vikter skall verifieras.
+**************************************************************************************************/
+int ann_map(struct ann* self,
+            const char* filepath,
+            const bool verify)
+{
+   struct file_map map;
+   if (ann_model_open(&map, filepath, false, verify)) return 1;
+
+   if ((uintptr_t)map.data % DOUBLE_MATRIX_ALIGNMENT)
+   {
+      fprintf(stderr, "Model file %s could not be mapped to an aligned address!\n\n", filepath);
+      file_map_delete(&map);
+      return 1;
+   }
+   return ann_model_build(self, &map, false);
+}
+
+/**************************************************************************************************
+* ann_model_open: Mappar modellfilen p angiven filskvg till minnet och kontrollerar att den
+*                 utgr en giltig modellfil. Returnerar 1 ifall filen inte kan ppnas eller r
+*                 ogiltig, varvid mappningen tas bort, annars 0.
+*
+*                 - map       : Pekare till mappningen.
+*                 - filepath  : Filskvg till modellfilen.
+*                 - sequential: Indikerar ifall filen kommer lsas sekventiellt.
+*                 - verify    : Indikerar ifall kontrollsummorna fr lagrens vikter skall
+*                               verifieras.
+**************************************************************************************************/
+static int ann_model_open(struct file_map* map,
+                          const char* filepath,
+                          const bool sequential,
+                          const bool verify)
+{
+   if (file_map_new(map, filepath, sequential))
+   {
+      fprintf(stderr, "Could not open file at path %s!\n\n", filepath);
+      return 1;
+   }
+
+   if (ann_model_check(map, verify))
+   {
+      fprintf(stderr, "File %s is not a valid model file!\n\n", filepath);
+      file_map_delete(map);
+      return 1;
+   }
+   return 0;
+}
+
+/**************************************************************************************************
+* ann_model_check: Kontrollerar att angiven mappning utgr en giltig modellfil fr flyttalstypen
+*                  real_t, det vill sga att huvudet och lagertabellen har korrekt kontrollsumma,
+*                  att varje lager har lika mnga vikter per nod som fregende lager har noder
+*                  (frsta lagret lika mnga som ntverkets insignaler) samt att samtliga lagers
+*                  block r justerade och ryms i filen. Ifall verifiering begrs kontrolleras
+*                  ven kontrollsummorna fr lagrens vikter. Returnerar 1 ifall filen r
+*                  ogiltig, annars 0.
+*
+*                  - map   : Pekare till mappningen.
+*                  - verify: Indikerar ifall kontrollsummorna fr lagrens vikter skall
+*                            verifieras.
+**************************************************************************************************/
+static int ann_model_check(const struct file_map* map,
+                           const bool verify)
+{
+   const struct ann_model_header* header = (const struct ann_model_header*)map->data;
+   const uint64_t size = map->size;
+
+   if (size < sizeof(*header) ||
+       memcmp(header->magic, ANN_MODEL_MAGIC, sizeof(ANN_MODEL_MAGIC)) ||
+       header->version != ANN_MODEL_VERSION || header->dtype != sizeof(real_t) ||
+       header->size != size || header->alignment != ANN_MODEL_ALIGNMENT ||
+       header->num_layers < 2 ||
+       header->num_layers > (size - sizeof(*header)) / sizeof(struct ann_model_layer))
+   {
+      return 1;
+   }
+
+   const struct ann_model_layer* table = (const struct ann_model_layer*)(header + 1);
+   if (header_checksum(header, table) != header->checksum) return 1;
+
+   for (uint64_t i = 0; i < header->num_layers; ++i)
+   {
+      const struct ann_model_layer* entry = &table[i];
+      const uint64_t max_values = size / sizeof(real_t);
+
+      if (!entry->num_nodes || entry->stride < entry->num_weights ||
+          (entry->stride * sizeof(real_t)) % DOUBLE_MATRIX_ALIGNMENT ||
+          entry->weights_offset % ANN_MODEL_ALIGNMENT || entry->bias_offset % ANN_MODEL_ALIGNMENT ||
+          !activation_valid((enum activation)entry->activation) ||
+          entry->weight_format > HALF_FORMAT_BF16 || entry->sparse > 1 ||
+          entry->num_weights != (i ? table[i - 1].num_nodes : header->num_inputs) ||
+          (i + 1 == header->num_layers && entry->num_nodes != header->num_outputs) ||
+          entry->num_nodes > max_values || entry->stride > max_values / entry->num_nodes)
+      {
+         return 1;
+      }
+
+      const uint64_t weights_size = entry->num_nodes * entry->stride * sizeof(real_t);
+      const uint64_t bias_size = entry->num_nodes * sizeof(real_t);
+
+      if (entry->weights_offset > size || weights_size > size - entry->weights_offset ||
+          entry->bias_offset > size || bias_size > size - entry->bias_offset)
+      {
+         return 1;
+      }
+
+      if (verify && layer_checksum((const real_t*)(map->data + entry->weights_offset),
+                                   entry->num_nodes * entry->stride,
+                                   (const real_t*)(map->data + entry->bias_offset),
+                                   entry->num_nodes) != entry->checksum)
+      {
+         return 1;
+      }
+   }
+   return 0;
+}
+
+/**************************************************************************************************
+* ann_model_build: Initierar angivet neuralt ntverk med topologin i angiven modellfil, varefter
+*                  lagrens vikter och biasvrden kopieras frn filen eller pekar in i filen.
+*                  Lagren skapas utan vikter, s att inga vikter allokeras eller slumpas innan
+*                  de erstts. Vid mappning vertar ntverket mappningen. Returnerar 1 ifall
+*                  minnesallokering misslyckas, varvid ntverket raderas (vid mappning ven
+*                  mappningen), annars 0.
+*
+*                  - self: Pekare till det neurala ntverket.
+*                  - map : Pekare till mappningen av en kontrollerad modellfil.
+*                  - copy: Indikerar ifall vikterna skall kopieras i stllet fr att mappas.
+**************************************************************************************************/
+static int ann_model_build(struct ann* self,
+                           const struct file_map* map,
+                           const bool copy)
+{
+   const struct ann_model_header* header = (const struct ann_model_header*)map->data;
+   const struct ann_model_layer* table = (const struct ann_model_layer*)(header + 1);
+   int status = 0;
+
+   self->num_inputs = (size_t)header->num_inputs;
+   self->num_outputs = (size_t)header->num_outputs;
+   self->input_layer = 0;
+   self->map.data = 0;
+   self->map.size = 0;
+   dense_layer_new(&self->output_layer, self->num_outputs, 0);
+   training_data_new(&self->training_data, self->num_inputs, self->num_outputs);
+   dense_layer_vector_new(&self->hidden_layers);
+   if (!copy) self->map = *map;
+
+   for (size_t i = 0; i + 1 < header->num_layers && !status; ++i)
+   {
+      status = dense_layer_vector_add_layer(&self->hidden_layers, table[i].num_nodes, 0);
+   }
+
+   for (size_t i = 0; i < header->num_layers && !status; ++i)
+   {
+      status = ann_model_attach(get_layer(self, i), &table[i], map->data, copy);
+   }
+
+   if (status) ann_delete(self);
+   return status;
+}
+
+/**************************************************************************************************
+* ann_model_attach: Tilldelar angivet lager, skapat utan vikter, vikter och biasvrden frn
+*                   angiven modellfil, antingen genom kopiering eller genom att lagret pekar in
+*                   i mappningen, samt lagrets aktiveringsfunktion. Drefter skapas eventuella
+*                   kopior i halv precision och gles form p nytt frn vikterna. Returnerar 1
+*                   ifall minnesallokering misslyckas, annars 0.
+*
+*                   - self : Pekare till lagret.
+*                   - entry: Pekare till lagrets element i modellfilens lagertabell.
+*                   - base : Pekare till modellfilens frsta byte.
+*                   - copy : Indikerar ifall vikterna skall kopieras i stllet fr att mappas.
+**************************************************************************************************/
+static int ann_model_attach(struct dense_layer* self,
+                            const struct ann_model_layer* entry,
+                            const char* base,
+                            const bool copy)
+{
+   real_t* weights = (real_t*)(base + entry->weights_offset);
+   real_t* bias = (real_t*)(base + entry->bias_offset);
+   const size_t num_weights = (size_t)entry->num_weights;
+
+   double_matrix_delete(&self->weights);
+
+   if (copy)
+   {
+      if (double_matrix_resize(&self->weights, self->num_nodes, num_weights)) return 1;
+
+      for (size_t i = 0; i < self->num_nodes; ++i)
+      {
+         memcpy(double_matrix_row(&self->weights, i), weights + i * entry->stride,
+                sizeof(real_t) * num_weights);
+      }
+
+      memcpy(self->bias.data, bias, sizeof(real_t) * self->num_nodes);
+   }
+   else
+   {
+      double_vector_delete(&self->bias);
+      self->weights.data = entry->stride ? weights : 0;
+      self->weights.rows = self->num_nodes;
+      self->weights.cols = num_weights;
+      self->weights.stride = (size_t)entry->stride;
+      self->bias.data = bias;
+      self->bias.size = self->num_nodes;
+      self->bias.capacity = self->num_nodes;
+   }
+
+   self->num_weights = num_weights;
+   dense_layer_set_activation(self, (enum activation)entry->activation);
+
+   if (entry->sparse && csr_matrix_sparsify(&self->sparse_weights, &self->weights, 0))
+   {
+      return 1;
+   }
+
+   return dense_layer_set_weight_format(self, (enum half_format)entry->weight_format);
+}
+
+/**************************************************************************************************
+* ann_model_layout: Fyller i modellfilens huvud samt lagertabell fr angivet neuralt ntverk,
+*                   inklusive samtliga kontrollsummor, och returnerar positionen i byte dr
+*                   lagertabellen slutar.
+*
+*                   - self  : Pekare till det neurala ntverket.
+*                   - header: Pekare till huvudet som skall fyllas i.
+*                   - table : Pekare till lagertabellen som skall fyllas i.
+**************************************************************************************************/
+static uint64_t ann_model_layout(const struct ann* self,
+                                 struct ann_model_header* header,
+                                 struct ann_model_layer* table)
+{
+   const size_t num_layers = self->hidden_layers.size + 1;
+   const uint64_t table_end = sizeof(*header) + sizeof(struct ann_model_layer) * num_layers;
+   uint64_t position = table_end;
+
+   for (size_t i = 0; i < num_layers; ++i)
+   {
+      const struct dense_layer* layer = get_layer(self, i);
+      struct ann_model_layer* entry = &table[i];
+
+      entry->num_nodes = layer->num_nodes;
+      entry->num_weights = layer->num_weights;
+      entry->stride = layer->weights.stride;
+      entry->weights_offset = align_offset(position, ANN_MODEL_ALIGNMENT);
+      position = entry->weights_offset + entry->num_nodes * entry->stride * sizeof(real_t);
+      entry->bias_offset = align_offset(position, ANN_MODEL_ALIGNMENT);
+      position = entry->bias_offset + entry->num_nodes * sizeof(real_t);
+      entry->activation = (uint32_t)layer->activation;
+      entry->weight_format = (uint32_t)layer->half_weights.format;
+      entry->sparse = layer->sparse_weights.row_offsets != 0;
+      entry->reserved = 0;
+      entry->checksum = layer_checksum(layer->weights.data, entry->num_nodes * entry->stride,
+                                       layer->bias.data, layer->num_nodes);
+   }
+
+   memset(header, 0, sizeof(*header));
+   memcpy(header->magic, ANN_MODEL_MAGIC, sizeof(ANN_MODEL_MAGIC));
+   header->version = ANN_MODEL_VERSION;
+   header->dtype = sizeof(real_t);
+   header->num_inputs = self->num_inputs;
+   header->num_outputs = self->num_outputs;
+   header->num_layers = num_layers;
+   header->alignment = ANN_MODEL_ALIGNMENT;
+   header->size = position;
+   header->checksum = header_checksum(header, table);
+   return table_end;
+}
+
+/**************************************************************************************************
+* header_checksum: Returnerar kontrollsumman fr angivet huvud, med fltet fr kontrollsumman
+*                  nollstllt, fljt av angiven lagertabell.
+*
+*                  - header: Pekare till modellfilens huvud.
+*                  - table : Pekare till modellfilens lagertabell.
+**************************************************************************************************/
+static uint64_t header_checksum(const struct ann_model_header* header,
+                                const struct ann_model_layer* table)
+{
+   struct ann_model_header copy = *header;
+   copy.checksum = 0;
+   const uint64_t hash = checksum(ANN_MODEL_HASH_BASIS, &copy, sizeof(copy));
+   return checksum(hash, table, sizeof(struct ann_model_layer) * (size_t)header->num_layers);
+}
+
+/**************************************************************************************************
+* layer_checksum: Returnerar kontrollsumman fr ett lagers vikter fljt av dess biasvrden.
+*
+*                 - weights    : Pekare till lagrets vikter (inklusive utfyllnad).
+*                 - num_weights: Antalet flyttal i viktblocket.
+*                 - bias       : Pekare till lagrets biasvrden.
+*                 - num_bias   : Antalet biasvrden.
+**************************************************************************************************/
+static uint64_t layer_checksum(const real_t* weights,
+                               const size_t num_weights,
+                               const real_t* bias,
+                               const size_t num_bias)
+{
+   const uint64_t hash = checksum(ANN_MODEL_HASH_BASIS, weights, sizeof(real_t) * num_weights);
+   return checksum(hash, bias, sizeof(real_t) * num_bias);
+}
+
+/**************************************************************************************************
+* checksum: Uppdaterar angiven kontrollsumma med angivet minnesblock och returnerar resultatet.
+*           Blocket bearbetas tta byte i taget, dr eventuella resterande byte bearbetas var
+*           fr sig.
+*
+*           - hash: Kontrollsumman som skall uppdateras.
+*           - data: Pekare till minnesblocket (fr vara null ifall storleken r noll).
+*           - size: Minnesblockets storlek i byte.
+**************************************************************************************************/
+static uint64_t checksum(uint64_t hash,
+                         const void* data,
+                         const size_t size)
+{
+   const uint8_t* bytes = (const uint8_t*)data;
+   size_t i = 0;
+
+   for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+   {
+      uint64_t word;
+      memcpy(&word, bytes + i, sizeof(word));
+      hash = (hash ^ word) * ANN_MODEL_HASH_PRIME;
+   }
+
+   for (; i < size; ++i)
+   {
+      hash = (hash ^ bytes[i]) * ANN_MODEL_HASH_PRIME;
+   }
+   return hash;
+}
+
+/**************************************************************************************************
+* get_layer: Returnerar lagret med angivet index, dr dolda lager rknas frst fljt av det
+*            yttre lagret.
+*
+*            - self : Pekare till det neurala ntverket.
+*            - index: Lagrets index.
+**************************************************************************************************/
+static struct dense_layer* get_layer(const struct ann* self,
+                                     const size_t index)
+{
+   if (index < self->hidden_layers.size) return &self->hidden_layers.data[index];
+   return (struct dense_layer*)&self->output_layer;
+}
+
+/**************************************************************************************************
+* write_padding: Skriver nollor till angiven filstrm frn aktuell position fram till angiven
+*                position. Returnerar 1 ifall skrivningen misslyckas, annars 0.
+*
+*                - offset  : Positionen som skall ns.
+*                - position: Aktuell position i filen.
+*                - fstream : Pekare till filstrmmen.
+**************************************************************************************************/
+static int write_padding(const uint64_t offset,
+                         const uint64_t position,
+                         FILE* fstream)
+{
+   for (uint64_t i = position; i < offset; ++i)
+   {
+      if (fputc(0, fstream) == EOF) return 1;
+   }
+   return 0;
+}
+
+/**************************************************************************************************
+* align_offset: Returnerar angiven position avrundad uppt till nrmaste multipel av angiven
+*               justering.
+*
+*               - offset   : Positionen som skall avrundas.
+*               - alignment: Justeringen i byte.
+**************************************************************************************************/
+static uint64_t align_offset(const uint64_t offset,
+                             const uint64_t alignment)
+{
+   return (offset + alignment - 1) / alignment * alignment;
+}
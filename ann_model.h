@@ -0,0 +1,73 @@
+/**************************************************************************************************
+* ann_model.h: Innehller funktionalitet fr att spara trnade neurala ntverk till binra
+*              modellfiler samt att lsa in dem igen, antingen genom att kopiera vikterna till
+*              ett nytt ntverk (ann_load) eller genom att mappa filen till minnet och anvnda
+*              vikterna direkt ur filen (ann_map). Det senare medfr att ett ntverk kan tas i
+*              bruk fr prediktion inom millisekunder oavsett storlek, d inga vikter lses in
+*              eller kopieras innan de anvnds, samt att multipla processer som mappar samma
+*              fil delar vikterna i operativsystemets sidcache.
+*
+*              En modellfil inleds av ett huvud (strukten ann_model_header) fljt av en tabell
+*              med ett element per lager (strukten ann_model_layer), dr dolda lager lagras
+*              frst fljt av det yttre lagret. Drefter fljer respektive lagers vikter, lagrade
+*              radvis med samma radsteg som i strukten double_matrix, samt biasvrden, dr
+*              varje block brjar p en multipel av ANN_MODEL_ALIGNMENT byte rknat frn filens
+*              brjan. Huvudet och tabellen skyddas av en gemensam kontrollsumma, och varje
+*              lagers vikter samt biasvrden av var sin. Samtliga tal lagras i maskinens
+*              byteordning.
+**************************************************************************************************/
+#ifndef ANN_MODEL_H_
+#define ANN_MODEL_H_
+
+/* Inkluderingsdirektiv: */
+#include "def.h"
+#include "ann.h"
+
+/* Makrodefinitioner: */
+#define ANN_MODEL_MAGIC "ANNMODL" /* Inledande tecken i binra modellfiler. */
+#define ANN_MODEL_VERSION 1       /* Aktuell version av modellformatet. */
+#define ANN_MODEL_ALIGNMENT 64    /* Justering i byte fr lagrens block i modellfiler. */
+
+/**************************************************************************************************
+* ann_model_header: Inledande huvud i binra modellfiler.
+**************************************************************************************************/
+struct ann_model_header
+{
+   char magic[8];         /* Filformatets identifierare, ANN_MODEL_MAGIC. */
+   uint32_t version;      /* Filformatets version, ANN_MODEL_VERSION. */
+   uint32_t dtype;        /* Storleken i byte p varje flyttal (8 = double, 4 = float). */
+   uint64_t num_inputs;   /* Antalet insignaler i ntverket. */
+   uint64_t num_outputs;  /* Antalet utsignaler i ntverket. */
+   uint64_t num_layers;   /* Antalet lager i tabellen (dolda lager + yttre lager). */
+   uint64_t alignment;    /* Justering i byte fr lagrens block. */
+   uint64_t size;         /* Filens storlek i byte. */
+   uint64_t checksum;     /* Kontrollsumma fr huvudet (med detta flt nollstllt) samt tabellen. */
+};
+
+/**************************************************************************************************
+* ann_model_layer: Element i modellfilens lagertabell.
+**************************************************************************************************/
+struct ann_model_layer
+{
+   uint64_t num_nodes;      /* Antalet noder i lagret. */
+   uint64_t num_weights;    /* Antalet vikter per nod. */
+   uint64_t stride;         /* Antalet flyttal mellan brjan p tv efterfljande viktrader. */
+   uint64_t weights_offset; /* Position i byte fr lagrets vikter. */
+   uint64_t bias_offset;    /* Position i byte fr lagrets biasvrden. */
+   uint64_t checksum;       /* Kontrollsumma fr lagrets vikter fljt av biasvrden. */
+   uint32_t activation;     /* Lagrets aktiveringsfunktion (enum activation). */
+   uint32_t weight_format;  /* Format fr kopian i halv precision (enum half_format). */
+   uint32_t sparse;         /* Indikerar ifall lagret har en gles kopia av vikterna. */
+   uint32_t reserved;       /* Reserverat fr framtida bruk, alltid noll. */
+};
+
+/* Externa funktioner: */
+int ann_save(const struct ann* self,
+             const char* filepath);
+int ann_load(struct ann* self,
+             const char* filepath);
+int ann_map(struct ann* self,
+            const char* filepath,
+            const bool verify);
+
+#endif /* ANN_MODEL_H_ */
@@ -0,0 +1,524 @@
+/**************************************************************************************************
+* ann_pipeline.c: Innehller funktionsdefinitioner fr trning av neurala ntverk i pipeline.
+*                 Varje steg ansvarar fr ett sammanhngande intervall av lager och turas om att
+*                 skicka nsta uppsttning framt samt fregende uppsttning bakt (1F1B), s
+*                 att antalet uppsttningar under behandling i ett steg begrnsas av antalet
+*                 efterfljande steg. Stegen signalerar varandra via atomra rknare per batch.
+*                 Nr samtliga uppsttningar har passerat synkroniseras stegen, varefter varje
+*                 steg ackumulerar gradienterna och justerar vikterna fr sina egna lager.
+**************************************************************************************************/
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
+#include "ann_pipeline.h"
+#include "dense_layer_batch.h"
+#include "simd.h"
+#include "gemm.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+/* Makrodefinitioner: */
+#define ANN_PIPELINE_SPIN 1000 /* Antalet kontroller innan en vntande trd lmnar processorn. */
+
+/**************************************************************************************************
+* ann_stage: Ett steg i pipelinen, vilket ansvarar fr lagren i intervallet [first, last).
+**************************************************************************************************/
+struct ann_stage
+{
+   struct ann_pipeline* shared; /* Pekare till tillstnd som delas av samtliga steg. */
+   size_t index;                /* Stegets index, dr steg 0 krs av anropande trd. */
+   size_t first;                /* Index fr stegets frsta lager. */
+   size_t last;                 /* Index efter stegets sista lager. */
+   size_t num_samples;          /* Antalet uppsttningar i stegets senaste batch. */
+   atomic_size_t forward;       /* Antalet uppsttningar i batchen som passerat framt. */
+   atomic_size_t backward;      /* Antalet uppsttningar i batchen som passerat bakt. */
+   pthread_t thread;            /* Trden som kr steget. */
+};
+
+/**************************************************************************************************
+* ann_pipeline: Tillstnd som delas av samtliga steg vid trning i pipeline.
+**************************************************************************************************/
+struct ann_pipeline
+{
+   struct ann* network;               /* Pekare till det neurala ntverket som trnas. */
+   struct ann_stage* stages;          /* Flt innehllande pipelinens steg. */
+   struct dense_layer_batch* batches; /* Arbetsminne fr dolda lager fljt av utgngslagret. */
+   struct double_matrix input;        /* Indata fr aktuell batch, en rad per uppsttning. */
+   struct double_matrix reference;    /* Referensvrden fr aktuell batch. */
+   size_t num_stages;                 /* Antalet steg i pipelinen. */
+   size_t num_layers;                 /* Antalet lager i ntverket (dolda lager + utgngslager). */
+   size_t begin;                      /* Index fr batchens frsta uppsttning i ordningsfljden. */
+   size_t num_samples;                /* Antalet trningsuppsttningar i aktuell batch. */
+   double learning_rate;              /* Lrhastigheten, avgr justeringsgraden vid avvikelse. */
+   bool stop;                         /* Indikerar ifall stegen skall avslutas. */
+   pthread_barrier_t barrier;         /* Barrir som synkroniserar stegen mellan varje batch. */
+   pthread_mutex_t mutex;             /* Ls som hindrar trdarna frn att starta fr tidigt. */
+};
+
+/* Statiska funktioner: */
+static int ann_pipeline_new(struct ann_pipeline* self,
+                            struct ann* network,
+                            const size_t batch_size,
+                            const size_t num_stages,
+                            const double learning_rate);
+static void ann_pipeline_delete(struct ann_pipeline* self);
+static void ann_pipeline_partition(struct ann_pipeline* self);
+static void* ann_stage_run(void* arg);
+static void ann_stage_process(struct ann_stage* self);
+static void ann_stage_forward(struct ann_stage* self,
+                              const size_t sample);
+static void ann_stage_backward(struct ann_stage* self,
+                               const size_t sample);
+static void ann_stage_update(struct ann_stage* self);
+static struct dense_layer* get_layer(struct ann* self,
+                                     const size_t index);
+static void copy_row(real_t* destination,
+                     const struct double_vector* source,
+                     const size_t size);
+static void wait_for(atomic_size_t* counter,
+                     const size_t value);
+static void pin_thread(pthread_t thread,
+                       const size_t core);
+
+/**************************************************************************************************
+* ann_train_pipelined: Trnar angivet neuralt ntverk angivet antal epoker med mini-batch i en
+*                      pipeline med angivet antal steg. Lagren frdelas mellan stegen s att
+*                      antalet vikter per steg blir s jmnt som mjligt, dr varje steg fr
+*                      minst ett lager. Steg 0 krs av anropande trd, vriga steg av egna
+*                      trdar bundna till var sin processorkrna. Infr varje epok randomiseras
+*                      ordningen p trningsuppsttningarna. Varje uppsttning i en batch passerar
+*                      stegen framt och sedan bakt, varefter gradienterna fr samtliga
+*                      uppsttningar tillmpas en gng per batch likt ann_train_batch. Resultatet
+*                      beror inte p trdarnas schemalggning. Vid noll steg anvnds ett steg per
+*                      tillgnglig processorkrna. Returnerar 1 ifall minnesallokering eller
+*                      skapande av trdar misslyckas, annars 0.
+*
+*                      - self         : Pekare till det neurala ntverket.
+*                      - num_epochs   : Antalet epoker/omgng trning som skall genomfras.
+*                      - batch_size   : Antalet trningsuppsttningar per batch.
+*                      - learning_rate: Lrhastigheten, avgr justeringsgraden vid avvikelse.
+*                      - num_stages   : Antalet steg i pipelinen (0 = antalet krnor).
+**************************************************************************************************/
+int ann_train_pipelined(struct ann* self,
+                        const size_t num_epochs,
+                        const size_t batch_size,
+                        const double learning_rate,
+                        size_t num_stages)
+{
+   const struct training_data* data = &self->training_data;
+   struct ann_pipeline pipeline;
+   size_t num_started = 0;
+   int status = 0;
+
+   if (!batch_size) return 1;
+
+   if (!num_stages)
+   {
+      const long num_cores = sysconf(_SC_NPROCESSORS_ONLN);
+      num_stages = num_cores > 0 ? (size_t)num_cores : 1;
+   }
+
+   if (ann_pipeline_new(&pipeline, self, batch_size, num_stages, learning_rate)) return 1;
+
+   simd_init();
+   pthread_mutex_init(&pipeline.mutex, 0);
+   pthread_mutex_lock(&pipeline.mutex);
+
+   for (size_t i = 1; i < pipeline.num_stages && !status; ++i)
+   {
+      struct ann_stage* stage = &pipeline.stages[i];
+
+      if (pthread_create(&stage->thread, 0, &ann_stage_run, stage))
+      {
+         status = 1;
+      }
+      else
+      {
+         pin_thread(stage->thread, i);
+         num_started++;
+      }
+   }
+
+   pipeline.stop = status ? true : false;
+   pthread_barrier_init(&pipeline.barrier, 0, (unsigned)(num_started + 1));
+   pthread_mutex_unlock(&pipeline.mutex);
+
+   for (size_t i = 0; i < num_epochs && !status; ++i)
+   {
+      training_data_shuffle(&self->training_data);
+
+      for (size_t j = 0; j < data->sets; j += batch_size)
+      {
+         pipeline.begin = j;
+         pipeline.num_samples = data->sets - j < batch_size ? data->sets - j : batch_size;
+         pthread_barrier_wait(&pipeline.barrier);
+         ann_stage_process(&pipeline.stages[0]);
+         pthread_barrier_wait(&pipeline.barrier);
+         ann_stage_update(&pipeline.stages[0]);
+      }
+   }
+
+   pipeline.stop = true;
+   pthread_barrier_wait(&pipeline.barrier);
+
+   for (size_t i = 1; i <= num_started; ++i)
+   {
+      pthread_join(pipeline.stages[i].thread, 0);
+   }
+
+   pthread_barrier_destroy(&pipeline.barrier);
+   pthread_mutex_destroy(&pipeline.mutex);
+   ann_pipeline_delete(&pipeline);
+   return status;
+}
+
+/**************************************************************************************************
+* ann_pipeline_new: Initierar tillstnd fr trning i pipeline, dr arbetsminne allokeras fr
+*                   samtliga lager och lagren frdelas mellan stegen. Antalet steg begrnsas till
+*                   antalet lager. Returnerar 1 ifall minnesallokering misslyckas, annars 0.
+*
+*                   - self         : Pekare till tillstndet.
+*                   - network      : Pekare till det neurala ntverket som skall trnas.
+*                   - batch_size   : Antalet trningsuppsttningar per batch.
+*                   - num_stages   : nskat antal steg i pipelinen.
+*                   - learning_rate: Lrhastigheten, avgr justeringsgraden vid avvikelse.
+**************************************************************************************************/
+static int ann_pipeline_new(struct ann_pipeline* self,
+                            struct ann* network,
+                            const size_t batch_size,
+                            const size_t num_stages,
+                            const double learning_rate)
+{
+   size_t num_batches = 0;
+
+   self->network = network;
+   self->num_layers = network->hidden_layers.size + 1;
+   self->num_stages = num_stages < self->num_layers ? num_stages : self->num_layers;
+   self->begin = 0;
+   self->num_samples = 0;
+   self->learning_rate = learning_rate;
+   self->stop = false;
+   double_matrix_new(&self->input);
+   double_matrix_new(&self->reference);
+   self->stages = (struct ann_stage*)calloc(self->num_stages, sizeof(struct ann_stage));
+   self->batches = (struct dense_layer_batch*)malloc(sizeof(struct dense_layer_batch) *
+                                                     self->num_layers);
+
+   if (self->stages && self->batches &&
+       !double_matrix_resize(&self->input, batch_size, network->num_inputs) &&
+       !double_matrix_resize(&self->reference, batch_size, network->num_outputs))
+   {
+      for (; num_batches < self->num_layers; ++num_batches)
+      {
+         if (dense_layer_batch_new(&self->batches[num_batches], get_layer(network, num_batches),
+                                   batch_size)) break;
+      }
+   }
+
+   if (num_batches < self->num_layers)
+   {
+      while (num_batches > 0) dense_layer_batch_delete(&self->batches[--num_batches]);
+      free(self->batches);
+      self->batches = 0;
+      ann_pipeline_delete(self);
+      return 1;
+   }
+
+   ann_pipeline_partition(self);
+   return 0;
+}
+
+/**************************************************************************************************
+* ann_pipeline_delete: Frigr minne fr angivet tillstnd fr trning i pipeline.
+*
+*                      - self: Pekare till tillstndet.
+**************************************************************************************************/
+static void ann_pipeline_delete(struct ann_pipeline* self)
+{
+   for (size_t i = 0; self->batches && i < self->num_layers; ++i)
+   {
+      dense_layer_batch_delete(&self->batches[i]);
+   }
+
+   free(self->batches);
+   free(self->stages);
+   double_matrix_delete(&self->input);
+   double_matrix_delete(&self->reference);
+   self->batches = 0;
+   self->stages = 0;
+   return;
+}
+
+/**************************************************************************************************
+* ann_pipeline_partition: Frdelar ntverkets lager mellan pipelinens steg i ordning, dr varje
+*                         steg tilldelas lager tills stegets andel av det sammanlagda antalet
+*                         vikter har uppntts. Varje steg tilldelas minst ett lager.
+*
+*                         - self: Pekare till tillstndet.
+**************************************************************************************************/
+static void ann_pipeline_partition(struct ann_pipeline* self)
+{
+   size_t total = 0, sum = 0, layer = 0;
+
+   for (size_t i = 0; i < self->num_layers; ++i)
+   {
+      const struct dense_layer* current = get_layer(self->network, i);
+      total += current->num_nodes * current->num_weights;
+   }
+
+   for (size_t i = 0; i < self->num_stages; ++i)
+   {
+      struct ann_stage* stage = &self->stages[i];
+      const size_t remaining = self->num_stages - i - 1;
+      stage->shared = self;
+      stage->index = i;
+      stage->first = layer;
+
+      do
+      {
+         const struct dense_layer* current = get_layer(self->network, layer++);
+         sum += current->num_nodes * current->num_weights;
+      } while (layer < self->num_layers - remaining &&
+               sum * self->num_stages < total * (i + 1));
+
+      stage->last = layer;
+      atomic_init(&stage->forward, 0);
+      atomic_init(&stage->backward, 0);
+   }
+   return;
+}
+
+/**************************************************************************************************
+* ann_stage_run: Startfunktion fr trdarna som kr pipelinens steg (utom steg 0). Trden
+*                vntar in vriga steg infr varje batch, lter batchens uppsttningar passera
+*                steget och justerar drefter stegets lager, tills trden beordras att avslutas,
+*                varefter trdens buffertar fr GEMM frigrs.
+*
+*                - arg: Pekare till steget.
+**************************************************************************************************/
+static void* ann_stage_run(void* arg)
+{
+   struct ann_stage* self = (struct ann_stage*)arg;
+   struct ann_pipeline* shared = self->shared;
+
+   pthread_mutex_lock(&shared->mutex);
+   pthread_mutex_unlock(&shared->mutex);
+
+   while (true)
+   {
+      pthread_barrier_wait(&shared->barrier);
+      if (shared->stop) break;
+      ann_stage_process(self);
+      pthread_barrier_wait(&shared->barrier);
+      ann_stage_update(self);
+   }
+
+   gemm_release();
+   return 0;
+}
+
+/**************************************************************************************************
+* ann_stage_process: Lter samtliga uppsttningar i aktuell batch passera angivet steg framt
+*                    samt bakt. Steget skickar nsta uppsttning framt s lnge antalet
+*                    uppsttningar under behandling understiger antalet terstende steg, och
+*                    skickar annars ldsta uppsttningen bakt, vilket hller samtliga steg
+*                    sysselsatta utan att pipelinen lser sig. Varje steg vntar in fregende
+*                    steg framt samt efterfljande steg bakt.
+*
+*                    - self: Pekare till steget.
+**************************************************************************************************/
+static void ann_stage_process(struct ann_stage* self)
+{
+   struct ann_pipeline* shared = self->shared;
+   const size_t num_samples = self->num_samples = shared->num_samples;
+   const size_t depth = shared->num_stages - self->index;
+   struct ann_stage* previous = self->index ? self - 1 : 0;
+   struct ann_stage* next = self->index + 1 < shared->num_stages ? self + 1 : 0;
+   size_t num_forward = 0, num_backward = 0;
+
+   while (num_backward < num_samples)
+   {
+      if (num_forward < num_samples && num_forward - num_backward < depth)
+      {
+         if (previous) wait_for(&previous->forward, num_forward + 1);
+         ann_stage_forward(self, num_forward);
+         atomic_store_explicit(&self->forward, ++num_forward, memory_order_release);
+      }
+      else
+      {
+         if (next) wait_for(&next->backward, num_backward + 1);
+         ann_stage_backward(self, num_backward);
+         atomic_store_explicit(&self->backward, ++num_backward, memory_order_release);
+      }
+   }
+   return;
+}
+
+/**************************************************************************************************
+* ann_stage_forward: Genomfr feedforward fr en uppsttning genom lagren i angivet steg, dr
+*                    frsta steget frst hmtar uppsttningens indata frn trningsdatan.
+*
+*                    - self  : Pekare till steget.
+*                    - sample: Uppsttningens index i aktuell batch.
+**************************************************************************************************/
+static void ann_stage_forward(struct ann_stage* self,
+                              const size_t sample)
+{
+   struct ann_pipeline* shared = self->shared;
+   struct ann* network = shared->network;
+   const struct training_data* data = &network->training_data;
+
+   for (size_t i = self->first; i < self->last; ++i)
+   {
+      if (i == 0)
+      {
+         copy_row(double_matrix_row(&shared->input, sample),
+                  &data->in.data[data->order.data[shared->begin + sample]], network->num_inputs);
+      }
+
+      dense_layer_batch_feedforward_sample(&shared->batches[i], get_layer(network, i),
+                                           i ? &shared->batches[i - 1].output : &shared->input,
+                                           sample);
+   }
+   return;
+}
+
+/**************************************************************************************************
+* ann_stage_backward: Berknar avvikelser fr en uppsttning i lagren i angivet steg, frn
+*                     stegets sista lager till dess frsta. Steget som innehller utgngslagret
+*                     hmtar frst uppsttningens referensvrden frn trningsdatan.
+*
+*                     - self  : Pekare till steget.
+*                     - sample: Uppsttningens index i aktuell batch.
+**************************************************************************************************/
+static void ann_stage_backward(struct ann_stage* self,
+                               const size_t sample)
+{
+   struct ann_pipeline* shared = self->shared;
+   struct ann* network = shared->network;
+   const struct training_data* data = &network->training_data;
+
+   for (size_t i = self->last; i > self->first; --i)
+   {
+      if (i == shared->num_layers)
+      {
+         copy_row(double_matrix_row(&shared->reference, sample),
+                  &data->out.data[data->order.data[shared->begin + sample]],
+                  network->num_outputs);
+         dense_layer_batch_compare_sample(&shared->batches[i - 1], &network->output_layer,
+                                          &shared->reference, sample);
+      }
+      else
+      {
+         dense_layer_batch_backpropagate_sample(&shared->batches[i - 1], get_layer(network, i - 1),
+                                                &shared->batches[i], get_layer(network, i),
+                                                sample);
+      }
+   }
+   return;
+}
+
+/**************************************************************************************************
+* ann_stage_update: Ackumulerar gradienterna fr aktuell batch och justerar drefter bias samt
+*                   vikter i lagren i angivet steg. Anropas nr samtliga steg har slutfrt
+*                   batchen, s att inget annat steg lser lagrens vikter under justeringen.
+*                   Antalet uppsttningar lses frn steget, eftersom anropande trd kan ha
+*                   pbrjat nsta batch. Stegets rknare nollstlls infr nsta batch.
+*
+*                   - self: Pekare till steget.
+**************************************************************************************************/
+static void ann_stage_update(struct ann_stage* self)
+{
+   struct ann_pipeline* shared = self->shared;
+
+   for (size_t i = self->first; i < self->last; ++i)
+   {
+      struct dense_layer* layer = get_layer(shared->network, i);
+      shared->batches[i].num_samples = self->num_samples;
+      dense_layer_batch_accumulate(&shared->batches[i], layer,
+                                   i ? &shared->batches[i - 1].output : &shared->input);
+      dense_layer_batch_optimize(&shared->batches[i], layer, shared->learning_rate);
+   }
+
+   atomic_store_explicit(&self->forward, 0, memory_order_relaxed);
+   atomic_store_explicit(&self->backward, 0, memory_order_relaxed);
+   return;
+}
+
+/**************************************************************************************************
+* get_layer: Returnerar lagret med angivet index, dr dolda lager rknas frst fljt av det
+*            yttre lagret.
+*
+*            - self : Pekare till det neurala ntverket.
+*            - index: Lagrets index.
+**************************************************************************************************/
+static struct dense_layer* get_layer(struct ann* self,
+                                     const size_t index)
+{
+   if (index < self->hidden_layers.size) return &self->hidden_layers.data[index];
+   return &self->output_layer;
+}
+
+/**************************************************************************************************
+* copy_row: Kopierar angivet antal flyttal frn en vektor till en rad i en matris. Ifall vektorn
+*           innehller frre element fylls resterande element med nollor.
+*
+*           - destination: Pekare till raden som flyttalen skall kopieras till.
+*           - source     : Pekare till vektorn som flyttalen skall kopieras frn.
+*           - size       : Antalet flyttal som skall kopieras.
+**************************************************************************************************/
+static void copy_row(real_t* destination,
+                     const struct double_vector* source,
+                     const size_t size)
+{
+   const size_t num = source->size < size ? source->size : size;
+   memcpy(destination, source->data, sizeof(real_t) * num);
+   memset(destination + num, 0, sizeof(real_t) * (size - num));
+   return;
+}
+
+/**************************************************************************************************
+* wait_for: Vntar tills angiven rknare har uppntt angivet vrde. Rknaren kontrolleras
+*           upprepade gnger, dr processorn lmnas ver till andra trdar efter
+*           ANN_PIPELINE_SPIN kontroller, ifall fler trdar n processorkrnor anvnds.
+*
+*           - counter: Pekare till rknaren.
+*           - value  : Vrdet som skall uppns.
+**************************************************************************************************/
+static void wait_for(atomic_size_t* counter,
+                     const size_t value)
+{
+   for (size_t i = 0; atomic_load_explicit(counter, memory_order_acquire) < value; ++i)
+   {
+      if (i >= ANN_PIPELINE_SPIN) sched_yield();
+   }
+   return;
+}
+
+/**************************************************************************************************
+* pin_thread: Binder angiven trd till angiven processorkrna (modulo antalet krnor), s att
+*             varje steg i pipelinen behller sina lager i samma krnas cacheminne. Stds enbart
+*             p Linux, p vriga plattformar schemalggs trden fritt.
+*
+*             - thread: Trden som skall bindas.
+*             - core  : Index fr processorkrnan.
+**************************************************************************************************/
+static void pin_thread(pthread_t thread,
+                       const size_t core)
+{
+#ifdef __linux__
+   const long num_cores = sysconf(_SC_NPROCESSORS_ONLN);
+   cpu_set_t cpus;
+   CPU_ZERO(&cpus);
+   CPU_SET(core % (num_cores > 0 ? (size_t)num_cores : 1), &cpus);
+   pthread_setaffinity_np(thread, sizeof(cpu_set_t), &cpus);
+#else
+   (void)thread;
+   (void)core;
+#endif
+   return;
+}
@@ -0,0 +1,26 @@
+/**************************************************************************************************
+* ann_pipeline.h: Innehller funktionalitet fr trning av neurala ntverk i pipeline, dr
+*                 ntverkets lager delas upp i steg som krs av var sin trd, bunden till var
+*                 sin processorkrna. Trningsuppsttningarna strmmar genom stegen en i taget,
+*                 s att feedforward fr nsta uppsttning i ett steg verlappar med berkningar
+*                 fr fregende uppsttning lngre fram i ntverket. Vikterna justeras en gng
+*                 per batch nr samtliga uppsttningar har passerat stegen framt samt bakt,
+*                 vilket medfr att samtliga uppsttningar i en batch berknas med samma version
+*                 av vikterna. Lmpar sig fr djupa ntverk med mnga medelstora lager, som r
+*                 fr sm fr att delas upp mellan trdar inom respektive lager.
+**************************************************************************************************/
+#ifndef ANN_PIPELINE_H_
+#define ANN_PIPELINE_H_
+
+/* Inkluderingsdirektiv: */
+#include "def.h"
+#include "ann.h"
+
+/* Externa funktioner: */
+int ann_train_pipelined(struct ann* self,
+                        const size_t num_epochs,
+                        const size_t batch_size,
+                        const double learning_rate,
+                        size_t num_stages);
+
+#endif /* ANN_PIPELINE_H_ */
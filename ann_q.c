@@ -0,0 +1,631 @@
+/**************************************************************************************************
+* ann_q.c: Innehller funktionsdefinitioner fr kvantiserad inferens med trnade neurala ntverk.
+*          Vid prediktion bearbetas vikterna fyra noder t gngen, dr samtliga insignaler i en
+*          batch multipliceras med aktuella rader innan nsta rader lses in. Drmed lses varje
+*          viktmatris en gng per batch.
+**************************************************************************************************/
+#include "ann_q.h"
+#include "simd.h"
+#include "simd_vector.h"
+
+/* Makrodefinitioner: */
+#define ANN_Q_ALIGNMENT 64    /* Minnesjustering i byte fr kvantiserade vikter och insignaler. */
+#define ANN_Q_WEIGHT_MAX 127  /* Strsta absolutbelopp fr kvantiserade vikter. */
+#define ANN_Q_INPUT_MAX 127   /* Strsta vrde fr kvantiserade insignaler (7 bitar). */
+#define ANN_Q_ROWS 4          /* Antalet noder som berknas per anrop av berkningskrnan. */
+
+/**************************************************************************************************
+* ann_q_kernel: Berkningskrna som berknar skalrprodukten av en kvantiserad insignal x och
+*               upp till ANN_Q_ROWS rader av kvantiserade vikter w, lagrade med angivet radsteg.
+**************************************************************************************************/
+typedef void (*ann_q_kernel)(const uint8_t* x, const int8_t* w, const size_t stride,
+                             const size_t rows, int32_t* sums);
+
+/* Statiska funktioner: */
+static const struct dense_layer* get_layer(const struct ann* network,
+                                           const size_t index);
+static int quantize_layer(struct ann_q_layer* self,
+                          const struct dense_layer* layer,
+                          const size_t num_inputs);
+static void delete_layer(struct ann_q_layer* self);
+static void set_range(struct ann_q_layer* self,
+                      const real_t min,
+                      const real_t max);
+static void update_range(const real_t* data, const size_t size, real_t* min, real_t* max);
+static int reserve(struct ann_q* self,
+                   const size_t num_samples);
+static void forward(struct ann_q* self, const real_t* input, const size_t input_stride,
+                    const size_t num_samples, real_t* output, const size_t output_stride);
+static void quantize_input(const struct ann_q_layer* self,
+                           const real_t* input,
+                           uint8_t* output);
+static ann_q_kernel get_kernel(void);
+static size_t round_up(const size_t x, const size_t multiple);
+static inline int32_t round_to_int(const real_t x);
+static void dot_scalar(const uint8_t* x, const int8_t* w, const size_t stride,
+                       const size_t rows, int32_t* sums);
+
+#ifdef SIMD_X86
+static void dot_avx2(const uint8_t* x, const int8_t* w, const size_t stride,
+                     const size_t rows, int32_t* sums);
+static void dot_vnni(const uint8_t* x, const int8_t* w, const size_t stride,
+                     const size_t rows, int32_t* sums);
+#endif
+
+/**************************************************************************************************
+* ann_q_new: Skapar en kvantiserad modell av angivet trnat neuralt ntverk. Vikterna kvantiseras
+*            symmetriskt per nod, varefter insignalernas intervall kalibreras mot ntverkets
+*            trningsdata. Returnerar 1 ifall minnesallokering misslyckas, annars 0.
+*
+*            - self   : Pekare till den kvantiserade modellen.
+*            - network: Pekare till det trnade neurala ntverket.
+**************************************************************************************************/
+int ann_q_new(struct ann_q* self,
+              struct ann* network)
+{
+   self->num_layers = network->hidden_layers.size + 1;
+   self->num_inputs = network->num_inputs;
+   self->num_outputs = network->num_outputs;
+   self->activations = 0;
+   self->values = 0;
+   self->capacity = 0;
+   self->layers = (struct ann_q_layer*)calloc(self->num_layers, sizeof(struct ann_q_layer));
+
+   if (!self->layers)
+   {
+      self->num_layers = 0;
+      return 1;
+   }
+
+   for (size_t i = 0; i < self->num_layers; ++i)
+   {
+      const size_t num_inputs = i ? get_layer(network, i - 1)->num_nodes : self->num_inputs;
+
+      if (quantize_layer(&self->layers[i], get_layer(network, i), num_inputs))
+      {
+         ann_q_delete(self);
+         return 1;
+      }
+   }
+
+   if (ann_q_calibrate(self, network, &network->training_data.in))
+   {
+      ann_q_delete(self);
+      return 1;
+   }
+   return 0;
+}
+
+/**************************************************************************************************
+* ann_q_delete: Frigr minne fr angiven kvantiserad modell.
+*
+*               - self: Pekare till den kvantiserade modellen.
+**************************************************************************************************/
+void ann_q_delete(struct ann_q* self)
+{
+   for (size_t i = 0; i < self->num_layers; ++i)
+   {
+      delete_layer(&self->layers[i]);
+   }
+
+   free(self->layers);
+   free(self->activations);
+   free(self->values);
+   self->layers = 0;
+   self->activations = 0;
+   self->values = 0;
+   self->num_layers = 0;
+   self->num_inputs = 0;
+   self->num_outputs = 0;
+   self->capacity = 0;
+   return;
+}
+
+/**************************************************************************************************
+* ann_q_calibrate: Vljer skalfaktor samt nollpunkt fr insignalerna till respektive lager utefter
+*                  det intervall som uppmts vid prediktion med det ursprungliga ntverket fr
+*                  angivna insignaler. Intervallet omfattar alltid noll, vilket medfr att noll
+*                  kan representeras exakt. Returnerar 1 ifall minnesallokering misslyckas,
+*                  annars 0.
+*
+*                  - self   : Pekare till den kvantiserade modellen.
+*                  - network: Pekare till det ntverk som modellen har skapats frn.
+*                  - inputs : Pekare till representativa insignaler fr kalibreringen.
+**************************************************************************************************/
+int ann_q_calibrate(struct ann_q* self,
+                    struct ann* network,
+                    const struct double_2d_vector* inputs)
+{
+   real_t* min = (real_t*)calloc(self->num_layers * 2, sizeof(real_t));
+   if (!min) return 1;
+   real_t* max = min + self->num_layers;
+
+   for (const struct double_vector* i = inputs->data; i < inputs->data + inputs->size; ++i)
+   {
+      if (i->size < self->num_inputs) continue;
+      ann_predict(network, i);
+      update_range(i->data, self->num_inputs, &min[0], &max[0]);
+
+      for (size_t j = 1; j < self->num_layers; ++j)
+      {
+         const struct dense_layer* previous = get_layer(network, j - 1);
+         update_range(previous->output.data, previous->num_nodes, &min[j], &max[j]);
+      }
+   }
+
+   for (size_t i = 0; i < self->num_layers; ++i)
+   {
+      set_range(&self->layers[i], min[i], max[i]);
+   }
+
+   free(min);
+   return 0;
+}
+
+/**************************************************************************************************
+* ann_q_predict: Genomfr prediktion med angiven kvantiserad modell utifrn givna insignaler och
+*                returnerar adressen till ett flt innehllande predikterade utsignaler. Ifall
+*                antalet insignaler r fr litet eller minnesallokering misslyckas returneras
+*                en nullpekare.
+*
+*                - self : Pekare till den kvantiserade modellen.
+*                - input: Pekare till vektor innehllande indata till modellen.
+**************************************************************************************************/
+real_t* ann_q_predict(struct ann_q* self,
+                      const struct double_vector* input)
+{
+   if (input->size < self->num_inputs || reserve(self, 1)) return 0;
+   forward(self, input->data, self->num_inputs, 1, self->values, self->num_outputs);
+   return self->values;
+}
+
+/**************************************************************************************************
+* ann_q_predict_batch: Genomfr prediktion med angiven kvantiserad modell fr flera kombinationer
+*                      av insignaler, lagrade med en rad per kombination. Predikterade utsignaler
+*                      lagras radvis i angiven matris, vars storlek anpassas efter behov.
+*                      Returnerar 1 ifall insignalerna har fel dimensioner eller ifall
+*                      minnesallokering misslyckas, annars 0.
+*
+*                      - self       : Pekare till den kvantiserade modellen.
+*                      - inputs     : Pekare till matris innehllande insignaler.
+*                      - num_samples: Antalet rader i matrisen som skall behandlas.
+*                      - outputs    : Pekare till matrisen dr utsignalerna skall lagras.
+**************************************************************************************************/
+int ann_q_predict_batch(struct ann_q* self,
+                        const struct double_matrix* inputs,
+                        const size_t num_samples,
+                        struct double_matrix* outputs)
+{
+   if (num_samples > inputs->rows || inputs->cols < self->num_inputs) return 1;
+   if (double_matrix_resize(outputs, num_samples, self->num_outputs)) return 1;
+   if (!num_samples) return 0;
+   if (reserve(self, num_samples)) return 1;
+   forward(self, inputs->data, inputs->stride, num_samples, outputs->data, outputs->stride);
+   return 0;
+}
+
+/**************************************************************************************************
+* ann_q_model_size: Returnerar antalet byte som angiven kvantiserad modells parametrar upptar,
+*                   inklusive utfyllnad av viktraderna.
+*
+*                   - self: Pekare till den kvantiserade modellen.
+**************************************************************************************************/
+size_t ann_q_model_size(const struct ann_q* self)
+{
+   size_t size = 0;
+
+   for (size_t i = 0; i < self->num_layers; ++i)
+   {
+      const struct ann_q_layer* layer = &self->layers[i];
+      size += layer->num_nodes * layer->stride;
+      size += layer->num_nodes * (sizeof(real_t) * 2 + sizeof(int32_t));
+   }
+   return size;
+}
+
+/**************************************************************************************************
+* get_layer: Returnerar dense-lagret med angivet index, dr dolda lager rknas frst fljt av
+*            det yttre lagret.
+*
+*            - network: Pekare till det neurala ntverket.
+*            - index  : Lagrets index.
+**************************************************************************************************/
+static const struct dense_layer* get_layer(const struct ann* network,
+                                           const size_t index)
+{
+   if (index < network->hidden_layers.size) return &network->hidden_layers.data[index];
+   return &network->output_layer;
+}
+
+/**************************************************************************************************
+* quantize_layer: Kvantiserar vikterna i angivet dense-lager symmetriskt per nod, dr strsta
+*                 absolutbelopp i respektive rad avbildas p ANN_Q_WEIGHT_MAX. Likt funktionen
+*                 dense_layer_feedforward anvnds enbart de vikter som motsvaras av en insignal.
+*                 Returnerar 1 ifall minnesallokering misslyckas, annars 0.
+*
+*                 - self      : Pekare till det kvantiserade lagret som skall fyllas i.
+*                 - layer     : Pekare till dense-lagret vars vikter skall kvantiseras.
+*                 - num_inputs: Antalet insignaler till lagret.
+**************************************************************************************************/
+static int quantize_layer(struct ann_q_layer* self,
+                          const struct dense_layer* layer,
+                          const size_t num_inputs)
+{
+   self->num_nodes = layer->num_nodes;
+   self->num_weights = layer->num_weights < num_inputs ? layer->num_weights : num_inputs;
+   self->activation = layer->activation;
+   self->stride = round_up(self->num_weights ? self->num_weights : 1, ANN_Q_ALIGNMENT);
+   self->weights = (int8_t*)aligned_alloc(ANN_Q_ALIGNMENT, self->num_nodes * self->stride);
+   self->scales = (real_t*)malloc(sizeof(real_t) * self->num_nodes);
+   self->row_sums = (int32_t*)malloc(sizeof(int32_t) * self->num_nodes);
+   self->bias = (real_t*)malloc(sizeof(real_t) * self->num_nodes);
+   set_range(self, 0, 1);
+
+   if (!self->weights || !self->scales || !self->row_sums || !self->bias) return 1;
+
+   for (size_t i = 0; i < self->num_nodes; ++i)
+   {
+      const real_t* row = double_matrix_row(&layer->weights, i);
+      int8_t* destination = self->weights + i * self->stride;
+      real_t max = 0;
+
+      for (size_t j = 0; j < self->num_weights; ++j)
+      {
+         const real_t magnitude = row[j] < 0 ? -row[j] : row[j];
+         if (magnitude > max) max = magnitude;
+      }
+
+      self->scales[i] = max > 0 ? max / ANN_Q_WEIGHT_MAX : 1;
+      self->row_sums[i] = 0;
+      self->bias[i] = layer->bias.data[i];
+
+      for (size_t j = 0; j < self->num_weights; ++j)
+      {
+         int32_t value = round_to_int(row[j] / self->scales[i]);
+         if (value > ANN_Q_WEIGHT_MAX) value = ANN_Q_WEIGHT_MAX;
+         if (value < -ANN_Q_WEIGHT_MAX) value = -ANN_Q_WEIGHT_MAX;
+         destination[j] = (int8_t)value;
+         self->row_sums[i] += value;
+      }
+
+      memset(destination + self->num_weights, 0, self->stride - self->num_weights);
+   }
+   return 0;
+}
+
+/**************************************************************************************************
+* delete_layer: Frigr minne fr angivet kvantiserat lager.
+*
+*               - self: Pekare till det kvantiserade lagret.
+**************************************************************************************************/
+static void delete_layer(struct ann_q_layer* self)
+{
+   free(self->weights);
+   free(self->scales);
+   free(self->row_sums);
+   free(self->bias);
+   self->weights = 0;
+   self->scales = 0;
+   self->row_sums = 0;
+   self->bias = 0;
+   self->num_nodes = 0;
+   self->num_weights = 0;
+   self->stride = 0;
+   return;
+}
+
+/**************************************************************************************************
+* set_range: Stter skalfaktor samt nollpunkt fr angivet lagers insignaler s att intervallet
+*            [min, max] avbildas p heltalen 0 - ANN_Q_INPUT_MAX.
+*
+*            - self: Pekare till det kvantiserade lagret.
+*            - min : Minsta frvntade insignal.
+*            - max : Strsta frvntade insignal.
+**************************************************************************************************/
+static void set_range(struct ann_q_layer* self,
+                      const real_t min,
+                      const real_t max)
+{
+   const real_t lower = min < 0 ? min : 0;
+   const real_t upper = max > lower ? max : lower + 1;
+   self->input_scale = (upper - lower) / ANN_Q_INPUT_MAX;
+   self->input_offset = round_to_int(-lower / self->input_scale);
+   if (self->input_offset > ANN_Q_INPUT_MAX) self->input_offset = ANN_Q_INPUT_MAX;
+   return;
+}
+
+/**************************************************************************************************
+* update_range: Utkar intervallet [min, max] s att samtliga element i angivet flt omfattas.
+*
+*               - data: Pekare till fltet.
+*               - size: Antalet element i fltet.
+*               - min : Pekare till intervallets undre grns.
+*               - max : Pekare till intervallets vre grns.
+**************************************************************************************************/
+static void update_range(const real_t* data, const size_t size, real_t* min, real_t* max)
+{
+   for (size_t i = 0; i < size; ++i)
+   {
+      if (data[i] < *min) *min = data[i];
+      if (data[i] > *max) *max = data[i];
+   }
+   return;
+}
+
+/**************************************************************************************************
+* reserve: Skerstller att arbetsminnet rymmer angivet antal trningsuppsttningar. Returnerar
+*          1 ifall minnesallokering misslyckas, annars 0.
+*
+*          - self       : Pekare till den kvantiserade modellen.
+*          - num_samples: Antalet trningsuppsttningar som arbetsminnet skall rymma.
+**************************************************************************************************/
+static int reserve(struct ann_q* self,
+                   const size_t num_samples)
+{
+   size_t stride = 0;
+   size_t width = self->num_outputs;
+   if (num_samples <= self->capacity) return 0;
+
+   for (size_t i = 0; i < self->num_layers; ++i)
+   {
+      if (self->layers[i].stride > stride) stride = self->layers[i].stride;
+      if (self->layers[i].num_nodes > width) width = self->layers[i].num_nodes;
+   }
+
+   uint8_t* activations = (uint8_t*)aligned_alloc(ANN_Q_ALIGNMENT, num_samples * stride);
+   real_t* values = (real_t*)malloc(sizeof(real_t) * num_samples * width);
+
+   if (!activations || !values)
+   {
+      free(activations);
+      free(values);
+      return 1;
+   }
+
+   free(self->activations);
+   free(self->values);
+   self->activations = activations;
+   self->values = values;
+   self->capacity = num_samples;
+   return 0;
+}
+
+/**************************************************************************************************
+* forward: Berknar utsignalerna frn samtliga lager fr angivet antal insignaler, lagrade
+*          radvis med angivet radsteg. Insignalerna till varje lager kvantiseras frst, varefter
+*          vikterna bearbetas ANN_Q_ROWS noder t gngen fr samtliga insignaler. Resultatet
+*          terskalas till flyttal, dr nollpunkten kompenseras via viktradernas summa, varefter
+*          bias adderas och lagrets aktiveringsfunktion tillmpas.
+*
+*          - self         : Pekare till den kvantiserade modellen.
+*          - input        : Pekare till insignalerna.
+*          - input_stride : Radsteg mellan insignalernas rader.
+*          - num_samples  : Antalet kombinationer av insignaler.
+*          - output       : Pekare till flt dr utsignalerna skall lagras.
+*          - output_stride: Radsteg mellan utsignalernas rader.
+**************************************************************************************************/
+static void forward(struct ann_q* self, const real_t* input, const size_t input_stride,
+                    const size_t num_samples, real_t* output, const size_t output_stride)
+{
+   const ann_q_kernel kernel = get_kernel();
+   const real_t* source = input;
+   size_t source_stride = input_stride;
+
+   for (size_t l = 0; l < self->num_layers; ++l)
+   {
+      const struct ann_q_layer* layer = &self->layers[l];
+      const bool last = l == self->num_layers - 1;
+      real_t* destination = last ? output : self->values;
+      const size_t destination_stride = last ? output_stride : layer->num_nodes;
+
+      for (size_t s = 0; s < num_samples; ++s)
+      {
+         quantize_input(layer, source + s * source_stride, self->activations + s * layer->stride);
+      }
+
+      for (size_t i = 0; i < layer->num_nodes; i += ANN_Q_ROWS)
+      {
+         const size_t rows = layer->num_nodes - i < ANN_Q_ROWS ? layer->num_nodes - i : ANN_Q_ROWS;
+         const int8_t* weights = layer->weights + i * layer->stride;
+
+         for (size_t s = 0; s < num_samples; ++s)
+         {
+            int32_t sums[ANN_Q_ROWS];
+            real_t* y = destination + s * destination_stride + i;
+            kernel(self->activations + s * layer->stride, weights, layer->stride, rows, sums);
+
+            for (size_t r = 0; r < rows; ++r)
+            {
+               const int32_t sum = sums[r] - layer->input_offset * layer->row_sums[i + r];
+               y[r] = layer->scales[i + r] * layer->input_scale * sum;
+            }
+         }
+      }
+
+      for (size_t s = 0; s < num_samples; ++s)
+      {
+         activation_apply(layer->activation, destination + s * destination_stride, layer->bias,
+                          layer->num_nodes);
+      }
+
+      source = destination;
+      source_stride = destination_stride;
+   }
+   return;
+}
+
+/**************************************************************************************************
+* quantize_input: Kvantiserar insignalerna till angivet lager enligt lagrets skalfaktor samt
+*                 nollpunkt. Utfyllnaden nollstlls, vilket gr att krnorna kan lsa hela rader.
+*
+*                 - self  : Pekare till det kvantiserade lagret.
+*                 - input : Pekare till insignalerna.
+*                 - output: Pekare till flt dr de kvantiserade insignalerna skall lagras.
+**************************************************************************************************/
+static void quantize_input(const struct ann_q_layer* self,
+                           const real_t* input,
+                           uint8_t* output)
+{
+   const real_t inverse_scale = 1 / self->input_scale;
+
+   for (size_t i = 0; i < self->num_weights; ++i)
+   {
+      int32_t value = round_to_int(input[i] * inverse_scale) + self->input_offset;
+      if (value < 0) value = 0;
+      if (value > ANN_Q_INPUT_MAX) value = ANN_Q_INPUT_MAX;
+      output[i] = (uint8_t)value;
+   }
+
+   memset(output + self->num_weights, 0, self->stride - self->num_weights);
+   return;
+}
+
+/**************************************************************************************************
+* get_kernel: Returnerar berkningskrnan fr den instruktionsuppsttning som anvnds i simd.c.
+*             VNNI-krnan anvnds enbart ifall processorn har std fr AVX512-VNNI.
+**************************************************************************************************/
+static ann_q_kernel get_kernel(void)
+{
+#ifdef SIMD_X86
+   const enum simd_isa isa = simd_get_isa();
+   if (isa == SIMD_ISA_AVX512 && __builtin_cpu_supports("avx512vnni")) return &dot_vnni;
+   if (isa == SIMD_ISA_AVX2 || isa == SIMD_ISA_AVX512) return &dot_avx2;
+#endif
+   return &dot_scalar;
+}
+
+/**************************************************************************************************
+* round_up: Returnerar x avrundat uppt till nrmaste multipel av angivet tal.
+*
+*           - x       : Talet som skall avrundas.
+*           - multiple: Talet vars multipel avrundas till.
+**************************************************************************************************/
+static size_t round_up(const size_t x, const size_t multiple)
+{
+   return (x + multiple - 1) / multiple * multiple;
+}
+
+/**************************************************************************************************
+* round_to_int: Returnerar x avrundat till nrmaste heltal.
+*
+*               - x: Talet som skall avrundas.
+**************************************************************************************************/
+static inline int32_t round_to_int(const real_t x)
+{
+   return (int32_t)(x < 0 ? x - 0.5 : x + 0.5);
+}
+
+/**************************************************************************************************
+* dot_scalar: Portabel berkningskrna fr kvantiserade skalrprodukter.
+*
+*             - x     : Pekare till de kvantiserade insignalerna.
+*             - w     : Pekare till frsta viktraden.
+*             - stride: Radsteg mellan viktraderna.
+*             - rows  : Antalet viktrader (hgst ANN_Q_ROWS).
+*             - sums  : Pekare till flt dr skalrprodukterna skall lagras.
+**************************************************************************************************/
+static void dot_scalar(const uint8_t* x, const int8_t* w, const size_t stride,
+                       const size_t rows, int32_t* sums)
+{
+   for (size_t r = 0; r < rows; ++r, w += stride)
+   {
+      int32_t sum = 0;
+
+      for (size_t i = 0; i < stride; ++i)
+      {
+         sum += (int32_t)x[i] * w[i];
+      }
+
+      sums[r] = sum;
+   }
+   return;
+}
+
+#ifdef SIMD_X86
+
+/**************************************************************************************************
+* dot_avx2: Berkningskrna fr 256-bitars vektorer. Parvisa produkter av insignaler utan tecken
+*           och vikter med tecken summeras till 16 bitar via vpmaddubsw, varefter summorna
+*           utkas till 32 bitar via vpmaddwd. Insignalerna till varje rad lses en gng.
+*
+*           - x     : Pekare till de kvantiserade insignalerna.
+*           - w     : Pekare till frsta viktraden.
+*           - stride: Radsteg mellan viktraderna.
+*           - rows  : Antalet viktrader (hgst ANN_Q_ROWS).
+*           - sums  : Pekare till flt dr skalrprodukterna skall lagras.
+**************************************************************************************************/
+__attribute__((target("avx2")))
+static void dot_avx2(const uint8_t* x, const int8_t* w, const size_t stride,
+                     const size_t rows, int32_t* sums)
+{
+   const __m256i ones = _mm256_set1_epi16(1);
+   __m256i sum[ANN_Q_ROWS];
+
+   for (size_t r = 0; r < ANN_Q_ROWS; ++r)
+   {
+      sum[r] = _mm256_setzero_si256();
+   }
+
+   for (size_t i = 0; i < stride; i += 32)
+   {
+      const __m256i input = _mm256_load_si256((const __m256i*)(x + i));
+
+      for (size_t r = 0; r < rows; ++r)
+      {
+         const __m256i weights = _mm256_load_si256((const __m256i*)(w + r * stride + i));
+         const __m256i products = _mm256_maddubs_epi16(input, weights);
+         sum[r] = _mm256_add_epi32(sum[r], _mm256_madd_epi16(products, ones));
+      }
+   }
+
+   for (size_t r = 0; r < rows; ++r)
+   {
+      __m128i total = _mm_add_epi32(_mm256_castsi256_si128(sum[r]),
+                                    _mm256_extracti128_si256(sum[r], 1));
+      total = _mm_add_epi32(total, _mm_shuffle_epi32(total, 0x4e));
+      total = _mm_add_epi32(total, _mm_shuffle_epi32(total, 0xb1));
+      sums[r] = _mm_cvtsi128_si32(total);
+   }
+   return;
+}
+
+/**************************************************************************************************
+* dot_vnni: Berkningskrna fr 512-bitars vektorer med VNNI, dr vpdpbusd multiplicerar och
+*           ackumulerar fyra par av 8-bitars element direkt till 32 bitar per instruktion.
+*
+*           - x     : Pekare till de kvantiserade insignalerna.
+*           - w     : Pekare till frsta viktraden.
+*           - stride: Radsteg mellan viktraderna.
+*           - rows  : Antalet viktrader (hgst ANN_Q_ROWS).
+*           - sums  : Pekare till flt dr skalrprodukterna skall lagras.
+**************************************************************************************************/
+__attribute__((target("avx512f,avx512vnni")))
+static void dot_vnni(const uint8_t* x, const int8_t* w, const size_t stride,
+                     const size_t rows, int32_t* sums)
+{
+   __m512i sum[ANN_Q_ROWS];
+
+   for (size_t r = 0; r < ANN_Q_ROWS; ++r)
+   {
+      sum[r] = _mm512_setzero_si512();
+   }
+
+   for (size_t i = 0; i < stride; i += 64)
+   {
+      const __m512i input = _mm512_load_si512((const void*)(x + i));
+
+      for (size_t r = 0; r < rows; ++r)
+      {
+         const __m512i weights = _mm512_load_si512((const void*)(w + r * stride + i));
+         sum[r] = _mm512_dpbusd_epi32(sum[r], input, weights);
+      }
+   }
+
+   for (size_t r = 0; r < rows; ++r)
+   {
+      sums[r] = _mm512_reduce_add_epi32(sum[r]);
+   }
+   return;
+}
+
+#endif /* SIMD_X86 */
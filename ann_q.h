@@ -0,0 +1,71 @@
+/**************************************************************************************************
+* ann_q.h: Innehller funktionalitet fr kvantiserad inferens med trnade neurala ntverk via
+*          strukten ann_q samt motsvarande externa funktioner. Vikterna lagras som 8-bitars
+*          heltal med en skalfaktor per nod, vilket minskar modellens minnesbehov ttafaldigt
+*          jmfrt med dubbel precision. Insignalerna till respektive lager kvantiseras till
+*          7-bitars heltal utan tecken med nollpunkt, dr skalfaktor samt nollpunkt vljs via
+*          kalibrering mot representativ indata (default ntverkets trningsdata).
+*          Skalrprodukterna ackumuleras som 32-bitars heltal via VNNI (vpdpbusd) eller AVX2
+*          (vpmaddubsw) dr sdant std finns. Begrnsningen till 7 bitar medfr att
+*          vpmaddubsw aldrig mttas, vilket ger identiska resultat fr samtliga krnor.
+**************************************************************************************************/
+#ifndef ANN_Q_H_
+#define ANN_Q_H_
+
+/* Inkluderingsdirektiv: */
+#include "def.h"
+#include "double_vector.h"
+#include "double_2d_vector.h"
+#include "double_matrix.h"
+#include "ann.h"
+
+#include <stdint.h>
+
+/**************************************************************************************************
+* ann_q_layer: Kvantiserat dense-lager. Vikterna lagras radvis per nod, dr varje rad utfylls
+*              med nollor till ett helt antal cacheblock enligt radsteget (stride).
+**************************************************************************************************/
+struct ann_q_layer
+{
+   int8_t* weights;            /* Kvantiserade vikter, num_nodes x stride element. */
+   real_t* scales;             /* Skalfaktor fr vikterna i respektive nod. */
+   int32_t* row_sums;          /* Viktsumma per nod (kompensation av nollpunkt). */
+   real_t* bias;               /* Biasvrden fr respektive nod. */
+   size_t num_nodes;           /* Antalet noder i lagret. */
+   size_t num_weights;         /* Antalet vikter per nod. */
+   size_t stride;              /* Antalet element mellan brjan p tv efterfljande rader. */
+   real_t input_scale;         /* Skalfaktor fr lagrets kvantiserade insignaler. */
+   int32_t input_offset;       /* Nollpunkt fr lagrets kvantiserade insignaler. */
+   enum activation activation; /* Aktiveringsfunktion fr lagrets noder. */
+};
+
+/**************************************************************************************************
+* ann_q: Kvantiserad modell av ett trnat neuralt ntverk, avsedd enbart fr prediktion.
+**************************************************************************************************/
+struct ann_q
+{
+   struct ann_q_layer* layers; /* Flt innehllande kvantiserade lager i ordningsfljd. */
+   size_t num_layers;          /* Antalet lager (dolda lager samt yttre lager). */
+   size_t num_inputs;          /* Antalet insignaler. */
+   size_t num_outputs;         /* Antalet utsignaler. */
+   uint8_t* activations;       /* Arbetsminne fr kvantiserade insignaler. */
+   real_t* values;             /* Arbetsminne fr utsignaler frn respektive lager. */
+   size_t capacity;            /* Antalet trningsuppsttningar som arbetsminnet rymmer. */
+};
+
+/* Externa funktioner: */
+int ann_q_new(struct ann_q* self,
+              struct ann* network);
+void ann_q_delete(struct ann_q* self);
+int ann_q_calibrate(struct ann_q* self,
+                    struct ann* network,
+                    const struct double_2d_vector* inputs);
+real_t* ann_q_predict(struct ann_q* self,
+                      const struct double_vector* input);
+int ann_q_predict_batch(struct ann_q* self,
+                        const struct double_matrix* inputs,
+                        const size_t num_samples,
+                        struct double_matrix* outputs);
+size_t ann_q_model_size(const struct ann_q* self);
+
+#endif /* ANN_Q_H_ */
@@ -0,0 +1,184 @@
+/**************************************************************************************************
+* arena.c: Innehller funktionsdefinitioner fr arenan.
+**************************************************************************************************/
+#include "arena.h"
+
+/* Statiska funktioner: */
+static int arena_add_block(struct arena* self,
+                           const size_t size,
+                           const size_t alignment);
+static uint8_t* align_up(uint8_t* position,
+                         const size_t alignment);
+
+/* Statiska variabler: */
+static _Thread_local struct arena* current = 0; /* Aktiv arena fr respektive trd. */
+
+/**************************************************************************************************
+* arena_new: Initierar angiven arena. Inget minne allokeras frrn frsta allokeringen.
+*
+*            - self      : Pekare till arenan.
+*            - block_size: Minsta storlek i byte fr arenans block (0 = ARENA_BLOCK_SIZE).
+**************************************************************************************************/
+void arena_new(struct arena* self,
+               const size_t block_size)
+{
+   self->blocks = 0;
+   self->position = 0;
+   self->end = 0;
+   self->last = 0;
+   self->block_size = block_size ? block_size : ARENA_BLOCK_SIZE;
+   self->size = 0;
+   return;
+}
+
+/**************************************************************************************************
+* arena_delete: Frigr samtliga block i angiven arena, vilket frigr allt minne som har delats
+*               ut ur arenan. Ifall arenan r aktiv fr anropande trd inaktiveras den.
+*
+*               - self: Pekare till arenan.
+**************************************************************************************************/
+void arena_delete(struct arena* self)
+{
+   while (self->blocks)
+   {
+      struct arena_block* next = self->blocks->next;
+      free(self->blocks);
+      self->blocks = next;
+   }
+
+   if (current == self) current = 0;
+   self->position = 0;
+   self->end = 0;
+   self->last = 0;
+   self->size = 0;
+   return;
+}
+
+/**************************************************************************************************
+* arena_alloc: Returnerar en pekare till ett minnesblock av angiven storlek ur angiven arena,
+*              justerat till angiven justering (dock minst ARENA_ALIGNMENT byte). Ifall
+*              aktuellt block inte rymmer allokeringen allokeras ett nytt block. Returnerar
+*              null ifall minnesallokering misslyckas.
+*
+*              - self     : Pekare till arenan.
+*              - size     : Minnesblockets storlek i byte.
+*              - alignment: Minnesblockets justering i byte (en tvpotens).
+**************************************************************************************************/
+void* arena_alloc(struct arena* self,
+                  const size_t size,
+                  const size_t alignment)
+{
+   const size_t multiple = alignment > ARENA_ALIGNMENT ? alignment : ARENA_ALIGNMENT;
+   uint8_t* data = self->position ? align_up(self->position, multiple) : 0;
+
+   if (!data || data > self->end || (size_t)(self->end - data) < size)
+   {
+      if (arena_add_block(self, size, multiple)) return 0;
+      data = self->position;
+   }
+
+   self->position = data + size;
+   self->last = data;
+   self->size += size;
+   return data;
+}
+
+/**************************************************************************************************
+* arena_realloc: ndrar storleken p ett minnesblock i angiven arena och returnerar en pekare
+*                till minnesblocket. Ifall minnesblocket utgr arenans senaste allokering och
+*                aktuellt block rymmer den nya storleken frlngs (eller frkortas) det p
+*                plats, annars allokeras ett nytt minnesblock dit innehllet kopieras. Det
+*                gamla minnesblocket frigrs frst nr arenan raderas. Returnerar null ifall
+*                minnesallokering misslyckas, varvid det gamla minnesblocket behlls.
+*
+*                - self     : Pekare till arenan.
+*                - data     : Pekare till minnesblocket (null = ny allokering).
+*                - old_size : Minnesblockets nuvarande storlek i byte.
+*                - new_size : Minnesblockets nya storlek i byte.
+*                - alignment: Minnesblockets justering i byte (en tvpotens).
+**************************************************************************************************/
+void* arena_realloc(struct arena* self,
+                    void* data,
+                    const size_t old_size,
+                    const size_t new_size,
+                    const size_t alignment)
+{
+   if (data && data == self->last && (size_t)(self->end - self->last) >= new_size)
+   {
+      self->position = self->last + new_size;
+      self->size = self->size - old_size + new_size;
+      return data;
+   }
+
+   void* copy = arena_alloc(self, new_size, alignment);
+   if (!copy) return 0;
+   if (data) memcpy(copy, data, old_size < new_size ? old_size : new_size);
+   return copy;
+}
+
+/**************************************************************************************************
+* arena_use: Gr angiven arena aktiv fr anropande trd, s att efterfljande allokeringar via
+*            funktionerna i allocator.h placeras i arenan, och returnerar fregende aktiva arena
+*            s att den kan terstllas. Vid null allokeras minnet ter p heapen.
+*
+*            - self: Pekare till arenan som skall anvndas (null = heapen).
+**************************************************************************************************/
+struct arena* arena_use(struct arena* self)
+{
+   struct arena* previous = current;
+   current = self;
+   return previous;
+}
+
+/**************************************************************************************************
+* arena_current: Returnerar en pekare till aktiv arena fr anropande trd, eller null ifall
+*                minnet allokeras p heapen.
+**************************************************************************************************/
+struct arena* arena_current(void)
+{
+   return current;
+}
+
+/**************************************************************************************************
+* arena_add_block: Allokerar ett nytt block i angiven arena, som rymmer minst en allokering av
+*                  angiven storlek och justering, och gr blocket till arenans aktuella block.
+*                  terstende minne i fregende block lmnas oanvnt. Returnerar 1 ifall
+*                  minnesallokering misslyckas, annars 0.
+*
+*                  - self     : Pekare till arenan.
+*                  - size     : Storleken i byte p allokeringen som blocket skall rymma.
+*                  - alignment: Justeringen i byte fr allokeringen som blocket skall rymma.
+**************************************************************************************************/
+static int arena_add_block(struct arena* self,
+                           const size_t size,
+                           const size_t alignment)
+{
+   const size_t block_size = size > self->block_size ? size : self->block_size;
+   struct arena_block* block =
+      (struct arena_block*)malloc(sizeof(struct arena_block) + alignment + block_size);
+   if (!block) return 1;
+
+   block->data = align_up((uint8_t*)(block + 1), alignment);
+   block->size = block_size;
+   block->next = self->blocks;
+   self->blocks = block;
+
+   self->position = block->data;
+   self->end = block->data + block->size;
+   self->last = 0;
+   return 0;
+}
+
+/**************************************************************************************************
+* align_up: Returnerar angiven position avrundad uppt till nrmaste multipel av angiven
+*           justering.
+*
+*           - position : Positionen som skall avrundas.
+*           - alignment: Justeringen i byte (en tvpotens).
+**************************************************************************************************/
+static uint8_t* align_up(uint8_t* position,
+                         const size_t alignment)
+{
+   const uintptr_t address = (uintptr_t)position;
+   return position + ((alignment - address % alignment) % alignment);
+}
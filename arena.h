@@ -0,0 +1,74 @@
+/**************************************************************************************************
+* arena.h: Innehller funktionalitet fr en arena, vilket r en minnesallokator som delar ut
+*          minne ur ett ftal stora block genom att enbart flytta fram en position i aktuellt
+*          block. Varje allokering justeras till minst ARENA_ALIGNMENT byte. Enskilda
+*          allokeringar frigrs inte, utan samtliga block frigrs p en gng nr arenan
+*          raderas. Den senaste allokeringen kan dock frlngas p plats, vilket medfr att
+*          en vektor som vxer ett element i taget inte behver kopieras.
+*
+*          En arena kan gras aktiv fr anropande trd via funktionen arena_use, varefter
+*          samtliga vektorer och matriser som allokeras av trden (via funktionerna i
+*          allocator.h) placeras i arenan, exempelvis ett neuralt ntverk samt dess trningsdata:
+*
+*          struct arena arena;
+*          arena_new(&arena, 0);
+*          struct arena* previous = arena_use(&arena);
+*          ann_new(&network, 2, 3, 1);
+*          ann_load_training_data(&network, "data.txt");
+*          arena_use(previous);
+*          ...
+*          arena_delete(&arena); // Frigr ntverket samt trningsdatan.
+*
+*          Minne i en arena frigrs enbart via funktionen arena_delete, anrop av exempelvis
+*          ann_delete fr ett ntverk i arenan frigr drmed inget minne (men r tilltet).
+*          En arena fr enbart anvndas av en trd t gngen.
+**************************************************************************************************/
+#ifndef ARENA_H_
+#define ARENA_H_
+
+/* Inkluderingsdirektiv: */
+#include "def.h"
+
+/* Makrodefinitioner: */
+#define ARENA_ALIGNMENT 64             /* Minsta justering i byte fr varje allokering. */
+#define ARENA_BLOCK_SIZE (1024 * 1024) /* Default storlek p arenans block i byte. */
+
+/**************************************************************************************************
+* arena_block: Minnesblock i en arena, allokerat p heapen. Blocken lagras i en lnkad lista.
+**************************************************************************************************/
+struct arena_block
+{
+   struct arena_block* next; /* Pekare till fregende block i arenan. */
+   uint8_t* data;            /* Pekare till blockets frsta justerade byte. */
+   size_t size;              /* Blockets storlek i byte, rknat frn data. */
+};
+
+/**************************************************************************************************
+* arena: Minnesallokator som delar ut minne ur stora block, vilka frigrs p en gng.
+**************************************************************************************************/
+struct arena
+{
+   struct arena_block* blocks; /* Arenans block, dr senast allokerade block lagras frst. */
+   uint8_t* position;          /* Nsta lediga byte i aktuellt block. */
+   uint8_t* end;               /* Slutet p aktuellt block. */
+   uint8_t* last;              /* Senaste allokeringen, som kan frlngas p plats. */
+   size_t block_size;          /* Minsta storlek i byte fr nya block. */
+   size_t size;                /* Totalt antal byte som har delats ut ur arenan. */
+};
+
+/* Externa funktioner: */
+void arena_new(struct arena* self,
+               const size_t block_size);
+void arena_delete(struct arena* self);
+void* arena_alloc(struct arena* self,
+                  const size_t size,
+                  const size_t alignment);
+void* arena_realloc(struct arena* self,
+                    void* data,
+                    const size_t old_size,
+                    const size_t new_size,
+                    const size_t alignment);
+struct arena* arena_use(struct arena* self);
+struct arena* arena_current(void);
+
+#endif /* ARENA_H_ */
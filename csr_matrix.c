@@ -0,0 +1,328 @@
+/**************************************************************************************************
+* csr_matrix.c: Innehller funktionsdefinitioner fr glesa matriser i formatet CSR samt
+*               berkningskrnor fr gles matris-vektor-multiplikation, dr insignaler lses via
+*               gather utefter lagrade kolumnindex. Krnan vljs utefter den
+*               instruktionsuppsttning som anvnds av krnorna i simd.c.
+**************************************************************************************************/
+#include "csr_matrix.h"
+#include "allocator.h"
+#include "simd.h"
+#include "simd_vector.h"
+
+/* Makrodefinitioner: */
+#define CSR_MATRIX_MAX_COLS 0x7fffffff /* Strsta antal kolumner (index lagras som int32). */
+
+/**************************************************************************************************
+* csr_kernel: Berkningskrna fr gles matris-vektor-multiplikation.
+**************************************************************************************************/
+typedef void (*csr_kernel)(const struct csr_matrix* self, const real_t* x, real_t* y);
+
+/* Statiska funktioner: */
+static csr_kernel get_kernel(const bool transposed);
+static void gemv_scalar(const struct csr_matrix* self, const real_t* x, real_t* y);
+static void gemv_transposed_scalar(const struct csr_matrix* self, const real_t* x, real_t* y);
+
+#ifdef SIMD_X86
+static void gemv_avx2(const struct csr_matrix* self, const real_t* x, real_t* y);
+static void gemv_avx512(const struct csr_matrix* self, const real_t* x, real_t* y);
+static void gemv_transposed_avx512(const struct csr_matrix* self, const real_t* x, real_t* y);
+#endif
+
+/**************************************************************************************************
+* csr_matrix_new: Initierar angiven matris som tom.
+*
+*                 - self: Pekare till matrisen.
+**************************************************************************************************/
+void csr_matrix_new(struct csr_matrix* self)
+{
+   self->values = 0;
+   self->columns = 0;
+   self->row_offsets = 0;
+   self->rows = 0;
+   self->cols = 0;
+   self->nnz = 0;
+   return;
+}
+
+/**************************************************************************************************
+* csr_matrix_delete: Frigr minne allokerat fr angiven matris.
+*
+*                    - self: Pekare till matrisen.
+**************************************************************************************************/
+void csr_matrix_delete(struct csr_matrix* self)
+{
+   allocator_free(self->values);
+   allocator_free(self->columns);
+   allocator_free(self->row_offsets);
+   csr_matrix_new(self);
+   return;
+}
+
+/**************************************************************************************************
+* csr_matrix_sparsify: Tilldelar angiven matris de element i en tt matris vars belopp verstiger
+*                      angivet trskelvrde, vriga element utelmnas. Vid trskelvrdet 0
+*                      utelmnas drmed enbart element som r exakt noll. Returnerar 1 ifall
+*                      minnesallokering misslyckas eller ifall antalet kolumner r fr stort,
+*                      annars 0.
+*
+*                      - self     : Pekare till matrisen.
+*                      - source   : Pekare till den tta matrisen.
+*                      - threshold: Trskelvrde, element med mindre eller lika belopp utelmnas.
+**************************************************************************************************/
+int csr_matrix_sparsify(struct csr_matrix* self,
+                        const struct double_matrix* source,
+                        const real_t threshold)
+{
+   size_t nnz = 0;
+   if (source->cols > CSR_MATRIX_MAX_COLS) return 1;
+
+   for (size_t i = 0; i < source->rows; ++i)
+   {
+      const real_t* row = double_matrix_row(source, i);
+
+      for (size_t j = 0; j < source->cols; ++j)
+      {
+         if (row[j] > threshold || row[j] < -threshold) nnz++;
+      }
+   }
+
+   real_t* values = (real_t*)allocator_alloc(sizeof(real_t) * (nnz ? nnz : 1));
+   uint32_t* columns = (uint32_t*)allocator_alloc(sizeof(uint32_t) * (nnz ? nnz : 1));
+   size_t* row_offsets = (size_t*)allocator_alloc(sizeof(size_t) * (source->rows + 1));
+
+   if (!values || !columns || !row_offsets)
+   {
+      allocator_free(values);
+      allocator_free(columns);
+      allocator_free(row_offsets);
+      return 1;
+   }
+
+   csr_matrix_delete(self);
+   self->values = values;
+   self->columns = columns;
+   self->row_offsets = row_offsets;
+   self->rows = source->rows;
+   self->cols = source->cols;
+   self->nnz = nnz;
+   row_offsets[0] = 0;
+
+   for (size_t i = 0, k = 0; i < source->rows; ++i)
+   {
+      const real_t* row = double_matrix_row(source, i);
+
+      for (size_t j = 0; j < source->cols; ++j)
+      {
+         if (row[j] > threshold || row[j] < -threshold)
+         {
+            values[k] = row[j];
+            columns[k++] = (uint32_t)j;
+         }
+      }
+      row_offsets[i + 1] = k;
+   }
+   return 0;
+}
+
+/**************************************************************************************************
+* csr_matrix_gemv: Berknar y = A * x, dr A utgrs av angiven gles matris.
+*
+*                  - self: Pekare till matrisen A.
+*                  - x   : Pekare till vektorn som multipliceras (ett element per kolumn i A).
+*                  - y   : Pekare till resultatvektorn (ett element per rad i A).
+**************************************************************************************************/
+void csr_matrix_gemv(const struct csr_matrix* self,
+                     const real_t* x,
+                     real_t* y)
+{
+   get_kernel(false)(self, x, y);
+   return;
+}
+
+/**************************************************************************************************
+* csr_matrix_gemv_transposed: Berknar y = A^T * x, dr A utgrs av angiven gles matris. Varje
+*                             rad i A lses en gng och adderas till de element i y som
+*                             motsvarar radens kolumnindex, skalad med motsvarande element i x.
+*                             Rader vars element i x r noll hoppas ver.
+*
+*                             - self: Pekare till matrisen A.
+*                             - x   : Pekare till vektorn som multipliceras (ett element per rad).
+*                             - y   : Pekare till resultatvektorn (ett element per kolumn i A).
+**************************************************************************************************/
+void csr_matrix_gemv_transposed(const struct csr_matrix* self,
+                                const real_t* x,
+                                real_t* y)
+{
+   memset(y, 0, sizeof(real_t) * self->cols);
+   get_kernel(true)(self, x, y);
+   return;
+}
+
+/**************************************************************************************************
+* csr_matrix_density: Returnerar andelen lagrade element i frhllande till en tt matris med
+*                     samma dimensioner (0.0 - 1.0).
+*
+*                     - self: Pekare till matrisen.
+**************************************************************************************************/
+double csr_matrix_density(const struct csr_matrix* self)
+{
+   if (!self->rows || !self->cols) return 0.0;
+   return (double)self->nnz / ((double)self->rows * self->cols);
+}
+
+/**************************************************************************************************
+* csr_matrix_size: Returnerar antalet byte som upptas av matrisens element, kolumnindex samt
+*                  radindex.
+*
+*                  - self: Pekare till matrisen.
+**************************************************************************************************/
+size_t csr_matrix_size(const struct csr_matrix* self)
+{
+   if (!self->row_offsets) return 0;
+   return self->nnz * (sizeof(real_t) + sizeof(uint32_t)) + (self->rows + 1) * sizeof(size_t);
+}
+
+/**************************************************************************************************
+* get_kernel: Returnerar berkningskrnan fr den instruktionsuppsttning som anvnds i simd.c.
+*             Vid multiplikation med den transponerade matrisen krvs scatter, vilket saknas i
+*             AVX2, varp den portabla krnan anvnds i stllet.
+*
+*             - transposed: Indikerar ifall krnan fr A^T * x efterfrgas.
+**************************************************************************************************/
+static csr_kernel get_kernel(const bool transposed)
+{
+#ifdef SIMD_X86
+   const enum simd_isa isa = simd_get_isa();
+   if (isa == SIMD_ISA_AVX512) return transposed ? &gemv_transposed_avx512 : &gemv_avx512;
+   if (isa == SIMD_ISA_AVX2 && !transposed) return &gemv_avx2;
+#endif
+   return transposed ? &gemv_transposed_scalar : &gemv_scalar;
+}
+
+/**************************************************************************************************
+* gemv_scalar: Portabel berkningskrna fr y = A * x.
+**************************************************************************************************/
+static void gemv_scalar(const struct csr_matrix* self, const real_t* x, real_t* y)
+{
+   for (size_t i = 0; i < self->rows; ++i)
+   {
+      real_t sum = 0;
+
+      for (size_t k = self->row_offsets[i]; k < self->row_offsets[i + 1]; ++k)
+      {
+         sum += self->values[k] * x[self->columns[k]];
+      }
+      y[i] = sum;
+   }
+   return;
+}
+
+/**************************************************************************************************
+* gemv_transposed_scalar: Portabel berkningskrna fr y += A^T * x.
+**************************************************************************************************/
+static void gemv_transposed_scalar(const struct csr_matrix* self, const real_t* x, real_t* y)
+{
+   for (size_t i = 0; i < self->rows; ++i)
+   {
+      if (x[i] == 0) continue;
+
+      for (size_t k = self->row_offsets[i]; k < self->row_offsets[i + 1]; ++k)
+      {
+         y[self->columns[k]] += x[i] * self->values[k];
+      }
+   }
+   return;
+}
+
+#ifdef SIMD_X86
+
+/**************************************************************************************************
+* gemv_avx2: Berkningskrna fr y = A * x med 256-bitars vektorer, dr insignalerna fr ett
+*            helt register lses via gather.
+**************************************************************************************************/
+__attribute__((target("avx2,fma")))
+static void gemv_avx2(const struct csr_matrix* self, const real_t* x, real_t* y)
+{
+   for (size_t i = 0; i < self->rows; ++i)
+   {
+      const size_t end = self->row_offsets[i + 1];
+      size_t k = self->row_offsets[i];
+      V256 sum = v256_zero();
+
+      for (; k + V256_LANES <= end; k += V256_LANES)
+      {
+         sum = v256_fmadd(v256_loadu(self->values + k), v256_gather(x, self->columns + k), sum);
+      }
+
+      real_t result = v256_hsum(sum);
+
+      for (; k < end; ++k)
+      {
+         result += self->values[k] * x[self->columns[k]];
+      }
+      y[i] = result;
+   }
+   return;
+}
+
+/**************************************************************************************************
+* gemv_avx512: Berkningskrna fr y = A * x med 512-bitars vektorer, dr insignalerna fr ett
+*              helt register lses via gather.
+**************************************************************************************************/
+__attribute__((target("avx512f")))
+static void gemv_avx512(const struct csr_matrix* self, const real_t* x, real_t* y)
+{
+   for (size_t i = 0; i < self->rows; ++i)
+   {
+      const size_t end = self->row_offsets[i + 1];
+      size_t k = self->row_offsets[i];
+      V512 sum = v512_zero();
+
+      for (; k + V512_LANES <= end; k += V512_LANES)
+      {
+         sum = v512_fmadd(v512_loadu(self->values + k), v512_gather(x, self->columns + k), sum);
+      }
+
+      real_t result = v512_reduce_add(sum);
+
+      for (; k < end; ++k)
+      {
+         result += self->values[k] * x[self->columns[k]];
+      }
+      y[i] = result;
+   }
+   return;
+}
+
+/**************************************************************************************************
+* gemv_transposed_avx512: Berkningskrna fr y += A^T * x med 512-bitars vektorer. Elementen i
+*                         y lses via gather, uppdateras och skrivs tillbaka via scatter, vilket
+*                         r mjligt eftersom kolumnindex r unika inom varje rad.
+**************************************************************************************************/
+__attribute__((target("avx512f")))
+static void gemv_transposed_avx512(const struct csr_matrix* self, const real_t* x, real_t* y)
+{
+   for (size_t i = 0; i < self->rows; ++i)
+   {
+      if (x[i] == 0) continue;
+
+      const size_t end = self->row_offsets[i + 1];
+      const V512 scale = v512_set1(x[i]);
+      size_t k = self->row_offsets[i];
+
+      for (; k + V512_LANES <= end; k += V512_LANES)
+      {
+         const V512 sum = v512_fmadd(scale, v512_loadu(self->values + k),
+                                     v512_gather(y, self->columns + k));
+         v512_scatter(y, self->columns + k, sum);
+      }
+
+      for (; k < end; ++k)
+      {
+         y[self->columns[k]] += x[i] * self->values[k];
+      }
+   }
+   return;
+}
+
+#endif /* SIMD_X86 */
@@ -0,0 +1,49 @@
+/**************************************************************************************************
+* csr_matrix.h: Implementering av glesa matriser lagrade i formatet CSR (compressed sparse row)
+*               via strukten csr_matrix samt motsvarande externa funktioner. Matrisen anvnds som
+*               gles kopia av ett dense-lagers vikter efter beskrning (pruning), dr enbart
+*               nollskilda vikter lagras tillsammans med respektive kolumnindex. Drmed lses
+*               samt multipliceras enbart kvarvarande vikter vid feedforward samt
+*               backpropagation, medan minnestgngen vid 90 % gleshet uppgr till ungefr
+*               15 % (dubbel precision) respektive 20 % (enkel precision) av en tt matris.
+**************************************************************************************************/
+#ifndef CSR_MATRIX_H_
+#define CSR_MATRIX_H_
+
+/* Inkluderingsdirektiv: */
+#include "def.h"
+#include "double_matrix.h"
+
+#include <stdint.h>
+
+/**************************************************************************************************
+* csr_matrix: Gles matris, dr nollskilda element lagras radvis i fltet values och motsvarande
+*             kolumnindex i fltet columns (stigande inom varje rad). Rad i omfattar elementen
+*             frn och med index row_offsets[i] till index row_offsets[i + 1].
+**************************************************************************************************/
+struct csr_matrix
+{
+   real_t* values;      /* Pekare till flt innehllande nollskilda element. */
+   uint32_t* columns;   /* Pekare till flt innehllande kolumnindex fr respektive element. */
+   size_t* row_offsets; /* Pekare till flt innehllande startindex per rad (rows + 1 element). */
+   size_t rows;         /* Antalet rader i matrisen. */
+   size_t cols;         /* Antalet kolumner i matrisen. */
+   size_t nnz;          /* Antalet lagrade (nollskilda) element. */
+};
+
+/* Externa funktioner: */
+void csr_matrix_new(struct csr_matrix* self);
+void csr_matrix_delete(struct csr_matrix* self);
+int csr_matrix_sparsify(struct csr_matrix* self,
+                        const struct double_matrix* source,
+                        const real_t threshold);
+void csr_matrix_gemv(const struct csr_matrix* self,
+                     const real_t* x,
+                     real_t* y);
+void csr_matrix_gemv_transposed(const struct csr_matrix* self,
+                                const real_t* x,
+                                real_t* y);
+double csr_matrix_density(const struct csr_matrix* self);
+size_t csr_matrix_size(const struct csr_matrix* self);
+
+#endif /* CSR_MATRIX_H_ */
@@ -0,0 +1,270 @@
+/**************************************************************************************************
+* data_stream.c: Innehller funktionsdefinitioner fr strmmande inlsning av trningsdata.
+**************************************************************************************************/
+#define _FILE_OFFSET_BITS 64
+
+#include "data_stream.h"
+#include "allocator.h"
+
+/* Statiska funktioner: */
+static int data_stream_alloc(struct data_stream* self);
+static int read_block(real_t* data,
+                      const size_t count,
+                      const uint64_t offset,
+                      FILE* fstream);
+static int seek(FILE* fstream,
+                const uint64_t offset);
+static int file_size(FILE* fstream,
+                     uint64_t* size);
+
+/**************************************************************************************************
+* data_stream_new: ppnar en binr trningsdatafil fr strmmande inlsning. Blockstorleken
+*                  vljs s att ett block, inklusive uppsttningarnas vektorhuvuden, ryms inom
+*                  angiven minnesbudget (dock minst en uppsttning per block). Blockets buffrar
+*                  allokeras i frvg, s att inga allokeringar sker under inlsningen. Blocken
+*                  lses i filens ordning tills funktionen data_stream_shuffle anropas.
+*
+*                  Returnerar 1 ifall filen inte kan ppnas, inte utgr en giltig trningsdatafil
+*                  med angivet antal in- och utsignaler eller ifall minnesallokering
+*                  misslyckas, annars 0.
+*
+*                  - self         : Pekare till strmmen.
+*                  - filepath     : Filskvg till den binra trningsdatafilen.
+*                  - num_inputs   : Antalet insignaler per uppsttning.
+*                  - num_outputs  : Antalet utsignaler per uppsttning.
+*                  - memory_budget: Minnesbudget i byte fr ett block (0 = DATA_STREAM_BUDGET).
+**************************************************************************************************/
+int data_stream_new(struct data_stream* self,
+                    const char* filepath,
+                    const size_t num_inputs,
+                    const size_t num_outputs,
+                    const size_t memory_budget)
+{
+   struct training_data_header header;
+   uint64_t size = 0;
+
+   training_data_new(&self->chunk, num_inputs, num_outputs);
+   double_vector_new(&self->inputs);
+   double_vector_new(&self->outputs);
+   uint_vector_new(&self->order);
+   self->rows = 0;
+   self->chunk_rows = 0;
+   self->next = 0;
+   self->failed = false;
+   self->fstream = fopen(filepath, "rb");
+
+   if (!self->fstream)
+   {
+      fprintf(stderr, "Could not open file at path %s!\n\n", filepath);
+      return 1;
+   }
+
+   if (fread(&header, sizeof(header), 1, self->fstream) != 1 ||
+       file_size(self->fstream, &size) || size > SIZE_MAX ||
+       training_data_check(&self->chunk, &header, (size_t)size))
+   {
+      fprintf(stderr, "File %s is not a training data file for %zu inputs, %zu outputs!\n\n",
+              filepath, num_inputs, num_outputs);
+      data_stream_delete(self);
+      return 1;
+   }
+
+   const size_t row_size = sizeof(real_t) * (num_inputs + num_outputs) +
+                           sizeof(struct double_vector) * 2 + sizeof(size_t);
+   const size_t budget = memory_budget ? memory_budget : DATA_STREAM_BUDGET;
+
+   self->rows = (size_t)header.rows;
+   self->chunk_rows = budget / row_size ? budget / row_size : 1;
+   if (self->chunk_rows > self->rows) self->chunk_rows = self->rows;
+   self->inputs_offset = header.inputs_offset;
+   self->outputs_offset = header.outputs_offset;
+
+   if (data_stream_alloc(self))
+   {
+      fprintf(stderr, "Memory allocation failed!\n\n");
+      data_stream_delete(self);
+      return 1;
+   }
+   return 0;
+}
+
+/**************************************************************************************************
+* data_stream_delete: Stnger filen samt frigr blocket i angiven strm. Enbart blockets
+*                     vektorhuvuden frigrs, eftersom uppsttningarnas tal tillhr buffrarna.
+*
+*                     - self: Pekare till strmmen.
+**************************************************************************************************/
+void data_stream_delete(struct data_stream* self)
+{
+   if (self->fstream) fclose(self->fstream);
+   allocator_free(self->chunk.in.data);
+   allocator_free(self->chunk.out.data);
+   double_2d_vector_new(&self->chunk.in);
+   double_2d_vector_new(&self->chunk.out);
+   training_data_delete(&self->chunk);
+   double_vector_delete(&self->inputs);
+   double_vector_delete(&self->outputs);
+   uint_vector_delete(&self->order);
+   self->fstream = 0;
+   self->rows = 0;
+   self->chunk_rows = 0;
+   self->next = 0;
+   return;
+}
+
+/**************************************************************************************************
+* data_stream_shuffle: Pbrjar en ny epok fr angiven strm genom att randomisera ordningen som
+*                      blocken skall lsas i, varefter nsta anrop av funktionen data_stream_next
+*                      lser in det frsta blocket i den nya ordningen.
+*
+*                      - self: Pekare till strmmen.
+**************************************************************************************************/
+void data_stream_shuffle(struct data_stream* self)
+{
+   for (size_t i = 0; i < self->order.size; ++i)
+   {
+      const size_t r = (size_t)(rand() % self->order.size);
+      const size_t temp = self->order.data[i];
+      self->order.data[i] = self->order.data[r];
+      self->order.data[r] = temp;
+   }
+
+   self->next = 0;
+   return;
+}
+
+/**************************************************************************************************
+* data_stream_next: Lser in nsta block i aktuell epok och returnerar en pekare till blocket i
+*                   form av en trningsdatabehllare, vars uppsttningar r giltiga till nsta
+*                   anrop. Uppsttningarna lagras i filens ordning. Returnerar null nr samtliga
+*                   block i epoken har lsts, eller ifall inlsningen misslyckas, varvid
+*                   medlemmen failed stts.
+*
+*                   - self: Pekare till strmmen.
+**************************************************************************************************/
+struct training_data* data_stream_next(struct data_stream* self)
+{
+   if (self->failed || self->next >= self->order.size) return 0;
+
+   const size_t first = self->order.data[self->next++] * self->chunk_rows;
+   const size_t remaining = self->rows - first;
+   const size_t count = remaining < self->chunk_rows ? remaining : self->chunk_rows;
+   struct training_data* chunk = &self->chunk;
+
+   if (read_block(self->inputs.data, count * chunk->num_inputs,
+                  self->inputs_offset + (uint64_t)first * chunk->num_inputs * sizeof(real_t),
+                  self->fstream) ||
+       read_block(self->outputs.data, count * chunk->num_outputs,
+                  self->outputs_offset + (uint64_t)first * chunk->num_outputs * sizeof(real_t),
+                  self->fstream))
+   {
+      fprintf(stderr, "Could not read training data at row %zu!\n\n", first);
+      self->failed = true;
+      return 0;
+   }
+
+   for (size_t i = 0; i < count; ++i)
+   {
+      chunk->order.data[i] = i;
+   }
+
+   chunk->order.size = count;
+   chunk->sets = count;
+   return chunk;
+}
+
+/**************************************************************************************************
+* data_stream_alloc: Allokerar blockets buffrar i angiven strm, lter blockets uppsttningar
+*                    peka in i buffrarna samt initierar ordningen p blocken till filens
+*                    ordning. Returnerar 1 ifall minnesallokering misslyckas, annars 0.
+*
+*                    - self: Pekare till strmmen.
+**************************************************************************************************/
+static int data_stream_alloc(struct data_stream* self)
+{
+   struct training_data* chunk = &self->chunk;
+   const size_t num_chunks = self->chunk_rows ?
+      (self->rows + self->chunk_rows - 1) / self->chunk_rows : 0;
+
+   if (uint_vector_resize(&self->order, num_chunks) ||
+       uint_vector_resize(&chunk->order, self->chunk_rows) ||
+       double_vector_resize(&self->inputs, self->chunk_rows * chunk->num_inputs) ||
+       double_vector_resize(&self->outputs, self->chunk_rows * chunk->num_outputs) ||
+       double_2d_vector_resize(&chunk->in, self->chunk_rows) ||
+       double_2d_vector_resize(&chunk->out, self->chunk_rows))
+   {
+      return 1;
+   }
+
+   for (size_t i = 0; i < num_chunks; ++i)
+   {
+      self->order.data[i] = i;
+   }
+
+   for (size_t i = 0; i < self->chunk_rows; ++i)
+   {
+      chunk->in.data[i].data = self->inputs.data + i * chunk->num_inputs;
+      chunk->in.data[i].size = chunk->num_inputs;
+      chunk->in.data[i].capacity = chunk->num_inputs;
+      chunk->out.data[i].data = self->outputs.data + i * chunk->num_outputs;
+      chunk->out.data[i].size = chunk->num_outputs;
+      chunk->out.data[i].capacity = chunk->num_outputs;
+   }
+   return 0;
+}
+
+/**************************************************************************************************
+* read_block: Lser angivet antal tal frn angiven position i filen till angiven buffer.
+*             Returnerar 1 ifall inlsningen misslyckas, annars 0.
+*
+*             - data   : Pekare till buffern som talen skall lsas till.
+*             - count  : Antalet tal som skall lsas.
+*             - offset : Position i byte fr det frsta talet i filen.
+*             - fstream: Pekare till filstrmmen.
+**************************************************************************************************/
+static int read_block(real_t* data,
+                      const size_t count,
+                      const uint64_t offset,
+                      FILE* fstream)
+{
+   return seek(fstream, offset) || fread(data, sizeof(real_t), count, fstream) != count;
+}
+
+/**************************************************************************************************
+* seek: Flyttar angiven filstrm till angiven position rknat frn filens brjan, ven fr
+*       filer strre n 2 GB. Returnerar 1 ifall frflyttningen misslyckas, annars 0.
+*
+*       - fstream: Pekare till filstrmmen.
+*       - offset : Positionen i byte.
+**************************************************************************************************/
+static int seek(FILE* fstream,
+                const uint64_t offset)
+{
+#ifdef _WIN32
+   return _fseeki64(fstream, (__int64)offset, SEEK_SET) != 0;
+#else
+   return fseeko(fstream, (off_t)offset, SEEK_SET) != 0;
+#endif
+}
+
+/**************************************************************************************************
+* file_size: Lagrar storleken p filen tillhrande angiven filstrm p angiven adress.
+*            Returnerar 1 ifall storleken inte kan avgras, annars 0.
+*
+*            - fstream: Pekare till filstrmmen.
+*            - size   : Pekare till adressen dr filens storlek i byte skall lagras.
+**************************************************************************************************/
+static int file_size(FILE* fstream,
+                     uint64_t* size)
+{
+#ifdef _WIN32
+   if (_fseeki64(fstream, 0, SEEK_END)) return 1;
+   const __int64 position = _ftelli64(fstream);
+#else
+   if (fseeko(fstream, 0, SEEK_END)) return 1;
+   const off_t position = ftello(fstream);
+#endif
+   if (position < 0) return 1;
+   *size = (uint64_t)position;
+   return 0;
+}
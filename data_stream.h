@@ -0,0 +1,67 @@
+/**************************************************************************************************
+* data_stream.h: Innehller funktionalitet fr strmmande inlsning av trningsdata som r fr
+*                stor fr att rymmas i minnet. Trningsdatan lses frn en binr
+*                trningsdatafil (se strukten training_data_header samt verktyget ann_convert)
+*                i block om ett fast antal uppsttningar, dr blockstorleken vljs s att ett
+*                block ryms inom en angiven minnesbudget. Blockets in- och utsignaler lagras i
+*                var sin sammanhngande buffer, som lses in via ett anrop per buffer och
+*                teranvnds mellan inlsningar, vilket medfr att minnestgngen r konstant
+*                oavsett filens storlek.
+*
+*                Infr varje epok randomiseras ordningen p blocken via funktionen
+*                data_stream_shuffle, varefter blocken lses in ett i taget via funktionen
+*                data_stream_next. Ordningen p uppsttningarna inom respektive block
+*                randomiseras sedan p samma stt som fr trningsdata i minnet:
+*
+*                struct data_stream stream;
+*                data_stream_new(&stream, "data.bin", 3, 1, 64 * 1024 * 1024);
+*                data_stream_shuffle(&stream);
+*
+*                for (struct training_data* chunk; (chunk = data_stream_next(&stream));)
+*                {
+*                   training_data_shuffle(chunk);
+*                   ...
+*                }
+*
+*                data_stream_delete(&stream);
+**************************************************************************************************/
+#ifndef DATA_STREAM_H_
+#define DATA_STREAM_H_
+
+/* Inkluderingsdirektiv: */
+#include "def.h"
+#include "training_data.h"
+#include "uint_vector.h"
+
+/* Makrodefinitioner: */
+#define DATA_STREAM_BUDGET (64 * 1024 * 1024) /* Default minnesbudget i byte fr ett block. */
+
+/**************************************************************************************************
+* data_stream: Strm av trningsdata frn en binr trningsdatafil, som lses i block.
+**************************************************************************************************/
+struct data_stream
+{
+   FILE* fstream;                /* Filstrm till den binra trningsdatafilen. */
+   struct training_data chunk;   /* Senast inlsta block, vars uppsttningar pekar i buffrarna. */
+   struct double_vector inputs;  /* Sammanhngande buffer fr blockets insignaler. */
+   struct double_vector outputs; /* Sammanhngande buffer fr blockets utsignaler. */
+   struct uint_vector order;     /* Ordningen som blocken lses i under aktuell epok. */
+   size_t rows;                  /* Totalt antal uppsttningar i filen. */
+   size_t chunk_rows;            /* Maximalt antal uppsttningar per block. */
+   size_t next;                  /* Index i ordningen fr nsta block som skall lsas. */
+   uint64_t inputs_offset;       /* Position i byte fr filens block med insignaler. */
+   uint64_t outputs_offset;      /* Position i byte fr filens block med utsignaler. */
+   bool failed;                  /* Indikerar ifall en inlsning har misslyckats. */
+};
+
+/* Externa funktioner: */
+int data_stream_new(struct data_stream* self,
+                    const char* filepath,
+                    const size_t num_inputs,
+                    const size_t num_outputs,
+                    const size_t memory_budget);
+void data_stream_delete(struct data_stream* self);
+void data_stream_shuffle(struct data_stream* self);
+struct training_data* data_stream_next(struct data_stream* self);
+
+#endif /* DATA_STREAM_H_ */
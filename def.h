@@ -7,7 +7,21 @@
 /* Inkluderingsdirektiv: */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <stdint.h>
 #include <stdbool.h>
 
+/**************************************************************************************************
+* real_t: Flyttalstyp som anvnds fr samtliga buffertar och berkningar i ntverket. Som default
+*         anvnds dubbel precision (double). Vid kompilering med makrot ANN_FLOAT32 definierat
+*         anvnds i stllet enkel precision (float), vilket halverar minnestrafiken och dubblerar
+*         antalet element per vektorregister i berkningskrnorna, exempelvis via kommandot
+*         $ gcc *.c -o main -Wall -DANN_FLOAT32
+**************************************************************************************************/
+#ifdef ANN_FLOAT32
+typedef float real_t;
+#else
+typedef double real_t;
+#endif
+
 #endif /* DEF_H_ */
\ No newline at end of file
@@ -3,6 +3,36 @@
 *                dense-lager i neurala ntverk.
 **************************************************************************************************/
 #include "dense_layer.h"
+#include "allocator.h"
+#include "simd.h"
+#include "gemm.h"
+#include "thread_pool.h"
+
+#include <time.h>
+#include <pthread.h>
+
+/* Makrodefinitioner: */
+#define DENSE_LAYER_MEASURE_TIME 1e-3 /* Minsta mttid i sekunder per krna vid jmfrelse. */
+#define DENSE_LAYER_PARALLEL_ALIGNMENT (THREAD_POOL_CACHE_LINE / sizeof(real_t))
+#define DENSE_LAYER_PARALLEL_CHUNKS 32 /* Antalet nodintervall vid parallell backpropagation. */
+
+/**************************************************************************************************
+* dense_layer_task: Argument till de funktioner som bearbetar ett intervall av noder i ett
+*                   dense-lager, vilka frdelas mellan trdarna i trdpoolen.
+**************************************************************************************************/
+struct dense_layer_task
+{
+   struct dense_layer* self;             /* Pekare till dense-lagret som bearbetas. */
+   const struct dense_layer* next_layer; /* Pekare till efterfljande lager (backpropagation). */
+   const struct double_vector* input;    /* Pekare till lagrets indata (feedforward, optimering). */
+   real_t* output;                       /* Pekare till flt dr utdatan lagras (feedforward). */
+   size_t num_weights;                   /* Antalet vikter per nod som anvnds. */
+   double learning_rate;                 /* Lrhastigheten vid optimering. */
+   struct dense_layer* previous;         /* Pekare till fregende lager (backpropagation). */
+   real_t* partial_errors;               /* Delsummor av fregende lagers avvikelser. */
+   size_t chunk_nodes;                   /* Antalet noder per intervall vid delsummering. */
+   size_t chunk_stride;                  /* Avstnd mellan intervallens delsummor. */
+};
 
 /* Statiska funktioner: */
 static void dense_layer_init(struct dense_layer* self);
@@ -10,12 +40,64 @@ static void dense_layer_set_nodes(struct dense_layer* self,
                                   const size_t num_nodes);
 static void dense_layer_set_weights(struct dense_layer* self, 
                                     const size_t num_weights);
-static inline double get_random_start_val(void);
-static inline double relu(const double x);
-static inline double delta_relu(const double x);
-static void print_line(const struct double_vector* self, 
+static void dense_layer_optimize_sparse(struct dense_layer* self,
+                                        real_t* previous_errors,
+                                        const size_t num_errors,
+                                        const struct double_vector* input,
+                                        const double learning_rate,
+                                        const size_t begin,
+                                        const size_t end);
+static void dense_layer_backpropagate_optimize_parallel(struct dense_layer* self,
+                                                        struct dense_layer* previous,
+                                                        const struct double_vector* input,
+                                                        const double learning_rate,
+                                                        const size_t num_weights);
+static void dense_layer_run(const size_t num_weights,
+                            const size_t num_nodes,
+                            void (*function)(void* arg, const size_t begin, const size_t end),
+                            struct dense_layer_task* task);
+static void feedforward_nodes(void* arg,
+                              const size_t begin,
+                              const size_t end);
+static void backpropagate_nodes(void* arg,
+                                const size_t begin,
+                                const size_t end);
+static void optimize_nodes(void* arg,
+                           const size_t begin,
+                           const size_t end);
+static void backpropagate_optimize_chunks(void* arg,
+                                          const size_t begin,
+                                          const size_t end);
+static void backpropagate_optimize_rows(struct dense_layer* self,
+                                        real_t* previous_errors,
+                                        const size_t num_errors,
+                                        const struct double_vector* input,
+                                        const double learning_rate,
+                                        const size_t num_weights,
+                                        const size_t begin,
+                                        const size_t end);
+static real_t* reserve_partial_errors(const size_t size);
+static void create_key(void);
+static void release_partial_errors(void);
+static void destroy_partial_errors(void* unused);
+static bool sparse_is_faster(const struct dense_layer* self);
+static double measure_feedforward(const struct dense_layer* self,
+                                  const bool sparse,
+                                  const real_t* input,
+                                  real_t* output);
+static double get_time(void);
+static inline real_t get_random_start_val(void);
+static void print_line(const real_t* data, 
+                       const size_t size,
                        FILE* ostream);
 
+/* Statiska variabler: */
+static size_t parallel_size = DENSE_LAYER_PARALLEL_SIZE; /* Grns fr trdpoolen. */
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t key;                         /* Nyckel som frigr trdens delsummor. */
+static _Thread_local real_t* partial_errors = 0;  /* Trdens buffer fr delsummor. */
+static _Thread_local size_t partial_capacity = 0; /* Antalet element som ryms i bufferten. */
+
 /**************************************************************************************************
 * dense_layer_new: Initierar angivet dense-lager. Minne allokeras fr lagrets noder och samtliga 
 *                  parametrar tilldelas startvrden.
@@ -31,7 +113,11 @@ void dense_layer_new(struct dense_layer* self,
    double_vector_new(&self->output);
    double_vector_new(&self->bias);
    double_vector_new(&self->error);
-   double_2d_vector_new(&self->weights);
+   double_matrix_new(&self->weights);
+   half_matrix_new(&self->half_weights);
+   csr_matrix_new(&self->sparse_weights);
+   self->sparse_kernels = false;
+   self->activation = ACTIVATION_RELU;
    self->num_nodes = num_nodes;
    self->num_weights = num_weights;
    dense_layer_init(self);
@@ -48,7 +134,10 @@ void dense_layer_delete(struct dense_layer* self)
    double_vector_delete(&self->output);
    double_vector_delete(&self->bias);
    double_vector_delete(&self->error);
-   double_2d_vector_delete(&self->weights);
+   double_matrix_delete(&self->weights);
+   half_matrix_delete(&self->half_weights);
+   csr_matrix_delete(&self->sparse_weights);
+   self->sparse_kernels = false;
    self->num_nodes = 0;
    self->num_weights = 0;
    return;
@@ -63,7 +152,7 @@ void dense_layer_delete(struct dense_layer* self)
 struct dense_layer* dense_layer_ptr_new(const size_t num_nodes, 
                                         const size_t num_weights)
 {
-   struct dense_layer* self = (struct dense_layer*)malloc(sizeof(struct dense_layer));
+   struct dense_layer* self = (struct dense_layer*)allocator_alloc(sizeof(struct dense_layer));
    if (!self) return 0;
    dense_layer_new(self, num_nodes, num_weights);
    return self;
@@ -78,22 +167,29 @@ struct dense_layer* dense_layer_ptr_new(const size_t num_nodes,
 void dense_layer_ptr_delete(struct dense_layer** self)
 {
    dense_layer_delete(*self);
-   free(*self);
+   allocator_free(*self);
    *self = 0;
    return;
 }
 
 /**************************************************************************************************
-* dense_layer_clear: Nollstller parametrar i angivet dense-lager.
+* dense_layer_clear: Nollstller parametrar i angivet dense-lager. Valt format fr vikterna
+*                    behlls, s att en ny kopia i halv precision skapas vid terstllning,
+*                    likt vald aktiveringsfunktion. En gles kopia av vikterna tas bort.
 * 
 *                    - self: Pekare till dense-lagret.
 **************************************************************************************************/
 void dense_layer_clear(struct dense_layer* self)
 {
+   const enum half_format format = self->half_weights.format;
    double_vector_delete(&self->output);
    double_vector_delete(&self->bias);
    double_vector_delete(&self->error);
-   double_2d_vector_delete(&self->weights);
+   double_matrix_delete(&self->weights);
+   half_matrix_delete(&self->half_weights);
+   csr_matrix_delete(&self->sparse_weights);
+   self->sparse_kernels = false;
+   self->half_weights.format = format;
    return;
 }
 
@@ -109,7 +205,9 @@ void dense_layer_reset(struct dense_layer* self)
    return;
 }
 /**************************************************************************************************
-* dense_layer_resize: ndrar antalet noder och/eller vikter i angivet dense-lager.
+* dense_layer_resize: ndrar antalet noder och/eller vikter i angivet dense-lager. Vid ndrad
+*                     storlek tas en gles kopia av vikterna bort, eftersom tillagda vikter
+*                     tilldelas nollskilda startvrden.
 * 
 *                     - self       : Pekare till dense-lagret.
 *                     - num_nodes  : Nytt antal noder i dense-lagret.
@@ -119,6 +217,11 @@ void dense_layer_resize(struct dense_layer* self,
                         const size_t num_nodes, 
                         const size_t num_weights)
 {
+   if (num_nodes != self->num_nodes || num_weights != self->num_weights)
+   {
+      csr_matrix_delete(&self->sparse_weights);
+      self->sparse_kernels = false;
+   }
    if (num_nodes != self->num_nodes)
    {
       dense_layer_set_nodes(self, num_nodes);
@@ -127,11 +230,91 @@ void dense_layer_resize(struct dense_layer* self,
    {
       dense_layer_set_weights(self, num_weights);
    }
+
+   dense_layer_set_weight_format(self, self->half_weights.format);
    return;
 }
 
 /**************************************************************************************************
-* dense_layer_feedforward: Berknar ny utdata fr angivet dense-lager via ny indata.
+* dense_layer_set_weight_format: Vljer format fr de vikter som anvnds vid feedforward. Vid
+*                                halv precision (fp16 eller bf16) skapas en avrundad kopia av
+*                                vikterna, vilken hlls uppdaterad vid trning, medan vikterna i
+*                                full precision anvnds vid backpropagation samt optimering.
+*                                Vid HALF_FORMAT_NONE anvnds vikterna i full precision.
+*                                Ifall lagret har beskurits jmfrs de glesa krnorna p nytt
+*                                med de tta krnorna fr valt format. Returnerar 1 ifall
+*                                minnesallokering misslyckas, annars 0.
+*
+*                                - self  : Pekare till dense-lagret.
+*                                - format: Format fr vikterna som anvnds vid feedforward.
+**************************************************************************************************/
+int dense_layer_set_weight_format(struct dense_layer* self,
+                                  const enum half_format format)
+{
+   if (half_matrix_narrow(&self->half_weights, &self->weights, format)) return 1;
+   if (self->sparse_weights.row_offsets) self->sparse_kernels = sparse_is_faster(self);
+   return 0;
+}
+
+/**************************************************************************************************
+* dense_layer_set_activation: Vljer aktiveringsfunktion fr samtliga noder i angivet dense-lager.
+*                             Returnerar 1 ifall angiven aktiveringsfunktion inte finns, annars 0.
+*
+*                             - self      : Pekare till dense-lagret.
+*                             - activation: Aktiveringsfunktionen som skall anvndas.
+**************************************************************************************************/
+int dense_layer_set_activation(struct dense_layer* self,
+                               const enum activation activation)
+{
+   if (!activation_valid(activation)) return 1;
+   self->activation = activation;
+   return 0;
+}
+
+/**************************************************************************************************
+* dense_layer_sparsify: Beskr angivet dense-lager genom att nollstlla vikter vars belopp inte
+*                       verstiger angivet trskelvrde och skapar en gles kopia (CSR) av
+*                       kvarvarande vikter. Vid efterfljande trning justeras enbart
+*                       kvarvarande vikter, s att beskurna vikter frblir noll. Huruvida den
+*                       glesa kopian anvnds vid feedforward samt backpropagation avgrs genom
+*                       att de glesa och tta krnorna mts p lagrets egna vikter, eftersom
+*                       brytpunkten beror p lagrets storlek, gleshet samt processor. Vid ett
+*                       negativt trskelvrde tas den glesa kopian bort, medan redan beskurna
+*                       vikter frblir noll. Returnerar 1 ifall minnesallokering misslyckas,
+*                       annars 0.
+*
+*                       - self     : Pekare till dense-lagret.
+*                       - threshold: Trskelvrde, vikter med mindre eller lika belopp tas bort.
+**************************************************************************************************/
+int dense_layer_sparsify(struct dense_layer* self,
+                         const double threshold)
+{
+   if (threshold < 0)
+   {
+      csr_matrix_delete(&self->sparse_weights);
+      self->sparse_kernels = false;
+      return 0;
+   }
+
+   for (size_t i = 0; i < self->num_nodes; ++i)
+   {
+      real_t* weights = double_matrix_row(&self->weights, i);
+
+      for (size_t j = 0; j < self->num_weights; ++j)
+      {
+         if (weights[j] <= threshold && weights[j] >= -threshold) weights[j] = 0;
+      }
+   }
+
+   if (csr_matrix_sparsify(&self->sparse_weights, &self->weights, (real_t)threshold)) return 1;
+   return dense_layer_set_weight_format(self, self->half_weights.format);
+}
+
+/**************************************************************************************************
+* dense_layer_feedforward: Berknar ny utdata fr angivet dense-lager via ny indata. Ifall
+*                          lagret har beskurits och den glesa kopian av vikterna har uppmtts
+*                          som snabbast anvnds denna. I stora lager frdelas noderna mellan
+*                          trdarna i trdpoolen.
 * 
 *                          - self : Pekare till dense-lagret.
 *                          - input: Pekare till vektor innehllande ny indata.
@@ -139,17 +322,78 @@ void dense_layer_resize(struct dense_layer* self,
 void dense_layer_feedforward(struct dense_layer* self, 
                              const struct double_vector* input)
 {
-   for (size_t i = 0; i < self->num_nodes; ++i)
-   {
-      double sum = self->bias.data[i];
-      struct double_vector* weights = &self->weights.data[i];
+   dense_layer_feedforward_to(self, input, self->output.data);
+   return;
+}
+
+/**************************************************************************************************
+* dense_layer_feedforward_to: Berknar utdata fr angivet dense-lager och lagrar resultatet i
+*                             angivet flt i stllet fr i lagrets egna utsignaler. Lagret lses
+*                             enbart, vilket medfr att multipla trdar kan berkna utdata fr
+*                             samma lager samtidigt, s lnge varje trd anvnder egna flt fr
+*                             in- och utdata.
+*
+*                             - self  : Pekare till dense-lagret.
+*                             - input : Pekare till vektor innehllande indata.
+*                             - output: Pekare till flt dr utdatan skall lagras, som mste
+*                                       rymma ett vrde per nod.
+**************************************************************************************************/
+void dense_layer_feedforward_to(const struct dense_layer* self,
+                                const struct double_vector* input,
+                                real_t* output)
+{
+   struct dense_layer_task task = { .self = (struct dense_layer*)self, .input = input,
+                                    .output = output };
+   task.num_weights = self->num_weights < input->size ? self->num_weights : input->size;
+   dense_layer_run(self->sparse_kernels ? self->sparse_weights.nnz : 
+                   self->num_nodes * task.num_weights, self->num_nodes, &feedforward_nodes, &task);
+   return;
+}
+
+/**************************************************************************************************
+* dense_layer_feedforward_batch: Berknar utdata fr angivet dense-lager fr multipla
+*                                uppsttningar indata t gngen via en matrismultiplikation,
+*                                dr varje rad i indatamatrisen utgr en uppsttning och
+*                                resultatet lagras p motsvarande rad i utdatamatrisen. Lagrets
+*                                egna utsignaler pverkas inte. Utdatamatrisen mste rymma
+*                                angivet antal rader samt en kolumn per nod. Ifall lagret
+*                                anvnder den glesa kopian av vikterna eller vikter i halv
+*                                precision berknas i stllet varje uppsttning likt funktionen
+*                                dense_layer_feedforward_to, s att samma vikter anvnds som vid
+*                                prediktion av en enskild uppsttning.
+*
+*                                - self       : Pekare till dense-lagret.
+*                                - input      : Pekare till matris innehllande indata.
+*                                - output     : Pekare till matris dr utdatan skall lagras.
+*                                - num_samples: Antalet uppsttningar (rader) som skall berknas.
+**************************************************************************************************/
+void dense_layer_feedforward_batch(const struct dense_layer* self,
+                                   const struct double_matrix* input,
+                                   struct double_matrix* output,
+                                   const size_t num_samples)
+{
+   const size_t num_weights = self->num_weights < input->cols ? self->num_weights : input->cols;
 
-      for (size_t j = 0; j < self->num_weights && j < input->size; ++j)
+   if ((self->sparse_kernels && input->cols >= self->sparse_weights.cols) ||
+       self->half_weights.format != HALF_FORMAT_NONE)
+   {
+      for (size_t j = 0; j < num_samples; ++j)
       {
-         sum += input->data[j] * weights->data[j];
+         const struct double_vector row = { .data = double_matrix_row(input, j),
+                                            .size = input->cols, .capacity = input->cols };
+         dense_layer_feedforward_to(self, &row, double_matrix_row(output, j));
       }
-      
-      self->output.data[i] = relu(sum);
+      return;
+   }
+
+   gemm(GEMM_NO_TRANSPOSE, GEMM_TRANSPOSE, num_samples, self->num_nodes, num_weights,
+        1.0, input->data, input->stride, self->weights.data, self->weights.stride,
+        0.0, output->data, output->stride);
+
+   for (size_t j = 0; j < num_samples; ++j)
+   {
+      activation_apply(self->activation, double_matrix_row(output, j), self->bias.data,
+                       self->num_nodes);
    }
    return;
 }
@@ -165,18 +409,23 @@ void dense_layer_feedforward(struct dense_layer* self,
 void dense_layer_compare_with_reference(struct dense_layer* self, 
                                         const struct double_vector* reference)
 {
-   for (size_t i = 0; i < self->num_nodes && i < reference->size; ++i)
+   const size_t num_nodes = self->num_nodes < reference->size ? self->num_nodes : reference->size;
+
+   for (size_t i = 0; i < num_nodes; ++i)
    {
-      const double error = reference->data[i] - self->output.data[i];
-      self->error.data[i] = error * delta_relu(self->output.data[i]);
+      self->error.data[i] = reference->data[i] - self->output.data[i];
    }
+
+   activation_delta(self->activation, self->error.data, self->output.data, num_nodes);
    return;
 }
 
 /**************************************************************************************************
 * dense_layer_backpropagate: Berknar avvikelser i angivet dolt lager via data frn efterfljande
 *                            dense-lager, vilket kan vara antingen ett utgngslager eller ett 
-*                            annat dolt lager.
+*                            annat dolt lager. I stora lager med tta vikter frdelas noderna
+*                            mellan trdarna i trdpoolen, dr varje trd lser motsvarande
+*                            kolumner i efterfljande lagers vikter.
 *
 *                            - self      : Pekare till dense-lagret.
 *                            - next_layer: Pekare till efterfljande dense-lager.
@@ -184,17 +433,17 @@ void dense_layer_compare_with_reference(struct dense_layer* self,
 void dense_layer_backpropagate(struct dense_layer* self, 
                                const struct dense_layer* next_layer)
 {
-   for (size_t i = 0; i < self->num_nodes; ++i)
+   if (next_layer->sparse_kernels && next_layer->sparse_weights.cols == self->num_nodes)
    {
-      double deviation = 0;
-
-      for (size_t j = 0; j < next_layer->num_nodes; ++j)
-      {
-         const struct double_vector* weights = &next_layer->weights.data[j];
-         deviation += next_layer->error.data[j] * weights->data[i];
-      }
-
-      self->error.data[i] = deviation * delta_relu(self->output.data[i]);
+      csr_matrix_gemv_transposed(&next_layer->sparse_weights, next_layer->error.data,
+                                 self->error.data);
+      activation_delta(self->activation, self->error.data, self->output.data, self->num_nodes);
+   }
+   else
+   {
+      struct dense_layer_task task = { .self = self, .next_layer = next_layer };
+      dense_layer_run(next_layer->num_nodes * self->num_nodes, self->num_nodes,
+                      &backpropagate_nodes, &task);
    }
    return;
 }
@@ -202,7 +451,9 @@ void dense_layer_backpropagate(struct dense_layer* self,
 /**************************************************************************************************
 * dense_layer_optimize: Justerar bias samt vikter fr angivet dense-lager med angiven 
 *                       lrhastighet fr att minska fel. Utdatan frn fregende lager, som utgr
-*                       indata p angivet lager, anvnds fr att justera vikterna.
+*                       indata p angivet lager, anvnds fr att justera vikterna. I ett
+*                       beskuret lager justeras enbart kvarvarande vikter. I stora lager
+*                       frdelas noderna mellan trdarna i trdpoolen.
 *                       
 *                       - self         : Pekare till angivet dense-lager.
 *                       - input        : Pekare till vektor innehllande utdata frn fregende 
@@ -213,21 +464,95 @@ void dense_layer_optimize(struct dense_layer* self,
                           const struct double_vector* input,
                           const double learning_rate)
 {
-   for (size_t i = 0; i < self->num_nodes; ++i)
+   struct dense_layer_task task = { .self = self, .input = input, .learning_rate = learning_rate };
+   task.num_weights = self->num_weights < input->size ? self->num_weights : input->size;
+   dense_layer_run(self->sparse_weights.row_offsets ? self->sparse_weights.nnz : 
+                   self->num_nodes * task.num_weights, self->num_nodes, &optimize_nodes, &task);
+   return;
+}
+
+/**************************************************************************************************
+* dense_layer_backpropagate_optimize: Berknar avvikelser i fregende dense-lager via angivet
+*                                     lagers avvikelser och vikter och justerar drefter bias
+*                                     samt vikter i angivet lager. Varje viktrad anvnds frst
+*                                     fr att berkna avvikelserna och justeras direkt drefter,
+*                                     vilket medfr att viktmatrisen enbart lses en gng.
+*                                     Resultatet motsvarar anrop av dense_layer_backpropagate
+*                                     fr fregende lager fljt av dense_layer_optimize.
+*                                     I ett beskuret lager lses samt justeras enbart
+*                                     kvarvarande vikter via den glesa kopian. I stora lager
+*                                     frdelas noderna mellan trdarna i trdpoolen, dr
+*                                     resultatet inte beror p antalet trdar.
+*
+*                                     - self         : Pekare till dense-lagret, vars avvikelser
+*                                                      redan har berknats.
+*                                     - previous     : Pekare till fregende dense-lager, vars
+*                                                      avvikelser skall berknas (null ifall
+*                                                      angivet lager r det frsta).
+*                                     - input        : Pekare till vektor innehllande indata
+*                                                      till angivet lager.
+*                                     - learning_rate: Lrhastigheten, avgr graden av justering.
+**************************************************************************************************/
+void dense_layer_backpropagate_optimize(struct dense_layer* self,
+                                       struct dense_layer* previous,
+                                       const struct double_vector* input,
+                                       const double learning_rate)
+{
+   const size_t num_weights = self->num_weights < input->size ? self->num_weights : input->size;
+   const size_t num_processed = self->sparse_weights.row_offsets ? self->sparse_weights.nnz :
+                                self->num_nodes * num_weights;
+
+   if (!previous)
    {
-      const double change_rate = self->error.data[i] * learning_rate;
-      struct double_vector* weights = &self->weights.data[i];
-      self->bias.data[i] += change_rate;
+      struct dense_layer_task task = { .self = self, .input = input,
+                                       .learning_rate = learning_rate };
+      task.num_weights = num_weights;
+      dense_layer_run(num_processed, self->num_nodes, &optimize_nodes, &task);
+      return;
+   }
 
-      for (size_t j = 0; j < self->num_weights && j < input->size; ++j)
-      {
-         weights->data[j] += change_rate * input->data[j];
-      }
+   if (num_processed >= parallel_size && self->num_nodes > 1)
+   {
+      dense_layer_backpropagate_optimize_parallel(self, previous, input, learning_rate,
+                                                  num_weights);
+   }
+   else
+   {
+      memset(previous->error.data, 0, sizeof(real_t) * previous->num_nodes);
+      backpropagate_optimize_rows(self, previous->error.data, previous->num_nodes, input,
+                                  learning_rate, num_weights, 0, self->num_nodes);
    }
 
+   activation_delta(previous->activation, previous->error.data, previous->output.data,
+                    previous->num_nodes);
+   return;
+}
+
+/**************************************************************************************************
+* dense_layer_set_parallel_size: Anger minsta antal vikter som ett lager mste bearbeta fr att
+*                                noderna skall frdelas mellan trdarna i trdpoolen (default
+*                                DENSE_LAYER_PARALLEL_SIZE). Lmpligt vrde beror p antalet
+*                                krnor samt cacheminnet och kan mtas fram via programmet
+*                                tools/bench_backprop.c. Br anropas innan trning eller
+*                                prediktion pbrjas.
+*
+*                                - num_weights: Minsta antal vikter (0 = alltid trdpoolen).
+**************************************************************************************************/
+void dense_layer_set_parallel_size(const size_t num_weights)
+{
+   parallel_size = num_weights;
    return;
 }
 
+/**************************************************************************************************
+* dense_layer_parallel_size: Returnerar minsta antal vikter som ett lager mste bearbeta fr att
+*                            noderna skall frdelas mellan trdarna i trdpoolen.
+**************************************************************************************************/
+size_t dense_layer_parallel_size(void)
+{
+   return parallel_size;
+}
+
 /**************************************************************************************************
 * dense_layer_print: Skriver ut information gllande givet dense-lager via angiven utstrm, dr
 *                    standardutenheten stdout anvnds som default fr utskrift i terminalen.
@@ -243,24 +568,31 @@ void dense_layer_print(const struct dense_layer* self,
 
    fprintf(ostream, "Number of nodes: %zu\n", self->num_nodes);
    fprintf(ostream, "Weights per node: %zu\n", self->num_weights);
+   fprintf(ostream, "Activation function: %s\n", activation_name(self->activation));
+
+   if (self->sparse_weights.row_offsets)
+   {
+      fprintf(ostream, "Sparse weights: %zu (density %.1f %%, %s kernels)\n",
+              self->sparse_weights.nnz, csr_matrix_density(&self->sparse_weights) * 100,
+              self->sparse_kernels ? "sparse" : "dense");
+   }
    fprintf(ostream, "----------------------------------------------------------------------------\n");
 
    fprintf(ostream, "Outputs: ");
-   print_line(&self->output, ostream);
+   print_line(self->output.data, self->output.size, ostream);
 
    fprintf(ostream, "Bias: ");
-   print_line(&self->bias, ostream);
+   print_line(self->bias.data, self->bias.size, ostream);
 
    fprintf(ostream, "Error: ");
-   print_line(&self->error, ostream);
+   print_line(self->error.data, self->error.size, ostream);
 
    fprintf(ostream, "\nWeights:\n");
 
    for (size_t i = 0; i < self->num_nodes; ++i)
    {
       fprintf(ostream, "\tNode %zu: ", i + 1);
-      struct double_vector* weights = &self->weights.data[i];
-      print_line(weights, ostream);
+      print_line(double_matrix_row(&self->weights, i), self->num_weights, ostream);
    }
 
    fprintf(ostream, "----------------------------------------------------------------------------\n\n");
@@ -279,24 +611,23 @@ static void dense_layer_init(struct dense_layer* self)
    double_vector_resize(&self->output, self->num_nodes);
    double_vector_resize(&self->bias, self->num_nodes);
    double_vector_resize(&self->error, self->num_nodes);
-   double_2d_vector_resize(&self->weights, self->num_nodes);
+   double_matrix_resize(&self->weights, self->num_nodes, self->num_weights);
 
    for (size_t i = 0; i < self->num_nodes; ++i)
    {
-      struct double_vector weights = { .data = 0, .size = 0 };
-      double_vector_resize(&weights, self->num_weights);
+      real_t* weights = double_matrix_row(&self->weights, i);
 
       for (size_t j = 0; j < self->num_weights; ++j)
       {
-         weights.data[j] = get_random_start_val();
+         weights[j] = get_random_start_val();
       }
 
       self->output.data[i] = 0;
       self->bias.data[i] = get_random_start_val();
       self->error.data[i] = 0;
-      self->weights.data[i] = weights;
    }
 
+   dense_layer_set_weight_format(self, self->half_weights.format);
    return;
 }
 
@@ -313,24 +644,22 @@ static void dense_layer_set_nodes(struct dense_layer* self,
    double_vector_resize(&self->output, num_nodes);
    double_vector_resize(&self->bias, num_nodes);
    double_vector_resize(&self->error, num_nodes);
-   double_2d_vector_resize(&self->weights, num_nodes);
+   double_matrix_resize(&self->weights, num_nodes, self->num_weights);
 
    if (num_nodes > self->num_nodes)
    {
       for (size_t i = self->num_nodes; i < num_nodes; ++i)
       {
-         struct double_vector weights = { .data = 0, .size = 0 };
-         double_vector_resize(&weights, self->num_weights);
+         real_t* weights = double_matrix_row(&self->weights, i);
 
          for (size_t j = 0; j < self->num_weights; ++j)
          {
-            weights.data[j] = get_random_start_val();
+            weights[j] = get_random_start_val();
          }
 
          self->output.data[i] = 0;
          self->bias.data[i] = get_random_start_val(); 
          self->error.data[i] = 0;
-         self->weights.data[i] = weights;
       }
    }
 
@@ -348,19 +677,16 @@ static void dense_layer_set_nodes(struct dense_layer* self,
 static void dense_layer_set_weights(struct dense_layer* self, 
                                     const size_t num_weights)
 {
-   for (size_t i = 0; i < self->num_nodes; ++i)
-   {
-      double_vector_resize(&self->weights.data[i], num_weights);
-   }
+   double_matrix_resize(&self->weights, self->num_nodes, num_weights);
 
    if (num_weights > self->num_weights)
    {
       for (size_t i = 0; i < self->num_nodes; ++i)
       {
-         struct double_vector* weights = &self->weights.data[i];
+         real_t* weights = double_matrix_row(&self->weights, i);
          for (size_t j = self->num_weights; j < num_weights; ++j)
          {
-            weights->data[j] = get_random_start_val();
+            weights[j] = get_random_start_val();
          }
       }
    }
@@ -370,47 +696,489 @@ static void dense_layer_set_weights(struct dense_layer* self,
 }
 
 /**************************************************************************************************
-* get_random_start_val: Returnerar ett randomiserat flyttal mellan 0.0 - 1.0.
+* dense_layer_optimize_sparse: Justerar bias samt kvarvarande vikter i ett beskuret dense-lager,
+*                              dr vikterna i den glesa kopian samt motsvarande vikter i full
+*                              precision uppdateras, medan beskurna vikter frblir noll. Ifall
+*                              fregende lagers avvikelser anges adderas ven dessa (fre
+*                              aktiveringsfunktionens derivata) via vikterna fre justering.
+*
+*                              - self           : Pekare till dense-lagret.
+*                              - previous_errors: Pekare till flt dr fregende lagers
+*                                                 avvikelser adderas (null ifall enbart
+*                                                 optimering skall genomfras).
+*                              - num_errors     : Antalet avvikelser i fltet.
+*                              - input        : Pekare till vektor innehllande indata.
+*                              - learning_rate: Lrhastigheten, avgr graden av justering.
+*                              - begin        : Index fr frsta noden som skall justeras.
+*                              - end          : Index efter sista noden som skall justeras.
 **************************************************************************************************/
-static inline double get_random_start_val(void)
+static void dense_layer_optimize_sparse(struct dense_layer* self,
+                                        real_t* previous_errors,
+                                        const size_t num_errors,
+                                        const struct double_vector* input,
+                                        const double learning_rate,
+                                        const size_t begin,
+                                        const size_t end)
 {
-   return rand() / (double)RAND_MAX;
+   const struct csr_matrix* sparse = &self->sparse_weights;
+   const size_t num_weights = self->num_weights < input->size ? self->num_weights : input->size;
+   const enum half_format format = self->half_weights.format;
+
+   for (size_t i = begin; i < end; ++i)
+   {
+      const real_t error = self->error.data[i];
+      const real_t change_rate = error * learning_rate;
+      real_t* weights = double_matrix_row(&self->weights, i);
+      uint16_t* half_weights = format != HALF_FORMAT_NONE ?
+                               self->half_weights.data + i * self->half_weights.stride : 0;
+
+      for (size_t k = sparse->row_offsets[i]; k < sparse->row_offsets[i + 1]; ++k)
+      {
+         const uint32_t column = sparse->columns[k];
+
+         if (column < num_errors)
+         {
+            previous_errors[column] += error * sparse->values[k];
+         }
+         if (column < num_weights)
+         {
+            sparse->values[k] += change_rate * input->data[column];
+            weights[column] = sparse->values[k];
+
+            if (format != HALF_FORMAT_NONE)
+            {
+               half_weights[column] = half_from_real(sparse->values[k], format);
+            }
+         }
+      }
+
+      self->bias.data[i] += change_rate;
+   }
+   return;
 }
 
 /**************************************************************************************************
-* relu: Returnerar ReLU (Rectified Linear Unit) ur angiven insignal x:
-*       x > 0.0  => ReLU(x) = x
-*       x <= 0.0 => ReLU(x) = 0.0
-* 
-*       - x: Aktuell insignal.
+* dense_layer_backpropagate_optimize_parallel: Berknar avvikelser i fregende dense-lager och
+*                                              justerar angivet lager via trdpoolen. Noderna
+*                                              delas upp i DENSE_LAYER_PARALLEL_CHUNKS intervall
+*                                              vars storlek enbart beror p lagret, dr varje
+*                                              intervall summerar sitt bidrag till fregende
+*                                              lagers avvikelser i en egen buffer. Bidragen
+*                                              adderas sedan i intervallens ordning, vilket
+*                                              medfr att resultatet r detsamma oavsett antalet
+*                                              trdar. Ifall minnesallokering misslyckas
+*                                              genomfrs berkningen av anropande trd.
+*
+*                                              - self         : Pekare till dense-lagret.
+*                                              - previous     : Pekare till fregende lager.
+*                                              - input        : Pekare till lagrets indata.
+*                                              - learning_rate: Lrhastigheten.
+*                                              - num_weights  : Antalet vikter per nod.
 **************************************************************************************************/
-static inline double relu(const double x)
+static void dense_layer_backpropagate_optimize_parallel(struct dense_layer* self,
+                                                        struct dense_layer* previous,
+                                                        const struct double_vector* input,
+                                                        const double learning_rate,
+                                                        const size_t num_weights)
 {
-   return x > 0.0 ? x : 0.0;
+   const size_t alignment = DENSE_LAYER_PARALLEL_ALIGNMENT;
+   const size_t per_chunk = (self->num_nodes + DENSE_LAYER_PARALLEL_CHUNKS - 1) /
+                            DENSE_LAYER_PARALLEL_CHUNKS;
+   const size_t chunk_nodes = (per_chunk + alignment - 1) / alignment * alignment;
+   const size_t num_chunks = (self->num_nodes + chunk_nodes - 1) / chunk_nodes;
+   const size_t chunk_stride = (previous->num_nodes + alignment - 1) / alignment * alignment;
+   real_t* partial = reserve_partial_errors(num_chunks * chunk_stride);
+
+   if (!partial)
+   {
+      memset(previous->error.data, 0, sizeof(real_t) * previous->num_nodes);
+      backpropagate_optimize_rows(self, previous->error.data, previous->num_nodes, input,
+                                  learning_rate, num_weights, 0, self->num_nodes);
+      return;
+   }
+
+   struct dense_layer_task task = { .self = self, .input = input, .num_weights = num_weights,
+                                    .learning_rate = learning_rate, .previous = previous,
+                                    .partial_errors = partial, .chunk_nodes = chunk_nodes,
+                                    .chunk_stride = chunk_stride };
+   thread_pool_run(num_chunks, 1, &backpropagate_optimize_chunks, &task);
+   memcpy(previous->error.data, partial, sizeof(real_t) * previous->num_nodes);
+
+   for (size_t i = 1; i < num_chunks; ++i)
+   {
+      simd_axpy(previous->error.data, 1.0, partial + i * chunk_stride, previous->num_nodes);
+   }
+   return;
 }
 
 /**************************************************************************************************
-* delta_relu: Returnerar derivatan av angiven insignal x:
-*             x > 0.0  => ReLU(x) = x   => ReLU'(x) = 1.0
-*             x <= 0.0 => ReLU(x) = 0.0 => ReLU'(x) = 0.0
-* 
-*             - x: Aktuell insignal.
+* dense_layer_run: Anropar angiven funktion fr samtliga noder i ett dense-lager. Ifall antalet
+*                  vikter som bearbetas uppgr till minst angiven grns (se funktionen
+*                  dense_layer_set_parallel_size) frdelas noderna mellan trdarna i
+*                  trdpoolen, dr varje delintervall startar p en ny cacheminnesrad i lagrets
+*                  vektorer. Mindre lager bearbetas direkt av anropande trd, d vckning av
+*                  trdarna annars kostar mer n den sparar.
+*
+*                  - num_weights: Antalet vikter som bearbetas i lagret.
+*                  - num_nodes  : Antalet noder i lagret.
+*                  - function   : Funktion som bearbetar noderna i intervallet [begin, end).
+*                  - task       : Pekare till argument som passeras till funktionen.
 **************************************************************************************************/
-static inline double delta_relu(const double x)
+static void dense_layer_run(const size_t num_weights,
+                            const size_t num_nodes,
+                            void (*function)(void* arg, const size_t begin, const size_t end),
+                            struct dense_layer_task* task)
 {
-   return x > 0.0 ? 1.0 : 0.0;
+   if (num_weights >= parallel_size)
+   {
+      thread_pool_run(num_nodes, DENSE_LAYER_PARALLEL_ALIGNMENT, function, task);
+   }
+   else
+   {
+      function(task, 0, num_nodes);
+   }
+   return;
+}
+
+/**************************************************************************************************
+* feedforward_nodes: Berknar utdata fr noderna i intervallet [begin, end) i ett dense-lager
+*                    via den glesa kopian av vikterna, vikterna i halv precision eller de tta
+*                    vikterna, fljt av lagrets aktiveringsfunktion.
+*
+*                    - arg  : Pekare till argument av typen dense_layer_task.
+*                    - begin: Index fr frsta noden som skall berknas.
+*                    - end  : Index efter sista noden som skall berknas.
+**************************************************************************************************/
+static void feedforward_nodes(void* arg,
+                              const size_t begin,
+                              const size_t end)
+{
+   const struct dense_layer_task* task = (const struct dense_layer_task*)arg;
+   const struct dense_layer* self = task->self;
+   const struct double_vector* input = task->input;
+   real_t* output = task->output + begin;
+
+   if (self->sparse_kernels && input->size >= self->sparse_weights.cols)
+   {
+      struct csr_matrix rows = self->sparse_weights;
+      rows.row_offsets += begin;
+      rows.rows = end - begin;
+      csr_matrix_gemv(&rows, input->data, output);
+   }
+   else if (self->half_weights.format != HALF_FORMAT_NONE)
+   {
+      struct half_matrix rows = self->half_weights;
+      rows.data += begin * rows.stride;
+      rows.rows = end - begin;
+      half_matrix_gemv(&rows, task->num_weights, input->data, output);
+   }
+   else
+   {
+      gemv(GEMM_NO_TRANSPOSE, end - begin, task->num_weights,
+           double_matrix_row(&self->weights, begin), self->weights.stride, input->data, output);
+   }
+
+   activation_apply(self->activation, output, self->bias.data + begin, end - begin);
+   return;
+}
+
+/**************************************************************************************************
+* backpropagate_nodes: Berknar avvikelser fr noderna i intervallet [begin, end) i ett dolt
+*                      dense-lager via motsvarande kolumner i efterfljande lagers tta vikter.
+*
+*                      - arg  : Pekare till argument av typen dense_layer_task.
+*                      - begin: Index fr frsta noden vars avvikelse skall berknas.
+*                      - end  : Index efter sista noden vars avvikelse skall berknas.
+**************************************************************************************************/
+static void backpropagate_nodes(void* arg,
+                                const size_t begin,
+                                const size_t end)
+{
+   const struct dense_layer_task* task = (const struct dense_layer_task*)arg;
+   struct dense_layer* self = task->self;
+   const struct dense_layer* next_layer = task->next_layer;
+
+   gemv(GEMM_TRANSPOSE, next_layer->num_nodes, end - begin, next_layer->weights.data + begin,
+        next_layer->weights.stride, next_layer->error.data, self->error.data + begin);
+   activation_delta(self->activation, self->error.data + begin, self->output.data + begin,
+                    end - begin);
+   return;
+}
+
+/**************************************************************************************************
+* optimize_nodes: Justerar bias samt vikter fr noderna i intervallet [begin, end) i ett
+*                 dense-lager, dr enbart kvarvarande vikter justeras i ett beskuret lager.
+*
+*                 - arg  : Pekare till argument av typen dense_layer_task.
+*                 - begin: Index fr frsta noden som skall justeras.
+*                 - end  : Index efter sista noden som skall justeras.
+**************************************************************************************************/
+static void optimize_nodes(void* arg,
+                           const size_t begin,
+                           const size_t end)
+{
+   const struct dense_layer_task* task = (const struct dense_layer_task*)arg;
+   struct dense_layer* self = task->self;
+
+   if (self->sparse_weights.row_offsets)
+   {
+      dense_layer_optimize_sparse(self, 0, 0, task->input, task->learning_rate, begin, end);
+      return;
+   }
+
+   for (size_t i = begin; i < end; ++i)
+   {
+      real_t* weights = double_matrix_row(&self->weights, i);
+      const real_t change_rate = self->error.data[i] * task->learning_rate;
+      self->bias.data[i] += change_rate;
+      simd_axpy(weights, change_rate, task->input->data, task->num_weights);
+
+      if (self->half_weights.format != HALF_FORMAT_NONE)
+      {
+         half_matrix_narrow_row(&self->half_weights, i, weights, task->num_weights);
+      }
+   }
+   return;
+}
+
+/**************************************************************************************************
+* backpropagate_optimize_chunks: Berknar bidragen till fregende lagers avvikelser samt
+*                                justerar noderna i nodintervallen [begin, end) i ett
+*                                dense-lager, dr varje intervall nollstller och summerar i
+*                                sin egen buffer fr delsummor.
+*
+*                                - arg  : Pekare till argument av typen dense_layer_task.
+*                                - begin: Index fr frsta intervallet som skall bearbetas.
+*                                - end  : Index efter sista intervallet som skall bearbetas.
+**************************************************************************************************/
+static void backpropagate_optimize_chunks(void* arg,
+                                          const size_t begin,
+                                          const size_t end)
+{
+   const struct dense_layer_task* task = (const struct dense_layer_task*)arg;
+   struct dense_layer* self = task->self;
+   const size_t num_errors = task->previous->num_nodes;
+
+   for (size_t i = begin; i < end; ++i)
+   {
+      real_t* partial = task->partial_errors + i * task->chunk_stride;
+      const size_t first = i * task->chunk_nodes;
+      const size_t last = first + task->chunk_nodes < self->num_nodes ?
+                          first + task->chunk_nodes : self->num_nodes;
+
+      memset(partial, 0, sizeof(real_t) * num_errors);
+      backpropagate_optimize_rows(self, partial, num_errors, task->input, task->learning_rate,
+                                  task->num_weights, first, last);
+   }
+   return;
+}
+
+/**************************************************************************************************
+* backpropagate_optimize_rows: Adderar bidragen frn noderna i intervallet [begin, end) i ett
+*                              dense-lager till angivet flt med fregende lagers avvikelser
+*                              och justerar drefter nodernas bias samt vikter. Varje viktrad
+*                              anvnds frst fr att berkna avvikelserna och justeras direkt
+*                              drefter. I ett beskuret lager anvnds den glesa kopian.
+*
+*                              - self           : Pekare till dense-lagret.
+*                              - previous_errors: Pekare till flt dr avvikelserna adderas.
+*                              - num_errors     : Antalet avvikelser i fltet.
+*                              - input          : Pekare till lagrets indata.
+*                              - learning_rate  : Lrhastigheten.
+*                              - num_weights    : Antalet vikter per nod som anvnds.
+*                              - begin          : Index fr frsta noden som skall bearbetas.
+*                              - end            : Index efter sista noden som skall bearbetas.
+**************************************************************************************************/
+static void backpropagate_optimize_rows(struct dense_layer* self,
+                                        real_t* previous_errors,
+                                        const size_t num_errors,
+                                        const struct double_vector* input,
+                                        const double learning_rate,
+                                        const size_t num_weights,
+                                        const size_t begin,
+                                        const size_t end)
+{
+   if (self->sparse_weights.row_offsets)
+   {
+      dense_layer_optimize_sparse(self, previous_errors, num_errors, input, learning_rate,
+                                  begin, end);
+      return;
+   }
+
+   for (size_t i = begin; i < end; ++i)
+   {
+      real_t* weights = double_matrix_row(&self->weights, i);
+      const real_t change_rate = self->error.data[i] * learning_rate;
+
+      simd_axpy(previous_errors, self->error.data[i], weights, num_errors);
+      self->bias.data[i] += change_rate;
+      simd_axpy(weights, change_rate, input->data, num_weights);
+
+      if (self->half_weights.format != HALF_FORMAT_NONE)
+      {
+         half_matrix_narrow_row(&self->half_weights, i, weights, num_weights);
+      }
+   }
+   return;
+}
+
+/**************************************************************************************************
+* reserve_partial_errors: Returnerar en pekare till anropande trds buffer fr delsummor, som
+*                         rymmer minst angivet antal element. Vid trdens frsta allokering
+*                         registreras bufferten s att den frigrs nr trden avslutas.
+*                         Returnerar null ifall minnesallokering misslyckas.
+*
+*                         - size: Minsta antal element som bufferten skall rymma.
+**************************************************************************************************/
+static real_t* reserve_partial_errors(const size_t size)
+{
+   if (size <= partial_capacity) return partial_errors;
+   real_t* copy = (real_t*)aligned_alloc(THREAD_POOL_CACHE_LINE, sizeof(real_t) * size);
+   if (!copy) return 0;
+   free(partial_errors);
+   partial_errors = copy;
+   partial_capacity = size;
+   pthread_once(&key_once, &create_key);
+   pthread_setspecific(key, copy);
+   return copy;
+}
+
+/**************************************************************************************************
+* create_key: Skapar nyckeln vars destruktor frigr en trds buffer fr delsummor nr trden
+*             avslutas. Den trd som avslutar programmet frigr sin buffer via atexit.
+**************************************************************************************************/
+static void create_key(void)
+{
+   pthread_key_create(&key, &destroy_partial_errors);
+   atexit(&release_partial_errors);
+   return;
+}
+
+/**************************************************************************************************
+* release_partial_errors: Frigr anropande trds buffer fr delsummor.
+**************************************************************************************************/
+static void release_partial_errors(void)
+{
+   free(partial_errors);
+   partial_errors = 0;
+   partial_capacity = 0;
+   return;
+}
+
+/**************************************************************************************************
+* destroy_partial_errors: Destruktor som frigr avslutande trds buffer fr delsummor.
+**************************************************************************************************/
+static void destroy_partial_errors(void* unused)
+{
+   (void)unused;
+   release_partial_errors();
+   return;
+}
+
+/**************************************************************************************************
+* sparse_is_faster: Indikerar ifall feedforward via den glesa kopian av vikterna i angivet
+*                   dense-lager r snabbare n via de tta vikterna (i valt format), vilket mts
+*                   genom att respektive krna krs p lagrets egna vikter. Samma val anvnds
+*                   vid backpropagation, som lser samma vikter.
+*
+*                   - self: Pekare till dense-lagret.
+**************************************************************************************************/
+static bool sparse_is_faster(const struct dense_layer* self)
+{
+   const size_t size = self->num_weights > self->num_nodes ? self->num_weights : self->num_nodes;
+   real_t* buffer = (real_t*)malloc(sizeof(real_t) * (size ? size : 1) * 2);
+   double dense = -1, sparse = -1;
+
+   if (!buffer) return false;
+
+   for (size_t i = 0; i < size; ++i)
+   {
+      buffer[i] = 1;
+   }
+
+   for (size_t i = 0; i < 3; ++i)
+   {
+      const double dense_time = measure_feedforward(self, false, buffer, buffer + size);
+      const double sparse_time = measure_feedforward(self, true, buffer, buffer + size);
+      if (dense < 0 || dense_time < dense) dense = dense_time;
+      if (sparse < 0 || sparse_time < sparse) sparse = sparse_time;
+   }
+
+   free(buffer);
+   return sparse < dense;
+}
+
+/**************************************************************************************************
+* measure_feedforward: Returnerar genomsnittlig krtid i sekunder fr multiplikation av
+*                      vikterna i angivet dense-lager med en vektor, dr krnan anropas upprepade
+*                      gnger tills den sammanlagda mttiden verstiger DENSE_LAYER_MEASURE_TIME.
+*
+*                      - self  : Pekare till dense-lagret.
+*                      - sparse: Indikerar ifall den glesa kopian av vikterna skall anvndas.
+*                      - input : Pekare till indata (num_weights element).
+*                      - output: Pekare till utdata (num_nodes element).
+**************************************************************************************************/
+static double measure_feedforward(const struct dense_layer* self,
+                                  const bool sparse,
+                                  const real_t* input,
+                                  real_t* output)
+{
+   const double start = get_time();
+   double elapsed = 0;
+   size_t num_calls = 0;
+
+   while (elapsed < DENSE_LAYER_MEASURE_TIME)
+   {
+      if (sparse)
+      {
+         csr_matrix_gemv(&self->sparse_weights, input, output);
+      }
+      else if (self->half_weights.format != HALF_FORMAT_NONE)
+      {
+         half_matrix_gemv(&self->half_weights, self->num_weights, input, output);
+      }
+      else
+      {
+         gemv(GEMM_NO_TRANSPOSE, self->num_nodes, self->num_weights, self->weights.data,
+              self->weights.stride, input, output);
+      }
+
+      elapsed = get_time() - start;
+      num_calls++;
+   }
+   return elapsed / num_calls;
+}
+
+/**************************************************************************************************
+* get_time: Returnerar aktuell tid i sekunder, avsett fr mtning av krtider.
+**************************************************************************************************/
+static double get_time(void)
+{
+   struct timespec time;
+   timespec_get(&time, TIME_UTC);
+   return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+/**************************************************************************************************
+* get_random_start_val: Returnerar ett randomiserat flyttal mellan 0.0 - 1.0.
+**************************************************************************************************/
+static inline real_t get_random_start_val(void)
+{
+   return rand() / (double)RAND_MAX;
 }
 
 /**************************************************************************************************
-* print_line: Skriver ut flyttal lagrat i angiven vektor p en enda rad via angiven utstrm.
+* print_line: Skriver ut angivet antal flyttal p en enda rad via angiven utstrm.
 * 
-*             - self   : Pekare till vektorn innehllande flyttalen som skall skrivas ut.
+*             - data   : Pekare till fltet innehllande flyttalen som skall skrivas ut.
+*             - size   : Antalet flyttal som skall skrivas ut.
 *             - ostream: Pekare till angiven utstrm.
 **************************************************************************************************/
-static void print_line(const struct double_vector* self, 
+static void print_line(const real_t* data, 
+                       const size_t size,
                        FILE* ostream)
 {
-   for (const double* i = self->data; i < self->data + self->size; ++i)
+   for (const real_t* i = data; i < data + size; ++i)
    {
       fprintf(ostream, "%g ", *i);
    }
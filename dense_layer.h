@@ -8,7 +8,13 @@
 /* Inkluderingsdirektiv: */
 #include "def.h"
 #include "double_vector.h"
-#include "double_2d_vector.h"
+#include "double_matrix.h"
+#include "half_matrix.h"
+#include "csr_matrix.h"
+#include "activation.h"
+
+/* Makrodefinitioner: */
+#define DENSE_LAYER_PARALLEL_SIZE 262144 /* Default minsta antal vikter fr trdpoolen. */
 
 /**************************************************************************************************
 * dense_layer: Implementering av ett dense-lager i ett neuralt ntverk, kan anvnda fr dolda
@@ -16,12 +22,16 @@
 **************************************************************************************************/
 struct dense_layer
 {
-   struct double_vector output;     /* Utsignaler frn respektive nod.. */
-   struct double_vector bias;       /* Biasvrden / vilovrden fr respektive nod. */
-   struct double_vector error;      /* Aktuell fel fr respektive nod. */
-   struct double_2d_vector weights; /* Vikter fr respektive nod. */
-   size_t num_nodes;                /* Antalet noder i lagret. */
-   size_t num_weights;              /* Antalet vikter per nod. */
+   struct double_vector output;      /* Utsignaler frn respektive nod.. */
+   struct double_vector bias;        /* Biasvrden / vilovrden fr respektive nod. */
+   struct double_vector error;       /* Aktuell fel fr respektive nod. */
+   struct double_matrix weights;     /* Vikter fr respektive nod, lagrade radvis per nod. */
+   struct half_matrix half_weights;  /* Valbar kopia av vikterna i halv precision (feedforward). */
+   struct csr_matrix sparse_weights; /* Valbar gles kopia av vikterna efter beskrning. */
+   bool sparse_kernels;              /* Indikerar ifall den glesa kopian r snabbast (uppmtt). */
+   enum activation activation;       /* Aktiveringsfunktion fr lagrets noder (default ReLU). */
+   size_t num_nodes;                 /* Antalet noder i lagret. */
+   size_t num_weights;               /* Antalet vikter per nod. */
 };
 
 /* Externa funktioner: */
@@ -37,16 +47,35 @@ void dense_layer_reset(struct dense_layer* self);
 void dense_layer_resize(struct dense_layer* self, 
                         const size_t num_nodes, 
                         const size_t num_weights);
+int dense_layer_set_weight_format(struct dense_layer* self,
+                                  const enum half_format format);
+int dense_layer_set_activation(struct dense_layer* self,
+                               const enum activation activation);
+int dense_layer_sparsify(struct dense_layer* self,
+                         const double threshold);
 void dense_layer_feedforward(struct dense_layer* self, 
                              const struct double_vector* input);
+void dense_layer_feedforward_to(const struct dense_layer* self,
+                                const struct double_vector* input,
+                                real_t* output);
 void dense_layer_compare_with_reference(struct dense_layer* self, 
                                         const struct double_vector* reference);
+void dense_layer_feedforward_batch(const struct dense_layer* self,
+                                   const struct double_matrix* input,
+                                   struct double_matrix* output,
+                                   const size_t num_samples);
 void dense_layer_backpropagate(struct dense_layer* self, 
                                const struct dense_layer* next_layer);
 void dense_layer_optimize(struct dense_layer* self, 
                           const struct double_vector* input,
                           const double learning_rate);
+void dense_layer_backpropagate_optimize(struct dense_layer* self,
+                                       struct dense_layer* previous,
+                                       const struct double_vector* input,
+                                       const double learning_rate);
 void dense_layer_print(const struct dense_layer* self, 
                        FILE* ostream);
+void dense_layer_set_parallel_size(const size_t num_weights);
+size_t dense_layer_parallel_size(void);
 
 #endif /* DENSE_LAYER_H_ */
\ No newline at end of file
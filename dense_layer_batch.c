@@ -0,0 +1,315 @@
+/**************************************************************************************************
+* dense_layer_batch.c: Innehller funktionsdefinitioner som anvnds fr trning av dense-lager
+*                      med mini-batch. Samtliga berkningar genomfrs som matrismultiplikationer
+*                      via gemm, vilket medfr att varje viktmatris lses blockvis en gng per
+*                      batch i stllet fr en gng per trningsuppsttning.
+**************************************************************************************************/
+#include "dense_layer_batch.h"
+#include "gemm.h"
+#include "simd.h"
+
+/**************************************************************************************************
+* dense_layer_batch_new: Initierar arbetsminne fr angivet dense-lager vid trning med angiven
+*                        batchstorlek. Returnerar 1 ifall minnesallokering misslyckas, annars 0.
+*
+*                        - self      : Pekare till arbetsminnet.
+*                        - layer     : Pekare till det dense-lager som arbetsminnet avser.
+*                        - batch_size: Maximalt antal trningsuppsttningar per batch.
+**************************************************************************************************/
+int dense_layer_batch_new(struct dense_layer_batch* self,
+                          const struct dense_layer* layer,
+                          const size_t batch_size)
+{
+   double_matrix_new(&self->output);
+   double_matrix_new(&self->error);
+   double_matrix_new(&self->weight_gradient);
+   double_vector_new(&self->bias_gradient);
+   self->batch_size = batch_size;
+   self->num_samples = 0;
+
+   if (double_matrix_resize(&self->output, batch_size, layer->num_nodes) ||
+       double_matrix_resize(&self->error, batch_size, layer->num_nodes) ||
+       double_matrix_resize(&self->weight_gradient, layer->num_nodes, layer->num_weights) ||
+       double_vector_resize(&self->bias_gradient, layer->num_nodes))
+   {
+      dense_layer_batch_delete(self);
+      return 1;
+   }
+   return 0;
+}
+
+/**************************************************************************************************
+* dense_layer_batch_delete: Frigr minne fr angivet arbetsminne.
+*
+*                           - self: Pekare till arbetsminnet.
+**************************************************************************************************/
+void dense_layer_batch_delete(struct dense_layer_batch* self)
+{
+   double_matrix_delete(&self->output);
+   double_matrix_delete(&self->error);
+   double_matrix_delete(&self->weight_gradient);
+   double_vector_delete(&self->bias_gradient);
+   self->batch_size = 0;
+   self->num_samples = 0;
+   return;
+}
+
+/**************************************************************************************************
+* dense_layer_batch_feedforward: Berknar nya utsignaler fr samtliga trningsuppsttningar i
+*                                aktuell batch, dr varje rad i indatamatrisen utgr indata fr
+*                                en trningsuppsttning.
+*
+*                                - self       : Pekare till arbetsminnet.
+*                                - layer      : Pekare till dense-lagret.
+*                                - input      : Pekare till matris innehllande indata.
+*                                - num_samples: Antalet trningsuppsttningar i batchen.
+**************************************************************************************************/
+void dense_layer_batch_feedforward(struct dense_layer_batch* self,
+                                   const struct dense_layer* layer,
+                                   const struct double_matrix* input,
+                                   const size_t num_samples)
+{
+   self->num_samples = num_samples < self->batch_size ? num_samples : self->batch_size;
+   dense_layer_feedforward_batch(layer, input, &self->output, self->num_samples);
+   return;
+}
+
+/**************************************************************************************************
+* dense_layer_batch_compare_with_reference: Berknar avvikelser i ett utgngslager fr samtliga
+*                                           trningsuppsttningar i aktuell batch via jmfrelse
+*                                           med referensvrden, lagrade radvis.
+*
+*                                           - self     : Pekare till arbetsminnet.
+*                                           - layer    : Pekare till utgngslagret.
+*                                           - reference: Pekare till matris med referensvrden.
+**************************************************************************************************/
+void dense_layer_batch_compare_with_reference(struct dense_layer_batch* self,
+                                              const struct dense_layer* layer,
+                                              const struct double_matrix* reference)
+{
+   for (size_t j = 0; j < self->num_samples; ++j)
+   {
+      dense_layer_batch_compare_sample(self, layer, reference, j);
+   }
+   return;
+}
+
+/**************************************************************************************************
+* dense_layer_batch_backpropagate: Berknar avvikelser i ett dolt lager fr samtliga
+*                                  trningsuppsttningar i aktuell batch via avvikelser samt
+*                                  vikter i efterfljande lager.
+*
+*                                  - self      : Pekare till arbetsminnet fr det dolda lagret.
+*                                  - layer     : Pekare till det dolda lagret.
+*                                  - next_batch: Pekare till arbetsminnet fr efterfljande lager.
+*                                  - next_layer: Pekare till efterfljande dense-lager.
+**************************************************************************************************/
+void dense_layer_batch_backpropagate(struct dense_layer_batch* self,
+                                     const struct dense_layer* layer,
+                                     const struct dense_layer_batch* next_batch,
+                                     const struct dense_layer* next_layer)
+{
+   self->num_samples = next_batch->num_samples;
+
+   gemm(GEMM_NO_TRANSPOSE, GEMM_NO_TRANSPOSE, self->num_samples, layer->num_nodes,
+        next_layer->num_nodes, 1.0, next_batch->error.data, next_batch->error.stride,
+        next_layer->weights.data, next_layer->weights.stride,
+        0.0, self->error.data, self->error.stride);
+
+   for (size_t j = 0; j < self->num_samples; ++j)
+   {
+      activation_delta(layer->activation, double_matrix_row(&self->error, j),
+                       double_matrix_row(&self->output, j), layer->num_nodes);
+   }
+   return;
+}
+
+/**************************************************************************************************
+* dense_layer_batch_feedforward_sample: Berknar nya utsignaler fr en enskild
+*                                       trningsuppsttning i aktuell batch, vilket mjliggr
+*                                       att uppsttningarna passerar lagren en i taget, exempelvis
+*                                       vid trning i pipeline. Resultatet lagras p samma rad
+*                                       som indatan har i indatamatrisen.
+*
+*                                       - self  : Pekare till arbetsminnet.
+*                                       - layer : Pekare till dense-lagret.
+*                                       - input : Pekare till matris innehllande indata.
+*                                       - sample: Index fr trningsuppsttningen (raden).
+**************************************************************************************************/
+void dense_layer_batch_feedforward_sample(struct dense_layer_batch* self,
+                                          const struct dense_layer* layer,
+                                          const struct double_matrix* input,
+                                          const size_t sample)
+{
+   const size_t num_weights = layer->num_weights < input->cols ? layer->num_weights : input->cols;
+   real_t* output = double_matrix_row(&self->output, sample);
+
+   gemv(GEMM_NO_TRANSPOSE, layer->num_nodes, num_weights, layer->weights.data,
+        layer->weights.stride, double_matrix_row(input, sample), output);
+   activation_apply(layer->activation, output, layer->bias.data, layer->num_nodes);
+   return;
+}
+
+/**************************************************************************************************
+* dense_layer_batch_compare_sample: Berknar avvikelser i ett utgngslager fr en enskild
+*                                   trningsuppsttning i aktuell batch via jmfrelse med
+*                                   referensvrden, lagrade p motsvarande rad.
+*
+*                                   - self     : Pekare till arbetsminnet.
+*                                   - layer    : Pekare till utgngslagret.
+*                                   - reference: Pekare till matris med referensvrden.
+*                                   - sample   : Index fr trningsuppsttningen (raden).
+**************************************************************************************************/
+void dense_layer_batch_compare_sample(struct dense_layer_batch* self,
+                                      const struct dense_layer* layer,
+                                      const struct double_matrix* reference,
+                                      const size_t sample)
+{
+   const size_t num_nodes = layer->num_nodes < reference->cols ? layer->num_nodes : reference->cols;
+   const real_t* output = double_matrix_row(&self->output, sample);
+   const real_t* target = double_matrix_row(reference, sample);
+   real_t* error = double_matrix_row(&self->error, sample);
+
+   for (size_t i = 0; i < num_nodes; ++i)
+   {
+      error[i] = target[i] - output[i];
+   }
+
+   activation_delta(layer->activation, error, output, num_nodes);
+   return;
+}
+
+/**************************************************************************************************
+* dense_layer_batch_backpropagate_sample: Berknar avvikelser i ett dolt lager fr en enskild
+*                                         trningsuppsttning i aktuell batch via avvikelser
+*                                         samt vikter i efterfljande lager.
+*
+*                                         - self      : Pekare till arbetsminnet fr lagret.
+*                                         - layer     : Pekare till det dolda lagret.
+*                                         - next_batch: Pekare till arbetsminnet fr
+*                                                       efterfljande lager.
+*                                         - next_layer: Pekare till efterfljande dense-lager.
+*                                         - sample    : Index fr trningsuppsttningen (raden).
+**************************************************************************************************/
+void dense_layer_batch_backpropagate_sample(struct dense_layer_batch* self,
+                                            const struct dense_layer* layer,
+                                            const struct dense_layer_batch* next_batch,
+                                            const struct dense_layer* next_layer,
+                                            const size_t sample)
+{
+   real_t* error = double_matrix_row(&self->error, sample);
+
+   gemv(GEMM_TRANSPOSE, next_layer->num_nodes, layer->num_nodes, next_layer->weights.data,
+        next_layer->weights.stride, double_matrix_row(&next_batch->error, sample), error);
+   activation_delta(layer->activation, error, double_matrix_row(&self->output, sample),
+                    layer->num_nodes);
+   return;
+}
+
+/**************************************************************************************************
+* dense_layer_batch_accumulate: Berknar gradienter fr bias samt vikter i angivet dense-lager,
+*                              summerade ver samtliga trningsuppsttningar i aktuell batch.
+*                              Indata till lagret passeras radvis, en rad per uppsttning.
+*
+*                              - self : Pekare till arbetsminnet.
+*                              - layer: Pekare till dense-lagret.
+*                              - input: Pekare till matris innehllande lagrets indata.
+**************************************************************************************************/
+void dense_layer_batch_accumulate(struct dense_layer_batch* self,
+                                  const struct dense_layer* layer,
+                                  const struct double_matrix* input)
+{
+   const size_t num_weights = layer->num_weights < input->cols ? layer->num_weights : input->cols;
+
+   gemm(GEMM_TRANSPOSE, GEMM_NO_TRANSPOSE, layer->num_nodes, num_weights, self->num_samples,
+        1.0, self->error.data, self->error.stride, input->data, input->stride,
+        0.0, self->weight_gradient.data, self->weight_gradient.stride);
+   memset(self->bias_gradient.data, 0, sizeof(real_t) * layer->num_nodes);
+
+   for (size_t j = 0; j < self->num_samples; ++j)
+   {
+      const real_t* error = double_matrix_row(&self->error, j);
+
+      for (size_t i = 0; i < layer->num_nodes; ++i)
+      {
+         self->bias_gradient.data[i] += error[i];
+      }
+   }
+   return;
+}
+
+/**************************************************************************************************
+* dense_layer_batch_reduce: Adderar gradienterna i ett annat arbetsminne fr samma dense-lager
+*                           till angivet arbetsminne, exempelvis ackumulerade av en annan trd
+*                           ver en annan del av batchen. Antalet trningsuppsttningar summeras,
+*                           s att efterfljande optimering tillmpar medelvrdet av samtliga
+*                           gradienter. Additionen sker elementvis i en fast ordning, vilket
+*                           medfr att resultatet r reproducerbart.
+*
+*                           - self : Pekare till arbetsminnet som gradienterna adderas till.
+*                           - other: Pekare till arbetsminnet vars gradienter skall adderas.
+*                           - layer: Pekare till dense-lagret.
+**************************************************************************************************/
+void dense_layer_batch_reduce(struct dense_layer_batch* self,
+                              const struct dense_layer_batch* other,
+                              const struct dense_layer* layer)
+{
+   for (size_t i = 0; i < layer->num_nodes; ++i)
+   {
+      simd_axpy(double_matrix_row(&self->weight_gradient, i), 1.0,
+                double_matrix_row(&other->weight_gradient, i), layer->num_weights);
+   }
+
+   simd_axpy(self->bias_gradient.data, 1.0, other->bias_gradient.data, layer->num_nodes);
+   self->num_samples += other->num_samples;
+   return;
+}
+
+/**************************************************************************************************
+* dense_layer_batch_optimize: Justerar bias samt vikter i angivet dense-lager en gng via
+*                             ackumulerade gradienter. Lrhastigheten skalas med antalet
+*                             trningsuppsttningar i batchen, s att medelvrdet av gradienterna
+*                             tillmpas. Drmed motsvarar en batchstorlek p ett ordinarie trning.
+*                             I ett beskuret lager justeras enbart kvarvarande vikter.
+*
+*                             - self         : Pekare till arbetsminnet.
+*                             - layer        : Pekare till dense-lagret som skall justeras.
+*                             - learning_rate: Lrhastigheten, avgr graden av justering.
+**************************************************************************************************/
+void dense_layer_batch_optimize(const struct dense_layer_batch* self,
+                                struct dense_layer* layer,
+                                const double learning_rate)
+{
+   if (!self->num_samples) return;
+   const real_t scale = learning_rate / self->num_samples;
+
+   for (size_t i = 0; i < layer->num_nodes; ++i)
+   {
+      layer->bias.data[i] += scale * self->bias_gradient.data[i];
+
+      if (layer->sparse_weights.row_offsets)
+      {
+         const struct csr_matrix* sparse = &layer->sparse_weights;
+         const real_t* gradient = double_matrix_row(&self->weight_gradient, i);
+         real_t* weights = double_matrix_row(&layer->weights, i);
+
+         for (size_t k = sparse->row_offsets[i]; k < sparse->row_offsets[i + 1]; ++k)
+         {
+            sparse->values[k] += scale * gradient[sparse->columns[k]];
+            weights[sparse->columns[k]] = sparse->values[k];
+         }
+      }
+      else
+      {
+         simd_axpy(double_matrix_row(&layer->weights, i), scale,
+                   double_matrix_row(&self->weight_gradient, i), layer->num_weights);
+      }
+
+      if (layer->half_weights.format != HALF_FORMAT_NONE)
+      {
+         half_matrix_narrow_row(&layer->half_weights, i, double_matrix_row(&layer->weights, i),
+                                layer->num_weights);
+      }
+   }
+   return;
+}
@@ -0,0 +1,69 @@
+/**************************************************************************************************
+* dense_layer_batch.h: Innehller funktionalitet fr trning av dense-lager med flera
+*                      trningsuppsttningar t gngen (mini-batch) via strukten
+*                      dense_layer_batch samt motsvarande externa funktioner. Utsignaler samt
+*                      avvikelser lagras som matriser med en rad per trningsuppsttning, medan
+*                      gradienter ackumuleras ver hela batchen och tillmpas en gng per batch.
+**************************************************************************************************/
+#ifndef DENSE_LAYER_BATCH_H_
+#define DENSE_LAYER_BATCH_H_
+
+/* Inkluderingsdirektiv: */
+#include "def.h"
+#include "double_vector.h"
+#include "double_matrix.h"
+#include "dense_layer.h"
+
+/**************************************************************************************************
+* dense_layer_batch: Arbetsminne fr ett dense-lager vid trning med mini-batch.
+**************************************************************************************************/
+struct dense_layer_batch
+{
+   struct double_matrix output;          /* Utsignaler, en rad per trningsuppsttning. */
+   struct double_matrix error;           /* Avvikelser, en rad per trningsuppsttning. */
+   struct double_matrix weight_gradient; /* Ackumulerad gradient fr lagrets vikter. */
+   struct double_vector bias_gradient;   /* Ackumulerad gradient fr lagrets bias. */
+   size_t batch_size;                    /* Maximalt antal trningsuppsttningar per batch. */
+   size_t num_samples;                   /* Antalet trningsuppsttningar i aktuell batch. */
+};
+
+/* Externa funktioner: */
+int dense_layer_batch_new(struct dense_layer_batch* self,
+                          const struct dense_layer* layer,
+                          const size_t batch_size);
+void dense_layer_batch_delete(struct dense_layer_batch* self);
+void dense_layer_batch_feedforward(struct dense_layer_batch* self,
+                                   const struct dense_layer* layer,
+                                   const struct double_matrix* input,
+                                   const size_t num_samples);
+void dense_layer_batch_compare_with_reference(struct dense_layer_batch* self,
+                                              const struct dense_layer* layer,
+                                              const struct double_matrix* reference);
+void dense_layer_batch_backpropagate(struct dense_layer_batch* self,
+                                     const struct dense_layer* layer,
+                                     const struct dense_layer_batch* next_batch,
+                                     const struct dense_layer* next_layer);
+void dense_layer_batch_feedforward_sample(struct dense_layer_batch* self,
+                                          const struct dense_layer* layer,
+                                          const struct double_matrix* input,
+                                          const size_t sample);
+void dense_layer_batch_compare_sample(struct dense_layer_batch* self,
+                                      const struct dense_layer* layer,
+                                      const struct double_matrix* reference,
+                                      const size_t sample);
+void dense_layer_batch_backpropagate_sample(struct dense_layer_batch* self,
+                                            const struct dense_layer* layer,
+                                            const struct dense_layer_batch* next_batch,
+                                            const struct dense_layer* next_layer,
+                                            const size_t sample);
+void dense_layer_batch_accumulate(struct dense_layer_batch* self,
+                                  const struct dense_layer* layer,
+                                  const struct double_matrix* input);
+void dense_layer_batch_reduce(struct dense_layer_batch* self,
+                              const struct dense_layer_batch* other,
+                              const struct dense_layer* layer);
+void dense_layer_batch_optimize(const struct dense_layer_batch* self,
+                                struct dense_layer* layer,
+                                const double learning_rate);
+
+#endif /* DENSE_LAYER_BATCH_H_ */
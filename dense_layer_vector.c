@@ -3,6 +3,7 @@
 *                       multipla dense-lager i neurala ntverk, primrt avsett fr dolda lager.
 **************************************************************************************************/
 #include "dense_layer_vector.h"
+#include "allocator.h"
 
 /**************************************************************************************************
 * dense_layer_vector_new: Initierar angiven dense-lagervektor.
@@ -13,6 +14,7 @@ void dense_layer_vector_new(struct dense_layer_vector* self)
 {
    self->data = 0;
    self->size = 0;
+   self->capacity = 0;
    return;
 }
 
@@ -23,9 +25,10 @@ void dense_layer_vector_new(struct dense_layer_vector* self)
 **************************************************************************************************/
 void dense_layer_vector_delete(struct dense_layer_vector* self)
 {
-   free(self->data);
+   allocator_free(self->data);
    self->data = 0;
    self->size = 0;
+   self->capacity = 0;
    return;
 }
 
@@ -34,10 +37,11 @@ void dense_layer_vector_delete(struct dense_layer_vector* self)
 **************************************************************************************************/
 struct dense_layer_vector* dense_layer_vector_ptr_new(void)
 {
-   struct dense_layer_vector* self = (struct dense_layer_vector*)malloc(sizeof(struct dense_layer_vector));
+   struct dense_layer_vector* self = (struct dense_layer_vector*)allocator_alloc(sizeof(struct dense_layer_vector));
    if (!self) return 0;
    self->data = 0;
    self->size = 0;
+   self->capacity = 0;
    return self;
 }
 
@@ -50,29 +54,30 @@ struct dense_layer_vector* dense_layer_vector_ptr_new(void)
 void dense_layer_vector_ptr_delete(struct dense_layer_vector** self)
 {
    dense_layer_vector_delete(*self);
-   free(*self);
+   allocator_free(*self);
    *self = 0;
    return;
 }
 
 /**************************************************************************************************
-* dense_layer_vector_resize: ndrar storleken angiven dense-lagervektor via omallokering.
+* dense_layer_vector_resize: ndrar storleken p angiven dense-lagervektor. Vid behov utkas
+*                            kapaciteten till exakt den nya storleken, men kapaciteten minskas
+*                            aldrig (se funktionen dense_layer_vector_shrink_to_fit).
+*
 *                            - self    : Pekare till dense-lagervektorn.
-*                            - new_size: Dense-lagervektorns nya storlek efter omallokering.
+*                            - new_size: Dense-lagervektorns nya storlek.
 **************************************************************************************************/
 int dense_layer_vector_resize(struct dense_layer_vector* self, 
                               const size_t new_size)
 {
-   struct dense_layer* copy = (struct dense_layer*)realloc(self->data, 
-      sizeof(struct dense_layer) * new_size);
-   if (!copy) return 1;
-   self->data = copy;
+   if (new_size > self->capacity && dense_layer_vector_reserve(self, new_size)) return 1;
    self->size = new_size;
    return 0;
 }
 
 /**************************************************************************************************
 * dense_layer_vector_push: Lgger till ett nytt dense-lager lngst bak angiven dense-lagervektor.
+*                          Ifall fltet r fullt frdubblas kapaciteten.
 * 
 *                          - self     : Pekare till dense-lagervektorn.
 *                          - new_layer: Pekare till det nya lager som skall lggas till.
@@ -80,11 +85,9 @@ int dense_layer_vector_resize(struct dense_layer_vector* self,
 int dense_layer_vector_push(struct dense_layer_vector* self, 
                             const struct dense_layer* new_layer)
 {
-   struct dense_layer* copy = (struct dense_layer*)realloc(self->data, 
-      sizeof(struct dense_layer) * (self->size + 1));
-   if (!copy) return 1;
-   copy[self->size++] = *new_layer;
-   self->data = copy;
+   if (self->size == self->capacity &&
+       dense_layer_vector_reserve(self, self->capacity ? self->capacity * 2 : 1)) return 1;
+   self->data[self->size++] = *new_layer;
    return 0;
 }
 
@@ -102,15 +105,60 @@ int dense_layer_vector_pop(struct dense_layer_vector* self)
    }
    else
    {
-      struct dense_layer* copy = (struct dense_layer*)realloc(self->data,
-         sizeof(struct dense_layer) * (self->size - 1));
-      if (!copy) return 1;
-      self->data = copy;
       self->size--;
    }
    return 0;
 }
 
+/**************************************************************************************************
+* dense_layer_vector_reserve: Skerstller att angiven dense-lagervektor rymmer minst angivet antal
+*                             element utan omallokering, exempelvis infr inlsning av ett knt
+*                             antal element. Vektorns storlek pverkas inte. Returnerar 1 ifall
+*                             minnesallokering misslyckas, annars 0.
+*
+*                             - self    : Pekare till dense-lagervektorn.
+*                             - capacity: Antalet element som skall rymmas.
+**************************************************************************************************/
+int dense_layer_vector_reserve(struct dense_layer_vector* self,
+                               const size_t capacity)
+{
+   if (capacity <= self->capacity) return 0;
+   struct dense_layer* copy = (struct dense_layer*)allocator_realloc(self->data,
+      sizeof(struct dense_layer) * self->capacity, sizeof(struct dense_layer) * capacity);
+   if (!copy) return 1;
+   self->data = copy;
+   self->capacity = capacity;
+   return 0;
+}
+
+/**************************************************************************************************
+* dense_layer_vector_shrink_to_fit: Minskar kapaciteten fr angiven dense-lagervektor till dess
+*                                   storlek, s att verskottet frn tidigare tillvxt frigrs.
+*                                   Returnerar 1 ifall minnesallokering misslyckas, varvid vektorn
+*                                   behlls ofrndrad, annars 0.
+*
+*                                   - self: Pekare till dense-lagervektorn.
+**************************************************************************************************/
+int dense_layer_vector_shrink_to_fit(struct dense_layer_vector* self)
+{
+   if (self->size == self->capacity) return 0;
+
+   if (!self->size)
+   {
+      allocator_free(self->data);
+      self->data = 0;
+      self->capacity = 0;
+      return 0;
+   }
+
+   struct dense_layer* copy = (struct dense_layer*)allocator_realloc(self->data,
+      sizeof(struct dense_layer) * self->capacity, sizeof(struct dense_layer) * self->size);
+   if (!copy) return 1;
+   self->data = copy;
+   self->capacity = self->size;
+   return 0;
+}
+
 /**************************************************************************************************
 * dense_layer_vector_add_layer: Lgger till ett nytt dense-lager med specificerat antal noder
 *                               och vikter per nod lngst bak i angiven dense-lagervektor.
@@ -259,6 +307,36 @@ void dense_layer_vector_optimize(struct dense_layer_vector* self,
    return;
 }
 
+/**************************************************************************************************
+* dense_layer_vector_backpropagate_optimize: Berknar avvikelser samt justerar parametrar fr
+*                                            samtliga dense-lager i angiven dense-lagervektor i
+*                                            en gemensam passering bakifrn, dr avvikelserna i
+*                                            det sista lagret redan mste vara berknade. Varje
+*                                            lagers vikter anvnds fr att berkna avvikelserna
+*                                            i fregende lager och justeras direkt drefter.
+*              
+*                                            - self         : Pekare till dense-lagervektorn.
+*                                            - input        : Utdata frn fregende
+*                                                             ingngslager.  
+*                                            - learning_rate: Lrhastigheten, avgr graden av
+*                                                             justering.
+**************************************************************************************************/
+void dense_layer_vector_backpropagate_optimize(struct dense_layer_vector* self,
+                                              const struct double_vector* input,
+                                              const double learning_rate)
+{
+   struct dense_layer* first = self->data;
+   struct dense_layer* last = self->data + self->size - 1;
+
+   for (struct dense_layer* i = last; i > first; --i)
+   {
+      dense_layer_backpropagate_optimize(i, i - 1, &(i - 1)->output, learning_rate);
+   }
+
+   dense_layer_backpropagate_optimize(first, 0, input, learning_rate);
+   return;
+}
+
 /**************************************************************************************************
 * dense_layer_vector_begin: Returnerar adressen till det frsta dense-lagret i angiven 
 *                           dense-lagervektor.
@@ -18,6 +18,7 @@ struct dense_layer_vector
 {
    struct dense_layer* data; /* Pekare till flt innehllande dense-lager. */
    size_t size;             /* Antalet dense-lager i fltet. */
+   size_t capacity;         /* Antalet dense-lager som ryms i fltet innan omallokering krvs. */
 };
 
 /* Externa funktioner: */
@@ -30,6 +31,9 @@ int dense_layer_vector_resize(struct dense_layer_vector* self,
 int dense_layer_vector_push(struct dense_layer_vector* self, 
                             const struct dense_layer* new_layer);
 int dense_layer_vector_pop(struct dense_layer_vector* self);
+int dense_layer_vector_reserve(struct dense_layer_vector* self,
+                               const size_t capacity);
+int dense_layer_vector_shrink_to_fit(struct dense_layer_vector* self);
 int dense_layer_vector_add_layer(struct dense_layer_vector* self, 
                                  const size_t num_nodes, 
                                  const size_t num_weights);
@@ -43,6 +47,9 @@ void dense_layer_vector_feedforward(struct dense_layer_vector* self,
                                     const struct double_vector* input);
 void dense_layer_vector_backpropagate(struct dense_layer_vector* self, 
                                       const struct dense_layer* output_layer);
+void dense_layer_vector_backpropagate_optimize(struct dense_layer_vector* self,
+                                              const struct double_vector* input,
+                                              const double learning_rate);
 void dense_layer_vector_optimize(struct dense_layer_vector* self, 
                                  const struct double_vector* input, 
                                  const double learning_rate);
@@ -3,6 +3,7 @@
 *                     tvdimensionella vektorer innehllande flyttal.
 **************************************************************************************************/
 #include "double_2d_vector.h"
+#include "allocator.h"
 
 /**************************************************************************************************
 * double_2d_vector_new: Initierar angiven tvdimensionell vektor.
@@ -13,6 +14,7 @@ void double_2d_vector_new(struct double_2d_vector* self)
 {
    self->data = 0;
    self->size = 0;
+   self->capacity = 0;
    return;
 }
 
@@ -28,9 +30,10 @@ void double_2d_vector_delete(struct double_2d_vector* self)
       double_vector_delete(i);
    }
 
-   free(self->data);
+   allocator_free(self->data);
    self->data = 0;
    self->size = 0;
+   self->capacity = 0;
    return;
 }
 
@@ -42,10 +45,11 @@ void double_2d_vector_delete(struct double_2d_vector* self)
 **************************************************************************************************/
 struct double_2d_vector* double_2d_vector_ptr_new(const size_t size)
 {
-   struct double_2d_vector* self = (struct double_2d_vector*)malloc(sizeof(struct double_2d_vector));
+   struct double_2d_vector* self = (struct double_2d_vector*)allocator_alloc(sizeof(struct double_2d_vector));
    if (!self) return 0;
    self->data = 0;
    self->size = 0;
+   self->capacity = 0;
    double_2d_vector_resize(self, size);
    return self;
 }
@@ -59,13 +63,15 @@ struct double_2d_vector* double_2d_vector_ptr_new(const size_t size)
 void double_2d_vector_ptr_delete(struct double_2d_vector** self)
 {
    double_2d_vector_delete(*self);
-   free(*self);
+   allocator_free(*self);
    *self = 0;
    return;
 }
 
 /**************************************************************************************************
-* double_2d_vector_resize: ndrar storleken / kapaciteten p angiven tvdimensionell vektor.
+* double_2d_vector_resize: ndrar storleken p angiven tvdimensionell vektor. Vid behov utkas
+*                          kapaciteten till exakt den nya storleken, men kapaciteten minskas aldrig
+*                          (se funktionen double_2d_vector_shrink_to_fit).
 * 
 *                          - self    : Pekare till den tvdimensionella vektorn.
 *                          - new_size: Vektorns nya storlek.
@@ -73,16 +79,15 @@ void double_2d_vector_ptr_delete(struct double_2d_vector** self)
 int double_2d_vector_resize(struct double_2d_vector* self, 
                             const size_t new_size)
 {
-   struct double_vector* copy = (struct double_vector*)realloc(self->data,
-      sizeof(struct double_vector) * new_size);
-   if (!copy) return 1;
-   self->data = copy;
+   if (new_size > self->capacity && double_2d_vector_reserve(self, new_size)) return 1;
    self->size = new_size;
    return 0;
 }
 
 /**************************************************************************************************
 * double_2d_vector_push: Lgger till ett nytt element lngst bak i angiven tvdimensionell vektor.
+*                        Ifall fltet r fullt frdubblas kapaciteten, vilket medfr att N element
+*                        kan lggas till med ett ftal omallokeringar.
 * 
 *                        - self       : Pekare till den tvdimensionella vektorn.
 *                        - new_element: Pekare till det nya element som skall lggas till. 
@@ -90,11 +95,9 @@ int double_2d_vector_resize(struct double_2d_vector* self,
 int double_2d_vector_push(struct double_2d_vector* self, 
                           const struct double_vector* new_element)
 {
-   struct double_vector* copy = (struct double_vector*)realloc(self->data, 
-      sizeof(struct double_vector) * (self->size + 1));
-   if (!copy) return 1;
-   copy[self->size++] = *new_element;
-   self->data = copy;
+   if (self->size == self->capacity &&
+       double_2d_vector_reserve(self, self->capacity ? self->capacity * 2 : 1)) return 1;
+   self->data[self->size++] = *new_element;
    return 0;
 }
 
@@ -113,15 +116,60 @@ int double_2d_vector_pop(struct double_2d_vector* self)
    }
    else
    {
-      struct double_vector* copy = (struct double_vector*)realloc(self->data,
-         sizeof(struct double_vector) * (self->size - 1));
-      if (!copy) return 1;
-      self->data = copy;
       self->size--;
       return 0;
    }
 }
 
+/**************************************************************************************************
+* double_2d_vector_reserve: Skerstller att angiven tvdimensionell vektor rymmer minst angivet
+*                           antal element utan omallokering, exempelvis infr inlsning av ett knt
+*                           antal element. Vektorns storlek pverkas inte. Returnerar 1 ifall
+*                           minnesallokering misslyckas, annars 0.
+*
+*                           - self    : Pekare till den tvdimensionella vektorn.
+*                           - capacity: Antalet element som skall rymmas.
+**************************************************************************************************/
+int double_2d_vector_reserve(struct double_2d_vector* self,
+                             const size_t capacity)
+{
+   if (capacity <= self->capacity) return 0;
+   struct double_vector* copy = (struct double_vector*)allocator_realloc(self->data,
+      sizeof(struct double_vector) * self->capacity, sizeof(struct double_vector) * capacity);
+   if (!copy) return 1;
+   self->data = copy;
+   self->capacity = capacity;
+   return 0;
+}
+
+/**************************************************************************************************
+* double_2d_vector_shrink_to_fit: Minskar kapaciteten fr angiven tvdimensionell vektor till dess
+*                                 storlek, s att verskottet frn tidigare tillvxt frigrs.
+*                                 Returnerar 1 ifall minnesallokering misslyckas, varvid vektorn
+*                                 behlls ofrndrad, annars 0.
+*
+*                                 - self: Pekare till den tvdimensionella vektorn.
+**************************************************************************************************/
+int double_2d_vector_shrink_to_fit(struct double_2d_vector* self)
+{
+   if (self->size == self->capacity) return 0;
+
+   if (!self->size)
+   {
+      allocator_free(self->data);
+      self->data = 0;
+      self->capacity = 0;
+      return 0;
+   }
+
+   struct double_vector* copy = (struct double_vector*)allocator_realloc(self->data,
+      sizeof(struct double_vector) * self->capacity, sizeof(struct double_vector) * self->size);
+   if (!copy) return 1;
+   self->data = copy;
+   self->capacity = self->size;
+   return 0;
+}
+
 /**************************************************************************************************
 * double_2d_vector_print: Skriver ut innehllet lagrat i angiven tvdimensionell vektor via
 *                         angiven utstrm, dr standardutenhet stdout anvnds som default fr
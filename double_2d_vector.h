@@ -17,6 +17,7 @@ struct double_2d_vector
 {
    struct double_vector* data; /* Pekare till multipla dynamiska flt. */
    size_t size;                /* Antalet element i fltet. */
+   size_t capacity;            /* Antalet element som ryms i fltet innan omallokering krvs. */
 };
 
 /* Externa funktioner: */
@@ -29,6 +30,9 @@ int double_2d_vector_resize(struct double_2d_vector* self,
 int  double_2d_vector_push(struct double_2d_vector* self, 
                            const struct double_vector* new_element);
 int double_2d_vector_pop(struct double_2d_vector* self);
+int double_2d_vector_reserve(struct double_2d_vector* self,
+                             const size_t capacity);
+int double_2d_vector_shrink_to_fit(struct double_2d_vector* self);
 void double_2d_vector_print(const struct double_2d_vector* self, 
                             FILE* ostream);
 struct double_vector* double_2d_vector_begin(const struct double_2d_vector* self);
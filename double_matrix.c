@@ -0,0 +1,195 @@
+/**************************************************************************************************
+* double_matrix.c: Innehller funktionsdefinitioner som anvnds fr implementering av matriser
+*                  innehllande flyttal lagrade i ett sammanhngande, justerat minnesblock.
+**************************************************************************************************/
+#include "double_matrix.h"
+#include "allocator.h"
+
+/* Statiska funktioner: */
+static size_t get_stride(const size_t cols);
+static real_t* aligned_new(const size_t num_elements);
+static void aligned_delete(real_t* data);
+
+/**************************************************************************************************
+* double_matrix_new: Initierar angiven matris.
+*
+*                    - self: Pekare till matrisen.
+**************************************************************************************************/
+void double_matrix_new(struct double_matrix* self)
+{
+   self->data = 0;
+   self->rows = 0;
+   self->cols = 0;
+   self->stride = 0;
+   return;
+}
+
+/**************************************************************************************************
+* double_matrix_delete: Tmmer innehllet i angiven matris.
+*
+*                       - self: Pekare till matrisen.
+**************************************************************************************************/
+void double_matrix_delete(struct double_matrix* self)
+{
+   aligned_delete(self->data);
+   self->data = 0;
+   self->rows = 0;
+   self->cols = 0;
+   self->stride = 0;
+   return;
+}
+
+/**************************************************************************************************
+* double_matrix_ptr_new: Returnerar en pekare till en ny heapallokerad matris av angiven storlek,
+*                        dr samtliga element stts till 0.0 vid start.
+*
+*                        - rows: Antalet rader i matrisen.
+*                        - cols: Antalet kolumner i matrisen.
+**************************************************************************************************/
+struct double_matrix* double_matrix_ptr_new(const size_t rows,
+                                            const size_t cols)
+{
+   struct double_matrix* self = (struct double_matrix*)allocator_alloc(sizeof(struct double_matrix));
+   if (!self) return 0;
+   double_matrix_new(self);
+   double_matrix_resize(self, rows, cols);
+   return self;
+}
+
+/**************************************************************************************************
+* double_matrix_ptr_delete: Frigr minne fr angiven heapallokerad matris och stter motsvarande
+*                           pekare till null.
+*
+*                           - self: Adressen till matrispekaren.
+**************************************************************************************************/
+void double_matrix_ptr_delete(struct double_matrix** self)
+{
+   double_matrix_delete(*self);
+   allocator_free(*self);
+   *self = 0;
+   return;
+}
+
+/**************************************************************************************************
+* double_matrix_resize: ndrar antalet rader och/eller kolumner i angiven matris. Ett nytt
+*                       justerat minnesblock allokeras och befintliga element kopieras radvis,
+*                       medan tillagda element samt utfyllnad stts till 0.0.
+*
+*                       - self: Pekare till matrisen.
+*                       - rows: Nytt antal rader i matrisen.
+*                       - cols: Nytt antal kolumner i matrisen.
+**************************************************************************************************/
+int double_matrix_resize(struct double_matrix* self,
+                         const size_t rows,
+                         const size_t cols)
+{
+   const size_t stride = get_stride(cols);
+   real_t* copy = 0;
+
+   if (rows && stride)
+   {
+      copy = aligned_new(rows * stride);
+      if (!copy) return 1;
+      memset(copy, 0, sizeof(real_t) * rows * stride);
+
+      const size_t num_rows = rows < self->rows ? rows : self->rows;
+      const size_t num_cols = cols < self->cols ? cols : self->cols;
+
+      for (size_t i = 0; i < num_rows; ++i)
+      {
+         memcpy(copy + i * stride, self->data + i * self->stride, sizeof(real_t) * num_cols);
+      }
+   }
+
+   aligned_delete(self->data);
+   self->data = copy;
+   self->rows = rows;
+   self->cols = cols;
+   self->stride = stride;
+   return 0;
+}
+
+/**************************************************************************************************
+* double_matrix_row: Returnerar adressen till det frsta elementet p angiven rad.
+*
+*                    - self: Pekare till matrisen.
+*                    - row : Index fr aktuell rad.
+**************************************************************************************************/
+real_t* double_matrix_row(const struct double_matrix* self,
+                          const size_t row)
+{
+   return self->data + row * self->stride;
+}
+
+/**************************************************************************************************
+* double_matrix_print: Skriver ut innehllet lagrat i angiven matris radvis via angiven utstrm,
+*                      dr standardutenheten stdout anvnds som default fr utskrift i terminalen.
+*
+*                      - self   : Pekare till matrisen.
+*                      - ostream: Pekare till angiven utstrm (default = stdout).
+**************************************************************************************************/
+void double_matrix_print(const struct double_matrix* self,
+                         FILE* ostream)
+{
+   if (!self->rows) return;
+   if (!ostream) ostream = stdout;
+   fprintf(ostream, "--------------------------------------------------------------------------\n");
+
+   for (size_t i = 0; i < self->rows; ++i)
+   {
+      const real_t* row = double_matrix_row(self, i);
+
+      for (size_t j = 0; j < self->cols; ++j)
+      {
+         fprintf(ostream, "%g ", row[j]);
+      }
+
+      fprintf(ostream, "\n");
+   }
+
+   fprintf(ostream, "--------------------------------------------------------------------------\n\n");
+   return;
+}
+
+/**************************************************************************************************
+* double_matrix_clear: Tmmer innehllet i angiven matris.
+*
+*                      - self: Pekare till matrisen.
+**************************************************************************************************/
+void (*double_matrix_clear)(struct double_matrix* self) = &double_matrix_delete;
+
+/**************************************************************************************************
+* get_stride: Returnerar radsteget fr angivet antal kolumner, avrundat uppt till ett helt
+*             antal justeringsblock s att varje rad startar p en justerad adress.
+*
+*             - cols: Antalet kolumner per rad.
+**************************************************************************************************/
+static size_t get_stride(const size_t cols)
+{
+   const size_t block = DOUBLE_MATRIX_ALIGNMENT / sizeof(real_t);
+   return (cols + block - 1) / block * block;
+}
+
+/**************************************************************************************************
+* aligned_new: Allokerar ett minnesblock fr angivet antal flyttal, justerat till
+*              DOUBLE_MATRIX_ALIGNMENT byte, ur aktiv arena eller p heapen. Blockets storlek
+*              r alltid en multipel av justeringen, eftersom radsteget avrundas till hela
+*              justeringsblock.
+*
+*              - num_elements: Antalet flyttal som minnesblocket skall rymma.
+**************************************************************************************************/
+static real_t* aligned_new(const size_t num_elements)
+{
+   return (real_t*)allocator_aligned_alloc(DOUBLE_MATRIX_ALIGNMENT, sizeof(real_t) * num_elements);
+}
+
+/**************************************************************************************************
+* aligned_delete: Frigr ett minnesblock allokerat via funktionen aligned_new.
+*
+*                 - data: Pekare till minnesblocket.
+**************************************************************************************************/
+static void aligned_delete(real_t* data)
+{
+   allocator_aligned_free(data);
+   return;
+}
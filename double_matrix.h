@@ -0,0 +1,46 @@
+/**************************************************************************************************
+* double_matrix.h: Implementering av tvdimensionella matriser innehllande flyttal lagrade i ett
+*                  enda sammanhngande minnesblock via strukten double_matrix samt motsvarande
+*                  externa funktioner.
+**************************************************************************************************/
+#ifndef DOUBLE_MATRIX_H_
+#define DOUBLE_MATRIX_H_
+
+/* Inkluderingsdirektiv: */
+#include "def.h"
+
+/* Makrodefinitioner: */
+#define DOUBLE_MATRIX_ALIGNMENT 64 /* Minnesjustering i byte fr matrisens minnesblock. */
+
+/**************************************************************************************************
+* double_matrix: Matris innehllande flyttal lagrade radvis i ett enda sammanhngande minnesblock,
+*                justerat till DOUBLE_MATRIX_ALIGNMENT byte. Varje rad utfylls med nollor till
+*                ett helt antal cacheblock, vilket uttrycks via radsteget (stride). Drmed startar
+*                varje rad p en justerad adress.
+**************************************************************************************************/
+struct double_matrix
+{
+   real_t* data;  /* Pekare till minnesblocket innehllande matrisens element. */
+   size_t rows;   /* Antalet rader i matrisen. */
+   size_t cols;   /* Antalet kolumner (anvnda element) per rad. */
+   size_t stride; /* Antalet element mellan brjan p tv efterfljande rader. */
+};
+
+/* Externa funktioner: */
+void double_matrix_new(struct double_matrix* self);
+void double_matrix_delete(struct double_matrix* self);
+struct double_matrix* double_matrix_ptr_new(const size_t rows,
+                                            const size_t cols);
+void double_matrix_ptr_delete(struct double_matrix** self);
+int double_matrix_resize(struct double_matrix* self,
+                         const size_t rows,
+                         const size_t cols);
+real_t* double_matrix_row(const struct double_matrix* self,
+                          const size_t row);
+void double_matrix_print(const struct double_matrix* self,
+                         FILE* ostream);
+
+/* Funktionspekare: */
+extern void (*double_matrix_clear)(struct double_matrix* self);
+
+#endif /* DOUBLE_MATRIX_H_ */
@@ -3,6 +3,7 @@
 *                  endimensionella vektorer innehllande flyttal.
 **************************************************************************************************/
 #include "double_vector.h"
+#include "allocator.h"
 
 /**************************************************************************************************
 * double_vector_new: Initierar angiven vektor.
@@ -13,6 +14,7 @@ void double_vector_new(struct double_vector* self)
 {
    self->data = 0;
    self->size = 0;
+   self->capacity = 0;
    return;
 }
 
@@ -23,9 +25,10 @@ void double_vector_new(struct double_vector* self)
 **************************************************************************************************/
 void double_vector_delete(struct double_vector* self)
 {
-   free(self->data);
+   allocator_free(self->data);
    self->data = 0;
    self->size = 0;
+   self->capacity = 0;
    return;
 }
 
@@ -36,10 +39,11 @@ void double_vector_delete(struct double_vector* self)
 **************************************************************************************************/
 struct double_vector* double_vector_ptr_new(const size_t size)
 {
-   struct double_vector* self = (struct double_vector*)malloc(sizeof(struct double_vector));
+   struct double_vector* self = (struct double_vector*)allocator_alloc(sizeof(struct double_vector));
    if (!self) return 0;
    self->data = 0;
    self->size = 0;
+   self->capacity = 0;
    double_vector_resize(self, size);
    return self;
 }
@@ -54,40 +58,41 @@ struct double_vector* double_vector_ptr_new(const size_t size)
 void double_vector_ptr_delete(struct double_vector** self)
 {
    double_vector_delete(*self);
-   free(*self);
+   allocator_free(*self);
    *self = 0;
    return;
 }
 
 /**************************************************************************************************
-* double_vector_resize: ndrar storleken / kapaciteten p angiven vektor via omallokering.
+* double_vector_resize: ndrar storleken p angiven vektor. Vid behov utkas kapaciteten till
+*                      exakt den nya storleken, men kapaciteten minskas aldrig (se funktionen
+*                      double_vector_shrink_to_fit).
 *
 *                      - self    : Pekare till vektorn.
-*                      - new_size: Vektorns nya storlek efter omallokeringen.
+*                      - new_size: Vektorns nya storlek.
 **************************************************************************************************/
 int double_vector_resize(struct double_vector* self,
                          const size_t new_size)
 {
-   double* copy = (double*)realloc(self->data, sizeof(double) * new_size);
-   if (!copy) return 1;
-   self->data = copy;
+   if (new_size > self->capacity && double_vector_reserve(self, new_size)) return 1;
    self->size = new_size;
    return 0;
 }
 
 /**************************************************************************************************
-* double_vector_push: Lgger till ett nytt element lngst bak i angiven vektor.
+* double_vector_push: Lgger till ett nytt element lngst bak i angiven vektor. Ifall fltet r
+*                     fullt frdubblas kapaciteten, vilket medfr att N element kan lggas till med
+*                     ett ftal omallokeringar i stllet fr en per element.
 *
 *                     - self       : Pekare till vektorn.
 *                     - new_element: Det nya element som skall lggas till.
 **************************************************************************************************/
 int double_vector_push(struct double_vector* self,
-                       const double new_element)
+                       const real_t new_element)
 {
-   double* copy = (double*)realloc(self->data, sizeof(double) * (self->size + 1));
-   if (!copy) return 1;
-   copy[self->size++] = new_element;
-   self->data = copy;
+   if (self->size == self->capacity &&
+       double_vector_reserve(self, self->capacity ? self->capacity * 2 : 1)) return 1;
+   self->data[self->size++] = new_element;
    return 0;
 }
 
@@ -105,14 +110,60 @@ int double_vector_pop(struct double_vector* self)
    }
    else
    {
-      double* copy = (double*)realloc(self->data, sizeof(double) * (self->size - 1));
-      if (!copy) return 1;
-      self->data = copy;
       self->size--;
       return 0;
    }
 }
 
+/**************************************************************************************************
+* double_vector_reserve: Skerstller att angiven vektor rymmer minst angivet antal element utan
+*                        omallokering, exempelvis infr inlsning av ett knt antal element.
+*                        Vektorns storlek pverkas inte. Returnerar 1 ifall minnesallokering
+*                        misslyckas, annars 0.
+*
+*                        - self    : Pekare till vektorn.
+*                        - capacity: Antalet element som skall rymmas.
+**************************************************************************************************/
+int double_vector_reserve(struct double_vector* self,
+                          const size_t capacity)
+{
+   if (capacity <= self->capacity) return 0;
+   real_t* copy = (real_t*)allocator_realloc(self->data,
+      sizeof(real_t) * self->capacity, sizeof(real_t) * capacity);
+   if (!copy) return 1;
+   self->data = copy;
+   self->capacity = capacity;
+   return 0;
+}
+
+/**************************************************************************************************
+* double_vector_shrink_to_fit: Minskar kapaciteten fr angiven vektor till dess storlek, s att
+*                              verskottet frn tidigare tillvxt frigrs. Returnerar 1 ifall
+*                              minnesallokering misslyckas, varvid vektorn behlls ofrndrad,
+*                              annars 0.
+*
+*                              - self: Pekare till vektorn.
+**************************************************************************************************/
+int double_vector_shrink_to_fit(struct double_vector* self)
+{
+   if (self->size == self->capacity) return 0;
+
+   if (!self->size)
+   {
+      allocator_free(self->data);
+      self->data = 0;
+      self->capacity = 0;
+      return 0;
+   }
+
+   real_t* copy = (real_t*)allocator_realloc(self->data,
+      sizeof(real_t) * self->capacity, sizeof(real_t) * self->size);
+   if (!copy) return 1;
+   self->data = copy;
+   self->capacity = self->size;
+   return 0;
+}
+
 /**************************************************************************************************
 * double_vector_print: Skriver ut innehll lagrat i angiven vektor via angiven utstrm, dr
 *                      standardutenheten stdout anvnds som default fr utskrift i terminalen.
@@ -127,7 +178,7 @@ void double_vector_print(const struct double_vector* self,
    if (!ostream) ostream = stdout;
    fprintf(ostream, "--------------------------------------------------------------------------\n");
 
-   for (const double* i = self->data; i < self->data + self->size; ++i)
+   for (const real_t* i = self->data; i < self->data + self->size; ++i)
    {
       fprintf(ostream, "%g\n", *i);
    }
@@ -141,7 +192,7 @@ void double_vector_print(const struct double_vector* self,
 *
 *                      - self: Pekare till vektorn.
 **************************************************************************************************/
-double* double_vector_begin(const struct double_vector* self)
+real_t* double_vector_begin(const struct double_vector* self)
 {
    return self->data;
 }
@@ -151,7 +202,7 @@ double* double_vector_begin(const struct double_vector* self)
 *
 *                    - self: Pekare till vektorn.
 **************************************************************************************************/
-double* double_vector_end(const struct double_vector* self)
+real_t* double_vector_end(const struct double_vector* self)
 {
    return self->data + self->size;
 }
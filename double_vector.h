@@ -14,8 +14,9 @@
 **************************************************************************************************/
 struct double_vector
 {
-   double* data; /* Pekare till dynamiskt flt fr lagring av flyttal. */
-   size_t size;  /* Vektorns storlek (antalet element i fltet). */
+   real_t* data;    /* Pekare till dynamiskt flt fr lagring av flyttal. */
+   size_t size;     /* Vektorns storlek (antalet element i fltet). */
+   size_t capacity; /* Antalet element som ryms i fltet innan omallokering krvs. */
 };
 
 /* Externa funktioner: */
@@ -26,12 +27,15 @@ void double_vector_ptr_delete(struct double_vector** self);
 int double_vector_resize(struct double_vector* self,
                          const size_t new_size);
 int double_vector_push(struct double_vector* self,
-                       const double new_element);
+                       const real_t new_element);
 int double_vector_pop(struct double_vector* self);
+int double_vector_reserve(struct double_vector* self,
+                          const size_t capacity);
+int double_vector_shrink_to_fit(struct double_vector* self);
 void double_vector_print(const struct double_vector* self,
                          FILE* ostream);
-double* double_vector_begin(const struct double_vector* self);
-double* double_vector_end(const struct double_vector* self);
+real_t* double_vector_begin(const struct double_vector* self);
+real_t* double_vector_end(const struct double_vector* self);
 
 /* Funktionspekare: */
 extern void (*double_vector_clear)(struct double_vector* self);
@@ -0,0 +1,102 @@
+/**************************************************************************************************
+* file_map.c: Innehller funktionsdefinitioner fr mappning av filer till minnet.
+**************************************************************************************************/
+#include "file_map.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**************************************************************************************************
+* file_map_new: Mappar filen p angiven filskvg till minnet. Operativsystemet informeras om
+*               huruvida filen kommer lsas sekventiellt, s att efterfljande sidor lses in
+*               i frvg, eller i godtycklig ordning, varvid hela filen lses in i frvg.
+*               Returnerar 1 ifall filen inte kan ppnas eller mappas, annars 0.
+*
+*               - self      : Pekare till mappningen.
+*               - filepath  : Filskvg till filen som skall mappas.
+*               - sequential: Indikerar ifall filen kommer lsas sekventiellt.
+**************************************************************************************************/
+int file_map_new(struct file_map* self,
+                 const char* filepath,
+                 const bool sequential)
+{
+   self->data = 0;
+   self->size = 0;
+
+#ifdef _WIN32
+   (void)sequential;
+   FILE* fstream = fopen(filepath, "rb");
+   if (!fstream) return 1;
+
+   if (fseek(fstream, 0, SEEK_END) || ftell(fstream) < 0)
+   {
+      fclose(fstream);
+      return 1;
+   }
+
+   const size_t size = (size_t)ftell(fstream);
+   char* data = size ? (char*)malloc(size) : 0;
+   rewind(fstream);
+
+   if (size && (!data || fread(data, 1, size, fstream) != size))
+   {
+      free(data);
+      fclose(fstream);
+      return 1;
+   }
+
+   fclose(fstream);
+   self->data = data;
+   self->size = size;
+   return 0;
+#else
+   struct stat status;
+   const int fd = open(filepath, O_RDONLY);
+   if (fd < 0) return 1;
+
+   if (fstat(fd, &status) || status.st_size < 0)
+   {
+      close(fd);
+      return 1;
+   }
+
+   if (status.st_size > 0)
+   {
+      void* data = mmap(0, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+      if (data == MAP_FAILED)
+      {
+         close(fd);
+         return 1;
+      }
+
+      madvise(data, (size_t)status.st_size, sequential ? MADV_SEQUENTIAL : MADV_WILLNEED);
+      self->data = (const char*)data;
+      self->size = (size_t)status.st_size;
+   }
+
+   close(fd);
+   return 0;
+#endif
+}
+
+/**************************************************************************************************
+* file_map_delete: Tar bort angiven mappning och frigr motsvarande minne.
+*
+*                  - self: Pekare till mappningen.
+**************************************************************************************************/
+void file_map_delete(struct file_map* self)
+{
+#ifdef _WIN32
+   free((void*)self->data);
+#else
+   if (self->data) munmap((void*)self->data, self->size);
+#endif
+   self->data = 0;
+   self->size = 0;
+   return;
+}
@@ -0,0 +1,30 @@
+/**************************************************************************************************
+* file_map.h: Innehller funktionalitet fr att mappa en fil till minnet, s att filens innehll
+*             kan lsas direkt som ett flt av tecken utan att kopieras via filstrmmar. Sidorna
+*             lses in av operativsystemet vid behov, vilket medfr att ven filer p flera GB
+*             kan bearbetas utan att hela filen frst lses in. Vid Windows lses filen i
+*             stllet in i ett heapallokerat minnesblock.
+**************************************************************************************************/
+#ifndef FILE_MAP_H_
+#define FILE_MAP_H_
+
+/* Inkluderingsdirektiv: */
+#include "def.h"
+
+/**************************************************************************************************
+* file_map: Skrivskyddad vy av en fils innehll i minnet. Innehllet avslutas inte med ett
+*           nolltecken, utan storleken mste anvndas fr att avgra var innehllet slutar.
+**************************************************************************************************/
+struct file_map
+{
+   const char* data; /* Pekare till filens frsta tecken (null vid tom fil). */
+   size_t size;      /* Filens storlek i byte. */
+};
+
+/* Externa funktioner: */
+int file_map_new(struct file_map* self,
+                 const char* filepath,
+                 const bool sequential);
+void file_map_delete(struct file_map* self);
+
+#endif /* FILE_MAP_H_ */
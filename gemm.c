@@ -0,0 +1,746 @@
+/**************************************************************************************************
+* gemm.c: Innehller funktionsdefinitioner fr blockad matrismultiplikation med packade paneler
+*         samt registerblockade mikrokrnor fr respektive instruktionsuppsttning. Mikrokrnan
+*         vljs utefter den instruktionsuppsttning som anvnds av krnorna i simd.c.
+**************************************************************************************************/
+#include "gemm.h"
+#include "simd.h"
+
+#include <time.h>
+#include <pthread.h>
+
+#include "simd_vector.h"
+
+/* Makrodefinitioner: */
+#define GEMM_SMALL_SIZE 32768   /* Grns (m * n * k) under vilken packning inte lnar sig. */
+#define GEMM_MAX_TILE 256       /* Maximalt antal element i en mikrokrnas resultatblock. */
+#define GEMM_TUNE_SIZE 256      /* Matrisstorlek som anvnds vid mtning av blockstorlekar. */
+#define GEMM_TUNE_FILE "gemm_tune.txt" /* Default filskvg fr valda blockstorlekar. */
+
+#ifdef ANN_FLOAT32
+#define GEMM_PRECISION "float"  /* Flyttalstyp som valda blockstorlekar avser. */
+#else
+#define GEMM_PRECISION "double" /* Flyttalstyp som valda blockstorlekar avser. */
+#endif
+
+/**************************************************************************************************
+* gemm_kernel: Mikrokrna som berknar ett block om mr x nr element av C via packade paneler.
+**************************************************************************************************/
+struct gemm_kernel
+{
+   size_t mr; /* Antalet rader per block. */
+   size_t nr; /* Antalet kolumner per block. */
+   void (*compute)(const size_t kc, const real_t* a, const real_t* b,
+                   real_t* c, const size_t ldc, const real_t alpha);
+};
+
+/* Statiska funktioner: */
+static void gemm_init(void);
+static int gemm_load_params(const char* filepath);
+static void gemm_blocked(const enum gemm_transpose transpose_a,
+                         const enum gemm_transpose transpose_b,
+                         const size_t m, const size_t n, const size_t k, const real_t alpha,
+                         const real_t* a, const size_t lda, const real_t* b, const size_t ldb,
+                         real_t* c, const size_t ldc);
+static void gemm_small(const enum gemm_transpose transpose_a,
+                       const enum gemm_transpose transpose_b,
+                       const size_t m, const size_t n, const size_t k, const real_t alpha,
+                       const real_t* a, const size_t lda, const real_t* b, const size_t ldb,
+                       real_t* c, const size_t ldc);
+static void pack_a(const enum gemm_transpose transpose, const real_t* a, const size_t lda,
+                   const size_t rows, const size_t depth, const size_t mr, real_t* packed);
+static void pack_b(const enum gemm_transpose transpose, const real_t* b, const size_t ldb,
+                   const size_t depth, const size_t cols, const size_t nr, real_t* packed);
+static void scale(const size_t m, const size_t n, const real_t beta, real_t* c, const size_t ldc);
+static const struct gemm_kernel* get_kernel(void);
+static int reserve(real_t** buffer, size_t* capacity, const size_t size);
+static void create_key(void);
+static void release_buffers(void* unused);
+static size_t round_up(const size_t x, const size_t multiple);
+static double get_time(void);
+static void kernel_scalar(const size_t kc, const real_t* a, const real_t* b,
+                          real_t* c, const size_t ldc, const real_t alpha);
+
+#ifdef SIMD_X86
+static void kernel_sse2(const size_t kc, const real_t* a, const real_t* b,
+                        real_t* c, const size_t ldc, const real_t alpha);
+static void kernel_avx2(const size_t kc, const real_t* a, const real_t* b,
+                        real_t* c, const size_t ldc, const real_t alpha);
+static void kernel_avx512(const size_t kc, const real_t* a, const real_t* b,
+                          real_t* c, const size_t ldc, const real_t alpha);
+#endif
+
+/* Statiska variabler: */
+static struct gemm_params params = { .mc = 96, .kc = 256, .nc = 4096 };
+static pthread_once_t once = PTHREAD_ONCE_INIT;
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t key;                       /* Nyckel som frigr trdens buffertar. */
+static _Thread_local real_t* packed_a = 0;      /* Trdens buffer fr packade block av A. */
+static _Thread_local real_t* packed_b = 0;      /* Trdens buffer fr packade paneler av B. */
+static _Thread_local size_t capacity_a = 0;     /* Antalet element som ryms i packed_a. */
+static _Thread_local size_t capacity_b = 0;     /* Antalet element som ryms i packed_b. */
+
+/**************************************************************************************************
+* gemm: Berknar C = alpha * op(A) * op(B) + beta * C, dr op(A) utgr en m x k-matris, op(B)
+*       utgr en k x n-matris och C utgr en m x n-matris. Samtliga matriser lagras radvis med
+*       angivet radsteg. Vid beta = 0 lses inte C, vilket medfr att C inte behver initieras.
+*       Sm produkter berknas direkt, medan strre produkter berknas blockvis via packade
+*       paneler. Blockstorlekarna lses in eller mts fram vid frsta anrop.
+*
+*       - transpose_a: Anger ifall A skall transponeras (A lagras d som en k x m-matris).
+*       - transpose_b: Anger ifall B skall transponeras (B lagras d som en n x k-matris).
+*       - m, n, k    : Dimensionerna fr produkten.
+*       - alpha      : Skalr som produkten multipliceras med.
+*       - a, lda     : Pekare till matrisen A samt dess radsteg.
+*       - b, ldb     : Pekare till matrisen B samt dess radsteg.
+*       - beta       : Skalr som befintligt innehll i C multipliceras med.
+*       - c, ldc     : Pekare till matrisen C samt dess radsteg.
+**************************************************************************************************/
+void gemm(const enum gemm_transpose transpose_a,
+          const enum gemm_transpose transpose_b,
+          const size_t m,
+          const size_t n,
+          const size_t k,
+          const real_t alpha,
+          const real_t* a,
+          const size_t lda,
+          const real_t* b,
+          const size_t ldb,
+          const real_t beta,
+          real_t* c,
+          const size_t ldc)
+{
+   if (!m || !n) return;
+   scale(m, n, beta, c, ldc);
+   if (!k || alpha == 0.0) return;
+
+   if (m * n * k < GEMM_SMALL_SIZE)
+   {
+      gemm_small(transpose_a, transpose_b, m, n, k, alpha, a, lda, b, ldb, c, ldc);
+   }
+   else
+   {
+      pthread_once(&once, &gemm_init);
+      gemm_blocked(transpose_a, transpose_b, m, n, k, alpha, a, lda, b, ldb, c, ldc);
+   }
+   return;
+}
+
+/**************************************************************************************************
+* gemv: Berknar y = op(A) * x, dr A utgr en m x n-matris lagrad radvis med angivet radsteg.
+*       Utan transponering berknas varje element i y som skalrprodukten av en rad i A och x,
+*       medan y innehller n element vid transponering.
+*
+*       - transpose_a: Anger ifall A skall transponeras.
+*       - m, n       : Antalet rader respektive kolumner i A.
+*       - a, lda     : Pekare till matrisen A samt dess radsteg.
+*       - x          : Pekare till vektorn som multipliceras (n eller m element).
+*       - y          : Pekare till resultatvektorn (m eller n element).
+**************************************************************************************************/
+void gemv(const enum gemm_transpose transpose_a,
+          const size_t m,
+          const size_t n,
+          const real_t* a,
+          const size_t lda,
+          const real_t* x,
+          real_t* y)
+{
+   if (transpose_a == GEMM_TRANSPOSE)
+   {
+      simd_gemv_transposed(y, a, m, n, lda, x);
+   }
+   else
+   {
+      for (size_t i = 0; i < m; ++i, a += lda)
+      {
+         y[i] = simd_dot(a, x, n);
+      }
+   }
+   return;
+}
+
+/**************************************************************************************************
+* gemm_autotune: Mter prestandan fr ett antal kombinationer av blockstorlekar via multiplikation
+*                av kvadratiska matriser, vljer den snabbaste kombinationen och lagrar denna
+*                tillsammans med aktuell instruktionsuppsttning samt flyttalstyp i angiven fil. Returnerar 1 ifall
+*                minnesallokering misslyckas eller filen inte kan skrivas, annars 0.
+*
+*                - filepath: Filskvg som valda blockstorlekar skall skrivas till.
+**************************************************************************************************/
+int gemm_autotune(const char* filepath)
+{
+   static const size_t mc[] = { 48, 96, 144, 192 };
+   static const size_t kc[] = { 128, 256, 384 };
+   static const size_t nc[] = { 1024, 4096 };
+   const size_t size = GEMM_TUNE_SIZE;
+   real_t* matrices = (real_t*)malloc(sizeof(real_t) * size * size * 3);
+   struct gemm_params best = params;
+   double best_time = -1;
+
+   if (!matrices) return 1;
+
+   for (size_t i = 0, seed = 1; i < size * size * 2; ++i)
+   {
+      seed = seed * 1103515245 + 12345;
+      matrices[i] = (real_t)(seed >> 16 & 0x7fff) / 0x7fff - 0.5;
+   }
+
+   for (size_t i = 0; i < sizeof(mc) / sizeof(mc[0]); ++i)
+   {
+      for (size_t j = 0; j < sizeof(kc) / sizeof(kc[0]); ++j)
+      {
+         for (size_t k = 0; k < sizeof(nc) / sizeof(nc[0]); ++k)
+         {
+            const struct gemm_params candidate = { .mc = mc[i], .kc = kc[j], .nc = nc[k] };
+            double time = -1;
+            params = candidate;
+
+            for (size_t l = 0; l < 3; ++l)
+            {
+               const double start = get_time();
+               gemm_blocked(GEMM_NO_TRANSPOSE, GEMM_NO_TRANSPOSE, size, size, size, 1.0,
+                            matrices, size, matrices + size * size, size,
+                            matrices + size * size * 2, size);
+               const double elapsed = get_time() - start;
+               if (time < 0 || elapsed < time) time = elapsed;
+            }
+
+            if (best_time < 0 || time < best_time)
+            {
+               best_time = time;
+               best = candidate;
+            }
+         }
+      }
+   }
+
+   params = best;
+   free(matrices);
+
+   FILE* fstream = fopen(filepath, "w");
+   if (!fstream) return 1;
+   fprintf(fstream, "%s %s %zu %zu %zu\n", simd_isa_name(simd_get_isa()), GEMM_PRECISION,
+           params.mc, params.kc, params.nc);
+   fclose(fstream);
+   return 0;
+}
+
+/**************************************************************************************************
+* gemm_get_params: Returnerar de blockstorlekar som anvnds vid blockad matrismultiplikation.
+**************************************************************************************************/
+struct gemm_params gemm_get_params(void)
+{
+   pthread_once(&once, &gemm_init);
+   return params;
+}
+
+/**************************************************************************************************
+* gemm_set_params: Stter blockstorlekarna som anvnds vid blockad matrismultiplikation, vilket
+*                  erstter eventuella vrden inlsta frn fil.
+*
+*                  - params: Pekare till de blockstorlekar som skall anvndas.
+**************************************************************************************************/
+void gemm_set_params(const struct gemm_params* new_params)
+{
+   pthread_once(&once, &gemm_init);
+   if (new_params->mc && new_params->kc && new_params->nc) params = *new_params;
+   return;
+}
+
+/**************************************************************************************************
+* gemm_release: Frigr anropande trds buffertar fr packade paneler. Anropas automatiskt nr
+*               en trd som har anvnt funktionen gemm avslutas samt nr programmet avslutas,
+*               men kan ven anropas tidigare fr att lmna tillbaka minnet direkt.
+**************************************************************************************************/
+void gemm_release(void)
+{
+   free(packed_a);
+   free(packed_b);
+   packed_a = 0;
+   packed_b = 0;
+   capacity_a = 0;
+   capacity_b = 0;
+   return;
+}
+
+/**************************************************************************************************
+* gemm_init: Lser in blockstorlekar frn filen angiven via miljvariabeln ANN_GEMM_TUNE (default
+*            gemm_tune.txt). Ifall filen saknas eller avser en annan instruktionsuppsttning
+*            eller flyttalstyp mts nya blockstorlekar fram, vilka sedan lagras i filen.
+**************************************************************************************************/
+static void gemm_init(void)
+{
+   const char* filepath = getenv("ANN_GEMM_TUNE");
+   if (!filepath) filepath = GEMM_TUNE_FILE;
+
+   if (gemm_load_params(filepath))
+   {
+      gemm_autotune(filepath);
+   }
+   return;
+}
+
+/**************************************************************************************************
+* gemm_load_params: Lser in blockstorlekar frn angiven fil. Returnerar 1 ifall filen inte kan
+*                   lsas eller avser en annan instruktionsuppsttning eller flyttalstyp n
+*                   den som anvnds.
+*
+*                   - filepath: Filskvg som blockstorlekarna skall lsas frn.
+**************************************************************************************************/
+static int gemm_load_params(const char* filepath)
+{
+   FILE* fstream = fopen(filepath, "r");
+   char isa[16] = { '\0' };
+   char precision[16] = { '\0' };
+   struct gemm_params loaded;
+
+   if (!fstream) return 1;
+   const int num = fscanf(fstream, "%15s %15s %zu %zu %zu", isa, precision,
+                          &loaded.mc, &loaded.kc, &loaded.nc);
+   fclose(fstream);
+
+   if (num != 5 || strcmp(isa, simd_isa_name(simd_get_isa())) || strcmp(precision, GEMM_PRECISION) ||
+       !loaded.mc || !loaded.kc || !loaded.nc)
+   {
+      return 1;
+   }
+
+   params = loaded;
+   return 0;
+}
+
+/**************************************************************************************************
+* gemm_blocked: Berknar C += alpha * op(A) * op(B) blockvis. Paneler om kc x nc element av B
+*               packas frst, drefter packas block om mc x kc element av A, varefter
+*               mikrokrnan berknar ett block om mr x nr element av C t gngen.
+**************************************************************************************************/
+static void gemm_blocked(const enum gemm_transpose transpose_a,
+                         const enum gemm_transpose transpose_b,
+                         const size_t m, const size_t n, const size_t k, const real_t alpha,
+                         const real_t* a, const size_t lda, const real_t* b, const size_t ldb,
+                         real_t* c, const size_t ldc)
+{
+   const struct gemm_kernel* kernel = get_kernel();
+   const size_t mc = round_up(params.mc, kernel->mr);
+   const size_t nc = round_up(params.nc, kernel->nr);
+   const size_t kc = params.kc;
+   real_t tile[GEMM_MAX_TILE];
+
+   if (reserve(&packed_a, &capacity_a, mc * kc) || reserve(&packed_b, &capacity_b, kc * nc))
+   {
+      gemm_small(transpose_a, transpose_b, m, n, k, alpha, a, lda, b, ldb, c, ldc);
+      return;
+   }
+
+   for (size_t jc = 0; jc < n; jc += nc)
+   {
+      const size_t nb = n - jc < nc ? n - jc : nc;
+
+      for (size_t pc = 0; pc < k; pc += kc)
+      {
+         const size_t kb = k - pc < kc ? k - pc : kc;
+         const real_t* b_block = transpose_b == GEMM_TRANSPOSE ? b + jc * ldb + pc : b + pc * ldb + jc;
+         pack_b(transpose_b, b_block, ldb, kb, nb, kernel->nr, packed_b);
+
+         for (size_t ic = 0; ic < m; ic += mc)
+         {
+            const size_t mb = m - ic < mc ? m - ic : mc;
+            const real_t* a_block = transpose_a == GEMM_TRANSPOSE ? a + pc * lda + ic : a + ic * lda + pc;
+            pack_a(transpose_a, a_block, lda, mb, kb, kernel->mr, packed_a);
+
+            for (size_t jr = 0; jr < nb; jr += kernel->nr)
+            {
+               const size_t cols = nb - jr < kernel->nr ? nb - jr : kernel->nr;
+
+               for (size_t ir = 0; ir < mb; ir += kernel->mr)
+               {
+                  const size_t rows = mb - ir < kernel->mr ? mb - ir : kernel->mr;
+                  real_t* c_block = c + (ic + ir) * ldc + jc + jr;
+
+                  if (rows == kernel->mr && cols == kernel->nr)
+                  {
+                     kernel->compute(kb, packed_a + ir * kb, packed_b + jr * kb, c_block, ldc, alpha);
+                  }
+                  else
+                  {
+                     memset(tile, 0, sizeof(tile));
+                     kernel->compute(kb, packed_a + ir * kb, packed_b + jr * kb, tile, kernel->nr, alpha);
+
+                     for (size_t i = 0; i < rows; ++i)
+                     {
+                        for (size_t j = 0; j < cols; ++j)
+                        {
+                           c_block[i * ldc + j] += tile[i * kernel->nr + j];
+                        }
+                     }
+                  }
+               }
+            }
+         }
+      }
+   }
+   return;
+}
+
+/**************************************************************************************************
+* gemm_small: Berknar C += alpha * op(A) * op(B) direkt utan packning, vilket anvnds fr sm
+*             matriser dr packningen kostar mer n den sparar.
+**************************************************************************************************/
+static void gemm_small(const enum gemm_transpose transpose_a,
+                       const enum gemm_transpose transpose_b,
+                       const size_t m, const size_t n, const size_t k, const real_t alpha,
+                       const real_t* a, const size_t lda, const real_t* b, const size_t ldb,
+                       real_t* c, const size_t ldc)
+{
+   for (size_t i = 0; i < m; ++i)
+   {
+      real_t* c_row = c + i * ldc;
+
+      for (size_t p = 0; p < k; ++p)
+      {
+         const real_t a_value = transpose_a == GEMM_TRANSPOSE ? a[p * lda + i] : a[i * lda + p];
+         const real_t factor = alpha * a_value;
+
+         if (transpose_b == GEMM_TRANSPOSE)
+         {
+            for (size_t j = 0; j < n; ++j)
+            {
+               c_row[j] += factor * b[j * ldb + p];
+            }
+         }
+         else
+         {
+            simd_axpy(c_row, factor, b + p * ldb, n);
+         }
+      }
+   }
+   return;
+}
+
+/**************************************************************************************************
+* pack_a: Packar ett block om rows x depth element av op(A) i paneler om mr rader, dr varje
+*         panel lagras kolumnvis s att mikrokrnan lser den sekventiellt. Ofullstndiga
+*         paneler fylls ut med nollor.
+**************************************************************************************************/
+static void pack_a(const enum gemm_transpose transpose, const real_t* a, const size_t lda,
+                   const size_t rows, const size_t depth, const size_t mr, real_t* packed)
+{
+   for (size_t ir = 0; ir < rows; ir += mr)
+   {
+      const size_t num = rows - ir < mr ? rows - ir : mr;
+
+      for (size_t p = 0; p < depth; ++p, packed += mr)
+      {
+         for (size_t i = 0; i < num; ++i)
+         {
+            packed[i] = transpose == GEMM_TRANSPOSE ? a[p * lda + ir + i] : a[(ir + i) * lda + p];
+         }
+         for (size_t i = num; i < mr; ++i)
+         {
+            packed[i] = 0;
+         }
+      }
+   }
+   return;
+}
+
+/**************************************************************************************************
+* pack_b: Packar en panel om depth x cols element av op(B) i paneler om nr kolumner, dr varje
+*         panel lagras radvis s att mikrokrnan lser den sekventiellt. Ofullstndiga paneler
+*         fylls ut med nollor.
+**************************************************************************************************/
+static void pack_b(const enum gemm_transpose transpose, const real_t* b, const size_t ldb,
+                   const size_t depth, const size_t cols, const size_t nr, real_t* packed)
+{
+   for (size_t jr = 0; jr < cols; jr += nr)
+   {
+      const size_t num = cols - jr < nr ? cols - jr : nr;
+
+      for (size_t p = 0; p < depth; ++p, packed += nr)
+      {
+         for (size_t j = 0; j < num; ++j)
+         {
+            packed[j] = transpose == GEMM_TRANSPOSE ? b[(jr + j) * ldb + p] : b[p * ldb + jr + j];
+         }
+         for (size_t j = num; j < nr; ++j)
+         {
+            packed[j] = 0;
+         }
+      }
+   }
+   return;
+}
+
+/**************************************************************************************************
+* scale: Multiplicerar samtliga element i matrisen C med beta. Vid beta = 0 nollstlls C utan
+*        att befintligt innehll lses.
+**************************************************************************************************/
+static void scale(const size_t m, const size_t n, const real_t beta, real_t* c, const size_t ldc)
+{
+   if (beta == 1.0) return;
+
+   for (size_t i = 0; i < m; ++i, c += ldc)
+   {
+      if (beta == 0.0)
+      {
+         memset(c, 0, sizeof(real_t) * n);
+      }
+      else
+      {
+         for (size_t j = 0; j < n; ++j)
+         {
+            c[j] *= beta;
+         }
+      }
+   }
+   return;
+}
+
+/**************************************************************************************************
+* get_kernel: Returnerar mikrokrnan fr den instruktionsuppsttning som anvnds i simd.c.
+**************************************************************************************************/
+static const struct gemm_kernel* get_kernel(void)
+{
+   static const struct gemm_kernel scalar = { .mr = 4, .nr = 4, .compute = &kernel_scalar };
+
+#ifdef SIMD_X86
+   static const struct gemm_kernel sse2 =
+      { .mr = 4, .nr = 2 * V128_LANES, .compute = &kernel_sse2 };
+   static const struct gemm_kernel avx2 =
+      { .mr = 6, .nr = 2 * V256_LANES, .compute = &kernel_avx2 };
+   static const struct gemm_kernel avx512 =
+      { .mr = 8, .nr = 2 * V512_LANES, .compute = &kernel_avx512 };
+   const enum simd_isa isa = simd_get_isa();
+
+   if (isa == SIMD_ISA_SSE2) return &sse2;
+   if (isa == SIMD_ISA_AVX2) return &avx2;
+   if (isa == SIMD_ISA_AVX512) return &avx512;
+#endif
+   return &scalar;
+}
+
+/**************************************************************************************************
+* reserve: Skerstller att angiven buffer rymmer minst angivet antal element. Bufferten
+*          justeras till 64 byte. Vid trdens frsta allokering registreras trdens buffertar
+*          s att de frigrs nr trden avslutas. Returnerar 1 ifall minnesallokering
+*          misslyckas, annars 0.
+**************************************************************************************************/
+static int reserve(real_t** buffer, size_t* capacity, const size_t size)
+{
+   if (size <= *capacity) return 0;
+   real_t* copy = (real_t*)aligned_alloc(64, round_up(sizeof(real_t) * size, 64));
+   if (!copy) return 1;
+   free(*buffer);
+   *buffer = copy;
+   *capacity = size;
+   pthread_once(&key_once, &create_key);
+   pthread_setspecific(key, copy);
+   return 0;
+}
+
+/**************************************************************************************************
+* create_key: Skapar nyckeln vars destruktor frigr en trds buffertar nr trden avslutas.
+*             Eftersom destruktorn inte anropas fr den trd som avslutar programmet frigrs
+*             den trdens buffertar i stllet via atexit.
+**************************************************************************************************/
+static void create_key(void)
+{
+   pthread_key_create(&key, &release_buffers);
+   atexit(&gemm_release);
+   return;
+}
+
+/**************************************************************************************************
+* release_buffers: Destruktor som frigr avslutande trds buffertar fr packade paneler.
+**************************************************************************************************/
+static void release_buffers(void* unused)
+{
+   (void)unused;
+   gemm_release();
+   return;
+}
+
+/**************************************************************************************************
+* round_up: Returnerar x avrundat uppt till nrmaste multipel av angivet tal.
+**************************************************************************************************/
+static size_t round_up(const size_t x, const size_t multiple)
+{
+   return (x + multiple - 1) / multiple * multiple;
+}
+
+/**************************************************************************************************
+* get_time: Returnerar aktuell tid i sekunder, avsett fr mtning av krtider.
+**************************************************************************************************/
+static double get_time(void)
+{
+   struct timespec time;
+   timespec_get(&time, TIME_UTC);
+   return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+/**************************************************************************************************
+* kernel_scalar: Portabel mikrokrna som berknar ett block om 4 x 4 element.
+**************************************************************************************************/
+static void kernel_scalar(const size_t kc, const real_t* a, const real_t* b,
+                          real_t* c, const size_t ldc, const real_t alpha)
+{
+   real_t sum[4][4] = { { 0 } };
+
+   for (size_t p = 0; p < kc; ++p, a += 4, b += 4)
+   {
+      for (size_t i = 0; i < 4; ++i)
+      {
+         for (size_t j = 0; j < 4; ++j)
+         {
+            sum[i][j] += a[i] * b[j];
+         }
+      }
+   }
+
+   for (size_t i = 0; i < 4; ++i)
+   {
+      for (size_t j = 0; j < 4; ++j)
+      {
+         c[i * ldc + j] += alpha * sum[i][j];
+      }
+   }
+   return;
+}
+
+#ifdef SIMD_X86
+
+/**************************************************************************************************
+* kernel_sse2: Mikrokrna fr 128-bitars vektorer som berknar ett block om 4 x 2 vektorer.
+**************************************************************************************************/
+__attribute__((target("sse2")))
+static void kernel_sse2(const size_t kc, const real_t* a, const real_t* b,
+                        real_t* c, const size_t ldc, const real_t alpha)
+{
+   V128 sum[4][2];
+
+   for (size_t i = 0; i < 4; ++i)
+   {
+      sum[i][0] = v128_zero();
+      sum[i][1] = v128_zero();
+   }
+
+   for (size_t p = 0; p < kc; ++p, a += 4, b += 2 * V128_LANES)
+   {
+      const V128 b0 = v128_load(b);
+      const V128 b1 = v128_load(b + V128_LANES);
+
+      for (size_t i = 0; i < 4; ++i)
+      {
+         const V128 factor = v128_set1(a[i]);
+         sum[i][0] = v128_add(sum[i][0], v128_mul(factor, b0));
+         sum[i][1] = v128_add(sum[i][1], v128_mul(factor, b1));
+      }
+   }
+
+   const V128 factor = v128_set1(alpha);
+
+   for (size_t i = 0; i < 4; ++i)
+   {
+      real_t* row = c + i * ldc;
+      v128_storeu(row, v128_add(v128_loadu(row), v128_mul(factor, sum[i][0])));
+      v128_storeu(row + V128_LANES,
+                  v128_add(v128_loadu(row + V128_LANES), v128_mul(factor, sum[i][1])));
+   }
+   return;
+}
+
+/**************************************************************************************************
+* kernel_avx2: Mikrokrna fr 256-bitars vektorer med FMA som berknar ett block om 6 x 2
+*              vektorer, vilket hller tolv ackumulatorer i register.
+**************************************************************************************************/
+__attribute__((target("avx2,fma")))
+static void kernel_avx2(const size_t kc, const real_t* a, const real_t* b,
+                        real_t* c, const size_t ldc, const real_t alpha)
+{
+   V256 sum00 = v256_zero(), sum01 = v256_zero();
+   V256 sum10 = v256_zero(), sum11 = v256_zero();
+   V256 sum20 = v256_zero(), sum21 = v256_zero();
+   V256 sum30 = v256_zero(), sum31 = v256_zero();
+   V256 sum40 = v256_zero(), sum41 = v256_zero();
+   V256 sum50 = v256_zero(), sum51 = v256_zero();
+
+   for (size_t p = 0; p < kc; ++p, a += 6, b += 2 * V256_LANES)
+   {
+      const V256 b0 = v256_load(b);
+      const V256 b1 = v256_load(b + V256_LANES);
+      V256 factor = v256_broadcast(a);
+      sum00 = v256_fmadd(factor, b0, sum00);
+      sum01 = v256_fmadd(factor, b1, sum01);
+      factor = v256_broadcast(a + 1);
+      sum10 = v256_fmadd(factor, b0, sum10);
+      sum11 = v256_fmadd(factor, b1, sum11);
+      factor = v256_broadcast(a + 2);
+      sum20 = v256_fmadd(factor, b0, sum20);
+      sum21 = v256_fmadd(factor, b1, sum21);
+      factor = v256_broadcast(a + 3);
+      sum30 = v256_fmadd(factor, b0, sum30);
+      sum31 = v256_fmadd(factor, b1, sum31);
+      factor = v256_broadcast(a + 4);
+      sum40 = v256_fmadd(factor, b0, sum40);
+      sum41 = v256_fmadd(factor, b1, sum41);
+      factor = v256_broadcast(a + 5);
+      sum50 = v256_fmadd(factor, b0, sum50);
+      sum51 = v256_fmadd(factor, b1, sum51);
+   }
+
+   const V256 factor = v256_set1(alpha);
+   const V256 sum[6][2] = { { sum00, sum01 }, { sum10, sum11 }, { sum20, sum21 },
+                            { sum30, sum31 }, { sum40, sum41 }, { sum50, sum51 } };
+
+   for (size_t i = 0; i < 6; ++i)
+   {
+      real_t* row = c + i * ldc;
+      v256_storeu(row, v256_fmadd(factor, sum[i][0], v256_loadu(row)));
+      v256_storeu(row + V256_LANES,
+                  v256_fmadd(factor, sum[i][1], v256_loadu(row + V256_LANES)));
+   }
+   return;
+}
+
+/**************************************************************************************************
+* kernel_avx512: Mikrokrna fr 512-bitars vektorer med FMA som berknar ett block om 8 x 2
+*                vektorer, vilket hller sexton ackumulatorer i register.
+**************************************************************************************************/
+__attribute__((target("avx512f")))
+static void kernel_avx512(const size_t kc, const real_t* a, const real_t* b,
+                          real_t* c, const size_t ldc, const real_t alpha)
+{
+   V512 sum[8][2];
+
+   for (size_t i = 0; i < 8; ++i)
+   {
+      sum[i][0] = v512_zero();
+      sum[i][1] = v512_zero();
+   }
+
+   for (size_t p = 0; p < kc; ++p, a += 8, b += 2 * V512_LANES)
+   {
+      const V512 b0 = v512_load(b);
+      const V512 b1 = v512_load(b + V512_LANES);
+
+      for (size_t i = 0; i < 8; ++i)
+      {
+         const V512 factor = v512_set1(a[i]);
+         sum[i][0] = v512_fmadd(factor, b0, sum[i][0]);
+         sum[i][1] = v512_fmadd(factor, b1, sum[i][1]);
+      }
+   }
+
+   const V512 factor = v512_set1(alpha);
+
+   for (size_t i = 0; i < 8; ++i)
+   {
+      real_t* row = c + i * ldc;
+      v512_storeu(row, v512_fmadd(factor, sum[i][0], v512_loadu(row)));
+      v512_storeu(row + V512_LANES,
+                  v512_fmadd(factor, sum[i][1], v512_loadu(row + V512_LANES)));
+   }
+   return;
+}
+
+#endif /* SIMD_X86 */
@@ -0,0 +1,63 @@
+/**************************************************************************************************
+* gemm.h: Innehller funktionalitet fr matrismultiplikation (GEMM) samt matris-vektor-
+*         multiplikation (GEMV) fr berkningar i dense-lager. Matriser lagras radvis med
+*         angivet radsteg. Vid GEMM packas operanderna i paneler som passar i L1- samt
+*         L2-cacheminnet, vilka sedan bearbetas av registerblockade mikrokrnor. Blockstorlekarna
+*         kan vljas automatiskt via mtning vid frsta krning, dr valda parametrar lagras
+*         i en lokal fil (default gemm_tune.txt, kan ndras via miljvariabeln ANN_GEMM_TUNE)
+*         per instruktionsuppsttning och flyttalstyp.
+**************************************************************************************************/
+#ifndef GEMM_H_
+#define GEMM_H_
+
+/* Inkluderingsdirektiv: */
+#include "def.h"
+
+/**************************************************************************************************
+* gemm_transpose: Anger ifall en operand skall anvndas som den r eller transponerad.
+**************************************************************************************************/
+enum gemm_transpose
+{
+   GEMM_NO_TRANSPOSE, /* Operanden anvnds som den r lagrad. */
+   GEMM_TRANSPOSE     /* Operanden anvnds transponerad. */
+};
+
+/**************************************************************************************************
+* gemm_params: Blockstorlekar fr GEMM. Block om mc x kc element av A packas fr L2-cacheminnet,
+*              paneler om kc x nc element av B packas fr L3-/L2-cacheminnet medan mikrokrnan
+*              hller en panel om kc element per rad i L1-cacheminnet.
+**************************************************************************************************/
+struct gemm_params
+{
+   size_t mc; /* Antalet rader i A per block. */
+   size_t kc; /* Antalet element i den gemensamma dimensionen per block. */
+   size_t nc; /* Antalet kolumner i B per block. */
+};
+
+/* Externa funktioner: */
+void gemm(const enum gemm_transpose transpose_a,
+          const enum gemm_transpose transpose_b,
+          const size_t m,
+          const size_t n,
+          const size_t k,
+          const real_t alpha,
+          const real_t* a,
+          const size_t lda,
+          const real_t* b,
+          const size_t ldb,
+          const real_t beta,
+          real_t* c,
+          const size_t ldc);
+void gemv(const enum gemm_transpose transpose_a,
+          const size_t m,
+          const size_t n,
+          const real_t* a,
+          const size_t lda,
+          const real_t* x,
+          real_t* y);
+int gemm_autotune(const char* filepath);
+struct gemm_params gemm_get_params(void);
+void gemm_set_params(const struct gemm_params* params);
+void gemm_release(void);
+
+#endif /* GEMM_H_ */
@@ -0,0 +1,430 @@
+/**************************************************************************************************
+* half_matrix.c: Innehller funktionsdefinitioner fr matriser innehllande flyttal i halv
+*                precision samt berkningskrnor fr matris-vektor-multiplikation, dr vikterna
+*                utkas till full precision i register. Krnan vljs utefter den
+*                instruktionsuppsttning som anvnds av krnorna i simd.c.
+**************************************************************************************************/
+#include "half_matrix.h"
+#include "allocator.h"
+#include "simd.h"
+#include "simd_vector.h"
+
+/* Makrodefinitioner: */
+#define HALF_MATRIX_ALIGNMENT 64 /* Minnesjustering i byte fr matrisens minnesblock. */
+
+/**************************************************************************************************
+* half_kernel: Berkningskrna som returnerar skalrprodukten av en rad w i halv precision och
+*              en vektor x i full precision.
+**************************************************************************************************/
+typedef real_t (*half_kernel)(const uint16_t* w, const real_t* x, const size_t size,
+                              const enum half_format format);
+
+/* Statiska funktioner: */
+static uint16_t fp16_from_float(const float x);
+static float fp16_to_float(const uint16_t x);
+static uint16_t bf16_from_float(const float x);
+static float bf16_to_float(const uint16_t x);
+static half_kernel get_kernel(void);
+static real_t dot_scalar(const uint16_t* w, const real_t* x, const size_t size,
+                         const enum half_format format);
+
+#ifdef SIMD_X86
+static real_t dot_avx2(const uint16_t* w, const real_t* x, const size_t size,
+                       const enum half_format format);
+static real_t dot_avx512(const uint16_t* w, const real_t* x, const size_t size,
+                         const enum half_format format);
+#endif
+
+/**************************************************************************************************
+* half_matrix_new: Initierar angiven matris som tom.
+*
+*                  - self: Pekare till matrisen.
+**************************************************************************************************/
+void half_matrix_new(struct half_matrix* self)
+{
+   self->data = 0;
+   self->rows = 0;
+   self->cols = 0;
+   self->stride = 0;
+   self->format = HALF_FORMAT_NONE;
+   return;
+}
+
+/**************************************************************************************************
+* half_matrix_delete: Frigr minne allokerat fr angiven matris.
+*
+*                     - self: Pekare till matrisen.
+**************************************************************************************************/
+void half_matrix_delete(struct half_matrix* self)
+{
+   allocator_aligned_free(self->data);
+   half_matrix_new(self);
+   return;
+}
+
+/**************************************************************************************************
+* half_matrix_narrow: Tilldelar angiven matris innehllet i en matris i full precision,
+*                     avrundat till nrmaste vrde i angivet format. Vid formatet
+*                     HALF_FORMAT_NONE frigrs matrisen. Returnerar 1 ifall minnesallokering
+*                     misslyckas, annars 0.
+*
+*                     - self  : Pekare till matrisen.
+*                     - source: Pekare till matrisen i full precision.
+*                     - format: Format som elementen skall lagras i.
+**************************************************************************************************/
+int half_matrix_narrow(struct half_matrix* self,
+                       const struct double_matrix* source,
+                       const enum half_format format)
+{
+   if (format == HALF_FORMAT_NONE)
+   {
+      half_matrix_delete(self);
+      return 0;
+   }
+
+   if (self->rows != source->rows || self->cols != source->cols || !self->data)
+   {
+      const size_t per_block = HALF_MATRIX_ALIGNMENT / sizeof(uint16_t);
+      const size_t stride = (source->cols + per_block - 1) / per_block * per_block;
+      const size_t size = sizeof(uint16_t) * (stride ? stride : per_block) *
+                          (source->rows ? source->rows : 1);
+      uint16_t* data = (uint16_t*)allocator_aligned_alloc(HALF_MATRIX_ALIGNMENT, size);
+      if (!data) return 1;
+
+      memset(data, 0, size);
+      allocator_aligned_free(self->data);
+      self->data = data;
+      self->rows = source->rows;
+      self->cols = source->cols;
+      self->stride = stride;
+   }
+
+   self->format = format;
+
+   for (size_t i = 0; i < self->rows; ++i)
+   {
+      half_matrix_narrow_row(self, i, double_matrix_row(source, i), self->cols);
+   }
+   return 0;
+}
+
+/**************************************************************************************************
+* half_matrix_narrow_row: Tilldelar de frsta elementen p angiven rad i matrisen angivna vrden
+*                         i full precision, exempelvis efter att motsvarande vikter har justerats
+*                         vid trning.
+*
+*                         - self  : Pekare till matrisen.
+*                         - row   : Index fr raden som skall tilldelas.
+*                         - source: Pekare till vrden i full precision.
+*                         - size  : Antalet element som skall tilldelas.
+**************************************************************************************************/
+void half_matrix_narrow_row(struct half_matrix* self,
+                            const size_t row,
+                            const real_t* source,
+                            const size_t size)
+{
+   uint16_t* destination = self->data + row * self->stride;
+
+   for (size_t i = 0; i < size && i < self->cols; ++i)
+   {
+      destination[i] = half_from_real(source[i], self->format);
+   }
+   return;
+}
+
+/**************************************************************************************************
+* half_matrix_gemv: Berknar y = A * x, dr A utgrs av de frsta kolumnerna i angiven matris.
+*                   Vikterna utkas till full precision i register, medan insignaler samt
+*                   ackumulering hanteras i full precision.
+*
+*                   - self: Pekare till matrisen A.
+*                   - cols: Antalet kolumner i A som anvnds (element i x).
+*                   - x   : Pekare till vektorn som multipliceras.
+*                   - y   : Pekare till resultatvektorn (ett element per rad i A).
+**************************************************************************************************/
+void half_matrix_gemv(const struct half_matrix* self,
+                      const size_t cols,
+                      const real_t* x,
+                      real_t* y)
+{
+   const half_kernel kernel = get_kernel();
+   const size_t size = cols < self->cols ? cols : self->cols;
+
+   for (size_t i = 0; i < self->rows; ++i)
+   {
+      y[i] = kernel(self->data + i * self->stride, x, size, self->format);
+   }
+   return;
+}
+
+/**************************************************************************************************
+* half_from_real: Returnerar angivet flyttal avrundat till nrmaste vrde i angivet format.
+*
+*                 - x     : Flyttalet som skall avrundas.
+*                 - format: Format som flyttalet skall lagras i.
+**************************************************************************************************/
+uint16_t half_from_real(const real_t x,
+                        const enum half_format format)
+{
+   if (format == HALF_FORMAT_BF16) return bf16_from_float((float)x);
+   return fp16_from_float((float)x);
+}
+
+/**************************************************************************************************
+* half_to_real: Returnerar angivet flyttal i halv precision utkat till full precision.
+*
+*               - x     : Flyttalet i halv precision.
+*               - format: Format som flyttalet lagras i.
+**************************************************************************************************/
+real_t half_to_real(const uint16_t x,
+                    const enum half_format format)
+{
+   if (format == HALF_FORMAT_BF16) return bf16_to_float(x);
+   return fp16_to_float(x);
+}
+
+/**************************************************************************************************
+* fp16_from_float: Avrundar angivet flyttal till nrmaste vrde i formatet binary16 (avrundning
+*                  till jmnt vid lika avstnd). Vrden utanfr intervallet avbildas p ondlighet,
+*                  medan sm vrden avbildas p subnormala tal.
+**************************************************************************************************/
+static uint16_t fp16_from_float(const float x)
+{
+   uint32_t bits;
+   memcpy(&bits, &x, sizeof(bits));
+   const uint32_t sign = bits >> 16 & 0x8000;
+   const uint32_t exponent = bits >> 23 & 0xff;
+   uint32_t mantissa = bits & 0x7fffff;
+   const int32_t biased = (int32_t)exponent - 127 + 15;
+
+   if (exponent == 0xff) return (uint16_t)(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+   if (biased >= 0x1f) return (uint16_t)(sign | 0x7c00);
+
+   if (biased <= 0)
+   {
+      if (biased < -10) return (uint16_t)sign;
+      const uint32_t shift = (uint32_t)(14 - biased);
+      mantissa |= 0x800000;
+      uint32_t result = mantissa >> shift;
+      const uint32_t rest = mantissa & ((1u << shift) - 1);
+      const uint32_t halfway = 1u << (shift - 1);
+      if (rest > halfway || (rest == halfway && (result & 1))) result++;
+      return (uint16_t)(sign | result);
+   }
+
+   uint32_t result = (uint32_t)biased << 10 | mantissa >> 13;
+   const uint32_t rest = mantissa & 0x1fff;
+   if (rest > 0x1000 || (rest == 0x1000 && (result & 1))) result++;
+   return (uint16_t)(sign | result);
+}
+
+/**************************************************************************************************
+* fp16_to_float: Returnerar angivet flyttal i formatet binary16 utkat till enkel precision.
+**************************************************************************************************/
+static float fp16_to_float(const uint16_t x)
+{
+   const uint32_t sign = (uint32_t)(x & 0x8000) << 16;
+   uint32_t exponent = x >> 10 & 0x1f;
+   uint32_t mantissa = x & 0x3ff;
+   uint32_t bits;
+   float result;
+
+   if (exponent == 0x1f)
+   {
+      bits = sign | 0x7f800000 | mantissa << 13;
+   }
+   else if (exponent)
+   {
+      bits = sign | (exponent + 112) << 23 | mantissa << 13;
+   }
+   else if (!mantissa)
+   {
+      bits = sign;
+   }
+   else
+   {
+      for (exponent = 113; !(mantissa & 0x400); --exponent)
+      {
+         mantissa <<= 1;
+      }
+      bits = sign | exponent << 23 | (mantissa & 0x3ff) << 13;
+   }
+
+   memcpy(&result, &bits, sizeof(result));
+   return result;
+}
+
+/**************************************************************************************************
+* bf16_from_float: Avrundar angivet flyttal till nrmaste vrde i formatet bf16 (avrundning till
+*                  jmnt vid lika avstnd), vilket motsvarar de vre 16 bitarna i enkel precision.
+**************************************************************************************************/
+static uint16_t bf16_from_float(const float x)
+{
+   uint32_t bits;
+   memcpy(&bits, &x, sizeof(bits));
+   if ((bits & 0x7fffffff) > 0x7f800000) return (uint16_t)(bits >> 16 | 0x40);
+   bits += 0x7fff + (bits >> 16 & 1);
+   return (uint16_t)(bits >> 16);
+}
+
+/**************************************************************************************************
+* bf16_to_float: Returnerar angivet flyttal i formatet bf16 utkat till enkel precision.
+**************************************************************************************************/
+static float bf16_to_float(const uint16_t x)
+{
+   const uint32_t bits = (uint32_t)x << 16;
+   float result;
+   memcpy(&result, &bits, sizeof(result));
+   return result;
+}
+
+/**************************************************************************************************
+* get_kernel: Returnerar berkningskrnan fr den instruktionsuppsttning som anvnds i simd.c.
+*             AVX2-krnan krver dessutom F16C fr omvandling frn binary16.
+**************************************************************************************************/
+static half_kernel get_kernel(void)
+{
+#ifdef SIMD_X86
+   const enum simd_isa isa = simd_get_isa();
+   if (isa == SIMD_ISA_AVX512) return &dot_avx512;
+   if (isa == SIMD_ISA_AVX2 && __builtin_cpu_supports("f16c")) return &dot_avx2;
+#endif
+   return &dot_scalar;
+}
+
+/**************************************************************************************************
+* dot_scalar: Portabel berkningskrna som utkar ett element t gngen.
+**************************************************************************************************/
+static real_t dot_scalar(const uint16_t* w, const real_t* x, const size_t size,
+                         const enum half_format format)
+{
+   real_t sum = 0;
+
+   for (size_t i = 0; i < size; ++i)
+   {
+      sum += half_to_real(w[i], format) * x[i];
+   }
+   return sum;
+}
+
+#ifdef SIMD_X86
+
+/**************************************************************************************************
+* widen_avx2: Lser tta element i halv precision och returnerar dessa i enkel precision, dr
+*             binary16 omvandlas via F16C (vcvtph2ps) och bf16 via skiftning av 16 bitar.
+**************************************************************************************************/
+__attribute__((target("avx2,fma,f16c")))
+static inline __m256 widen_avx2(const uint16_t* w, const enum half_format format)
+{
+   const __m128i data = _mm_loadu_si128((const __m128i*)w);
+   if (format == HALF_FORMAT_FP16) return _mm256_cvtph_ps(data);
+   return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(data), 16));
+}
+
+/**************************************************************************************************
+* dot_avx2: Berkningskrna fr 256-bitars vektorer med FMA, dr sexton vikter utkas per varv.
+*           Vid dubbel precision delas de utkade vikterna upp i tv vektorer.
+**************************************************************************************************/
+__attribute__((target("avx2,fma,f16c")))
+static real_t dot_avx2(const uint16_t* w, const real_t* x, const size_t size,
+                       const enum half_format format)
+{
+   V256 sum0 = v256_zero();
+   V256 sum1 = v256_zero();
+   size_t i = 0;
+
+   for (; i + 16 <= size; i += 16)
+   {
+      const __m256 weights0 = widen_avx2(w + i, format);
+      const __m256 weights1 = widen_avx2(w + i + 8, format);
+#ifdef ANN_FLOAT32
+      sum0 = v256_fmadd(weights0, v256_loadu(x + i), sum0);
+      sum1 = v256_fmadd(weights1, v256_loadu(x + i + 8), sum1);
+#else
+      sum0 = v256_fmadd(_mm256_cvtps_pd(_mm256_castps256_ps128(weights0)), v256_loadu(x + i), sum0);
+      sum1 = v256_fmadd(_mm256_cvtps_pd(_mm256_extractf128_ps(weights0, 1)),
+                        v256_loadu(x + i + 4), sum1);
+      sum0 = v256_fmadd(_mm256_cvtps_pd(_mm256_castps256_ps128(weights1)),
+                        v256_loadu(x + i + 8), sum0);
+      sum1 = v256_fmadd(_mm256_cvtps_pd(_mm256_extractf128_ps(weights1, 1)),
+                        v256_loadu(x + i + 12), sum1);
+#endif
+   }
+
+   real_t sum = v256_hsum(v256_add(sum0, sum1));
+
+   for (; i < size; ++i)
+   {
+      sum += half_to_real(w[i], format) * x[i];
+   }
+   return sum;
+}
+
+/**************************************************************************************************
+* widen_avx512: Lser sexton element i halv precision och returnerar dessa i enkel precision.
+**************************************************************************************************/
+__attribute__((target("avx512f")))
+static inline __m512 widen_avx512(const uint16_t* w, const enum half_format format)
+{
+   const __m256i data = _mm256_loadu_si256((const __m256i*)w);
+   if (format == HALF_FORMAT_FP16) return _mm512_cvtph_ps(data);
+   return _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_cvtepu16_epi32(data), 16));
+}
+
+#ifndef ANN_FLOAT32
+
+/**************************************************************************************************
+* lower_avx512, upper_avx512: Returnerar den undre respektive vre halvan av angiven vektor i
+*                             enkel precision utkad till dubbel precision.
+**************************************************************************************************/
+__attribute__((target("avx512f")))
+static inline __m512d lower_avx512(const __m512 x)
+{
+   return _mm512_cvtps_pd(_mm512_castps512_ps256(x));
+}
+
+__attribute__((target("avx512f")))
+static inline __m512d upper_avx512(const __m512 x)
+{
+   return _mm512_cvtps_pd(_mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(x), 1)));
+}
+
+#endif /* ANN_FLOAT32 */
+
+/**************************************************************************************************
+* dot_avx512: Berkningskrna fr 512-bitars vektorer med FMA, dr 32 vikter utkas per varv.
+*             Vid dubbel precision delas de utkade vikterna upp i tv vektorer.
+**************************************************************************************************/
+__attribute__((target("avx512f")))
+static real_t dot_avx512(const uint16_t* w, const real_t* x, const size_t size,
+                         const enum half_format format)
+{
+   V512 sum0 = v512_zero();
+   V512 sum1 = v512_zero();
+   size_t i = 0;
+
+   for (; i + 32 <= size; i += 32)
+   {
+      const __m512 weights0 = widen_avx512(w + i, format);
+      const __m512 weights1 = widen_avx512(w + i + 16, format);
+#ifdef ANN_FLOAT32
+      sum0 = v512_fmadd(weights0, v512_loadu(x + i), sum0);
+      sum1 = v512_fmadd(weights1, v512_loadu(x + i + 16), sum1);
+#else
+      sum0 = v512_fmadd(lower_avx512(weights0), v512_loadu(x + i), sum0);
+      sum1 = v512_fmadd(upper_avx512(weights0), v512_loadu(x + i + 8), sum1);
+      sum0 = v512_fmadd(lower_avx512(weights1), v512_loadu(x + i + 16), sum0);
+      sum1 = v512_fmadd(upper_avx512(weights1), v512_loadu(x + i + 24), sum1);
+#endif
+   }
+
+   real_t sum = v512_reduce_add(v512_add(sum0, sum1));
+
+   for (; i < size; ++i)
+   {
+      sum += half_to_real(w[i], format) * x[i];
+   }
+   return sum;
+}
+
+#endif /* SIMD_X86 */
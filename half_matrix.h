@@ -0,0 +1,61 @@
+/**************************************************************************************************
+* half_matrix.h: Implementering av matriser innehllande flyttal i halv precision (fp16 eller
+*                bf16) via strukten half_matrix samt motsvarande externa funktioner. Matrisen
+*                anvnds som komprimerad kopia av ett dense-lagers vikter vid prediktion, dr
+*                vikterna utkas till full precision i berkningskrnan (via F16C eller AVX-512
+*                dr sdant std finns). Insignaler samt ackumulering sker i full precision,
+*                medan mngden data som lses frn minnet halveras jmfrt med enkel precision
+*                samt kvartas jmfrt med dubbel precision.
+**************************************************************************************************/
+#ifndef HALF_MATRIX_H_
+#define HALF_MATRIX_H_
+
+/* Inkluderingsdirektiv: */
+#include "def.h"
+#include "double_matrix.h"
+
+#include <stdint.h>
+
+/**************************************************************************************************
+* half_format: Format fr flyttal i halv precision.
+**************************************************************************************************/
+enum half_format
+{
+   HALF_FORMAT_NONE, /* Ingen komprimerad kopia, full precision anvnds. */
+   HALF_FORMAT_FP16, /* IEEE 754 binary16 (5 bitar exponent, 10 bitar mantissa). */
+   HALF_FORMAT_BF16  /* Brain float 16 (8 bitar exponent, 7 bitar mantissa). */
+};
+
+/**************************************************************************************************
+* half_matrix: Matris innehllande flyttal i halv precision lagrade radvis i ett enda
+*              sammanhngande minnesblock, dr varje rad startar p en justerad adress.
+**************************************************************************************************/
+struct half_matrix
+{
+   uint16_t* data;          /* Pekare till minnesblocket innehllande matrisens element. */
+   size_t rows;             /* Antalet rader i matrisen. */
+   size_t cols;             /* Antalet kolumner (anvnda element) per rad. */
+   size_t stride;           /* Antalet element mellan brjan p tv efterfljande rader. */
+   enum half_format format; /* Format fr matrisens element. */
+};
+
+/* Externa funktioner: */
+void half_matrix_new(struct half_matrix* self);
+void half_matrix_delete(struct half_matrix* self);
+int half_matrix_narrow(struct half_matrix* self,
+                       const struct double_matrix* source,
+                       const enum half_format format);
+void half_matrix_narrow_row(struct half_matrix* self,
+                            const size_t row,
+                            const real_t* source,
+                            const size_t size);
+void half_matrix_gemv(const struct half_matrix* self,
+                      const size_t cols,
+                      const real_t* x,
+                      real_t* y);
+uint16_t half_from_real(const real_t x,
+                        const enum half_format format);
+real_t half_to_real(const uint16_t x,
+                    const enum half_format format);
+
+#endif /* HALF_MATRIX_H_ */
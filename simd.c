@@ -0,0 +1,618 @@
+/**************************************************************************************************
+* simd.c: Innehller funktionsdefinitioner fr vektoriserade berkningskrnor samt val av
+*         instruktionsuppsttning vid krning. Krnorna fr respektive instruktionsuppsttning
+*         kompileras via attributet target, vilket medfr att hela programmet kan kompileras
+*         utan srskilda flaggor, medan valet av krna sker en gng via CPUID. Krnorna skrivs
+*         via makrona i simd_vector.h och gller drmed bde dubbel och enkel precision.
+**************************************************************************************************/
+#include "simd.h"
+
+#include "simd_vector.h"
+
+/* Makrodefinitioner: */
+#define SIMD_GEMV_ROWS 4 /* Antalet rader som strmmas samtidigt vid transponerad multiplikation. */
+#define SIMD_GEMV_TILE (8192 / sizeof(real_t)) /* Antalet element i y som bearbetas per block. */
+
+/* Statiska funktioner: */
+static void simd_select(const enum simd_isa isa);
+static real_t dot_scalar(const real_t* x, const real_t* y, const size_t size);
+static void axpy_scalar(real_t* y, const real_t a, const real_t* x, const size_t size);
+static void gemv_transposed_scalar(real_t* y, const real_t* a, const size_t rows,
+                                   const size_t cols, const size_t stride, const real_t* x);
+static real_t dot_resolve(const real_t* x, const real_t* y, const size_t size);
+static void axpy_resolve(real_t* y, const real_t a, const real_t* x, const size_t size);
+static void gemv_transposed_resolve(real_t* y, const real_t* a, const size_t rows,
+                                    const size_t cols, const size_t stride, const real_t* x);
+
+#ifdef SIMD_X86
+static real_t dot_sse2(const real_t* x, const real_t* y, const size_t size);
+static void axpy_sse2(real_t* y, const real_t a, const real_t* x, const size_t size);
+static void gemv_transposed_sse2(real_t* y, const real_t* a, const size_t rows,
+                                 const size_t cols, const size_t stride, const real_t* x);
+static real_t dot_avx2(const real_t* x, const real_t* y, const size_t size);
+static void axpy_avx2(real_t* y, const real_t a, const real_t* x, const size_t size);
+static void gemv_transposed_avx2(real_t* y, const real_t* a, const size_t rows,
+                                 const size_t cols, const size_t stride, const real_t* x);
+static real_t dot_avx512(const real_t* x, const real_t* y, const size_t size);
+static void axpy_avx512(real_t* y, const real_t a, const real_t* x, const size_t size);
+static void gemv_transposed_avx512(real_t* y, const real_t* a, const size_t rows,
+                                   const size_t cols, const size_t stride, const real_t* x);
+#endif
+
+/* Statiska variabler: */
+static enum simd_isa current_isa = SIMD_ISA_SCALAR; /* Aktuell instruktionsuppsttning. */
+static bool initialized = false;                    /* Indikerar ifall val har genomfrts. */
+
+/**************************************************************************************************
+* simd_dot: Returnerar skalrprodukten av tv vektorer x och y av angiven storlek.
+*
+*           - x   : Pekare till den frsta vektorn.
+*           - y   : Pekare till den andra vektorn.
+*           - size: Antalet element i respektive vektor.
+**************************************************************************************************/
+real_t (*simd_dot)(const real_t* x,
+                   const real_t* y,
+                   const size_t size) = &dot_resolve;
+
+/**************************************************************************************************
+* simd_axpy: Adderar produkten av skalren a och vektorn x till vektorn y (y += a * x).
+*
+*            - y   : Pekare till den vektor som uppdateras.
+*            - a   : Skalren som x multipliceras med.
+*            - x   : Pekare till den vektor som adderas.
+*            - size: Antalet element i respektive vektor.
+**************************************************************************************************/
+void (*simd_axpy)(real_t* y,
+                  const real_t a,
+                  const real_t* x,
+                  const size_t size) = &axpy_resolve;
+
+/**************************************************************************************************
+* simd_gemv_transposed: Berknar y = A^T * x, dr matrisen A lagras radvis med angivet radsteg.
+*                       Varje element y[i] berknas som summan av x[j] * A[j][i], dr j
+*                       rknas upp i stigande ordning, vilket motsvarar den skalra loopen.
+*                       Matrisen lses radvis, dr fyra rader i taget strmmas sammanhngande
+*                       och adderas till ett block av y som ryms i L1-cacheminnet. Drmed
+*                       undviks kolumnvis lsning ver radsteget, vilket ger konflikter i
+*                       cacheminnet samt uteblivna frhmtningar vid breda lager.
+*
+*                       - y     : Pekare till resultatvektorn (cols element).
+*                       - a     : Pekare till matrisens frsta element.
+*                       - rows  : Antalet rader i matrisen (element i x).
+*                       - cols  : Antalet kolumner som berknas (element i y).
+*                       - stride: Antalet element mellan tv efterfljande rader i matrisen.
+*                       - x     : Pekare till vektorn som multipliceras (rows element).
+**************************************************************************************************/
+void (*simd_gemv_transposed)(real_t* y,
+                             const real_t* a,
+                             const size_t rows,
+                             const size_t cols,
+                             const size_t stride,
+                             const real_t* x) = &gemv_transposed_resolve;
+
+/**************************************************************************************************
+* simd_init: Vljer bsta tillgngliga instruktionsuppsttning via CPUID, frutsatt att val inte
+*            redan har genomfrts. Ifall miljvariabeln ANN_SIMD r satt till en instruktions-
+*            uppsttning som stds av processorn anvnds denna i stllet.
+**************************************************************************************************/
+void simd_init(void)
+{
+   if (initialized) return;
+   enum simd_isa isa = SIMD_ISA_SCALAR;
+
+   if (simd_isa_supported(SIMD_ISA_AVX512)) isa = SIMD_ISA_AVX512;
+   else if (simd_isa_supported(SIMD_ISA_AVX2)) isa = SIMD_ISA_AVX2;
+   else if (simd_isa_supported(SIMD_ISA_SSE2)) isa = SIMD_ISA_SSE2;
+
+   const char* s = getenv("ANN_SIMD");
+
+   if (s)
+   {
+      for (enum simd_isa i = SIMD_ISA_SCALAR; i <= SIMD_ISA_AVX512; ++i)
+      {
+         if (!strcmp(s, simd_isa_name(i)))
+         {
+            if (simd_isa_supported(i)) isa = i;
+            else fprintf(stderr, "ANN_SIMD=%s is not supported by this processor!\n\n", s);
+         }
+      }
+   }
+
+   simd_select(isa);
+   return;
+}
+
+/**************************************************************************************************
+* simd_get_isa: Returnerar den instruktionsuppsttning som anvnds av berkningskrnorna.
+**************************************************************************************************/
+enum simd_isa simd_get_isa(void)
+{
+   simd_init();
+   return current_isa;
+}
+
+/**************************************************************************************************
+* simd_set_isa: Tvingar berkningskrnorna att anvnda angiven instruktionsuppsttning, exempelvis
+*               fr test eller jmfrelse. Returnerar 1 ifall processorn saknar std fr angiven
+*               instruktionsuppsttning, annars 0.
+*
+*               - isa: Den instruktionsuppsttning som skall anvndas.
+**************************************************************************************************/
+int simd_set_isa(const enum simd_isa isa)
+{
+   if (!simd_isa_supported(isa)) return 1;
+   simd_select(isa);
+   return 0;
+}
+
+/**************************************************************************************************
+* simd_isa_supported: Indikerar ifall angiven instruktionsuppsttning stds av processorn samt
+*                     av kompilatorn som programmet har kompilerats med.
+*
+*                     - isa: Den instruktionsuppsttning som skall kontrolleras.
+**************************************************************************************************/
+bool simd_isa_supported(const enum simd_isa isa)
+{
+#ifdef SIMD_X86
+   __builtin_cpu_init();
+   if (isa == SIMD_ISA_SSE2) return __builtin_cpu_supports("sse2");
+   if (isa == SIMD_ISA_AVX2) return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+   if (isa == SIMD_ISA_AVX512) return __builtin_cpu_supports("avx512f");
+#endif
+   return isa == SIMD_ISA_SCALAR;
+}
+
+/**************************************************************************************************
+* simd_isa_name: Returnerar namnet p angiven instruktionsuppsttning, vilket motsvarar de vrden
+*                som accepteras av miljvariabeln ANN_SIMD.
+*
+*                - isa: Aktuell instruktionsuppsttning.
+**************************************************************************************************/
+const char* simd_isa_name(const enum simd_isa isa)
+{
+   if (isa == SIMD_ISA_SSE2) return "sse2";
+   if (isa == SIMD_ISA_AVX2) return "avx2";
+   if (isa == SIMD_ISA_AVX512) return "avx512";
+   return "scalar";
+}
+
+/**************************************************************************************************
+* simd_select: Stter funktionspekarna till berkningskrnorna fr angiven instruktionsuppsttning.
+*              Valet skrivs endast med samma vrden vid samtidiga anrop frn flera trdar.
+*
+*              - isa: Den instruktionsuppsttning som skall anvndas.
+**************************************************************************************************/
+static void simd_select(const enum simd_isa isa)
+{
+   simd_dot = &dot_scalar;
+   simd_axpy = &axpy_scalar;
+   simd_gemv_transposed = &gemv_transposed_scalar;
+
+#ifdef SIMD_X86
+   if (isa == SIMD_ISA_SSE2)
+   {
+      simd_dot = &dot_sse2;
+      simd_axpy = &axpy_sse2;
+      simd_gemv_transposed = &gemv_transposed_sse2;
+   }
+   else if (isa == SIMD_ISA_AVX2)
+   {
+      simd_dot = &dot_avx2;
+      simd_axpy = &axpy_avx2;
+      simd_gemv_transposed = &gemv_transposed_avx2;
+   }
+   else if (isa == SIMD_ISA_AVX512)
+   {
+      simd_dot = &dot_avx512;
+      simd_axpy = &axpy_avx512;
+      simd_gemv_transposed = &gemv_transposed_avx512;
+   }
+#endif
+
+   current_isa = isa;
+   initialized = true;
+   return;
+}
+
+/**************************************************************************************************
+* dot_resolve, axpy_resolve, gemv_transposed_resolve: Startvrden fr funktionspekarna, vilka
+*                                                     genomfr valet av instruktionsuppsttning
+*                                                     vid frsta anrop och sedan vidarebefordrar
+*                                                     anropet till vald berkningskrna.
+**************************************************************************************************/
+static real_t dot_resolve(const real_t* x, const real_t* y, const size_t size)
+{
+   simd_init();
+   return simd_dot(x, y, size);
+}
+
+static void axpy_resolve(real_t* y, const real_t a, const real_t* x, const size_t size)
+{
+   simd_init();
+   simd_axpy(y, a, x, size);
+   return;
+}
+
+static void gemv_transposed_resolve(real_t* y, const real_t* a, const size_t rows,
+                                    const size_t cols, const size_t stride, const real_t* x)
+{
+   simd_init();
+   simd_gemv_transposed(y, a, rows, cols, stride, x);
+   return;
+}
+
+/**************************************************************************************************
+* dot_scalar, axpy_scalar, gemv_transposed_scalar: Portabla skalra berkningskrnor.
+**************************************************************************************************/
+static real_t dot_scalar(const real_t* x, const real_t* y, const size_t size)
+{
+   real_t sum = 0;
+
+   for (size_t i = 0; i < size; ++i)
+   {
+      sum += x[i] * y[i];
+   }
+   return sum;
+}
+
+static void axpy_scalar(real_t* y, const real_t a, const real_t* x, const size_t size)
+{
+   for (size_t i = 0; i < size; ++i)
+   {
+      y[i] += a * x[i];
+   }
+   return;
+}
+
+static void gemv_transposed_scalar(real_t* y, const real_t* a, const size_t rows,
+                                   const size_t cols, const size_t stride, const real_t* x)
+{
+   memset(y, 0, sizeof(real_t) * cols);
+
+   for (size_t j = 0; j < rows; ++j, a += stride)
+   {
+      for (size_t i = 0; i < cols; ++i)
+      {
+         y[i] += x[j] * a[i];
+      }
+   }
+   return;
+}
+
+#ifdef SIMD_X86
+
+/**************************************************************************************************
+* dot_sse2, axpy_sse2, gemv_transposed_sse2: Berkningskrnor fr 128-bitars vektorer (SSE2),
+*                                            som saknar FMA och drmed anvnder separat
+*                                            multiplikation och addition.
+**************************************************************************************************/
+__attribute__((target("sse2")))
+static real_t dot_sse2(const real_t* x, const real_t* y, const size_t size)
+{
+   V128 sum0 = v128_zero();
+   V128 sum1 = v128_zero();
+   size_t i = 0;
+
+   for (; i + 2 * V128_LANES <= size; i += 2 * V128_LANES)
+   {
+      sum0 = v128_add(sum0, v128_mul(v128_loadu(x + i), v128_loadu(y + i)));
+      sum1 = v128_add(sum1, v128_mul(v128_loadu(x + i + V128_LANES),
+                                     v128_loadu(y + i + V128_LANES)));
+   }
+
+   real_t sum = v128_hsum(v128_add(sum0, sum1));
+
+   for (; i < size; ++i)
+   {
+      sum += x[i] * y[i];
+   }
+   return sum;
+}
+
+__attribute__((target("sse2")))
+static void axpy_sse2(real_t* y, const real_t a, const real_t* x, const size_t size)
+{
+   const V128 factor = v128_set1(a);
+   size_t i = 0;
+
+   for (; i + V128_LANES <= size; i += V128_LANES)
+   {
+      v128_storeu(y + i, v128_add(v128_loadu(y + i), v128_mul(factor, v128_loadu(x + i))));
+   }
+
+   for (; i < size; ++i)
+   {
+      y[i] += a * x[i];
+   }
+   return;
+}
+
+__attribute__((target("sse2")))
+static void gemv_transposed_sse2(real_t* y, const real_t* a, const size_t rows,
+                                 const size_t cols, const size_t stride, const real_t* x)
+{
+   const size_t size = cols - cols % V128_LANES;
+   memset(y, 0, sizeof(real_t) * cols);
+
+   for (size_t start = 0; start < size; start += SIMD_GEMV_TILE)
+   {
+      const size_t end = size - start < SIMD_GEMV_TILE ? size : start + SIMD_GEMV_TILE;
+      const real_t* row = a;
+      size_t j = 0;
+
+      for (; j + SIMD_GEMV_ROWS <= rows; j += SIMD_GEMV_ROWS, row += SIMD_GEMV_ROWS * stride)
+      {
+         const V128 x0 = v128_set1(x[j]);
+         const V128 x1 = v128_set1(x[j + 1]);
+         const V128 x2 = v128_set1(x[j + 2]);
+         const V128 x3 = v128_set1(x[j + 3]);
+
+         for (size_t i = start; i < end; i += V128_LANES)
+         {
+            V128 sum = v128_loadu(y + i);
+            sum = v128_add(sum, v128_mul(x0, v128_loadu(row + i)));
+            sum = v128_add(sum, v128_mul(x1, v128_loadu(row + stride + i)));
+            sum = v128_add(sum, v128_mul(x2, v128_loadu(row + 2 * stride + i)));
+            sum = v128_add(sum, v128_mul(x3, v128_loadu(row + 3 * stride + i)));
+            v128_storeu(y + i, sum);
+         }
+      }
+
+      for (; j < rows; ++j, row += stride)
+      {
+         const V128 factor = v128_set1(x[j]);
+
+         for (size_t i = start; i < end; i += V128_LANES)
+         {
+            v128_storeu(y + i, v128_add(v128_loadu(y + i), v128_mul(factor, v128_loadu(row + i))));
+         }
+      }
+   }
+
+   for (size_t j = 0; j < rows; ++j, a += stride)
+   {
+      for (size_t i = size; i < cols; ++i)
+      {
+         y[i] += x[j] * a[i];
+      }
+   }
+   return;
+}
+
+/**************************************************************************************************
+* dot_avx2, axpy_avx2, gemv_transposed_avx2: Berkningskrnor fr 256-bitars vektorer med FMA.
+*                                            Fyra oberoende ackumulatorer anvnds fr att dlja
+*                                            latensen hos FMA-instruktionerna.
+**************************************************************************************************/
+__attribute__((target("avx2,fma")))
+static real_t dot_avx2(const real_t* x, const real_t* y, const size_t size)
+{
+   V256 sum0 = v256_zero();
+   V256 sum1 = v256_zero();
+   V256 sum2 = v256_zero();
+   V256 sum3 = v256_zero();
+   size_t i = 0;
+
+   for (; i + 4 * V256_LANES <= size; i += 4 * V256_LANES)
+   {
+      sum0 = v256_fmadd(v256_loadu(x + i), v256_loadu(y + i), sum0);
+      sum1 = v256_fmadd(v256_loadu(x + i + V256_LANES), v256_loadu(y + i + V256_LANES), sum1);
+      sum2 = v256_fmadd(v256_loadu(x + i + 2 * V256_LANES),
+                        v256_loadu(y + i + 2 * V256_LANES), sum2);
+      sum3 = v256_fmadd(v256_loadu(x + i + 3 * V256_LANES),
+                        v256_loadu(y + i + 3 * V256_LANES), sum3);
+   }
+
+   for (; i + V256_LANES <= size; i += V256_LANES)
+   {
+      sum0 = v256_fmadd(v256_loadu(x + i), v256_loadu(y + i), sum0);
+   }
+
+   real_t sum = v256_hsum(v256_add(v256_add(sum0, sum1), v256_add(sum2, sum3)));
+
+   for (; i < size; ++i)
+   {
+      sum += x[i] * y[i];
+   }
+   return sum;
+}
+
+__attribute__((target("avx2,fma")))
+static void axpy_avx2(real_t* y, const real_t a, const real_t* x, const size_t size)
+{
+   const V256 factor = v256_set1(a);
+   size_t i = 0;
+
+   for (; i + 2 * V256_LANES <= size; i += 2 * V256_LANES)
+   {
+      v256_storeu(y + i, v256_fmadd(factor, v256_loadu(x + i), v256_loadu(y + i)));
+      v256_storeu(y + i + V256_LANES, v256_fmadd(factor, v256_loadu(x + i + V256_LANES),
+                                                 v256_loadu(y + i + V256_LANES)));
+   }
+
+   for (; i + V256_LANES <= size; i += V256_LANES)
+   {
+      v256_storeu(y + i, v256_fmadd(factor, v256_loadu(x + i), v256_loadu(y + i)));
+   }
+
+   for (; i < size; ++i)
+   {
+      y[i] += a * x[i];
+   }
+   return;
+}
+
+__attribute__((target("avx2,fma")))
+static void gemv_transposed_avx2(real_t* y, const real_t* a, const size_t rows,
+                                 const size_t cols, const size_t stride, const real_t* x)
+{
+   const size_t size = cols - cols % V256_LANES;
+   memset(y, 0, sizeof(real_t) * cols);
+
+   for (size_t start = 0; start < size; start += SIMD_GEMV_TILE)
+   {
+      const size_t end = size - start < SIMD_GEMV_TILE ? size : start + SIMD_GEMV_TILE;
+      const real_t* row = a;
+      size_t j = 0;
+
+      for (; j + SIMD_GEMV_ROWS <= rows; j += SIMD_GEMV_ROWS, row += SIMD_GEMV_ROWS * stride)
+      {
+         const V256 x0 = v256_broadcast(x + j);
+         const V256 x1 = v256_broadcast(x + j + 1);
+         const V256 x2 = v256_broadcast(x + j + 2);
+         const V256 x3 = v256_broadcast(x + j + 3);
+
+         for (size_t i = start; i < end; i += V256_LANES)
+         {
+            V256 sum = v256_loadu(y + i);
+            sum = v256_fmadd(x0, v256_loadu(row + i), sum);
+            sum = v256_fmadd(x1, v256_loadu(row + stride + i), sum);
+            sum = v256_fmadd(x2, v256_loadu(row + 2 * stride + i), sum);
+            sum = v256_fmadd(x3, v256_loadu(row + 3 * stride + i), sum);
+            v256_storeu(y + i, sum);
+         }
+      }
+
+      for (; j < rows; ++j, row += stride)
+      {
+         const V256 factor = v256_broadcast(x + j);
+
+         for (size_t i = start; i < end; i += V256_LANES)
+         {
+            v256_storeu(y + i, v256_fmadd(factor, v256_loadu(row + i), v256_loadu(y + i)));
+         }
+      }
+   }
+
+   for (size_t j = 0; j < rows; ++j, a += stride)
+   {
+      for (size_t i = size; i < cols; ++i)
+      {
+         y[i] += x[j] * a[i];
+      }
+   }
+   return;
+}
+
+/**************************************************************************************************
+* dot_avx512, axpy_avx512, gemv_transposed_avx512: Berkningskrnor fr 512-bitars vektorer med
+*                                                  FMA. Resterande element hanteras via maskade
+*                                                  minnesoperationer i stllet fr skalra loopar.
+**************************************************************************************************/
+__attribute__((target("avx512f")))
+static real_t dot_avx512(const real_t* x, const real_t* y, const size_t size)
+{
+   V512 sum0 = v512_zero();
+   V512 sum1 = v512_zero();
+   V512 sum2 = v512_zero();
+   V512 sum3 = v512_zero();
+   size_t i = 0;
+
+   for (; i + 4 * V512_LANES <= size; i += 4 * V512_LANES)
+   {
+      sum0 = v512_fmadd(v512_loadu(x + i), v512_loadu(y + i), sum0);
+      sum1 = v512_fmadd(v512_loadu(x + i + V512_LANES), v512_loadu(y + i + V512_LANES), sum1);
+      sum2 = v512_fmadd(v512_loadu(x + i + 2 * V512_LANES),
+                        v512_loadu(y + i + 2 * V512_LANES), sum2);
+      sum3 = v512_fmadd(v512_loadu(x + i + 3 * V512_LANES),
+                        v512_loadu(y + i + 3 * V512_LANES), sum3);
+   }
+
+   for (; i + V512_LANES <= size; i += V512_LANES)
+   {
+      sum0 = v512_fmadd(v512_loadu(x + i), v512_loadu(y + i), sum0);
+   }
+
+   if (i < size)
+   {
+      const V512_MASK mask = v512_mask(size - i);
+      sum1 = v512_fmadd(v512_maskz_loadu(mask, x + i), v512_maskz_loadu(mask, y + i), sum1);
+   }
+
+   return v512_reduce_add(v512_add(v512_add(sum0, sum1), v512_add(sum2, sum3)));
+}
+
+__attribute__((target("avx512f")))
+static void axpy_avx512(real_t* y, const real_t a, const real_t* x, const size_t size)
+{
+   const V512 factor = v512_set1(a);
+   size_t i = 0;
+
+   for (; i + V512_LANES <= size; i += V512_LANES)
+   {
+      v512_storeu(y + i, v512_fmadd(factor, v512_loadu(x + i), v512_loadu(y + i)));
+   }
+
+   if (i < size)
+   {
+      const V512_MASK mask = v512_mask(size - i);
+      const V512 result = v512_fmadd(factor, v512_maskz_loadu(mask, x + i),
+                                     v512_maskz_loadu(mask, y + i));
+      v512_mask_storeu(y + i, mask, result);
+   }
+   return;
+}
+
+__attribute__((target("avx512f")))
+static void gemv_transposed_avx512(real_t* y, const real_t* a, const size_t rows,
+                                   const size_t cols, const size_t stride, const real_t* x)
+{
+   memset(y, 0, sizeof(real_t) * cols);
+
+   for (size_t start = 0; start < cols; start += SIMD_GEMV_TILE)
+   {
+      const size_t end = cols - start < SIMD_GEMV_TILE ? cols : start + SIMD_GEMV_TILE;
+      const size_t last = end - (end - start) % V512_LANES;
+      const V512_MASK mask = v512_mask(end - last);
+      const real_t* row = a;
+      size_t j = 0;
+
+      for (; j + SIMD_GEMV_ROWS <= rows; j += SIMD_GEMV_ROWS, row += SIMD_GEMV_ROWS * stride)
+      {
+         const V512 x0 = v512_set1(x[j]);
+         const V512 x1 = v512_set1(x[j + 1]);
+         const V512 x2 = v512_set1(x[j + 2]);
+         const V512 x3 = v512_set1(x[j + 3]);
+
+         for (size_t i = start; i < last; i += V512_LANES)
+         {
+            V512 sum = v512_loadu(y + i);
+            sum = v512_fmadd(x0, v512_loadu(row + i), sum);
+            sum = v512_fmadd(x1, v512_loadu(row + stride + i), sum);
+            sum = v512_fmadd(x2, v512_loadu(row + 2 * stride + i), sum);
+            sum = v512_fmadd(x3, v512_loadu(row + 3 * stride + i), sum);
+            v512_storeu(y + i, sum);
+         }
+
+         if (last < end)
+         {
+            V512 sum = v512_maskz_loadu(mask, y + last);
+            sum = v512_fmadd(x0, v512_maskz_loadu(mask, row + last), sum);
+            sum = v512_fmadd(x1, v512_maskz_loadu(mask, row + stride + last), sum);
+            sum = v512_fmadd(x2, v512_maskz_loadu(mask, row + 2 * stride + last), sum);
+            sum = v512_fmadd(x3, v512_maskz_loadu(mask, row + 3 * stride + last), sum);
+            v512_mask_storeu(y + last, mask, sum);
+         }
+      }
+
+      for (; j < rows; ++j, row += stride)
+      {
+         const V512 factor = v512_set1(x[j]);
+
+         for (size_t i = start; i < last; i += V512_LANES)
+         {
+            v512_storeu(y + i, v512_fmadd(factor, v512_loadu(row + i), v512_loadu(y + i)));
+         }
+
+         if (last < end)
+         {
+            const V512 result = v512_fmadd(factor, v512_maskz_loadu(mask, row + last),
+                                           v512_maskz_loadu(mask, y + last));
+            v512_mask_storeu(y + last, mask, result);
+         }
+      }
+   }
+   return;
+}
+
+#endif /* SIMD_X86 */
@@ -0,0 +1,47 @@
+/**************************************************************************************************
+* simd.h: Innehller vektoriserade berkningskrnor (SSE2, AVX2 samt AVX-512) fr de inre
+*         looparna i dense-lager. Bsta tillgngliga instruktionsuppsttning vljs en gng vid
+*         frsta anrop via CPUID, men kan tvingas via funktionen simd_set_isa eller via
+*         miljvariabeln ANN_SIMD (scalar, sse2, avx2 eller avx512), exempelvis vid test.
+*         En portabel skalr implementering anvnds p plattformar som saknar std.
+**************************************************************************************************/
+#ifndef SIMD_H_
+#define SIMD_H_
+
+/* Inkluderingsdirektiv: */
+#include "def.h"
+
+/**************************************************************************************************
+* simd_isa: Instruktionsuppsttningar som berkningskrnorna kan implementeras med.
+**************************************************************************************************/
+enum simd_isa
+{
+   SIMD_ISA_SCALAR, /* Portabel skalr implementering. */
+   SIMD_ISA_SSE2,   /* 128-bitars vektorer. */
+   SIMD_ISA_AVX2,   /* 256-bitars vektorer med FMA. */
+   SIMD_ISA_AVX512  /* 512-bitars vektorer med FMA. */
+};
+
+/* Externa funktioner: */
+void simd_init(void);
+enum simd_isa simd_get_isa(void);
+int simd_set_isa(const enum simd_isa isa);
+bool simd_isa_supported(const enum simd_isa isa);
+const char* simd_isa_name(const enum simd_isa isa);
+
+/* Funktionspekare: */
+extern real_t (*simd_dot)(const real_t* x,
+                          const real_t* y,
+                          const size_t size);
+extern void (*simd_axpy)(real_t* y,
+                         const real_t a,
+                         const real_t* x,
+                         const size_t size);
+extern void (*simd_gemv_transposed)(real_t* y,
+                                    const real_t* a,
+                                    const size_t rows,
+                                    const size_t cols,
+                                    const size_t stride,
+                                    const real_t* x);
+
+#endif /* SIMD_H_ */
@@ -0,0 +1,211 @@
+/**************************************************************************************************
+* simd_vector.h: Interna makron fr vektoroperationer p flyttalstypen real_t, vilka anvnds
+*                av berkningskrnorna fr respektive instruktionsuppsttning. Makrona verstts
+*                till motsvarande intrinsics fr dubbel eller enkel precision beroende p ifall
+*                makrot ANN_FLOAT32 r definierat, vilket medfr att varje krna endast behver
+*                skrivas en gng. Antalet element per vektor uttrycks via makrona V128_LANES,
+*                V256_LANES samt V512_LANES. Makrona fr endast anvndas i funktioner som
+*                kompileras fr motsvarande instruktionsuppsttning via attributet target.
+*                Makrona fr gather samt scatter lser ett 32-bitars heltalsindex per element
+*                frn angiven adress.
+**************************************************************************************************/
+#ifndef SIMD_VECTOR_H_
+#define SIMD_VECTOR_H_
+
+/* Inkluderingsdirektiv: */
+#include "def.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_X86
+#include <immintrin.h>
+
+#ifdef ANN_FLOAT32
+
+/* Makrodefinitioner fr enkel precision: */
+#define V128 __m128
+#define V128_LANES 4
+#define v128_zero _mm_setzero_ps
+#define v128_set1 _mm_set1_ps
+#define v128_load _mm_load_ps
+#define v128_loadu _mm_loadu_ps
+#define v128_storeu _mm_storeu_ps
+#define v128_add _mm_add_ps
+#define v128_mul _mm_mul_ps
+
+#define V256 __m256
+#define V256_LANES 8
+#define v256_zero _mm256_setzero_ps
+#define v256_set1 _mm256_set1_ps
+#define v256_broadcast _mm256_broadcast_ss
+#define v256_load _mm256_load_ps
+#define v256_loadu _mm256_loadu_ps
+#define v256_storeu _mm256_storeu_ps
+#define v256_add _mm256_add_ps
+#define v256_mul _mm256_mul_ps
+#define v256_fmadd _mm256_fmadd_ps
+#define v256_fnmadd _mm256_fnmadd_ps
+#define v256_sub _mm256_sub_ps
+#define v256_div _mm256_div_ps
+#define v256_max _mm256_max_ps
+#define v256_min _mm256_min_ps
+#define v256_round(x) _mm256_round_ps(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)
+#define v256_cmpgt(x, y) _mm256_cmp_ps(x, y, _CMP_GT_OQ)
+#define v256_blendv _mm256_blendv_ps
+#define v256_gather(base, index) \
+   _mm256_i32gather_ps(base, _mm256_loadu_si256((const __m256i*)(index)), 4)
+
+#define V512 __m512
+#define V512_MASK __mmask16
+#define V512_LANES 16
+#define v512_zero _mm512_setzero_ps
+#define v512_set1 _mm512_set1_ps
+#define v512_load _mm512_load_ps
+#define v512_loadu _mm512_loadu_ps
+#define v512_storeu _mm512_storeu_ps
+#define v512_maskz_loadu _mm512_maskz_loadu_ps
+#define v512_mask_storeu _mm512_mask_storeu_ps
+#define v512_add _mm512_add_ps
+#define v512_mul _mm512_mul_ps
+#define v512_fmadd _mm512_fmadd_ps
+#define v512_fnmadd _mm512_fnmadd_ps
+#define v512_sub _mm512_sub_ps
+#define v512_div _mm512_div_ps
+#define v512_max _mm512_max_ps
+#define v512_min _mm512_min_ps
+#define v512_round(x) _mm512_roundscale_ps(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)
+#define v512_scalef _mm512_scalef_ps
+#define v512_cmpgt_mask(x, y) _mm512_cmp_ps_mask(x, y, _CMP_GT_OQ)
+#define v512_mask_blend _mm512_mask_blend_ps
+#define v512_reduce_add _mm512_reduce_add_ps
+#define v512_gather(base, index) _mm512_i32gather_ps(_mm512_loadu_si512(index), base, 4)
+#define v512_scatter(base, index, x) _mm512_i32scatter_ps(base, _mm512_loadu_si512(index), x, 4)
+
+#else
+
+/* Makrodefinitioner fr dubbel precision: */
+#define V128 __m128d
+#define V128_LANES 2
+#define v128_zero _mm_setzero_pd
+#define v128_set1 _mm_set1_pd
+#define v128_load _mm_load_pd
+#define v128_loadu _mm_loadu_pd
+#define v128_storeu _mm_storeu_pd
+#define v128_add _mm_add_pd
+#define v128_mul _mm_mul_pd
+
+#define V256 __m256d
+#define V256_LANES 4
+#define v256_zero _mm256_setzero_pd
+#define v256_set1 _mm256_set1_pd
+#define v256_broadcast _mm256_broadcast_sd
+#define v256_load _mm256_load_pd
+#define v256_loadu _mm256_loadu_pd
+#define v256_storeu _mm256_storeu_pd
+#define v256_add _mm256_add_pd
+#define v256_mul _mm256_mul_pd
+#define v256_fmadd _mm256_fmadd_pd
+#define v256_fnmadd _mm256_fnmadd_pd
+#define v256_sub _mm256_sub_pd
+#define v256_div _mm256_div_pd
+#define v256_max _mm256_max_pd
+#define v256_min _mm256_min_pd
+#define v256_round(x) _mm256_round_pd(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)
+#define v256_cmpgt(x, y) _mm256_cmp_pd(x, y, _CMP_GT_OQ)
+#define v256_blendv _mm256_blendv_pd
+#define v256_gather(base, index) \
+   _mm256_i32gather_pd(base, _mm_loadu_si128((const __m128i*)(index)), 8)
+
+#define V512 __m512d
+#define V512_MASK __mmask8
+#define V512_LANES 8
+#define v512_zero _mm512_setzero_pd
+#define v512_set1 _mm512_set1_pd
+#define v512_load _mm512_load_pd
+#define v512_loadu _mm512_loadu_pd
+#define v512_storeu _mm512_storeu_pd
+#define v512_maskz_loadu _mm512_maskz_loadu_pd
+#define v512_mask_storeu _mm512_mask_storeu_pd
+#define v512_add _mm512_add_pd
+#define v512_mul _mm512_mul_pd
+#define v512_fmadd _mm512_fmadd_pd
+#define v512_fnmadd _mm512_fnmadd_pd
+#define v512_sub _mm512_sub_pd
+#define v512_div _mm512_div_pd
+#define v512_max _mm512_max_pd
+#define v512_min _mm512_min_pd
+#define v512_round(x) _mm512_roundscale_pd(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)
+#define v512_scalef _mm512_scalef_pd
+#define v512_cmpgt_mask(x, y) _mm512_cmp_pd_mask(x, y, _CMP_GT_OQ)
+#define v512_mask_blend _mm512_mask_blend_pd
+#define v512_reduce_add _mm512_reduce_add_pd
+#define v512_gather(base, index) \
+   _mm512_i32gather_pd(_mm256_loadu_si256((const __m256i*)(index)), base, 8)
+#define v512_scatter(base, index, x) \
+   _mm512_i32scatter_pd(base, _mm256_loadu_si256((const __m256i*)(index)), x, 8)
+
+#endif /* ANN_FLOAT32 */
+
+/* Makro fr mask som omfattar de frsta n elementen (n < V512_LANES) i en 512-bitars vektor: */
+#define v512_mask(n) ((V512_MASK)((1u << (n)) - 1))
+
+/**************************************************************************************************
+* v128_hsum: Returnerar summan av samtliga element i angiven 128-bitars vektor.
+*
+*            - x: Vektorn vars element skall summeras.
+**************************************************************************************************/
+__attribute__((target("sse2")))
+static inline real_t v128_hsum(const V128 x)
+{
+   real_t elements[V128_LANES];
+   real_t sum = 0;
+   v128_storeu(elements, x);
+
+   for (size_t i = 0; i < V128_LANES; ++i)
+   {
+      sum += elements[i];
+   }
+   return sum;
+}
+
+/**************************************************************************************************
+* v256_hsum: Returnerar summan av samtliga element i angiven 256-bitars vektor.
+*
+*            - x: Vektorn vars element skall summeras.
+**************************************************************************************************/
+__attribute__((target("avx2,fma")))
+static inline real_t v256_hsum(const V256 x)
+{
+   real_t elements[V256_LANES];
+   real_t sum = 0;
+   v256_storeu(elements, x);
+
+   for (size_t i = 0; i < V256_LANES; ++i)
+   {
+      sum += elements[i];
+   }
+   return sum;
+}
+
+/**************************************************************************************************
+* v256_pow2n: Returnerar 2^n fr varje element i angiven 256-bitars vektor, dr elementen mste
+*             vara heltal inom exponentomrdet fr normaliserade flyttal. Resultatet skapas
+*             direkt via exponentfltet, eftersom AVX2 saknar motsvarighet till vscalefpd.
+*
+*             - n: Vektor innehllande heltalsexponenter lagrade som flyttal.
+**************************************************************************************************/
+__attribute__((target("avx2,fma")))
+static inline V256 v256_pow2n(const V256 n)
+{
+#ifdef ANN_FLOAT32
+   const __m256i exponent = _mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127));
+   return _mm256_castsi256_ps(_mm256_slli_epi32(exponent, 23));
+#else
+   const __m256i exponent = _mm256_add_epi64(_mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(n)),
+                                              _mm256_set1_epi64x(1023));
+   return _mm256_castsi256_pd(_mm256_slli_epi64(exponent, 52));
+#endif /* ANN_FLOAT32 */
+}
+
+#endif /* SIMD_X86 */
+
+#endif /* SIMD_VECTOR_H_ */
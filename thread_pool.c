@@ -0,0 +1,226 @@
+/**************************************************************************************************
+* thread_pool.c: Innehller funktionsdefinitioner fr den bestndiga trdpoolen. Trdarna vntar
+*                p ett villkor tills en ny uppgift publiceras (via ett kat generationsnummer),
+*                bearbetar sitt delintervall och meddelar drefter anropande trd.
+**************************************************************************************************/
+#include "thread_pool.h"
+#include "simd.h"
+
+#include <pthread.h>
+#include <unistd.h>
+
+/* Statiska funktioner: */
+static void thread_pool_init(void);
+static void* thread_pool_worker(void* arg);
+static void thread_pool_stop(void);
+static int thread_pool_start(const size_t num_threads);
+
+/* Statiska variabler: */
+static pthread_once_t once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t owner = PTHREAD_MUTEX_INITIALIZER; /* Hlls av trden som anvnder poolen. */
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER; /* Skyddar uppgiften samt rknarna. */
+static pthread_cond_t start = PTHREAD_COND_INITIALIZER;   /* Signaleras vid ny uppgift. */
+static pthread_cond_t done = PTHREAD_COND_INITIALIZER;    /* Signaleras nr sista trden r klar. */
+static pthread_t* workers = 0;   /* Flt innehllande poolens trdar (utver anropande trd). */
+static size_t num_workers = 0;   /* Antalet trdar i poolen (utver anropande trd). */
+static size_t generation = 0;    /* Rknare som kas fr varje publicerad uppgift. */
+static size_t pending = 0;       /* Antalet trdar som nnu inte har slutfrt uppgiften. */
+static bool stop = false;        /* Indikerar ifall trdarna skall avslutas. */
+static void* task_arg = 0;       /* Argument som passeras till uppgiftens funktion. */
+static size_t task_size = 0;     /* Antalet index i uppgiftens intervall. */
+static size_t task_chunk = 0;    /* Antalet index per delintervall. */
+static void (*task_function)(void* arg, const size_t begin, const size_t end) = 0;
+
+/**************************************************************************************************
+* thread_pool_run: Anropar angiven funktion fr samtliga index i intervallet [0, size), uppdelat
+*                  i ett delintervall per trd. Delintervallens grnser avrundas uppt till en
+*                  multipel av angiven justering, s att exempelvis utdata fr olika trdar inte
+*                  delar cacheminnesrad. Anropande trd bearbetar det frsta delintervallet och
+*                  funktionen returnerar frst nr samtliga delintervall har bearbetats. Ifall
+*                  intervallet inte rcker till mer n ett delintervall, poolen saknar trdar
+*                  eller redan anvnds (exempelvis av en annan trd) anropas funktionen en gng
+*                  fr hela intervallet.
+*
+*                  - size     : Antalet index i intervallet.
+*                  - alignment: Multipel som delintervallens grnser avrundas till (minst 1).
+*                  - function : Funktion som bearbetar delintervallet [begin, end).
+*                  - arg      : Argument som passeras till funktionen.
+**************************************************************************************************/
+void thread_pool_run(const size_t size,
+                     const size_t alignment,
+                     void (*function)(void* arg, const size_t begin, const size_t end),
+                     void* arg)
+{
+   const size_t multiple = alignment ? alignment : 1;
+   pthread_once(&once, &thread_pool_init);
+
+   if (size <= multiple || pthread_mutex_trylock(&owner))
+   {
+      function(arg, 0, size);
+      return;
+   }
+   else if (!num_workers)
+   {
+      pthread_mutex_unlock(&owner);
+      function(arg, 0, size);
+      return;
+   }
+
+   size_t chunk = (size + num_workers) / (num_workers + 1);
+   chunk = (chunk + multiple - 1) / multiple * multiple;
+
+   pthread_mutex_lock(&mutex);
+   task_function = function;
+   task_arg = arg;
+   task_size = size;
+   task_chunk = chunk;
+   pending = num_workers;
+   generation++;
+   pthread_cond_broadcast(&start);
+   pthread_mutex_unlock(&mutex);
+
+   function(arg, 0, chunk < size ? chunk : size);
+
+   pthread_mutex_lock(&mutex);
+   while (pending) pthread_cond_wait(&done, &mutex);
+   pthread_mutex_unlock(&mutex);
+   pthread_mutex_unlock(&owner);
+   return;
+}
+
+/**************************************************************************************************
+* thread_pool_num_threads: Returnerar antalet trdar som delar p varje uppgift, inklusive
+*                          anropande trd.
+**************************************************************************************************/
+size_t thread_pool_num_threads(void)
+{
+   pthread_once(&once, &thread_pool_init);
+   return num_workers + 1;
+}
+
+/**************************************************************************************************
+* thread_pool_set_num_threads: ndrar antalet trdar som delar p varje uppgift, inklusive
+*                              anropande trd, dr befintliga trdar avslutas och nya skapas.
+*                              Vid en trd avslutas samtliga trdar i poolen och uppgifter
+*                              bearbetas enbart av anropande trd. Vid noll trdar anvnds en
+*                              trd per tillgnglig processorkrna. Funktionen vntar tills
+*                              eventuell pgende uppgift har slutfrts. Returnerar 1 ifall
+*                              minnesallokering eller skapande av trdar misslyckas, varvid
+*                              poolen innehller de trdar som hann skapas, annars 0.
+*
+*                              - num_threads: Antalet trdar per uppgift (0 = antalet krnor).
+**************************************************************************************************/
+int thread_pool_set_num_threads(size_t num_threads)
+{
+   if (!num_threads)
+   {
+      const long num_cores = sysconf(_SC_NPROCESSORS_ONLN);
+      num_threads = num_cores > 0 ? (size_t)num_cores : 1;
+   }
+
+   pthread_once(&once, &thread_pool_init);
+   pthread_mutex_lock(&owner);
+   thread_pool_stop();
+   const int status = thread_pool_start(num_threads - 1);
+   pthread_mutex_unlock(&owner);
+   return status;
+}
+
+/**************************************************************************************************
+* thread_pool_init: Skapar poolens trdar vid frsta anvndning, en per tillgnglig
+*                   processorkrna utver anropande trd, eller enligt miljvariabeln
+*                   ANN_NUM_THREADS ifall denna r satt. Krnorna i simd.c vljs innan
+*                   trdarna skapas, s att valet inte sker samtidigt frn flera trdar.
+**************************************************************************************************/
+static void thread_pool_init(void)
+{
+   const char* value = getenv("ANN_NUM_THREADS");
+   const long num_threads = value ? atol(value) : sysconf(_SC_NPROCESSORS_ONLN);
+   simd_init();
+   thread_pool_start(num_threads > 1 ? (size_t)(num_threads - 1) : 0);
+   return;
+}
+
+/**************************************************************************************************
+* thread_pool_worker: Startfunktion fr poolens trdar. Trden vntar tills en ny uppgift har
+*                     publicerats, bearbetar sitt delintervall (ifall sdant finns) och
+*                     meddelar drefter anropande trd, tills trden beordras att avslutas.
+*
+*                     - arg: Trdens index i poolen, dr index 0 utgr frsta trden utver
+*                            anropande trd.
+**************************************************************************************************/
+static void* thread_pool_worker(void* arg)
+{
+   const size_t index = (size_t)arg;
+   size_t current = 0;
+
+   pthread_mutex_lock(&mutex);
+
+   while (true)
+   {
+      while (!stop && generation == current) pthread_cond_wait(&start, &mutex);
+      if (stop) break;
+
+      void (*function)(void* arg, const size_t begin, const size_t end) = task_function;
+      void* task = task_arg;
+      const size_t begin = (index + 1) * task_chunk;
+      const size_t end = begin + task_chunk < task_size ? begin + task_chunk : task_size;
+      current = generation;
+      pthread_mutex_unlock(&mutex);
+
+      if (begin < end) function(task, begin, end);
+
+      pthread_mutex_lock(&mutex);
+      if (--pending == 0) pthread_cond_signal(&done);
+   }
+
+   pthread_mutex_unlock(&mutex);
+   return 0;
+}
+
+/**************************************************************************************************
+* thread_pool_stop: Avslutar samtliga trdar i poolen. Anropande trd mste hlla lset owner,
+*                   s att ingen uppgift pgr.
+**************************************************************************************************/
+static void thread_pool_stop(void)
+{
+   pthread_mutex_lock(&mutex);
+   stop = true;
+   pthread_cond_broadcast(&start);
+   pthread_mutex_unlock(&mutex);
+
+   for (size_t i = 0; i < num_workers; ++i)
+   {
+      pthread_join(workers[i], 0);
+   }
+
+   free(workers);
+   workers = 0;
+   num_workers = 0;
+   stop = false;
+   generation = 0;
+   return;
+}
+
+/**************************************************************************************************
+* thread_pool_start: Skapar angivet antal trdar i poolen, som d inte fr innehlla ngra
+*                    trdar. Returnerar 1 ifall minnesallokering eller skapande av trdar
+*                    misslyckas, varvid poolen innehller de trdar som hann skapas, annars 0.
+*
+*                    - num_threads: Antalet trdar som skall skapas.
+**************************************************************************************************/
+static int thread_pool_start(const size_t num_threads)
+{
+   if (!num_threads) return 0;
+   workers = (pthread_t*)malloc(sizeof(pthread_t) * num_threads);
+   if (!workers) return 1;
+
+   for (; num_workers < num_threads; ++num_workers)
+   {
+      if (pthread_create(&workers[num_workers], 0, &thread_pool_worker, (void*)num_workers))
+      {
+         return 1;
+      }
+   }
+   return 0;
+}
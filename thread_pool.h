@@ -0,0 +1,29 @@
+/**************************************************************************************************
+* thread_pool.h: Innehller funktionalitet fr en bestndig trdpool, som delar upp ett
+*                indexintervall (exempelvis noderna i ett dense-lager) i delintervall som
+*                bearbetas parallellt. Trdarna skapas vid frsta anrop och lever sedan kvar
+*                mellan anropen, dr de vntar p nsta uppgift, vilket medfr att enbart
+*                vckning av trdarna tillkommer per anrop. Anropande trd bearbetar sjlv det
+*                frsta delintervallet. Antalet trdar motsvarar default antalet processorkrnor,
+*                men kan ndras via miljvariabeln ANN_NUM_THREADS eller via anrop av funktionen
+*                thread_pool_set_num_threads. Ifall poolen redan anvnds av en annan trd, eller
+*                vid anrop inifrn en uppgift, bearbetas hela intervallet av anropande trd.
+**************************************************************************************************/
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+/* Inkluderingsdirektiv: */
+#include "def.h"
+
+/* Makrodefinitioner: */
+#define THREAD_POOL_CACHE_LINE 64 /* Storleken p en cacheminnesrad i byte. */
+
+/* Externa funktioner: */
+void thread_pool_run(const size_t size,
+                     const size_t alignment,
+                     void (*function)(void* arg, const size_t begin, const size_t end),
+                     void* arg);
+size_t thread_pool_num_threads(void);
+int thread_pool_set_num_threads(size_t num_threads);
+
+#endif /* THREAD_POOL_H_ */
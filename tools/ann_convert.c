@@ -0,0 +1,65 @@
+/**************************************************************************************************
+* ann_convert.c: Konverterar trningsdata frn textformatet som lses av funktionen
+*                training_data_load till det binra formatet som mappas via funktionen
+*                training_data_map, se strukten training_data_header. Textfilen behver drmed
+*                enbart tolkas en gng, varefter efterfljande krningar kan mappa den binra
+*                filen direkt utan att lsa in eller kopiera talen.
+*
+*                Flyttalen lagras som real_t, s verktyget mste kompileras med samma
+*                flyttalstyp (exempelvis -DANN_FLOAT32) som programmet som skall mappa filen.
+*
+*                Kompilera frn projektets rotkatalog med fljande kommando:
+*                $ gcc -O2 -I. tools/ann_convert.c $(ls *.c | grep -v main.c) -o ann_convert -lm -pthread
+*
+*                Kr sedan programmet, exempelvis fr tre insignaler samt en utsignal per rad:
+*                $ ./ann_convert -i 3 -o 1 data.txt data.bin
+**************************************************************************************************/
+#include "training_data.h"
+
+#include <unistd.h>
+
+int main(int argc, char** argv)
+{
+   size_t num_inputs = 0, num_outputs = 0;
+   int option;
+
+   while ((option = getopt(argc, argv, "i:o:")) != -1)
+   {
+      switch (option)
+      {
+         case 'i': num_inputs = (size_t)atol(optarg); break;
+         case 'o': num_outputs = (size_t)atol(optarg); break;
+         default: num_inputs = 0; break;
+      }
+   }
+
+   if (!num_inputs || !num_outputs || argc - optind != 2)
+   {
+      fprintf(stderr, "Usage: %s -i inputs -o outputs source.txt target.bin\n", argv[0]);
+      return 1;
+   }
+
+   struct training_data data;
+   struct training_data_stats stats;
+   training_data_new(&data, num_inputs, num_outputs);
+
+   if (training_data_load_stats(&data, argv[optind], &stats))
+   {
+      training_data_delete(&data);
+      return 1;
+   }
+
+   training_data_print_stats(&stats, stdout);
+
+   if (training_data_save(&data, argv[optind + 1]))
+   {
+      fprintf(stderr, "Could not write training data to %s!\n", argv[optind + 1]);
+      training_data_delete(&data);
+      return 1;
+   }
+
+   printf("Wrote %zu rows (%zu inputs, %zu outputs, %zu-byte values) to %s.\n", data.sets,
+          num_inputs, num_outputs, sizeof(real_t), argv[optind + 1]);
+   training_data_delete(&data);
+   return 0;
+}
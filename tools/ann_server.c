@@ -0,0 +1,731 @@
+/**************************************************************************************************
+* ann_server.c: Lokal inferensserver, som tillhandahller ett trnat neuralt ntverk via en
+*               UNIX-domnsocket. Frfrgningar som anlnder inom ett valbart tidsfnster
+*               samlas ihop till en batch (upp till en maximal storlek), som predikteras via ett
+*               enda anrop av ann_predict_batch_ws. Drmed lses varje viktmatris en gng per batch
+*               i stllet fr en gng per frfrgan, medan tidsfnstret begrnsar den extra
+*               frdrjning som batchningen medfr. Lager med glesa vikter eller vikter i halv
+*               precision (exempelvis i en modell inlst via -m) berknas dock en frfrgan t
+*               gngen via samma berkningskrnor som ann_predict. Servern skriver regelbundet ut
+*               genomstrmning (frfrgningar per sekund), frdrjning (median samt 99:e
+*               percentil, frn att en frfrgan har tagits emot till att svaret har skickats)
+*               samt genomsnittlig batchstorlek.
+*
+*               Ntverket skapas med angiven topologi och trnas med angiven trningsdata vid
+*               start, varefter det kan sparas som en modellfil (-o). Alternativt mappas en
+*               tidigare sparad modellfil (-m), varvid servern r redo inom millisekunder och
+*               ingen trning sker. Klienter ansluter till socketen och skickar frfrgningar
+*               bestende av ntverkets insignaler som flyttal (real_t) i maskinens byteordning.
+*               Fr varje frfrgan skickas ntverkets utsignaler tillbaka i samma format, i
+*               samma ordning som frfrgningarna skickades. En klient kan skicka flera
+*               frfrgningar utan att invnta svaren.
+*
+*               Kompilera frn projektets rotkatalog med fljande kommando:
+*               $ gcc -O2 -I. tools/ann_server.c $(ls *.c | grep -v main.c) -o ann_server -lm -pthread
+*
+*               Kr sedan programmet, exempelvis med ett tidsfnster p 200 us samt hgst 32
+*               frfrgningar per batch:
+*               $ ./ann_server -s /tmp/ann.sock -d data.txt -n 3,4,3,3,1 -w 200 -b 32 -o model.bin
+*
+*               Vid efterfljande start kan den sparade modellen anvndas direkt:
+*               $ ./ann_server -s /tmp/ann.sock -m model.bin -w 200 -b 32
+**************************************************************************************************/
+#define _GNU_SOURCE
+
+#include "ann.h"
+#include "ann_model.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Makrodefinitioner: */
+#define SERVER_MAX_CLIENTS 256     /* Maximalt antal samtidigt anslutna klienter. */
+#define SERVER_CLIENT_REQUESTS 64  /* Antalet frfrgningar som ryms i buffern per klient. */
+#define SERVER_MAX_LAYERS 32       /* Maximalt antal lager i topologin (inklusive in- och utgng). */
+
+/**************************************************************************************************
+* server_client: En ansluten klient, vars mottagna men nnu inte behandlade frfrgningar
+*                lagras i en buffer tillsammans med respektive ankomsttid.
+**************************************************************************************************/
+struct server_client
+{
+   int fd;                                   /* Klientens socket. */
+   unsigned char* buffer;                    /* Mottagna byte som nnu inte har behandlats. */
+   size_t size;                              /* Antalet byte i buffern. */
+   double arrivals[SERVER_CLIENT_REQUESTS];  /* Ankomsttid fr respektive frfrgan i buffern. */
+   size_t pending;                           /* Antalet frfrgningar i aktuell batch. */
+   bool closing;                             /* Indikerar ifall klienten har kopplat ned. */
+};
+
+/**************************************************************************************************
+* server_request: En frfrgan i aktuell batch.
+**************************************************************************************************/
+struct server_request
+{
+   size_t client;  /* Index fr klienten som skickade frfrgan. */
+   double arrival; /* Tidpunkt d frfrgan togs emot i sin helhet. */
+};
+
+/**************************************************************************************************
+* server: Serverns tillstnd, innehllande ntverket, anslutna klienter, aktuell batch samt
+*         statistik sedan senaste utskrift.
+**************************************************************************************************/
+struct server
+{
+   struct ann network;                                 /* Ntverket som anvnds fr prediktion. */
+   int listener;                                       /* Socket som tar emot nya anslutningar. */
+   struct server_client clients[SERVER_MAX_CLIENTS];   /* Anslutna klienter. */
+   size_t num_clients;                                 /* Antalet anslutna klienter. */
+   size_t next_client;                                 /* Klienten som str p tur att lsas. */
+   struct double_matrix input;                         /* Insignaler fr aktuell batch. */
+   struct double_matrix output;                        /* Utsignaler fr aktuell batch. */
+   struct ann_batch_workspace workspace;               /* Arbetsminne fr prediktionen. */
+   struct server_request* requests;                    /* Frfrgningar i aktuell batch. */
+   size_t num_requests;                                /* Antalet frfrgningar i aktuell batch. */
+   size_t max_batch;                                   /* Maximalt antal frfrgningar per batch. */
+   double window;                                      /* Tidsfnster i sekunder per batch. */
+   size_t request_size;                                /* Antalet byte per frfrgan. */
+   size_t response_size;                               /* Antalet byte per svar. */
+   double* latencies;                                  /* Frdrjning per besvarad frfrgan. */
+   size_t num_latencies;                               /* Antalet besvarade frfrgningar. */
+   size_t capacity;                                    /* Antalet frdrjningar som ryms. */
+   size_t num_batches;                                 /* Antalet genomfrda batcher. */
+   double report_start;                                /* Tidpunkt fr senaste utskrift. */
+   double report_interval;                             /* Tid i sekunder mellan utskrifter. */
+};
+
+/* Statiska funktioner: */
+static int train_network(struct ann* self,
+                         const char* topology_arg,
+                         const char* data_path,
+                         const size_t num_epochs,
+                         const double learning_rate);
+static int server_new(struct server* self,
+                      const char* socket_path,
+                      const size_t max_batch,
+                      const double window,
+                      const double report_interval);
+static void server_delete(struct server* self,
+                          const char* socket_path);
+static void server_run(struct server* self);
+static void server_accept(struct server* self);
+static void server_read(struct server* self,
+                        const size_t index,
+                        const double now);
+static void server_collect(struct server* self);
+static void server_flush(struct server* self);
+static void server_send(struct server* self,
+                        const size_t index,
+                        const real_t* response);
+static void server_remove_closed(struct server* self);
+static void server_report(struct server* self,
+                          const double now);
+static int compare_doubles(const void* x,
+                           const void* y);
+static size_t parse_topology(const char* s,
+                             size_t* topology);
+static void on_signal(const int signal);
+static double get_time(void);
+
+/* Statiska variabler: */
+static volatile sig_atomic_t stop = 0; /* Stts vid SIGINT/SIGTERM fr att avsluta servern. */
+
+/**************************************************************************************************
+* main: Lser in argument, skapar och trnar ntverket (eller mappar en sparad modell) och
+*       startar sedan servern, som krs tills programmet avbryts (exempelvis via Ctrl + C).
+*       Fljande argument r valbara:
+*
+*       -s <skvg>   : Skvg till socketen (default /tmp/ann.sock).
+*       -d <skvg>   : Skvg till trningsdata (default data.txt).
+*       -n <topologi> : Antalet noder per lager, inklusive in- och utgngar (default 3,4,3,3,1).
+*       -e <epoker>   : Antalet epoker trning (default 10000).
+*       -l <lrhast.> : Lrhastigheten vid trning (default 0.01).
+*       -w <us>       : Tidsfnster per batch i mikrosekunder (default 500).
+*       -b <antal>    : Maximalt antal frfrgningar per batch (default 64).
+*       -r <sekunder> : Tid mellan utskrifter av statistik (default 5).
+*       -m <modell>   : Modellfil som mappas i stllet fr att trna ntverket (default ingen).
+*       -o <modell>   : Modellfil dr ntverket sparas innan servern startas (default ingen).
+**************************************************************************************************/
+int main(int argc, char** argv)
+{
+   const char* socket_path = "/tmp/ann.sock";
+   const char* data_path = "data.txt";
+   const char* topology_arg = "3,4,3,3,1";
+   const char* model_path = 0;
+   const char* output_path = 0;
+   size_t num_epochs = 10000, max_batch = 64;
+   double learning_rate = 0.01, window_us = 500, report_interval = 5;
+   struct server server;
+   int option;
+
+   while ((option = getopt(argc, argv, "s:d:n:e:l:w:b:r:m:o:")) != -1)
+   {
+      switch (option)
+      {
+         case 's': socket_path = optarg; break;
+         case 'd': data_path = optarg; break;
+         case 'n': topology_arg = optarg; break;
+         case 'e': num_epochs = (size_t)atol(optarg); break;
+         case 'l': learning_rate = atof(optarg); break;
+         case 'w': window_us = atof(optarg); break;
+         case 'b': max_batch = (size_t)atol(optarg); break;
+         case 'r': report_interval = atof(optarg); break;
+         case 'm': model_path = optarg; break;
+         case 'o': output_path = optarg; break;
+         default:
+            fprintf(stderr, "Usage: %s [-s socket] [-d data] [-n topology] [-e epochs] "
+                    "[-l learning rate] [-w window us] [-b max batch] [-r report s] "
+                    "[-m model] [-o saved model]\n", argv[0]);
+            return 1;
+      }
+   }
+
+   if (!max_batch)
+   {
+      fprintf(stderr, "Invalid batch size!\n");
+      return 1;
+   }
+
+   if (model_path)
+   {
+      const double start = get_time();
+      if (ann_map(&server.network, model_path, false)) return 1;
+      printf("Mapped model %s in %.3f ms.\n", model_path, (get_time() - start) * 1e3);
+   }
+   else if (train_network(&server.network, topology_arg, data_path, num_epochs, learning_rate))
+   {
+      return 1;
+   }
+
+   if (output_path && ann_save(&server.network, output_path))
+   {
+      fprintf(stderr, "Could not save model to %s!\n", output_path);
+      ann_delete(&server.network);
+      return 1;
+   }
+
+   if (server_new(&server, socket_path, max_batch, window_us * 1e-6, report_interval)) return 1;
+
+   printf("Listening on %s (window %.0f us, max batch %zu).\n", socket_path, window_us, max_batch);
+   fflush(stdout);
+   server_run(&server);
+   server_delete(&server, socket_path);
+   return 0;
+}
+
+/**************************************************************************************************
+* train_network: Initierar angivet ntverk med angiven topologi och trnar det angivet antal
+*                epoker med trningsdatan i angiven fil. Returnerar 1 ifall topologin r
+*                ogiltig eller ifall ingen trningsdata hittas, varvid ntverket inte
+*                initieras, annars 0.
+*
+*                - self         : Pekare till ntverket.
+*                - topology_arg : Kommaseparerad strng med antalet noder per lager.
+*                - data_path    : Filskvg till trningsdatan.
+*                - num_epochs   : Antalet epoker som skall genomfras.
+*                - learning_rate: Lrhastigheten.
+**************************************************************************************************/
+static int train_network(struct ann* self,
+                         const char* topology_arg,
+                         const char* data_path,
+                         const size_t num_epochs,
+                         const double learning_rate)
+{
+   size_t topology[SERVER_MAX_LAYERS];
+   const size_t num_layers = parse_topology(topology_arg, topology);
+
+   if (num_layers < 3)
+   {
+      fprintf(stderr, "Invalid topology %s!\n", topology_arg);
+      return 1;
+   }
+
+   ann_new(self, topology[0], topology[1], topology[num_layers - 1]);
+
+   for (size_t i = 2; i < num_layers - 1; ++i)
+   {
+      ann_add_hidden_layer(self, topology[i]);
+   }
+
+   struct training_data_stats stats;
+   training_data_load_stats(&self->training_data, data_path, &stats);
+   training_data_print_stats(&stats, stdout);
+
+   if (!self->training_data.sets)
+   {
+      fprintf(stderr, "No training data found in %s!\n", data_path);
+      ann_delete(self);
+      return 1;
+   }
+
+   ann_train(self, num_epochs, learning_rate);
+   printf("Trained network, loss %g after %zu epochs.\n", ann_loss(self), num_epochs);
+   return 0;
+}
+
+/**************************************************************************************************
+* server_new: Initierar servern, vars ntverk redan har skapats, och ppnar socketen p angiven
+*             skvg. En befintlig socket p skvgen erstts. Returnerar 1 ifall socketen inte
+*             kan ppnas eller ifall minnesallokering misslyckas, varvid servern (inklusive
+*             ntverket) frigrs, annars 0.
+*
+*             - self           : Pekare till servern.
+*             - socket_path    : Skvg till socketen.
+*             - max_batch      : Maximalt antal frfrgningar per batch.
+*             - window         : Tidsfnster i sekunder per batch.
+*             - report_interval: Tid i sekunder mellan utskrifter av statistik.
+**************************************************************************************************/
+static int server_new(struct server* self,
+                      const char* socket_path,
+                      const size_t max_batch,
+                      const double window,
+                      const double report_interval)
+{
+   struct sockaddr_un address = { .sun_family = AF_UNIX };
+
+   self->num_clients = 0;
+   self->next_client = 0;
+   self->num_requests = 0;
+   self->max_batch = max_batch;
+   self->window = window;
+   self->request_size = sizeof(real_t) * self->network.num_inputs;
+   self->response_size = sizeof(real_t) * self->network.num_outputs;
+   self->latencies = 0;
+   self->num_latencies = 0;
+   self->capacity = 0;
+   self->num_batches = 0;
+   self->report_start = get_time();
+   self->report_interval = report_interval;
+   self->requests = (struct server_request*)malloc(sizeof(struct server_request) * max_batch);
+   double_matrix_new(&self->input);
+   double_matrix_new(&self->output);
+   const int workspace_failed =
+      ann_batch_workspace_new(&self->workspace, &self->network, max_batch);
+   self->listener = -1;
+
+   if (!self->requests || workspace_failed ||
+       double_matrix_resize(&self->input, max_batch, self->network.num_inputs) ||
+       double_matrix_resize(&self->output, max_batch, self->network.num_outputs))
+   {
+      fprintf(stderr, "Memory allocation failed!\n");
+      server_delete(self, 0);
+      return 1;
+   }
+
+   if (strlen(socket_path) >= sizeof(address.sun_path))
+   {
+      fprintf(stderr, "Socket path %s is too long!\n", socket_path);
+      server_delete(self, 0);
+      return 1;
+   }
+
+   strcpy(address.sun_path, socket_path);
+   unlink(socket_path);
+   self->listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+   if (self->listener < 0 ||
+       bind(self->listener, (const struct sockaddr*)&address, sizeof(address)) ||
+       listen(self->listener, SOMAXCONN))
+   {
+      fprintf(stderr, "Could not open socket at path %s: %s\n", socket_path, strerror(errno));
+      server_delete(self, 0);
+      return 1;
+   }
+
+   signal(SIGINT, &on_signal);
+   signal(SIGTERM, &on_signal);
+   signal(SIGPIPE, SIG_IGN);
+   return 0;
+}
+
+/**************************************************************************************************
+* server_delete: Stnger samtliga anslutningar samt socketen och frigr serverns minne,
+*                inklusive ntverket.
+*
+*                - self       : Pekare till servern.
+*                - socket_path: Skvg till socketen som skall tas bort (null om ingen).
+**************************************************************************************************/
+static void server_delete(struct server* self,
+                          const char* socket_path)
+{
+   for (size_t i = 0; i < self->num_clients; ++i)
+   {
+      close(self->clients[i].fd);
+      free(self->clients[i].buffer);
+   }
+
+   if (self->listener >= 0) close(self->listener);
+   if (socket_path) unlink(socket_path);
+   free(self->requests);
+   free(self->latencies);
+   double_matrix_delete(&self->input);
+   double_matrix_delete(&self->output);
+   ann_batch_workspace_delete(&self->workspace);
+   ann_delete(&self->network);
+   self->num_clients = 0;
+   return;
+}
+
+/**************************************************************************************************
+* server_run: Kr serverns hndelseloop tills programmet avbryts. Mottagna frfrgningar samlas
+*             i aktuell batch, som predikteras nr batchen r full eller nr tidsfnstret sedan
+*             batchens frsta frfrgan har lpt ut. Under tiden vntar servern p nya
+*             anslutningar samt data, dock hgst till tidsfnstrets slut.
+*
+*             - self: Pekare till servern.
+**************************************************************************************************/
+static void server_run(struct server* self)
+{
+   struct pollfd fds[SERVER_MAX_CLIENTS + 1];
+   size_t indices[SERVER_MAX_CLIENTS];
+
+   while (!stop)
+   {
+      double now = get_time();
+      server_collect(self);
+
+      if (self->num_requests &&
+          (self->num_requests == self->max_batch ||
+           now - self->requests[0].arrival >= self->window))
+      {
+         server_flush(self);
+         continue;
+      }
+
+      if (!self->num_requests) server_remove_closed(self);
+      if (now - self->report_start >= self->report_interval) server_report(self, now);
+
+      const double deadline = self->num_requests ? self->requests[0].arrival + self->window :
+                                                   self->report_start + self->report_interval;
+      const double timeout = deadline > now ? deadline - now : 0;
+      const struct timespec wait = { (time_t)timeout, (long)((timeout - (time_t)timeout) * 1e9) };
+      size_t num_fds = 1;
+
+      fds[0].fd = self->listener;
+      fds[0].events = self->num_clients < SERVER_MAX_CLIENTS ? POLLIN : 0;
+
+      for (size_t i = 0; i < self->num_clients; ++i)
+      {
+         const struct server_client* client = &self->clients[i];
+
+         if (!client->closing &&
+             client->size < self->request_size * SERVER_CLIENT_REQUESTS)
+         {
+            fds[num_fds].fd = client->fd;
+            fds[num_fds].events = POLLIN;
+            indices[num_fds++ - 1] = i;
+         }
+      }
+
+      if (ppoll(fds, num_fds, &wait, 0) <= 0) continue;
+      now = get_time();
+
+      for (size_t i = 1; i < num_fds; ++i)
+      {
+         if (fds[i].revents) server_read(self, indices[i - 1], now);
+      }
+
+      if (fds[0].revents & POLLIN) server_accept(self);
+   }
+
+   if (self->num_requests) server_flush(self);
+   server_report(self, get_time());
+   return;
+}
+
+/**************************************************************************************************
+* server_accept: Tar emot samtliga vntande anslutningar, s lnge det finns plats fr fler
+*                klienter.
+*
+*                - self: Pekare till servern.
+**************************************************************************************************/
+static void server_accept(struct server* self)
+{
+   while (self->num_clients < SERVER_MAX_CLIENTS)
+   {
+      struct server_client* client = &self->clients[self->num_clients];
+      const int fd = accept4(self->listener, 0, 0, SOCK_NONBLOCK | SOCK_CLOEXEC);
+      if (fd < 0) break;
+
+      client->buffer = (unsigned char*)malloc(self->request_size * SERVER_CLIENT_REQUESTS);
+
+      if (!client->buffer)
+      {
+         close(fd);
+         break;
+      }
+
+      client->fd = fd;
+      client->size = 0;
+      client->pending = 0;
+      client->closing = false;
+      self->num_clients++;
+   }
+   return;
+}
+
+/**************************************************************************************************
+* server_read: Lser mottagna byte frn angiven klient till klientens buffer, dr varje
+*              frfrgan som drmed har tagits emot i sin helhet tilldelas angiven ankomsttid.
+*              Ifall klienten har kopplat ned markeras den fr borttagning.
+*
+*              - self : Pekare till servern.
+*              - index: Klientens index.
+*              - now  : Aktuell tid.
+**************************************************************************************************/
+static void server_read(struct server* self,
+                        const size_t index,
+                        const double now)
+{
+   struct server_client* client = &self->clients[index];
+   const size_t capacity = self->request_size * SERVER_CLIENT_REQUESTS;
+   const size_t num_complete = client->size / self->request_size;
+   const ssize_t num_read = read(client->fd, client->buffer + client->size,
+                                 capacity - client->size);
+
+   if (num_read > 0)
+   {
+      client->size += (size_t)num_read;
+
+      for (size_t i = num_complete; i < client->size / self->request_size; ++i)
+      {
+         client->arrivals[i] = now;
+      }
+   }
+   else if (!num_read || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+   {
+      client->closing = true;
+   }
+   return;
+}
+
+/**************************************************************************************************
+* server_collect: Flyttar mottagna frfrgningar frn klienternas buffertar till aktuell batch
+*                 tills batchen r full, dr en frfrgan i taget hmtas frn respektive klient
+*                 i tur och ordning, s att en enskild klient inte kan trnga undan vriga.
+*
+*                 - self: Pekare till servern.
+**************************************************************************************************/
+static void server_collect(struct server* self)
+{
+   bool found = true;
+
+   while (found && self->num_requests < self->max_batch)
+   {
+      found = false;
+
+      for (size_t i = 0; i < self->num_clients && self->num_requests < self->max_batch; ++i)
+      {
+         const size_t index = (self->next_client + i) % self->num_clients;
+         struct server_client* client = &self->clients[index];
+         struct server_request* request = &self->requests[self->num_requests];
+         if (client->size < self->request_size) continue;
+
+         memcpy(double_matrix_row(&self->input, self->num_requests), client->buffer,
+                self->request_size);
+         request->client = index;
+         request->arrival = client->arrivals[0];
+         self->num_requests++;
+         client->pending++;
+         client->size -= self->request_size;
+         memmove(client->buffer, client->buffer + self->request_size, client->size);
+         memmove(client->arrivals, client->arrivals + 1,
+                 sizeof(double) * (client->size / self->request_size));
+         found = true;
+      }
+
+      if (self->num_clients) self->next_client = (self->next_client + 1) % self->num_clients;
+   }
+   return;
+}
+
+/**************************************************************************************************
+* server_flush: Predikterar samtliga frfrgningar i aktuell batch via ett enda anrop av
+*               ann_predict_batch_ws med serverns arbetsminne, vilket medfr att inget minne
+*               allokeras per batch, skickar svaren till respektive klient och lagrar
+*               frdrjningen fr varje frfrgan.
+*
+*               - self: Pekare till servern.
+**************************************************************************************************/
+static void server_flush(struct server* self)
+{
+   if (ann_predict_batch_ws(&self->network, &self->workspace, &self->input, &self->output,
+                            self->num_requests))
+   {
+      fprintf(stderr, "Prediction failed for batch of %zu requests!\n", self->num_requests);
+   }
+
+   for (size_t i = 0; i < self->num_requests; ++i)
+   {
+      const struct server_request* request = &self->requests[i];
+      server_send(self, request->client, double_matrix_row(&self->output, i));
+      self->clients[request->client].pending--;
+
+      if (self->num_latencies == self->capacity)
+      {
+         const size_t capacity = self->capacity ? self->capacity * 2 : 1024;
+         double* latencies = (double*)realloc(self->latencies, sizeof(double) * capacity);
+         if (!latencies) continue;
+         self->latencies = latencies;
+         self->capacity = capacity;
+      }
+
+      self->latencies[self->num_latencies++] = get_time() - request->arrival;
+   }
+
+   self->num_requests = 0;
+   self->num_batches++;
+   return;
+}
+
+/**************************************************************************************************
+* server_send: Skickar ett svar till angiven klient. Ifall svaret inte kan skickas i sin helhet,
+*              exempelvis d klienten inte lser sina svar, markeras klienten fr borttagning.
+*
+*              - self    : Pekare till servern.
+*              - index   : Klientens index.
+*              - response: Pekare till utsignalerna som skall skickas.
+**************************************************************************************************/
+static void server_send(struct server* self,
+                        const size_t index,
+                        const real_t* response)
+{
+   struct server_client* client = &self->clients[index];
+   const unsigned char* data = (const unsigned char*)response;
+   size_t num_sent = 0;
+
+   while (!client->closing && num_sent < self->response_size)
+   {
+      const ssize_t result = send(client->fd, data + num_sent, self->response_size - num_sent,
+                                  MSG_NOSIGNAL);
+      if (result > 0) num_sent += (size_t)result;
+      else if (result < 0 && errno == EINTR) continue;
+      else client->closing = true;
+   }
+   return;
+}
+
+/**************************************************************************************************
+* server_remove_closed: Stnger samt tar bort klienter som har kopplat ned. Anropas enbart nr
+*                       aktuell batch r tom, eftersom frfrgningarna refererar till
+*                       klienternas index.
+*
+*                       - self: Pekare till servern.
+**************************************************************************************************/
+static void server_remove_closed(struct server* self)
+{
+   for (size_t i = 0; i < self->num_clients;)
+   {
+      struct server_client* client = &self->clients[i];
+
+      if (client->closing && !client->pending)
+      {
+         close(client->fd);
+         free(client->buffer);
+         *client = self->clients[--self->num_clients];
+      }
+      else
+      {
+         ++i;
+      }
+   }
+
+   if (self->next_client >= self->num_clients) self->next_client = 0;
+   return;
+}
+
+/**************************************************************************************************
+* server_report: Skriver ut genomstrmning, median samt 99:e percentil av frdrjningen och
+*                genomsnittlig batchstorlek sedan senaste utskrift, ifall ngra frfrgningar
+*                har besvarats, och nollstller drefter statistiken.
+*
+*                - self: Pekare till servern.
+*                - now : Aktuell tid.
+**************************************************************************************************/
+static void server_report(struct server* self,
+                          const double now)
+{
+   const double elapsed = now - self->report_start;
+
+   if (self->num_latencies && elapsed > 0)
+   {
+      const size_t n = self->num_latencies;
+      qsort(self->latencies, n, sizeof(double), &compare_doubles);
+      printf("%10.0f req/s   p50 %8.1f us   p99 %8.1f us   batch %6.1f   (%zu clients)\n",
+             n / elapsed, self->latencies[(n - 1) / 2] * 1e6,
+             self->latencies[(n - 1) * 99 / 100] * 1e6, (double)n / self->num_batches,
+             self->num_clients);
+      fflush(stdout);
+   }
+
+   self->num_latencies = 0;
+   self->num_batches = 0;
+   self->report_start = now;
+   return;
+}
+
+/**************************************************************************************************
+* compare_doubles: Jmfr tv flyttal vid sortering via qsort.
+*
+*                  - x: Pekare till det frsta flyttalet.
+*                  - y: Pekare till det andra flyttalet.
+**************************************************************************************************/
+static int compare_doubles(const void* x,
+                           const void* y)
+{
+   const double a = *(const double*)x, b = *(const double*)y;
+   return (a > b) - (a < b);
+}
+
+/**************************************************************************************************
+* parse_topology: Lser in antalet noder per lager frn en kommaseparerad strng, exempelvis
+*                 "3,4,3,1", och returnerar antalet lager. Returnerar 0 ifall ngot lager saknar
+*                 noder eller ifall strngen innehller fler n SERVER_MAX_LAYERS lager.
+*
+*                 - s       : Pekare till strngen.
+*                 - topology: Pekare till flt dr antalet noder per lager skall lagras.
+**************************************************************************************************/
+static size_t parse_topology(const char* s,
+                             size_t* topology)
+{
+   size_t num_layers = 0;
+
+   while (*s)
+   {
+      char* end = 0;
+      const unsigned long num_nodes = strtoul(s, &end, 10);
+      if (!num_nodes || end == s || num_layers == SERVER_MAX_LAYERS) return 0;
+      topology[num_layers++] = (size_t)num_nodes;
+      s = *end == ',' ? end + 1 : end;
+      if (*end && *end != ',') return 0;
+   }
+   return num_layers;
+}
+
+/**************************************************************************************************
+* on_signal: Signalhanterare fr SIGINT samt SIGTERM, som avslutar serverns hndelseloop.
+*
+*            - signal: Signalens nummer (anvnds ej).
+**************************************************************************************************/
+static void on_signal(const int signal)
+{
+   (void)signal;
+   stop = 1;
+   return;
+}
+
+/**************************************************************************************************
+* get_time: Returnerar aktuell tid i sekunder frn en monoton klocka.
+**************************************************************************************************/
+static double get_time(void)
+{
+   struct timespec time;
+   clock_gettime(CLOCK_MONOTONIC, &time);
+   return time.tv_sec + time.tv_nsec * 1e-9;
+}
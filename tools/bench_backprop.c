@@ -0,0 +1,300 @@
+/**************************************************************************************************
+* bench_backprop.c: Mter krtiden fr berkning av avvikelser i ett dolt lager (W^T * e) fr
+*                   ett antal lagerstorlekar samt fr samtliga instruktionsuppsttningar som
+*                   stds av processorn. Som jmfrelse mts den ursprungliga implementeringen,
+*                   dr vikterna i efterfljande lager lses kolumnvis (ett element per rad fr
+*                   varje nod), samt feedforward i efterfljande lager, som lser samma
+*                   viktmatris radvis. Drefter mts den sammanslagna backpropagationen och
+*                   optimeringen (dense_layer_backpropagate_optimize) av anropande trd
+*                   respektive via trdpoolen, varvid minsta lagerstorlek dr trdpoolen r
+*                   snabbast skrivs ut som lmplig grns fr dense_layer_set_parallel_size.
+*                   Grnsen br mtas p den maskin dr ntverken skall trnas.
+*
+*                   Kompilera frn projektets rotkatalog med fljande kommando:
+*                   $ gcc -O2 -I. tools/bench_backprop.c $(ls *.c | grep -v main.c) -o bench_backprop -lm
+*
+*                   Kr sedan programmet med valfria lagerstorlekar (default 256 1024 2048 4096):
+*                   $ ./bench_backprop 1000 3000
+**************************************************************************************************/
+#include "dense_layer.h"
+#include "simd.h"
+#include "thread_pool.h"
+
+#include <stdint.h>
+
+#include <time.h>
+
+/* Makrodefinitioner: */
+#define BENCH_MIN_TIME 0.2 /* Minsta sammanlagda mttid i sekunder per mtning. */
+
+/* Statiska funktioner: */
+static void backpropagate_strided(struct dense_layer* self,
+                                  const struct dense_layer* next_layer);
+static void backpropagate(struct dense_layer* self,
+                          const struct dense_layer* next_layer);
+static void feedforward(struct dense_layer* self,
+                        const struct dense_layer* next_layer);
+static void backpropagate_optimize(struct dense_layer* self,
+                                   const struct dense_layer* next_layer);
+static void measure_parallel_size(const int argc,
+                                  const char** argv,
+                                  const size_t* default_sizes,
+                                  const size_t num_sizes);
+static double measure(void (*function)(struct dense_layer*, const struct dense_layer*),
+                      struct dense_layer* self,
+                      const struct dense_layer* next_layer);
+static real_t max_difference(const struct double_vector* x,
+                             const struct double_vector* y);
+static double get_time(void);
+
+/**************************************************************************************************
+* main: Skapar tv efterfljande dense-lager med angivet antal noder, dr samtliga noder i det
+*       frsta lagret r aktiva, och skriver ut uppmtt tid per anrop i millisekunder fr
+*       respektive implementering och instruktionsuppsttning.
+**************************************************************************************************/
+int main(const int argc, const char** argv)
+{
+   static const size_t default_sizes[] = { 256, 1024, 2048, 4096 };
+   const size_t num_sizes = argc > 1 ? (size_t)(argc - 1) : sizeof(default_sizes) / sizeof(size_t);
+
+   printf("%-8s %-8s %12s %12s %12s %10s\n", "nodes", "isa", "strided [ms]", "W^T*e [ms]",
+          "forward [ms]", "speedup");
+
+   for (size_t i = 0; i < num_sizes; ++i)
+   {
+      const size_t size = argc > 1 ? (size_t)atol(argv[i + 1]) : default_sizes[i];
+      struct dense_layer layer, next_layer;
+      struct double_vector reference;
+
+      if (!size) continue;
+      dense_layer_new(&layer, size, size);
+      dense_layer_new(&next_layer, size, size);
+      double_vector_new(&reference);
+
+      for (size_t j = 0; j < size; ++j)
+      {
+         layer.output.data[j] = 1.0;
+         next_layer.error.data[j] = (real_t)rand() / RAND_MAX - 0.5;
+      }
+
+      simd_set_isa(SIMD_ISA_SCALAR);
+      const double strided = measure(&backpropagate_strided, &layer, &next_layer);
+      double_vector_resize(&reference, size);
+      memcpy(reference.data, layer.error.data, sizeof(real_t) * size);
+
+      for (enum simd_isa isa = SIMD_ISA_SCALAR; isa <= SIMD_ISA_AVX512; ++isa)
+      {
+         if (!simd_isa_supported(isa)) continue;
+         simd_set_isa(isa);
+         const double transposed = measure(&backpropagate, &layer, &next_layer);
+         const double forward = measure(&feedforward, &layer, &next_layer);
+
+         printf("%-8zu %-8s %12.3f %12.3f %12.3f %9.1fx", size, simd_isa_name(isa),
+                strided * 1e3, transposed * 1e3, forward * 1e3, strided / transposed);
+
+         if (max_difference(&reference, &layer.error) > 1e-3)
+         {
+            printf("  (avvikande resultat)");
+         }
+         printf("\n");
+      }
+
+      double_vector_delete(&reference);
+      dense_layer_delete(&layer);
+      dense_layer_delete(&next_layer);
+   }
+
+   measure_parallel_size(argc, argv, default_sizes, num_sizes);
+   return 0;
+}
+
+/**************************************************************************************************
+* measure_parallel_size: Mter den sammanslagna backpropagationen och optimeringen fr angivna
+*                        lagerstorlekar (eller default-storlekarna), dels av anropande trd,
+*                        dels via trdpoolen, och skriver ut resultatet samt minsta antal
+*                        vikter frn vilket trdpoolen var snabbast fr samtliga strre lager
+*                        (lagerstorlekarna frutstts vara angivna i stigande ordning).
+*
+*                        - argc         : Antalet argument till programmet.
+*                        - argv         : Programmets argument, dr lagerstorlekarna fljer
+*                                         programmets namn.
+*                        - default_sizes: Lagerstorlekar som anvnds ifall inga anges.
+*                        - num_sizes    : Antalet lagerstorlekar.
+**************************************************************************************************/
+static void measure_parallel_size(const int argc,
+                                  const char** argv,
+                                  const size_t* default_sizes,
+                                  const size_t num_sizes)
+{
+   const size_t default_size = dense_layer_parallel_size();
+   size_t parallel_size = 0;
+
+   printf("\n%-8s %-8s %12s %12s %10s\n", "nodes", "threads", "serial [ms]", "pool [ms]",
+          "speedup");
+
+   for (size_t i = 0; i < num_sizes; ++i)
+   {
+      const size_t size = argc > 1 ? (size_t)atol(argv[i + 1]) : default_sizes[i];
+      struct dense_layer layer, next_layer;
+
+      if (!size) continue;
+      dense_layer_new(&layer, size, size);
+      dense_layer_new(&next_layer, size, size);
+
+      for (size_t j = 0; j < size; ++j)
+      {
+         layer.output.data[j] = 1.0;
+         next_layer.error.data[j] = (real_t)rand() / RAND_MAX - 0.5;
+      }
+
+      dense_layer_set_parallel_size(SIZE_MAX);
+      const double serial = measure(&backpropagate_optimize, &layer, &next_layer);
+      dense_layer_set_parallel_size(0);
+      const double pool = measure(&backpropagate_optimize, &layer, &next_layer);
+
+      printf("%-8zu %-8zu %12.3f %12.3f %9.2fx\n", size, thread_pool_num_threads(),
+             serial * 1e3, pool * 1e3, serial / pool);
+      if (pool >= serial) parallel_size = 0;
+      else if (!parallel_size) parallel_size = size * size;
+
+      dense_layer_delete(&layer);
+      dense_layer_delete(&next_layer);
+   }
+
+   dense_layer_set_parallel_size(default_size);
+
+   if (parallel_size)
+   {
+      printf("\nSuggested parallel size: %zu weights (default %zu).\n", parallel_size,
+             default_size);
+   }
+   else
+   {
+      printf("\nThe thread pool was not faster for any of the sizes (default %zu).\n",
+             default_size);
+   }
+   return;
+}
+
+/**************************************************************************************************
+* backpropagate_strided: Ursprunglig implementering av dense_layer_backpropagate, dr den inre
+*                        loopen lser ett element per rad i efterfljande lagers viktmatris.
+*
+*                        - self      : Pekare till det dolda lagret.
+*                        - next_layer: Pekare till efterfljande lager.
+**************************************************************************************************/
+static void backpropagate_strided(struct dense_layer* self,
+                                  const struct dense_layer* next_layer)
+{
+   for (size_t i = 0; i < self->num_nodes; ++i)
+   {
+      real_t deviation = 0;
+      const real_t* weights = next_layer->weights.data + i;
+
+      for (size_t j = 0; j < next_layer->num_nodes; ++j, weights += next_layer->weights.stride)
+      {
+         deviation += next_layer->error.data[j] * *weights;
+      }
+
+      self->error.data[i] = deviation * (self->output.data[i] > 0.0 ? 1.0 : 0.0);
+   }
+   return;
+}
+
+/**************************************************************************************************
+* backpropagate: Berknar avvikelser i det dolda lagret via dense_layer_backpropagate.
+*
+*                - self      : Pekare till det dolda lagret.
+*                - next_layer: Pekare till efterfljande lager.
+**************************************************************************************************/
+static void backpropagate(struct dense_layer* self,
+                          const struct dense_layer* next_layer)
+{
+   dense_layer_backpropagate(self, next_layer);
+   return;
+}
+
+/**************************************************************************************************
+* feedforward: Genomfr feedforward i efterfljande lager med det dolda lagrets utsignaler som
+*              indata, vilket lser samma viktmatris som vid berkning av avvikelser.
+*
+*              - self      : Pekare till det dolda lagret.
+*              - next_layer: Pekare till efterfljande lager.
+**************************************************************************************************/
+static void feedforward(struct dense_layer* self,
+                        const struct dense_layer* next_layer)
+{
+   dense_layer_feedforward((struct dense_layer*)next_layer, &self->output);
+   return;
+}
+
+/**************************************************************************************************
+* backpropagate_optimize: Berknar avvikelser i det dolda lagret och justerar efterfljande
+*                         lager via dense_layer_backpropagate_optimize, med lrhastigheten 0
+*                         s att vikterna frblir ofrndrade mellan mtningarna.
+*
+*                         - self      : Pekare till det dolda lagret.
+*                         - next_layer: Pekare till efterfljande lager.
+**************************************************************************************************/
+static void backpropagate_optimize(struct dense_layer* self,
+                                   const struct dense_layer* next_layer)
+{
+   dense_layer_backpropagate_optimize((struct dense_layer*)next_layer, self, &self->output, 0.0);
+   return;
+}
+
+/**************************************************************************************************
+* measure: Returnerar genomsnittlig krtid i sekunder fr angiven funktion, dr funktionen anropas
+*          upprepade gnger tills den sammanlagda mttiden verstiger BENCH_MIN_TIME.
+*
+*          - function  : Funktionen som skall mtas.
+*          - self      : Pekare till det dolda lagret.
+*          - next_layer: Pekare till efterfljande lager.
+**************************************************************************************************/
+static double measure(void (*function)(struct dense_layer*, const struct dense_layer*),
+                      struct dense_layer* self,
+                      const struct dense_layer* next_layer)
+{
+   size_t num_calls = 0;
+   function(self, next_layer);
+   const double start = get_time();
+   double elapsed = 0;
+
+   while (elapsed < BENCH_MIN_TIME)
+   {
+      function(self, next_layer);
+      elapsed = get_time() - start;
+      num_calls++;
+   }
+   return elapsed / num_calls;
+}
+
+/**************************************************************************************************
+* max_difference: Returnerar strsta absoluta skillnad mellan element i tv vektorer.
+*
+*                 - x: Pekare till den frsta vektorn.
+*                 - y: Pekare till den andra vektorn.
+**************************************************************************************************/
+static real_t max_difference(const struct double_vector* x,
+                             const struct double_vector* y)
+{
+   real_t max = 0;
+
+   for (size_t i = 0; i < x->size && i < y->size; ++i)
+   {
+      const real_t difference = x->data[i] > y->data[i] ? x->data[i] - y->data[i] :
+                                                          y->data[i] - x->data[i];
+      if (difference > max) max = difference;
+   }
+   return max;
+}
+
+/**************************************************************************************************
+* get_time: Returnerar aktuell tid i sekunder, avsett fr mtning av krtider.
+**************************************************************************************************/
+static double get_time(void)
+{
+   struct timespec time;
+   timespec_get(&time, TIME_UTC);
+   return time.tv_sec + time.tv_nsec * 1e-9;
+}
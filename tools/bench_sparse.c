@@ -0,0 +1,153 @@
+/**************************************************************************************************
+* bench_sparse.c: Mter krtiden fr feedforward i ett beskuret dense-lager via tta vikter
+*                 respektive den glesa kopian (CSR) fr ett antal lagerstorlekar och andelar
+*                 kvarvarande vikter, fr samtliga instruktionsuppsttningar som stds av
+*                 processorn. Dessutom skrivs minnestgngen fr respektive format ut samt
+*                 vilken krna som dense_layer_sparsify har valt efter mtning p lagrets vikter.
+*
+*                 Kompilera frn projektets rotkatalog med fljande kommando:
+*                 $ gcc -O2 -I. tools/bench_sparse.c $(ls *.c | grep -v main.c) -o bench_sparse -lm
+*
+*                 Kr sedan programmet med valfria lagerstorlekar (default 256 1024 4096):
+*                 $ ./bench_sparse 512 2048
+**************************************************************************************************/
+#include "dense_layer.h"
+#include "simd.h"
+#include "gemm.h"
+
+#include <time.h>
+
+/* Makrodefinitioner: */
+#define BENCH_MIN_TIME 0.1 /* Minsta sammanlagda mttid i sekunder per mtning. */
+
+/* Statiska funktioner: */
+static void prune(struct dense_layer* self,
+                  const double density);
+static double measure(const struct dense_layer* self,
+                      const bool sparse,
+                      const struct double_vector* input);
+static double get_time(void);
+
+/**************************************************************************************************
+* main: Skapar dense-lager med angivet antal noder och vikter per nod, beskr dessa till ett
+*       antal olika andelar kvarvarande vikter och skriver ut uppmtt tid per anrop i
+*       mikrosekunder fr respektive format och instruktionsuppsttning.
+**************************************************************************************************/
+int main(const int argc, const char** argv)
+{
+   static const size_t default_sizes[] = { 256, 1024, 4096 };
+   static const double densities[] = { 0.5, 0.3, 0.2, 0.1, 0.05 };
+   const size_t num_sizes = argc > 1 ? (size_t)(argc - 1) : sizeof(default_sizes) / sizeof(size_t);
+
+   printf("%-8s %-8s %8s %12s %12s %9s %10s %10s %8s\n", "nodes", "isa", "density",
+          "dense [us]", "sparse [us]", "speedup", "dense [kB]", "sparse [kB]", "chosen");
+
+   for (size_t i = 0; i < num_sizes; ++i)
+   {
+      const size_t size = argc > 1 ? (size_t)atol(argv[i + 1]) : default_sizes[i];
+      if (!size) continue;
+
+      for (enum simd_isa isa = SIMD_ISA_SCALAR; isa <= SIMD_ISA_AVX512; ++isa)
+      {
+         if (!simd_isa_supported(isa)) continue;
+         simd_set_isa(isa);
+
+         for (size_t j = 0; j < sizeof(densities) / sizeof(densities[0]); ++j)
+         {
+            struct dense_layer layer;
+            struct double_vector input;
+
+            dense_layer_new(&layer, size, size);
+            double_vector_new(&input);
+            double_vector_resize(&input, size);
+
+            for (size_t k = 0; k < size; ++k)
+            {
+               input.data[k] = (real_t)rand() / RAND_MAX;
+            }
+
+            prune(&layer, densities[j]);
+            dense_layer_sparsify(&layer, 0.0);
+            const double dense = measure(&layer, false, &input);
+            const double sparse = measure(&layer, true, &input);
+
+            printf("%-8zu %-8s %8.2f %12.1f %12.1f %8.2fx %10zu %10zu %8s\n", size,
+                   simd_isa_name(isa), csr_matrix_density(&layer.sparse_weights), dense * 1e6,
+                   sparse * 1e6, dense / sparse, sizeof(real_t) * size * size / 1024,
+                   csr_matrix_size(&layer.sparse_weights) / 1024,
+                   layer.sparse_kernels ? "sparse" : "dense");
+
+            double_vector_delete(&input);
+            dense_layer_delete(&layer);
+         }
+      }
+   }
+   return 0;
+}
+
+/**************************************************************************************************
+* prune: Nollstller slumpmssigt valda vikter i angivet dense-lager, s att ungefr angiven
+*        andel vikter terstr, likt efter beskrning av vikter med litet belopp.
+*
+*        - self   : Pekare till dense-lagret.
+*        - density: Andel vikter som skall terst (0.0 - 1.0).
+**************************************************************************************************/
+static void prune(struct dense_layer* self,
+                  const double density)
+{
+   for (size_t i = 0; i < self->num_nodes; ++i)
+   {
+      real_t* weights = double_matrix_row(&self->weights, i);
+
+      for (size_t j = 0; j < self->num_weights; ++j)
+      {
+         if ((double)rand() / RAND_MAX >= density) weights[j] = 0;
+      }
+   }
+   return;
+}
+
+/**************************************************************************************************
+* measure: Returnerar genomsnittlig krtid i sekunder fr multiplikation av lagrets vikter med
+*          angiven indata, dr berkningen upprepas tills den sammanlagda mttiden verstiger
+*          BENCH_MIN_TIME.
+*
+*          - self  : Pekare till dense-lagret.
+*          - sparse: Indikerar ifall den glesa kopian av vikterna skall anvndas.
+*          - input : Pekare till vektor innehllande indata.
+**************************************************************************************************/
+static double measure(const struct dense_layer* self,
+                      const bool sparse,
+                      const struct double_vector* input)
+{
+   size_t num_calls = 0;
+   const double start = get_time();
+   double elapsed = 0;
+
+   while (elapsed < BENCH_MIN_TIME)
+   {
+      if (sparse)
+      {
+         csr_matrix_gemv(&self->sparse_weights, input->data, self->output.data);
+      }
+      else
+      {
+         gemv(GEMM_NO_TRANSPOSE, self->num_nodes, self->num_weights, self->weights.data,
+              self->weights.stride, input->data, self->output.data);
+      }
+
+      elapsed = get_time() - start;
+      num_calls++;
+   }
+   return elapsed / num_calls;
+}
+
+/**************************************************************************************************
+* get_time: Returnerar aktuell tid i sekunder, avsett fr mtning av krtider.
+**************************************************************************************************/
+static double get_time(void)
+{
+   struct timespec time;
+   timespec_get(&time, TIME_UTC);
+   return time.tv_sec + time.tv_nsec * 1e-9;
+}
@@ -3,11 +3,26 @@
 *                  trningsdata fr neurala ntverk.
 **************************************************************************************************/
 #include "training_data.h"
+#include "allocator.h"
+#include "file_map.h"
+
+#include <time.h>
+#include <math.h>
 
 /* Statiska funktioner: */
-static void training_data_extract(struct training_data* self, const char* s);
-static bool is_digit(const char c);
-static void print_line(const double* data, const size_t size, FILE* ostream);
+static void training_data_unmap(struct training_data* self);
+static int write_block(const struct double_2d_vector* rows, const size_t cols, FILE* fstream);
+static int write_padding(const uint64_t offset, const uint64_t position, FILE* fstream);
+static uint64_t align_offset(const uint64_t offset, const uint64_t alignment);
+static int training_data_reserve(struct training_data* self, const size_t capacity);
+static int training_data_extract(struct training_data* self, const real_t* values);
+static size_t count_lines(const char* s, const char* end);
+static size_t parse_line(const char* s, const char* end, real_t* values, const size_t max);
+static const char* parse_number(const char* s, const char* end, real_t* value);
+static inline bool is_digit(const char c);
+static inline bool is_separator(const char c);
+static double get_time(void);
+static void print_line(const real_t* data, const size_t size, FILE* ostream);
 
 /**************************************************************************************************
 * training_data_new: Initierar angiven trningsdatabehllare fr lagring av trningsdata till
@@ -27,6 +42,8 @@ void training_data_new(struct training_data* self,
    self->sets = 0;
    self->num_inputs = num_inputs;
    self->num_outputs = num_outputs;
+   self->map.data = 0;
+   self->map.size = 0;
    return;
 }
 
@@ -37,6 +54,7 @@ void training_data_new(struct training_data* self,
 **************************************************************************************************/
 void training_data_delete(struct training_data* self)
 {
+   training_data_unmap(self);
    double_2d_vector_delete(&self->in);
    double_2d_vector_delete(&self->out);
    uint_vector_delete(&self->order);
@@ -56,7 +74,7 @@ void training_data_delete(struct training_data* self)
 struct training_data* training_data_ptr_new(const size_t inputs, 
                                             const size_t outputs)
 {
-   struct training_data* self = (struct training_data*)malloc(sizeof(struct training_data));
+   struct training_data* self = (struct training_data*)allocator_alloc(sizeof(struct training_data));
    if (!self) return 0;
    training_data_new(self, inputs, outputs);
    return self;
@@ -71,7 +89,7 @@ struct training_data* training_data_ptr_new(const size_t inputs,
 void training_data_ptr_delete(struct training_data** self)
 {
    training_data_delete(*self);
-   free(*self);
+   allocator_free(*self);
    *self = 0;
    return;
 }
@@ -85,6 +103,7 @@ void training_data_ptr_delete(struct training_data** self)
 **************************************************************************************************/
 void training_data_clear(struct training_data* self)
 {
+   training_data_unmap(self);
    double_2d_vector_delete(&self->in);
    double_2d_vector_delete(&self->out);
    uint_vector_delete(&self->order);
@@ -94,30 +113,267 @@ void training_data_clear(struct training_data* self)
 
 /**************************************************************************************************
 * training_data_load: Lser in trningsdata till ett neuralt ntverk frn en fil via angiven 
-*                     filskvg och lagrar i angiven trningsdatabehllare.
+*                     filskvg och lagrar i angiven trningsdatabehllare, se funktionen
+*                     training_data_load_stats.
 * 
 *                     - self    : Pekare till trningsdatabehllaren.
 *                     - filepath: Filskvg som trningsdatan skall lsas frn.
 **************************************************************************************************/
 void training_data_load(struct training_data* self, const char* filepath)
 {
-   FILE* fstream = fopen(filepath, "r");
+   training_data_load_stats(self, filepath, 0);
+   return;
+}
 
-   if (!fstream)
+/**************************************************************************************************
+* training_data_load_stats: Lser in trningsdata till ett neuralt ntverk frn en textfil via
+*                           angiven filskvg och lagrar i angiven trningsdatabehllare. Varje
+*                           rad utgr en trningsuppsttning, dr insignalerna fljs av
+*                           utsignalerna. Talen separeras av blanksteg, tabbar, kommatecken
+*                           eller semikolon och kan anges med tecken, decimaler samt exponent
+*                           (exempelvis -1.5e-3). Radslut kan anges med LF eller CRLF och raderna
+*                           kan ha godtycklig lngd. Tomma rader ignoreras, medan rader med fel
+*                           antal tal eller ogiltiga tal rapporteras och hoppas ver.
+*
+*                           Filen mappas till minnet och tolkas i ett svep. Antalet rader rknas
+*                           frst, s att vektorerna fr trningsuppsttningarna kan allokeras
+*                           en gng, varefter varje tal tolkas direkt ur filens innehll och
+*                           skrivs till respektive uppsttning. Returnerar 1 ifall filen inte
+*                           kan lsas eller minnesallokering misslyckas, annars 0.
+*
+*                           - self    : Pekare till trningsdatabehllaren.
+*                           - filepath: Filskvg som trningsdatan skall lsas frn.
+*                           - stats   : Pekare till strukt dr statistik fr inlsningen lagras
+*                                       (eller null).
+**************************************************************************************************/
+int training_data_load_stats(struct training_data* self,
+                             const char* filepath,
+                             struct training_data_stats* stats)
+{
+   const double start = get_time();
+   const size_t datapoints = self->num_inputs + self->num_outputs;
+   struct training_data_stats result = { .rows = 0, .rejected = 0, .bytes = 0, .seconds = 0 };
+   struct double_vector values = { .data = 0, .size = 0, .capacity = 0 };
+   struct file_map map;
+   int status = 0;
+
+   if (file_map_new(&map, filepath, true))
    {
       fprintf(stderr, "Could not open file at path %s!\n\n", filepath);
+      if (stats) *stats = result;
+      return 1;
    }
-   else
+
+   const char* line = map.data;
+   const char* end = map.data + map.size;
+
+   if (double_vector_resize(&values, datapoints ? datapoints : 1) ||
+       training_data_reserve(self, self->sets + count_lines(line, end)))
+   {
+      status = 1;
+   }
+
+   for (size_t number = 1; !status && line < end; ++number)
    {
-      char s[100] = { '\0 ' };
-      while (fgets(s, sizeof(s), fstream))
+      const char* line_end = (const char*)memchr(line, '\n', (size_t)(end - line));
+      if (!line_end) line_end = end;
+      const size_t count = parse_line(line, line_end, values.data, datapoints);
+
+      if (count == datapoints && datapoints)
       {
-         training_data_extract(self, s);
+         status = training_data_extract(self, values.data);
+         result.rows++;
       }
-      fclose(fstream);
+      else if (count)
+      {
+         fprintf(stderr, "Could not extract %zu datapoints out of line %zu!\n\n", 
+                 datapoints, number);
+         result.rejected++;
+      }
+
+      line = line_end + 1;
    }
+
+   double_2d_vector_shrink_to_fit(&self->in);
+   double_2d_vector_shrink_to_fit(&self->out);
+   uint_vector_shrink_to_fit(&self->order);
+   double_vector_delete(&values);
+
+   result.bytes = map.size;
+   result.seconds = get_time() - start;
+   file_map_delete(&map);
+   if (stats) *stats = result;
+   return status;
+}
+
+/**************************************************************************************************
+* training_data_print_stats: Skriver ut statistik fr en inlsning av trningsdata, i form av
+*                            antalet inlsta samt ignorerade rader, tidstgng samt hastighet i
+*                            rader per sekund och MB per sekund, via angiven utstrm, dr
+*                            standardutenheten stdout anvnds som default.
+*
+*                            - stats  : Pekare till statistiken som skall skrivas ut.
+*                            - ostream: Pekare till angiven utstrm (default = stdout).
+**************************************************************************************************/
+void training_data_print_stats(const struct training_data_stats* stats,
+                               FILE* ostream)
+{
+   const double seconds = stats->seconds > 0 ? stats->seconds : 1e-9;
+   if (!ostream) ostream = stdout;
+   fprintf(ostream, "Loaded %zu rows (%zu rejected, %.1f MB) in %.3f s: %.0f rows/s, %.1f MB/s\n",
+           stats->rows, stats->rejected, stats->bytes / 1e6, stats->seconds,
+           stats->rows / seconds, stats->bytes / 1e6 / seconds);
    return;
+}
+
+/**************************************************************************************************
+* training_data_map: ppnar en binr trningsdatafil skapad via funktionen training_data_save
+*                    och mappar den till minnet, varefter befintlig trningsdata erstts av
+*                    filens uppsttningar. Uppsttningarnas vektorer pekar direkt in i filens
+*                    block, s att talen varken lses in eller kopieras, utan sidorna lses in
+*                    av operativsystemet vid behov och kan delas mellan multipla processer som
+*                    anvnder samma fil. Enbart vektorhuvudena (pekare samt storlek per
+*                    uppsttning) allokeras. Mappningen tas bort nr trningsdatan tms eller
+*                    raderas. Uppsttningarna r skrivskyddade.
+*
+*                    Returnerar 1 ifall filen inte kan ppnas, inte utgr en giltig trningsdatafil,
+*                    har ett annat antal in- eller utsignaler n behllaren, lagrar flyttal av en
+*                    annan typ n real_t eller ifall minnesallokering misslyckas, annars 0.
+*
+*                    - self    : Pekare till trningsdatabehllaren.
+*                    - filepath: Filskvg till den binra trningsdatafilen.
+**************************************************************************************************/
+int training_data_map(struct training_data* self,
+                      const char* filepath)
+{
+   struct file_map map;
+   training_data_clear(self);
+
+   if (file_map_new(&map, filepath, false))
+   {
+      fprintf(stderr, "Could not open file at path %s!\n\n", filepath);
+      return 1;
+   }
+
+   const struct training_data_header* header = (const struct training_data_header*)map.data;
+
+   if (training_data_check(self, header, map.size))
+   {
+      fprintf(stderr, "File %s is not a training data file for %zu inputs, %zu outputs!\n\n",
+              filepath, self->num_inputs, self->num_outputs);
+      file_map_delete(&map);
+      return 1;
+   }
+
+   const size_t rows = (size_t)header->rows;
+   real_t* inputs = (real_t*)(map.data + header->inputs_offset);
+   real_t* outputs = (real_t*)(map.data + header->outputs_offset);
+   self->map = map;
+
+   if (double_2d_vector_resize(&self->in, rows) ||
+       double_2d_vector_resize(&self->out, rows) ||
+       uint_vector_resize(&self->order, rows))
+   {
+      training_data_clear(self);
+      return 1;
+   }
+
+   for (size_t i = 0; i < rows; ++i)
+   {
+      self->in.data[i].data = inputs + i * self->num_inputs;
+      self->in.data[i].size = self->num_inputs;
+      self->in.data[i].capacity = self->num_inputs;
+      self->out.data[i].data = outputs + i * self->num_outputs;
+      self->out.data[i].size = self->num_outputs;
+      self->out.data[i].capacity = self->num_outputs;
+      self->order.data[i] = i;
+   }
+
+   self->sets = rows;
+   return 0;
+}
+
+/**************************************************************************************************
+* training_data_save: Sparar trningsdata lagrad i angiven trningsdatabehllare som en binr
+*                     trningsdatafil p angiven filskvg, se strukten training_data_header.
+*                     Flyttalen lagras som real_t, vilket medfr att filen kan mappas av program
+*                     som anvnder samma flyttalstyp. Returnerar 1 ifall filen inte kan skapas
+*                     eller skrivas, annars 0.
+*
+*                     - self    : Pekare till trningsdatabehllaren.
+*                     - filepath: Filskvg dr den binra trningsdatafilen skall skapas.
+**************************************************************************************************/
+int training_data_save(const struct training_data* self,
+                       const char* filepath)
+{
+   struct training_data_header header = { .magic = TRAINING_DATA_MAGIC };
+   header.version = TRAINING_DATA_VERSION;
+   header.dtype = sizeof(real_t);
+   header.rows = self->sets;
+   header.num_inputs = self->num_inputs;
+   header.num_outputs = self->num_outputs;
+   header.alignment = TRAINING_DATA_ALIGNMENT;
+   header.inputs_offset = align_offset(sizeof(header), header.alignment);
+   header.outputs_offset = align_offset(header.inputs_offset +
+                                        header.rows * header.num_inputs * sizeof(real_t),
+                                        header.alignment);
+
+   FILE* fstream = fopen(filepath, "wb");
+
+   if (!fstream)
+   {
+      fprintf(stderr, "Could not open file at path %s!\n\n", filepath);
+      return 1;
+   }
 
+   const uint64_t inputs_end =
+      header.inputs_offset + header.rows * header.num_inputs * sizeof(real_t);
+   const int status = fwrite(&header, sizeof(header), 1, fstream) != 1 ||
+                      write_padding(header.inputs_offset, sizeof(header), fstream) ||
+                      write_block(&self->in, self->num_inputs, fstream) ||
+                      write_padding(header.outputs_offset, inputs_end, fstream) ||
+                      write_block(&self->out, self->num_outputs, fstream);
+   return fclose(fstream) || status;
+}
+
+/**************************************************************************************************
+* training_data_check: Kontrollerar att angivet huvud tillhr en giltig binr trningsdatafil av
+*                      angiven storlek, med samma antal in- och utsignaler som angiven
+*                      trningsdatabehllare samt flyttal av typen real_t, och att blocken med
+*                      in- och utsignaler r justerade och ryms i filen. Returnerar 1 ifall
+*                      filen r ogiltig, annars 0.
+*
+*                      - self  : Pekare till trningsdatabehllaren.
+*                      - header: Pekare till filens huvud.
+*                      - size  : Filens storlek i byte.
+**************************************************************************************************/
+int training_data_check(const struct training_data* self,
+                        const struct training_data_header* header,
+                        const size_t size)
+{
+   if (size < sizeof(*header) ||
+       memcmp(header->magic, TRAINING_DATA_MAGIC, sizeof(TRAINING_DATA_MAGIC)) ||
+       header->version != TRAINING_DATA_VERSION || header->dtype != sizeof(real_t) ||
+       header->num_inputs != self->num_inputs || header->num_outputs != self->num_outputs ||
+       header->inputs_offset < sizeof(*header) || header->outputs_offset < sizeof(*header) ||
+       header->inputs_offset % sizeof(real_t) || header->outputs_offset % sizeof(real_t))
+   {
+      return 1;
+   }
+
+   const uint64_t max_rows = size / sizeof(real_t);
+   const uint64_t num_inputs = header->num_inputs ? header->num_inputs : 1;
+   const uint64_t num_outputs = header->num_outputs ? header->num_outputs : 1;
+
+   if (header->rows > max_rows / num_inputs || header->rows > max_rows / num_outputs)
+   {
+      return 1;
+   }
+
+   const uint64_t inputs_size = header->rows * header->num_inputs * sizeof(real_t);
+   const uint64_t outputs_size = header->rows * header->num_outputs * sizeof(real_t);
+   return header->inputs_offset > size || inputs_size > size - header->inputs_offset ||
+          header->outputs_offset > size || outputs_size > size - header->outputs_offset;
 }
 
 /**************************************************************************************************
@@ -134,9 +390,6 @@ void training_data_set(struct training_data* self,
 {
    training_data_clear(self);
    self->sets = train_in->size;
-
-   double_2d_vector_resize(&self->in, self->sets);
-   double_2d_vector_resize(&self->out, self->sets);
    uint_vector_resize(&self->order, self->sets);
 
    self->in = *train_in;
@@ -209,80 +462,305 @@ void training_data_print(const struct training_data* self,
 }
 
 /**************************************************************************************************
-* training_data_extract: Extraherar trningsdata ur ett textstycke och lagrar i angiven
-*                        trningsdatabehllare ifall angivet datapunkter verensstmmer med 
-*                        antalet noder i ingngslagret samt utgngslagret p tillhrande neuralt
-*                        ntverk. OBS! Se till att textfilen avslutas med en blank rad, annars 
-*                        sker inte inlsning av sista raden.
+* training_data_unmap: Tar bort mappningen av en binr trningsdatafil i angiven
+*                      trningsdatabehllare, om en sdan finns. Enbart vektorhuvudena frigrs,
+*                      eftersom uppsttningarnas tal tillhr mappningen.
+*
+*                      - self: Pekare till trningsdatabehllaren.
+**************************************************************************************************/
+static void training_data_unmap(struct training_data* self)
+{
+   if (!self->map.data) return;
+   allocator_free(self->in.data);
+   allocator_free(self->out.data);
+   double_2d_vector_new(&self->in);
+   double_2d_vector_new(&self->out);
+   file_map_delete(&self->map);
+   return;
+}
+
+/**************************************************************************************************
+* write_block: Skriver samtliga rader i angiven tvdimensionell vektor till angiven filstrm,
+*              dr angivet antal tal skrivs per rad. Returnerar 1 ifall skrivningen misslyckas,
+*              annars 0.
+*
+*              - rows   : Pekare till vektorn innehllande raderna.
+*              - cols   : Antalet tal som skall skrivas per rad.
+*              - fstream: Pekare till filstrmmen.
+**************************************************************************************************/
+static int write_block(const struct double_2d_vector* rows,
+                       const size_t cols,
+                       FILE* fstream)
+{
+   for (const struct double_vector* i = rows->data; i < rows->data + rows->size; ++i)
+   {
+      if (i->size < cols || fwrite(i->data, sizeof(real_t), cols, fstream) != cols) return 1;
+   }
+   return 0;
+}
+
+/**************************************************************************************************
+* write_padding: Skriver nollor till angiven filstrm frn aktuell position fram till angiven
+*                position. Returnerar 1 ifall skrivningen misslyckas, annars 0.
+*
+*                - offset  : Positionen som skall ns.
+*                - position: Aktuell position i filen.
+*                - fstream : Pekare till filstrmmen.
+**************************************************************************************************/
+static int write_padding(const uint64_t offset,
+                         const uint64_t position,
+                         FILE* fstream)
+{
+   for (uint64_t i = position; i < offset; ++i)
+   {
+      if (fputc(0, fstream) == EOF) return 1;
+   }
+   return 0;
+}
+
+/**************************************************************************************************
+* align_offset: Returnerar angiven position avrundad uppt till nrmaste multipel av angiven
+*               justering.
+*
+*               - offset   : Positionen som skall avrundas.
+*               - alignment: Justeringen i byte.
+**************************************************************************************************/
+static uint64_t align_offset(const uint64_t offset,
+                             const uint64_t alignment)
+{
+   return (offset + alignment - 1) / alignment * alignment;
+}
+
+/**************************************************************************************************
+* training_data_reserve: Skerstller att angiven trningsdatabehllare rymmer angivet antal
+*                        trningsuppsttningar utan omallokering. Returnerar 1 ifall
+*                        minnesallokering misslyckas, annars 0.
+*
+*                        - self    : Pekare till trningsdatabehllaren.
+*                        - capacity: Antalet trningsuppsttningar som skall rymmas.
+**************************************************************************************************/
+static int training_data_reserve(struct training_data* self,
+                                 const size_t capacity)
+{
+   return double_2d_vector_reserve(&self->in, capacity) ||
+          double_2d_vector_reserve(&self->out, capacity) ||
+          uint_vector_reserve(&self->order, capacity);
+}
+
+/**************************************************************************************************
+* training_data_extract: Lagrar en trningsuppsttning i angiven trningsdatabehllare, dr
+*                        insignalerna fljs av utsignalerna i angivet flt. Returnerar 1 ifall
+*                        minnesallokering misslyckas, annars 0.
 * 
-*                        - self: Pekare till trningsdatabehllaren.
-*                        - s   : Pekare till det textstycke som trningsdata skall extraheras ur.
+*                        - self  : Pekare till trningsdatabehllaren.
+*                        - values: Pekare till flt innehllande uppsttningens insignaler samt
+*                                  utsignaler.
 **************************************************************************************************/
-static void training_data_extract(struct training_data* self, 
-                                  const char* s)
+static int training_data_extract(struct training_data* self, 
+                                 const real_t* values)
 {
-   char num_str[20] = { '\0 ' };
-   struct double_vector v = { .data = 0, .size = 0 };
-   size_t index = 0;
-   const size_t datapoints = self->num_inputs + self->num_outputs;
+   struct double_vector in = { .data = 0, .size = 0, .capacity = 0 };
+   struct double_vector out = { .data = 0, .size = 0, .capacity = 0 };
+
+   if (double_vector_resize(&in, self->num_inputs) ||
+       double_vector_resize(&out, self->num_outputs))
+   {
+      double_vector_delete(&in);
+      double_vector_delete(&out);
+      return 1;
+   }
+
+   memcpy(in.data, values, sizeof(real_t) * self->num_inputs);
+   memcpy(out.data, values + self->num_inputs, sizeof(real_t) * self->num_outputs);
 
-   for (const char* i = s; *i; ++i)
+   if (double_2d_vector_push(&self->in, &in) || double_2d_vector_push(&self->out, &out))
    {
-      if (is_digit(*i) || (i == s && *i == '-'))
+      double_vector_delete(&in);
+      double_vector_delete(&out);
+      return 1;
+   }
+
+   uint_vector_push(&self->order, self->sets++);
+   return 0;
+}
+
+/**************************************************************************************************
+* count_lines: Returnerar antalet rader i angivet textstycke, dr en sista rad utan radslut
+*              ocks rknas.
+*
+*              - s  : Pekare till textstyckets frsta tecken.
+*              - end: Pekare direkt efter textstyckets sista tecken.
+**************************************************************************************************/
+static size_t count_lines(const char* s,
+                          const char* end)
+{
+   size_t count = 0;
+
+   while (s < end)
+   {
+      const char* line_end = (const char*)memchr(s, '\n', (size_t)(end - s));
+      if (!line_end) return count + 1;
+      s = line_end + 1;
+      count++;
+   }
+   return count;
+}
+
+/**************************************************************************************************
+* parse_line: Tolkar talen p en rad och lagrar dem i angivet flt. Returnerar antalet tal p
+*             raden, vilket r 0 fr en tom rad. Ifall raden innehller ett ogiltigt tal eller
+*             fler tal n fltet rymmer returneras ett tal skiljt frn angivet max.
+*
+*             - s     : Pekare till radens frsta tecken.
+*             - end   : Pekare till radens slut (radslutet eller slutet p filen).
+*             - values: Pekare till flt dr talen skall lagras.
+*             - max   : Antalet tal som fltet rymmer.
+**************************************************************************************************/
+static size_t parse_line(const char* s,
+                         const char* end,
+                         real_t* values,
+                         const size_t max)
+{
+   size_t count = 0;
+
+   while (true)
+   {
+      while (s < end && is_separator(*s)) s++;
+      if (s == end) return count;
+      if (count == max) return max + 1;
+
+      s = parse_number(s, end, &values[count++]);
+      if (!s || (s < end && !is_separator(*s))) return max + 1;
+   }
+}
+
+/**************************************************************************************************
+* parse_number: Tolkar ett flyttal med valfritt tecken, decimaler samt exponent och returnerar
+*               en pekare direkt efter talet, eller null ifall inget giltigt tal finns. Upp till
+*               19 signifikanta siffror samlas i ett heltal, som sedan skalas med en exakt
+*               tiopotens, vilket ger ett korrekt avrundat resultat s lnge heltalet ryms i
+*               mantissan och exponenten r hgst 22. vriga tal tolkas via strtod. Tal som
+*               inte ryms i real_t, exempelvis 1e400, rknas som ogiltiga.
+*
+*               - s    : Pekare till talets frsta tecken.
+*               - end  : Pekare till slutet p textstycket som talet ingr i.
+*               - value: Pekare till variabel dr talet skall lagras.
+**************************************************************************************************/
+static const char* parse_number(const char* s,
+                                const char* end,
+                                real_t* value)
+{
+   static const double powers[] = { 1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                    1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                    1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+   const char* begin = s;
+   uint64_t mantissa = 0;
+   size_t num_digits = 0;
+   long exponent = 0;
+   bool digits = false;
+   bool exact = true;
+   const bool negative = s < end && *s == '-';
+   if (s < end && (*s == '-' || *s == '+')) s++;
+
+   for (; s < end && is_digit(*s); ++s, digits = true)
+   {
+      if (num_digits < 19)
       {
-         num_str[index++] = *i;
+         mantissa = mantissa * 10 + (uint64_t)(*s - '0');
+         if (mantissa) num_digits++;
       }
       else
       {
-         num_str[index] = '\0';
-         const double number = atof(num_str);
-         double_vector_push(&v, number);
-         index = 0;
+         exponent++;
+         exact = false;
       }
    }
 
-   if (v.data && v.size == datapoints)
+   if (s < end && *s == '.')
    {
-      struct double_vector in = { .data = 0, .size = 0 };
-      struct double_vector out = { .data = 0, .size = 0 };
-      double_vector_resize(&in, self->num_inputs);
-      double_vector_resize(&out, self->num_outputs);
-
-      for (size_t i = 0; i < self->num_inputs; ++i)
+      for (++s; s < end && is_digit(*s); ++s, digits = true)
       {
-         in.data[i] = v.data[i];
+         if (num_digits < 19)
+         {
+            mantissa = mantissa * 10 + (uint64_t)(*s - '0');
+            if (mantissa) num_digits++;
+            exponent--;
+         }
+         else
+         {
+            exact = false;
+         }
       }
-      for (size_t i = 0; i < self->num_outputs; ++i)
+   }
+
+   if (!digits) return 0;
+
+   if (s < end && (*s == 'e' || *s == 'E'))
+   {
+      const char* e = s + 1;
+      const bool negative_exponent = e < end && *e == '-';
+      long value = 0;
+      if (e < end && (*e == '-' || *e == '+')) e++;
+
+      if (e < end && is_digit(*e))
       {
-         out.data[i] = v.data[i + self->num_inputs];
+         for (; e < end && is_digit(*e); ++e)
+         {
+            if (value < 100000) value = value * 10 + (*e - '0');
+         }
+
+         exponent += negative_exponent ? -value : value;
+         s = e;
       }
+   }
 
-      double_2d_vector_push(&self->in, &in);
-      double_2d_vector_push(&self->out, &out);
-      uint_vector_push(&self->order, self->sets++);
+   if (exact && mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22)
+   {
+      const double number = exponent < 0 ? mantissa / powers[-exponent] :
+                                           mantissa * powers[exponent];
+      *value = (real_t)(negative ? -number : number);
    }
    else
    {
-      fprintf(stderr, "Could not extract %zu datapoints out of current line!\n\n", datapoints);
+      char buffer[128];
+      const size_t length = (size_t)(s - begin);
+      if (length >= sizeof(buffer)) return 0;
+      memcpy(buffer, begin, length);
+      buffer[length] = '\0';
+      *value = (real_t)strtod(buffer, 0);
    }
-
-   double_vector_clear(&v);
-   return;
+   return isfinite(*value) ? s : 0;
 }
 
 /**************************************************************************************************
-* is_digit: Indikerar ifall angivet tecken utgr en siffra eller ett decimaltecken (punkt).
+* is_digit: Indikerar ifall angivet tecken utgr en siffra.
 * 
 *           - c: Det tecken som skall kontrolleras.
 **************************************************************************************************/
-static bool is_digit(const char c)
+static inline bool is_digit(const char c)
 {
-   const char* s = "0123456789.";
-   for (const char* i = s; *i; ++i)
-   {
-      if (c == *i) return true;
-   }
-   return false;
+   return c >= '0' && c <= '9';
+}
+
+/**************************************************************************************************
+* is_separator: Indikerar ifall angivet tecken separerar tv tal p en rad, vilket gller fr
+*               blanksteg, tabbar, kommatecken, semikolon samt vagnreturer (vid CRLF).
+*
+*               - c: Det tecken som skall kontrolleras.
+**************************************************************************************************/
+static inline bool is_separator(const char c)
+{
+   return c == ' ' || c == '\t' || c == ',' || c == ';' || c == '\r';
+}
+
+/**************************************************************************************************
+* get_time: Returnerar aktuell tid i sekunder.
+**************************************************************************************************/
+static double get_time(void)
+{
+   struct timespec time;
+   timespec_get(&time, TIME_UTC);
+   return time.tv_sec + time.tv_nsec * 1e-9;
 }
 
 /**************************************************************************************************
@@ -291,9 +769,9 @@ static bool is_digit(const char c)
 *             - self   : Pekare till vektorn innehllande flyttalen som skall skrivas ut.
 *             - ostream: Pekare till angiven utstrm.
 **************************************************************************************************/
-static void print_line(const double* data, const size_t size, FILE* stream)
+static void print_line(const real_t* data, const size_t size, FILE* stream)
 {
-   for (const double* i = data; i < data + size; ++i)
+   for (const real_t* i = data; i < data + size; ++i)
    {
       fprintf(stream, "%g ", *i);
    }
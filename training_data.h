@@ -11,6 +11,12 @@
 #include "def.h"
 #include "double_2d_vector.h"
 #include "uint_vector.h"
+#include "file_map.h"
+
+/* Makrodefinitioner: */
+#define TRAINING_DATA_MAGIC "ANNDATA"   /* Inledande tecken i binra trningsdatafiler. */
+#define TRAINING_DATA_VERSION 1         /* Aktuell version av det binra filformatet. */
+#define TRAINING_DATA_ALIGNMENT 64      /* Justering i byte fr blocken i binra filer. */
 
 /**************************************************************************************************
 * training_data: Strukt fr lagring av trningsuppsttningar samt deras index fr randomisering
@@ -24,6 +30,39 @@ struct training_data
    size_t sets;                 /* Antalet trningsuppsttningar. */
    size_t num_inputs;           /* Antalet insignaler i ntverket. */
    size_t num_outputs;          /* Antalet utsignaler i ntverket. */
+   struct file_map map;         /* Mappad binrfil som uppsttningarna pekar in i (eller tom). */
+};
+
+/**************************************************************************************************
+* training_data_header: Inledande huvud i binra trningsdatafiler, vilka skapas via funktionen
+*                       training_data_save och ppnas via funktionen training_data_map. Efter
+*                       huvudet fljer samtliga uppsttningars insignaler som ett sammanhngande
+*                       block, rad fr rad, och drefter utsignalerna som ett eget block. Bda
+*                       blocken brjar p en multipel av angiven justering rknat frn filens
+*                       brjan. Samtliga tal lagras i maskinens byteordning.
+**************************************************************************************************/
+struct training_data_header
+{
+   char magic[8];           /* Filformatets identifierare, TRAINING_DATA_MAGIC. */
+   uint32_t version;        /* Filformatets version, TRAINING_DATA_VERSION. */
+   uint32_t dtype;          /* Storleken i byte p varje flyttal (8 = double, 4 = float). */
+   uint64_t rows;           /* Antalet trningsuppsttningar. */
+   uint64_t num_inputs;     /* Antalet insignaler per uppsttning. */
+   uint64_t num_outputs;    /* Antalet utsignaler per uppsttning. */
+   uint64_t alignment;      /* Justering i byte fr blocken med in- och utsignaler. */
+   uint64_t inputs_offset;  /* Position i byte fr blocket med insignaler. */
+   uint64_t outputs_offset; /* Position i byte fr blocket med utsignaler. */
+};
+
+/**************************************************************************************************
+* training_data_stats: Statistik fr en inlsning av trningsdata frn en fil.
+**************************************************************************************************/
+struct training_data_stats
+{
+   size_t rows;     /* Antalet inlsta trningsuppsttningar. */
+   size_t rejected; /* Antalet rader som inte kunde tolkas och drmed ignorerades. */
+   size_t bytes;    /* Filens storlek i byte. */
+   double seconds;  /* Inlsningens tidstgng i sekunder. */
 };
 
 /* Externa funktioner: */
@@ -37,6 +76,18 @@ void training_data_ptr_delete(struct training_data** self);
 void training_data_clear(struct training_data* self);
 void training_data_load(struct training_data* self,
                         const char* filepath);
+int training_data_load_stats(struct training_data* self,
+                             const char* filepath,
+                             struct training_data_stats* stats);
+void training_data_print_stats(const struct training_data_stats* stats,
+                               FILE* ostream);
+int training_data_map(struct training_data* self,
+                      const char* filepath);
+int training_data_save(const struct training_data* self,
+                       const char* filepath);
+int training_data_check(const struct training_data* self,
+                        const struct training_data_header* header,
+                        const size_t size);
 void training_data_set(struct training_data* self, 
                        const struct double_2d_vector* train_in, 
                        const struct double_2d_vector* train_out);
@@ -3,6 +3,7 @@
 *                endimensionella vektorer innehllande osignerade heltal.
 **************************************************************************************************/
 #include "uint_vector.h"
+#include "allocator.h"
 
 /**************************************************************************************************
 * uint_vector_new: Initierar angiven vektor.
@@ -13,6 +14,7 @@ void uint_vector_new(struct uint_vector* self)
 {
    self->data = 0;
    self->size = 0;
+   self->capacity = 0;
    return;
 }
 
@@ -23,9 +25,10 @@ void uint_vector_new(struct uint_vector* self)
 **************************************************************************************************/
 void uint_vector_delete(struct uint_vector* self)
 {
-   free(self->data);
+   allocator_free(self->data);
    self->data = 0;
    self->size = 0;
+   self->capacity = 0;
    return;
 }
 
@@ -36,10 +39,11 @@ void uint_vector_delete(struct uint_vector* self)
 **************************************************************************************************/
 struct uint_vector* uint_vector_ptr_new(const size_t size)
 {
-   struct uint_vector* self = (struct uint_vector*)malloc(sizeof(struct uint_vector));
+   struct uint_vector* self = (struct uint_vector*)allocator_alloc(sizeof(struct uint_vector));
    if (!self) return 0;
    self->data = 0;
    self->size = 0;
+   self->capacity = 0;
    uint_vector_resize(self, size);
    return self;
 }
@@ -54,29 +58,31 @@ struct uint_vector* uint_vector_ptr_new(const size_t size)
 void uint_vector_ptr_delete(struct uint_vector** self)
 {
    uint_vector_delete(*self);
-   free(*self);
+   allocator_free(*self);
    *self = 0;
    return;
 }
 
 /**************************************************************************************************
-* uint_vector_resize: ndrar storleken / kapaciteten p angiven vektor via omallokering.
+* uint_vector_resize: ndrar storleken p angiven vektor. Vid behov utkas kapaciteten till exakt
+*                     den nya storleken, men kapaciteten minskas aldrig (se funktionen
+*                     uint_vector_shrink_to_fit).
 *
 *                     - self    : Pekare till vektorn.
-*                     - new_size: Vektorns nya storlek efter omallokeringen.
+*                     - new_size: Vektorns nya storlek.
 **************************************************************************************************/
 int uint_vector_resize(struct uint_vector* self, 
                        const size_t new_size)
 {
-   size_t* copy = (size_t*)realloc(self->data, sizeof(size_t) * new_size);
-   if (!copy) return 1;
-   self->data = copy;
+   if (new_size > self->capacity && uint_vector_reserve(self, new_size)) return 1;
    self->size = new_size;
    return 0;
 }
 
 /**************************************************************************************************
-* uint_vector_push: Lgger till ett nytt element lngst bak i angiven vektor.
+* uint_vector_push: Lgger till ett nytt element lngst bak i angiven vektor. Ifall fltet r fullt
+*                   frdubblas kapaciteten, vilket medfr att N element kan lggas till med ett
+*                   ftal omallokeringar i stllet fr en per element.
 *
 *                   - self       : Pekare till vektorn.
 *                   - new_element: Det nya element som skall lggas till.
@@ -84,10 +90,9 @@ int uint_vector_resize(struct uint_vector* self,
 int uint_vector_push(struct uint_vector* self,  
                      const size_t new_element)
 {
-   size_t* copy = (size_t*)realloc(self->data, sizeof(size_t) * (self->size + 1));
-   if (!copy) return 1;
-   copy[self->size++] = new_element;
-   self->data = copy;
+   if (self->size == self->capacity &&
+       uint_vector_reserve(self, self->capacity ? self->capacity * 2 : 1)) return 1;
+   self->data[self->size++] = new_element;
    return 0;
 }
 
@@ -105,14 +110,60 @@ int uint_vector_pop(struct uint_vector* self)
    }
    else
    {
-      size_t* copy = (size_t*)realloc(self->data, sizeof(size_t) * (self->size - 1));
-      if (!copy) return 1;
-      self->data = copy;
       self->size--;
       return 0;
    }
 }
 
+/**************************************************************************************************
+* uint_vector_reserve: Skerstller att angiven vektor rymmer minst angivet antal element utan
+*                      omallokering, exempelvis infr inlsning av ett knt antal element. Vektorns
+*                      storlek pverkas inte. Returnerar 1 ifall minnesallokering misslyckas,
+*                      annars 0.
+*
+*                      - self    : Pekare till vektorn.
+*                      - capacity: Antalet element som skall rymmas.
+**************************************************************************************************/
+int uint_vector_reserve(struct uint_vector* self,
+                        const size_t capacity)
+{
+   if (capacity <= self->capacity) return 0;
+   size_t* copy = (size_t*)allocator_realloc(self->data,
+      sizeof(size_t) * self->capacity, sizeof(size_t) * capacity);
+   if (!copy) return 1;
+   self->data = copy;
+   self->capacity = capacity;
+   return 0;
+}
+
+/**************************************************************************************************
+* uint_vector_shrink_to_fit: Minskar kapaciteten fr angiven vektor till dess storlek, s att
+*                            verskottet frn tidigare tillvxt frigrs. Returnerar 1 ifall
+*                            minnesallokering misslyckas, varvid vektorn behlls ofrndrad, annars
+*                            0.
+*
+*                            - self: Pekare till vektorn.
+**************************************************************************************************/
+int uint_vector_shrink_to_fit(struct uint_vector* self)
+{
+   if (self->size == self->capacity) return 0;
+
+   if (!self->size)
+   {
+      allocator_free(self->data);
+      self->data = 0;
+      self->capacity = 0;
+      return 0;
+   }
+
+   size_t* copy = (size_t*)allocator_realloc(self->data,
+      sizeof(size_t) * self->capacity, sizeof(size_t) * self->size);
+   if (!copy) return 1;
+   self->data = copy;
+   self->capacity = self->size;
+   return 0;
+}
+
 /**************************************************************************************************
 * uint_vector_print: Skriver ut innehll lagrat i angiven vektor via angiven utstrm, dr
 *                    standardutenheten stdout anvnds som default fr utskrift i terminalen.